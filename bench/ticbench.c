@@ -0,0 +1,332 @@
+// ticbench: Measures how fast the parts of libpololu-tic that do not talk to
+// a device run, so changes that slow them down can be noticed without
+// hardware.
+//
+// Usage: ticbench [-t MILLISECONDS] [-f FILTER] [CORPUS_DIR]
+//
+// Each benchmark runs for at least the given time (default 200 ms) and prints
+// a line with its name, the number of operations, the time per operation,
+// and the number of memory allocations per operation.  Only benchmarks whose
+// names contain FILTER are run.  The settings files in the default_settings
+// and test_settings1 directories of CORPUS_DIR (default: the spec directory
+// of the source tree) are used as inputs.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <tic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Counting allocations requires replacing malloc, which we only know how to
+// do with glibc.
+#ifdef __GLIBC__
+#define COUNT_ALLOCATIONS
+#endif
+
+#ifdef COUNT_ALLOCATIONS
+
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t count, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+
+static size_t allocation_count;
+
+void * malloc(size_t size)
+{
+  allocation_count++;
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size)
+{
+  allocation_count++;
+  return __libc_calloc(count, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+  allocation_count++;
+  return __libc_realloc(ptr, size);
+}
+
+#endif
+
+static const char * product_names[] = {
+  "t825", "t834", "t500", "n825", "t249", "36v4",
+};
+
+static const uint8_t products[] = {
+  TIC_PRODUCT_T825, TIC_PRODUCT_T834, TIC_PRODUCT_T500,
+  TIC_PRODUCT_N825, TIC_PRODUCT_T249, TIC_PRODUCT_36V4,
+};
+
+#define PRODUCT_COUNT (sizeof(products) / sizeof(products[0]))
+
+static const char * corpus_names[] = { "default_settings", "test_settings1" };
+
+#define CORPUS_COUNT (sizeof(corpus_names) / sizeof(corpus_names[0]))
+
+static int64_t clock_ns(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER frequency, count;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return (int64_t)(count.QuadPart / frequency.QuadPart * 1000000000 +
+    count.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void check(tic_error * error)
+{
+  if (error != NULL)
+  {
+    fprintf(stderr, "Error: %s\n", tic_error_get_message(error));
+    exit(1);
+  }
+}
+
+static char * read_file(const char * filename)
+{
+  FILE * file = fopen(filename, "rb");
+  if (file == NULL)
+  {
+    fprintf(stderr, "Error: Failed to open %s.\n", filename);
+    exit(1);
+  }
+
+  size_t capacity = 4096, size = 0;
+  char * data = malloc(capacity);
+  while (data != NULL)
+  {
+    size += fread(data + size, 1, capacity - size - 1, file);
+    if (size < capacity - 1) { break; }
+    capacity *= 2;
+    data = realloc(data, capacity);
+  }
+  fclose(file);
+
+  if (data == NULL)
+  {
+    fprintf(stderr, "Error: Out of memory.\n");
+    exit(1);
+  }
+  data[size] = 0;
+  return data;
+}
+
+// The inputs for the benchmarks that work on one settings file.
+typedef struct settings_case
+{
+  const char * string;
+  tic_settings * settings;
+} settings_case;
+
+// The inputs for the benchmarks that work on many codes at once.
+typedef struct code_case
+{
+  uint8_t product;
+  uint32_t next;
+  uint8_t buffer[256];
+} code_case;
+
+static uint32_t time_limit_ms = 200;
+static const char * filter = "";
+
+// Runs the operation repeatedly, doubling the number of runs until they take
+// long enough to measure, and prints the results.
+static void run(const char * name, void (*op)(void *), void * context)
+{
+  if (strstr(name, filter) == NULL) { return; }
+
+  uint64_t count = 1;
+  int64_t elapsed_ns;
+  size_t allocations = 0;
+  while (1)
+  {
+#ifdef COUNT_ALLOCATIONS
+    size_t allocations_start = allocation_count;
+#endif
+    int64_t start_ns = clock_ns();
+    for (uint64_t i = 0; i < count; i++) { op(context); }
+    elapsed_ns = clock_ns() - start_ns;
+#ifdef COUNT_ALLOCATIONS
+    allocations = allocation_count - allocations_start;
+#endif
+
+    if (elapsed_ns >= (int64_t)time_limit_ms * 1000000) { break; }
+    count *= 2;
+  }
+
+  printf("%-40s %10llu %12.1f ns/op", name, (unsigned long long)count,
+    (double)elapsed_ns / count);
+#ifdef COUNT_ALLOCATIONS
+  printf(" %8.1f allocs/op", (double)allocations / count);
+#else
+  (void)allocations;
+  printf(" %8s allocs/op", "-");
+#endif
+  printf("\n");
+  fflush(stdout);
+}
+
+static void read_from_string_op(void * context)
+{
+  settings_case * c = context;
+  tic_settings * settings = NULL;
+  check(tic_settings_read_from_string(c->string, &settings));
+  tic_settings_free(settings);
+}
+
+static void to_string_op(void * context)
+{
+  settings_case * c = context;
+  char * string = NULL;
+  check(tic_settings_to_string(c->settings, &string));
+  tic_string_free(string);
+}
+
+static void fix_op(void * context)
+{
+  settings_case * c = context;
+  char * warnings = NULL;
+  check(tic_settings_fix(c->settings, &warnings));
+  tic_string_free(warnings);
+}
+
+static void copy_op(void * context)
+{
+  settings_case * c = context;
+  tic_settings * copy = NULL;
+  check(tic_settings_copy(c->settings, &copy));
+  tic_settings_free(copy);
+}
+
+static void variables_decode_op(void * context)
+{
+  code_case * c = context;
+  tic_variables * variables = NULL;
+  check(tic_variables_decode(c->buffer, c->product, &variables));
+  tic_variables_free(variables);
+}
+
+// Looks up the names the GUI and ticcmd show for one set of variables.
+static void names_op(void * context)
+{
+  code_case * c = context;
+  uint8_t code = c->next++;
+  const char * name;
+  volatile size_t sink = 0;
+  sink += (size_t)tic_look_up_product_name_ui(c->product);
+  sink += (size_t)tic_look_up_error_name_ui(1 << (code % 32));
+  sink += (size_t)tic_look_up_input_state_name_ui(code);
+  sink += (size_t)tic_look_up_device_reset_name_ui(code);
+  sink += (size_t)tic_look_up_operation_state_name_ui(code);
+  sink += (size_t)tic_look_up_step_mode_name_ui(code);
+  sink += (size_t)tic_look_up_pin_state_name_ui(code);
+  sink += (size_t)tic_look_up_planning_mode_name_ui(code);
+  sink += (size_t)tic_look_up_command_name_ui(code);
+  sink += tic_look_up_decay_mode_name(code, c->product, TIC_NAME_UI, &name);
+  uint8_t decay_mode;
+  sink += tic_look_up_decay_mode_code("mixed", c->product,
+    TIC_NAME_UI | TIC_NAME_SNAKE_CASE, &decay_mode);
+  (void)sink;
+}
+
+static void current_limit_op(void * context)
+{
+  code_case * c = context;
+  uint32_t n = c->next++;
+  volatile uint32_t sink = 0;
+  sink += tic_current_limit_code_to_ma(c->product, n & 0xFF);
+  sink += tic_current_limit_ma_to_code(c->product, n % 10000);
+  (void)sink;
+}
+
+int main(int argc, char ** argv)
+{
+  const char * corpus_dir = TIC_BENCH_CORPUS_DIR;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+    {
+      time_limit_ms = strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+    {
+      filter = argv[++i];
+    }
+    else if (argv[i][0] != '-')
+    {
+      corpus_dir = argv[i];
+    }
+    else
+    {
+      fprintf(stderr, "Usage: ticbench [-t MILLISECONDS] [-f FILTER] [CORPUS_DIR]\n");
+      return 1;
+    }
+  }
+
+  char name[256];
+
+  for (size_t c = 0; c < CORPUS_COUNT; c++)
+  {
+    for (size_t p = 0; p < PRODUCT_COUNT; p++)
+    {
+      char filename[1024];
+      snprintf(filename, sizeof(filename), "%s/%s/%s.txt",
+        corpus_dir, corpus_names[c], product_names[p]);
+
+      settings_case sc = { 0 };
+      sc.string = read_file(filename);
+      check(tic_settings_read_from_string(sc.string, &sc.settings));
+
+      const char * corpus = corpus_names[c];
+      const char * product = product_names[p];
+
+      snprintf(name, sizeof(name), "read_from_string/%s/%s", corpus, product);
+      run(name, read_from_string_op, &sc);
+      snprintf(name, sizeof(name), "to_string/%s/%s", corpus, product);
+      run(name, to_string_op, &sc);
+      snprintf(name, sizeof(name), "fix/%s/%s", corpus, product);
+      run(name, fix_op, &sc);
+      snprintf(name, sizeof(name), "copy/%s/%s", corpus, product);
+      run(name, copy_op, &sc);
+
+      tic_settings_free(sc.settings);
+      free((char *)sc.string);
+    }
+  }
+
+  for (size_t p = 0; p < PRODUCT_COUNT; p++)
+  {
+    code_case cc = { 0 };
+    cc.product = products[p];
+    for (size_t i = 0; i < sizeof(cc.buffer); i++)
+    {
+      cc.buffer[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    const char * product = product_names[p];
+
+    snprintf(name, sizeof(name), "variables_decode/%s", product);
+    run(name, variables_decode_op, &cc);
+    snprintf(name, sizeof(name), "names/%s", product);
+    run(name, names_op, &cc);
+    snprintf(name, sizeof(name), "current_limit/%s", product);
+    run(name, current_limit_op, &cc);
+  }
+
+  return 0;
+}
@@ -8,7 +8,13 @@
 // and remove features we don't need.
 
 #include "bootloader.h"
+#include "device_scanner.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <cstring>
+#include <map>
+#include <thread>
 
 // Request codes used to talk to the bootloader.
 #define REQUEST_INITIALIZE         0x80
@@ -40,6 +46,9 @@
 // Other bootloader constants
 #define DEVICE_CODE_SIZE           16
 
+// How often bootloader_wait_for_device() checks the list of USB devices.
+static const uint32_t WAIT_POLL_INTERVAL_MS = 20;
+
 static std::string bootloader_get_error_description(uint8_t error_code)
 {
   switch (error_code)
@@ -74,40 +83,45 @@ const bootloader_type * bootloader_type_lookup(
 
 std::vector<bootloader_instance> bootloader_list_connected_devices()
 {
-  // Get a list of all connected USB devices.
-  std::vector<libusbp::device> devices = libusbp::list_connected_devices();
-
-  std::vector<bootloader_instance> list;
+  return scan_connected_devices().bootloaders;
+}
 
-  for (const libusbp::device & device : devices)
+// Returns the mode that the device with the specified serial number is in
+// according to the scan, or 0 if it was not found.
+static uint8_t device_mode(const device_scan_result & scan,
+  const std::string & serial_number)
+{
+  for (const bootloader_instance & instance : scan.bootloaders)
   {
-    // Filter out things that are not bootloaders.
-    const bootloader_type * type = bootloader_type_lookup(
-      device.get_vendor_id(), device.get_product_id());
-    if (!type) { continue; }
-
-    // Get the generic interface object for interface 0.
-    libusbp::generic_interface usb_interface;
-    try
+    if (instance.get_serial_number() == serial_number)
     {
-      usb_interface = libusbp::generic_interface(device);
+      return DEVICE_MODE_BOOTLOADER;
     }
-    catch(const libusbp::error & error)
+  }
+  for (const tic::device & device : scan.app_devices)
+  {
+    if (device.get_serial_number() == serial_number)
     {
-      if (error.has_code(LIBUSBP_ERROR_NOT_READY))
-      {
-        // This interface is not ready to be used yet.
-        // This is normal if it was recently enumerated.
-        continue;
-      }
-      throw;
+      return DEVICE_MODE_APP;
     }
-
-    bootloader_instance instance(*type, usb_interface, device.get_serial_number());
-    list.push_back(instance);
   }
+  return 0;
+}
 
-  return list;
+uint8_t bootloader_wait_for_device(const std::string & serial_number,
+  uint8_t modes, std::chrono::steady_clock::time_point deadline)
+{
+  while (true)
+  {
+    uint8_t mode = device_mode(scan_connected_devices(), serial_number);
+    if (mode & modes) { return mode; }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) { return 0; }
+
+    auto next_check = now + std::chrono::milliseconds(WAIT_POLL_INTERVAL_MS);
+    std::this_thread::sleep_until(std::min(next_check, deadline));
+  }
 }
 
 bootloader_handle::bootloader_handle(bootloader_instance instance)
@@ -193,8 +207,65 @@ void bootloader_handle::restart_device()
   }
 }
 
+// Arranges the data from the blocks of an image into blocks that are aligned
+// to the write block size, in order of increasing address.  Blocks from the
+// image that are adjacent or share a write block are combined, and any bytes
+// not covered by the image are set to 0xFF.  Write blocks that would only
+// contain 0xFF are left out because erasing flash already sets them to that
+// value; skipped_count is set to the number of those.
+static std::vector<firmware_archive::block> plan_flash_writes(
+  const std::vector<firmware_archive::block> & blocks,
+  uint16_t write_block_size, uint32_t & skipped_count)
+{
+  assert(write_block_size != 0);
+
+  std::map<uint32_t, std::vector<uint8_t>> pages;
+  for (const firmware_archive::block & block : blocks)
+  {
+    for (size_t i = 0; i < block.data.size(); i++)
+    {
+      uint32_t address = block.address + i;
+      uint32_t page_address = address - address % write_block_size;
+      std::vector<uint8_t> & page = pages[page_address];
+      if (page.empty())
+      {
+        page.resize(write_block_size, 0xFF);
+      }
+      page[address - page_address] = block.data[i];
+    }
+  }
+
+  std::vector<firmware_archive::block> writes;
+  skipped_count = 0;
+  for (auto & page : pages)
+  {
+    bool blank = true;
+    for (uint8_t byte : page.second)
+    {
+      if (byte != 0xFF) { blank = false; break; }
+    }
+
+    if (blank)
+    {
+      skipped_count++;
+      continue;
+    }
+
+    firmware_archive::block write;
+    write.address = page.first;
+    write.data = std::move(page.second);
+    writes.push_back(std::move(write));
+  }
+  return writes;
+}
+
 void bootloader_handle::apply_image(const firmware_archive::image & image)
 {
+  write_stats = bootloader_write_stats();
+
+  std::vector<firmware_archive::block> writes = plan_flash_writes(
+    image.blocks, type.write_block_size, write_stats.blocks_skipped);
+
   initialize(image.upload_type);
 
   erase_flash();
@@ -204,17 +275,25 @@ void bootloader_handle::apply_image(const firmware_archive::image & image)
   // from an older version of the firmware.
   erase_eeprom_first_byte();
 
+  auto start_time = std::chrono::steady_clock::now();
+
   size_t progress = 0;
-  for (const firmware_archive::block & block : image.blocks)
+  for (const firmware_archive::block & block : writes)
   {
     write_flash_block(block.address, &block.data[0], block.data.size());
+    write_stats.blocks_written++;
+    write_stats.bytes_written += block.data.size();
 
     if (listener)
     {
       progress++;
-      listener->set_status("Writing flash...", progress, image.blocks.size());
+      listener->set_status("Writing flash...", progress, writes.size());
     }
   }
+
+  write_stats.write_time_us =
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
 }
 
 void bootloader_handle::write_flash_block(uint32_t address,
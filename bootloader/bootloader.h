@@ -2,6 +2,7 @@
 
 #include "firmware_archive.h"
 #include <libusbp.hpp>
+#include <chrono>
 #include <vector>
 
 typedef std::vector<uint8_t> memory_image;
@@ -10,6 +11,10 @@ typedef std::vector<uint8_t> memory_image;
 #define UPLOAD_TYPE_DEVICE_SPECIFIC 1
 #define UPLOAD_TYPE_PLAIN 2
 
+// Modes that can be passed to bootloader_wait_for_device().
+#define DEVICE_MODE_BOOTLOADER 1
+#define DEVICE_MODE_APP 2
+
 // Represents a type of bootloader.
 class bootloader_type
 {
@@ -110,6 +115,44 @@ public:
 // computer.
 std::vector<bootloader_instance> bootloader_list_connected_devices();
 
+// Waits until a Tic with the specified serial number is connected in one of
+// the specified modes (a combination of the DEVICE_MODE_* flags), or until the
+// deadline passes.  Returns the mode the device was found in, or 0 if the
+// deadline passed.
+//
+// This is meant to be used right after sending a command that makes a device
+// restart (e.g. to enter or leave its bootloader).  libusbp does not provide
+// notifications when devices are connected, so this scans the USB devices
+// frequently with scan_connected_devices().  That is much cheaper than opening
+// the device, so this returns within a few tens of milliseconds of the device
+// appearing.
+uint8_t bootloader_wait_for_device(const std::string & serial_number,
+  uint8_t modes, std::chrono::steady_clock::time_point deadline);
+
+// Information about the flash writes done by bootloader_handle::apply_image().
+class bootloader_write_stats
+{
+public:
+  // The number of flash blocks written.
+  uint32_t blocks_written = 0;
+
+  // The number of flash blocks that were not written because they only
+  // contained 0xFF, which is what erasing flash sets them to.
+  uint32_t blocks_skipped = 0;
+
+  uint32_t bytes_written = 0;
+
+  // The time spent writing flash, in microseconds.
+  uint64_t write_time_us = 0;
+
+  // Returns the average number of bytes written per second.
+  double get_bytes_per_second() const
+  {
+    if (write_time_us == 0) { return 0; }
+    return bytes_written * 1000000.0 / write_time_us;
+  }
+};
+
 class bootloder_status_listener
 {
 public:
@@ -146,6 +189,13 @@ public:
   // image to the device
   void apply_image(const firmware_archive::image & image);
 
+  // Returns information about the flash writes done by the last call to
+  // apply_image().
+  const bootloader_write_stats & get_write_stats() const
+  {
+    return write_stats;
+  }
+
   void set_status_listener(bootloder_status_listener * listener)
   {
     this->listener = listener;
@@ -161,7 +211,9 @@ private:
   void report_error(const libusbp::error & error, const std::string & context)
     __attribute__((noreturn));
 
-  bootloder_status_listener * listener;
+  bootloder_status_listener * listener = NULL;
+
+  bootloader_write_stats write_stats;
 
   libusbp::generic_handle handle;
 };
@@ -0,0 +1,88 @@
+// Code for finding Tics and bootloaders with a single pass over the USB
+// devices.
+
+#include "device_scanner.h"
+#include <tic_usb.h>
+
+#define USB_VENDOR_ID_POLOLU 0x1FFB
+
+device_scan_result device_scanner::scan()
+{
+  std::vector<libusbp::device> devices = libusbp::list_connected_devices();
+
+  device_scan_result result;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // The cache entries for the devices we find in this scan.  This replaces
+  // the cache at the end so that devices that went away are forgotten.
+  std::map<std::string, cache_entry> seen;
+
+  for (const libusbp::device & device : devices)
+  {
+    uint16_t vendor_id = device.get_vendor_id();
+    if (vendor_id != USB_VENDOR_ID_POLOLU) { continue; }
+
+    uint16_t product_id = device.get_product_id();
+    uint16_t revision = device.get_revision();
+    std::string os_id = device.get_os_id();
+
+    const cache_entry * cached = NULL;
+    auto it = cache.find(os_id);
+    if (it != cache.end() && it->second.vendor_id == vendor_id &&
+      it->second.product_id == product_id && it->second.revision == revision)
+    {
+      cached = &it->second;
+    }
+
+    std::string serial_number;
+
+    const bootloader_type * type = bootloader_type_lookup(vendor_id, product_id);
+    if (type)
+    {
+      libusbp::generic_interface usb_interface;
+      try
+      {
+        usb_interface = libusbp::generic_interface(device);
+      }
+      catch (const libusbp::error & error)
+      {
+        if (error.has_code(LIBUSBP_ERROR_NOT_READY))
+        {
+          // This interface is not ready to be used yet.
+          // This is normal if it was recently enumerated.
+          continue;
+        }
+        throw;
+      }
+
+      serial_number = cached ? cached->serial_number : device.get_serial_number();
+      result.bootloaders.push_back(
+        bootloader_instance(*type, usb_interface, serial_number));
+    }
+    else
+    {
+      // libpololu-tic decides whether this is a Tic that is ready to use, and
+      // only reads the serial number if it is one and we don't know it yet.
+      tic_device * p = NULL;
+      tic::throw_if_needed(tic_device_create_from_usb_device(
+        device.pointer_get(),
+        cached ? cached->serial_number.c_str() : NULL, &p));
+      if (p == NULL) { continue; }
+      tic::device tic_device(p);
+      serial_number = tic_device.get_serial_number();
+      result.app_devices.push_back(std::move(tic_device));
+    }
+
+    seen[os_id] = cache_entry{ vendor_id, product_id, revision, serial_number };
+  }
+
+  cache.swap(seen);
+  return result;
+}
+
+device_scan_result scan_connected_devices()
+{
+  static device_scanner scanner;
+  return scanner.scan();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bootloader.h"
+#include <tic.hpp>
+#include <libusbp.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The devices found by one pass over the USB devices connected to the
+// computer.
+struct device_scan_result
+{
+  // Tics running their normal firmware.
+  std::vector<tic::device> app_devices;
+
+  // Known bootloaders (usually Tics that are getting a firmware upgrade).
+  std::vector<bootloader_instance> bootloaders;
+};
+
+// Finds the Tics and bootloaders connected to the computer with a single
+// libusbp device list, so programs that need both (like the GUI and the
+// firmware upgrade code) do not enumerate the USB devices twice.
+//
+// Reading a serial number string descriptor is the most expensive part of
+// listing a device, so the scanner remembers the serial number of each device
+// it has seen, keyed by OS ID.  A cache entry is only used if the vendor ID,
+// product ID, and revision still match, and it is dropped as soon as a scan
+// does not find that device.
+class device_scanner
+{
+public:
+  device_scan_result scan();
+
+private:
+  struct cache_entry
+  {
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint16_t revision;
+    std::string serial_number;
+  };
+
+  std::string get_serial_number(const libusbp::device & device,
+    const std::string & os_id, std::map<std::string, cache_entry> & seen);
+
+  std::mutex mutex;
+  std::map<std::string, cache_entry> cache;
+};
+
+// Scans using a scanner shared by the whole program.  This function can be
+// called from any thread.
+device_scan_result scan_connected_devices();
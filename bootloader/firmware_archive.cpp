@@ -1,19 +1,187 @@
 #include "bootloader.h"
 #include <string_to_int.h>
 #include "tinyxml2.h"
+#include <cerrno>
+#include <cstring>
 #include <limits>
 #include <sstream>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define USB_VENDOR_ID_POLOLU 0x1FFB
 
-static int hex_digit_value(uint8_t c)
+// Maps each character to its value as a hex digit, or to 0xFF if it is not a
+// hex digit.
+class hex_digit_table
+{
+public:
+  hex_digit_table()
+  {
+    for (int c = 0; c < 256; c++) { values[c] = 0xFF; }
+    for (int c = '0'; c <= '9'; c++) { values[c] = c - '0'; }
+    for (int c = 'a'; c <= 'f'; c++) { values[c] = c - 'a' + 10; }
+    for (int c = 'A'; c <= 'F'; c++) { values[c] = c - 'A' + 10; }
+  }
+
+  uint8_t values[256];
+};
+
+static const hex_digit_table hex_digits;
+
+// Decodes pairs of hex digits into bytes.  Instead of checking each digit as
+// we go, we OR all the digit values together and check the result once at the
+// end, since only an invalid digit has any of the upper bits set.  Returns
+// false if there was an invalid digit.
+static bool decode_hex(const char * hex, size_t byte_count, uint8_t * output)
+{
+  const uint8_t * in = (const uint8_t *)hex;
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < byte_count; i++)
+  {
+    uint8_t high = hex_digits.values[in[2 * i + 0]];
+    uint8_t low = hex_digits.values[in[2 * i + 1]];
+    invalid |= high | low;
+    output[i] = high << 4 | (low & 0xF);
+  }
+  return (invalid & 0xF0) == 0;
+}
+
+namespace
+{
+  // Provides read-only access to the contents of a file by mapping it into
+  // memory, so we do not have to read the whole file into a string first.
+  // tinyxml2 still copies the text into its own buffer when it parses it.
+  class mapped_file
+  {
+  public:
+    explicit mapped_file(const std::string & filename);
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file & operator=(const mapped_file &) = delete;
+
+    const char * data = "";
+    size_t size = 0;
+
+  private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    void * mapping = NULL;
+#endif
+  };
+}
+
+#ifdef _WIN32
+
+static std::runtime_error windows_file_error(const std::string & filename)
+{
+  DWORD error_code = GetLastError();
+  char * message = NULL;
+  FormatMessageA(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM |
+    FORMAT_MESSAGE_IGNORE_INSERTS, NULL, error_code, 0, (LPSTR)&message, 0,
+    NULL);
+  std::string str = message ? message : "Unknown error.";
+  LocalFree(message);
+  return std::runtime_error(filename + ": " + str);
+}
+
+mapped_file::mapped_file(const std::string & filename)
+{
+  file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throw windows_file_error(filename);
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size))
+  {
+    std::runtime_error error = windows_file_error(filename);
+    CloseHandle(file);
+    throw error;
+  }
+  if (file_size.QuadPart == 0) { return; }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  const void * view = mapping ?
+    MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+  if (view == NULL)
+  {
+    std::runtime_error error = windows_file_error(filename);
+    if (mapping) { CloseHandle(mapping); }
+    CloseHandle(file);
+    throw error;
+  }
+  data = (const char *)view;
+  size = file_size.QuadPart;
+}
+
+mapped_file::~mapped_file()
+{
+  if (size) { UnmapViewOfFile(data); }
+  if (mapping) { CloseHandle(mapping); }
+  if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+}
+
+#else
+
+static std::runtime_error posix_file_error(const std::string & filename)
 {
-  if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
-  if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
-  if (c >= '0' && c <= '9') { return c - '0'; }
-  return -1;
+  int error_code = errno;
+  return std::runtime_error(filename + ": " + strerror(error_code) + ".");
 }
 
+mapped_file::mapped_file(const std::string & filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    throw posix_file_error(filename);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+  {
+    std::runtime_error error = posix_file_error(filename);
+    close(fd);
+    throw error;
+  }
+
+  if (st.st_size != 0)
+  {
+    mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+      mapping = NULL;
+      std::runtime_error error = posix_file_error(filename);
+      close(fd);
+      throw error;
+    }
+    data = (const char *)mapping;
+    size = st.st_size;
+  }
+
+  // The mapping stays valid after the file is closed.
+  close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+  if (mapping) { munmap(mapping, size); }
+}
+
+#endif
+
 static std::vector<std::string> split(const std::string & str, char delimiter)
 {
   std::vector<std::string> r;
@@ -46,35 +214,23 @@ static firmware_archive::block process_xml_block(
   }
 
   // Get the contents.
-  const char * contents_c_str = element->GetText();
-  if (contents_c_str == NULL)
+  const char * contents = element->GetText();
+  if (contents == NULL)
   {
     throw std::runtime_error("A block has missing or invalid contents.");
   }
 
-  std::string contents(contents_c_str);
-
-  if ((contents.size() % 2) != 0)
+  size_t length = strlen(contents);
+  if ((length % 2) != 0)
   {
     throw std::runtime_error("A block has an odd number of characters.");
   }
 
-  uint32_t byte_count = contents.size() / 2;
-
-  std::istringstream stream(contents);
-  block.data.resize(byte_count);
-
-  for (uint32_t i = 0; i < byte_count; i++)
+  // Decode the hex straight from tinyxml2's buffer into the block.
+  block.data.resize(length / 2);
+  if (!decode_hex(contents, block.data.size(), block.data.data()))
   {
-    int v1 = hex_digit_value(contents[i * 2 + 0]);
-    int v2 = hex_digit_value(contents[i * 2 + 1]);
-
-    if (v1 < 0 || v2 < 0)
-    {
-      throw std::runtime_error("Invalid hex digit.");
-    }
-
-    block.data[i] = v1 * 16 + v2;
+    throw std::runtime_error("Invalid hex digit.");
   }
 
   return block;
@@ -152,10 +308,11 @@ static firmware_archive::image process_xml_firmware_image(
   return image;
 }
 
-void firmware_archive::data::process_xml(const std::string & string)
+void firmware_archive::data::process_xml(const char * xml, size_t size)
 {
+  // tinyxml2 copies the XML into a buffer of its own and parses that.
   tinyxml2::XMLDocument doc;
-  doc.Parse(string.c_str(), string.size());
+  doc.Parse(xml, size);
   if (doc.Error())
   {
     throw std::runtime_error(std::string("XML error: ") + doc.ErrorName() + ".");
@@ -211,12 +368,23 @@ void firmware_archive::data::process_xml(const std::string & string)
 }
 
 void firmware_archive::data::read_from_string(const std::string & string)
+{
+  read_from_memory(string.data(), string.size());
+}
+
+void firmware_archive::data::read_from_file(const std::string & filename)
+{
+  mapped_file file(filename);
+  read_from_memory(file.data, file.size);
+}
+
+void firmware_archive::data::read_from_memory(const char * xml, size_t size)
 {
   name.clear();
   images.clear();
   try
   {
-    process_xml(string);
+    process_xml(xml, size);
   }
   catch (const std::runtime_error & e)
   {
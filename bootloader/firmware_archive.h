@@ -30,6 +30,13 @@ namespace firmware_archive
   public:
     void read_from_string(const std::string &);
 
+    // Reads the archive from a file.  The file is mapped into memory instead
+    // of being read into a string first, so the only copy of the text is the
+    // one that tinyxml2 makes when parsing it.
+    void read_from_file(const std::string & filename);
+
+    void read_from_memory(const char * xml, size_t size);
+
     operator bool() const
     {
       return !images.empty();
@@ -54,7 +61,7 @@ namespace firmware_archive
     std::vector<image> images;
 
   private:
-    void process_xml(const std::string &);
+    void process_xml(const char * xml, size_t size);
   };
 }
 
@@ -0,0 +1,126 @@
+// Measures how long requests to the selected device take, so that USB hosts,
+// hubs, and kernel versions can be compared from a single process.
+
+#include "cli.h"
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static double elapsed_us(benchmark_clock::time_point start,
+  benchmark_clock::time_point end)
+{
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Returns the latency that the given percentage of samples are less than or
+// equal to, using the nearest-rank method.  The samples must be sorted.
+static double percentile(const std::vector<double> & sorted, double percent)
+{
+  if (sorted.empty()) { return 0; }
+  size_t rank = (size_t)std::ceil(percent / 100 * sorted.size());
+  if (rank < 1) { rank = 1; }
+  if (rank > sorted.size()) { rank = sorted.size(); }
+  return sorted[rank - 1];
+}
+
+// Prints the results of one benchmark as YAML, which is easy for people and
+// programs to read.
+static void print_benchmark(const std::string & name,
+  std::vector<double> latencies_us, double total_us)
+{
+  std::sort(latencies_us.begin(), latencies_us.end());
+
+  double sum_us = 0;
+  for (double latency_us : latencies_us) { sum_us += latency_us; }
+  size_t count = latencies_us.size();
+
+  std::cout << name << ":" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "  iterations: " << count << std::endl;
+  std::cout << "  total_us: " << total_us << std::endl;
+  std::cout << "  per_second: " << (total_us > 0 ? count * 1e6 / total_us : 0)
+    << std::endl;
+  std::cout << "  min_us: " << (count ? latencies_us.front() : 0) << std::endl;
+  std::cout << "  mean_us: " << (count ? sum_us / count : 0) << std::endl;
+  std::cout << "  p50_us: " << percentile(latencies_us, 50) << std::endl;
+  std::cout << "  p90_us: " << percentile(latencies_us, 90) << std::endl;
+  std::cout << "  p99_us: " << percentile(latencies_us, 99) << std::endl;
+  std::cout << "  p99_9_us: " << percentile(latencies_us, 99.9) << std::endl;
+  std::cout << "  max_us: " << (count ? latencies_us.back() : 0) << std::endl;
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+}
+
+// Calls the function the given number of times, timing each call.
+template <typename F>
+static void run_benchmark(const std::string & name, uint32_t iterations, F f)
+{
+  std::vector<double> latencies_us;
+  latencies_us.reserve(iterations);
+
+  benchmark_clock::time_point start = benchmark_clock::now();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    benchmark_clock::time_point call_start = benchmark_clock::now();
+    f();
+    latencies_us.push_back(elapsed_us(call_start, benchmark_clock::now()));
+  }
+  double total_us = elapsed_us(start, benchmark_clock::now());
+
+  print_benchmark(name, std::move(latencies_us), total_us);
+}
+
+void benchmark(device_selector & selector, uint32_t iterations,
+  uint32_t settings_iterations)
+{
+  tic::device device = selector.select_device();
+
+  // Open and close a separate handle so the shared one stays usable.
+  {
+    std::vector<double> open_us, close_us;
+    open_us.reserve(iterations);
+    close_us.reserve(iterations);
+    double open_total_us = 0, close_total_us = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+      benchmark_clock::time_point open_start = benchmark_clock::now();
+      tic::handle handle(device);
+      benchmark_clock::time_point close_start = benchmark_clock::now();
+      handle.close();
+      benchmark_clock::time_point close_end = benchmark_clock::now();
+      open_us.push_back(elapsed_us(open_start, close_start));
+      close_us.push_back(elapsed_us(close_start, close_end));
+      open_total_us += open_us.back();
+      close_total_us += close_us.back();
+    }
+    print_benchmark("open", std::move(open_us), open_total_us);
+    print_benchmark("close", std::move(close_us), close_total_us);
+  }
+
+  tic::handle & handle = selector.select_handle();
+
+  run_benchmark("get_variables", iterations, [&]()
+  {
+    handle.get_variables();
+  });
+
+  // Commanding the position the motor is already at keeps it from moving.
+  int32_t position = handle.get_variables().get_current_position();
+  run_benchmark("set_target_position", iterations, [&]()
+  {
+    handle.set_target_position(position);
+  });
+
+  // Writing settings wears out the device's EEPROM, so these use a separate,
+  // smaller iteration count.  The settings written are the ones read, so
+  // nothing changes.
+  tic::settings settings = handle.get_settings();
+  run_benchmark("get_settings", settings_iterations, [&]()
+  {
+    settings = handle.get_settings();
+  });
+
+  run_benchmark("set_settings", settings_iterations, [&]()
+  {
+    handle.set_settings(settings);
+  });
+}
@@ -10,6 +10,11 @@ static const char help[] =
   "  --full                       When used with --status, shows more.\n"
   "  -d SERIALNUMBER              Specifies the serial number of the device.\n"
   "  --list                       List devices connected to computer.\n"
+  "  --daemon SOCKET              Talk to the device through ticd.\n"
+  "  --stats                      Show how long each USB request took.\n"
+  "  --benchmark                  Measure request latencies and throughput.\n"
+  "  --iterations NUM             Repeat each benchmarked request NUM times.\n"
+  "  --settings-iterations NUM    Repeat settings requests NUM times.\n"
   "  --pause                      Pause program at the end.\n"
   "  --pause-on-error             Pause program at the end if an error happens.\n"
   "  -h, --help                   Show this help screen.\n"
@@ -29,6 +34,35 @@ static const char help[] =
   "  --enter-safe-start           Send the enter safe start command.\n"
   "  --reset                      Make the controller forget its current state.\n"
   "  --clear-driver-error         Attempt to clear a motor driver error.\n"
+  "  --s-curve NUM                Move to position NUM along an S-curve.\n"
+  "  --max-jerk NUM               Set the S-curve jerk limit in microsteps / s^3.\n"
+  "  --dynamic-position NUM       Move to NUM, changing step modes with speed.\n"
+  "  --dynamic-steps MODE:SPD,... Use step MODE at speeds of SPD and up.\n"
+  "  --dynamic-max-speed NUM      Set the speed limit for --dynamic-position.\n"
+  "  --wait-for-position          Wait until the motor reaches the target.\n"
+  "  --wait-timeout MS            Stop waiting with an error after MS ms.\n"
+  "  --watch-slip NUM             Watch for slips of more than NUM microsteps.\n"
+  "  --slip-action ACTION         On slip: none, halt, or deenergize.\n"
+  "  --idle-current NUM           Lower the current limit to NUM mA when idle.\n"
+  "  --idle-time MS               Lower it after MS ms still (default: 1000).\n"
+  "  --idle-watch MS              Watch the idle motor for MS ms before moving.\n"
+  "  --servo NUM                  Move the encoder to NUM with a loop on the PC.\n"
+  "  --servo-gains KP,KI,KD       Set the gains of the loop (default: 20,0,0).\n"
+  "  --servo-interval US          Update the loop every US microseconds.\n"
+  "  --stream FILE                Send the timed targets listed in FILE.\n"
+  "  --stream-priority NUM        Stream with real-time (SCHED_FIFO) priority NUM.\n"
+  "  --stream-cpu NUM             Stream from a thread pinned to CPU NUM.\n"
+  "  --stream-lock-memory         Lock memory into RAM while streaming.\n"
+  "  --axes SERIAL,...            Use these devices for --sync and --gcode.\n"
+  "                               Name G-code axes like X=SERIAL,Y=SERIAL.\n"
+  "  --sync-position NUM,...      Set the target positions of --axes together.\n"
+  "  --sync-halt                  Abruptly stop all the --axes together.\n"
+  "  --sync-arrival               Make --sync-position moves finish together.\n"
+  "                               Waits for them, then restores the limits.\n"
+  "  --gcode FILE                 Run the G-code program in FILE on the --axes.\n"
+  "  --gcode-scale NUM            Set the microsteps per G-code unit (default: 1).\n"
+  "  --gcode-lookahead NUM        Read NUM blocks ahead of the move (default: 16).\n"
+  "                               Straight runs are joined; corners stop the axes.\n"
   "\n"
   "Temporary settings:\n"
   "  --max-speed NUM              Set the speed limit.\n"
@@ -57,6 +91,11 @@ static const char help[] =
   "  --get-settings FILE          Read device settings and write to file.\n"
   "  --fix-settings IN OUT        Read settings from a file and fix them.\n"
   "\n"
+  "Firmware upgrades:\n"
+  "  --upgrade-firmware FILE      Upgrade firmware using a .fmi file.\n"
+  "  --all                        Upgrade all devices at once (with -d, only\n"
+  "                               devices with that serial number).\n"
+  "\n"
   "For more help, see: " DOCUMENTATION_URL "\n"
   "\n";
 
@@ -71,6 +110,18 @@ struct arguments
 
   bool show_list = false;
 
+  bool use_daemon = false;
+  std::string daemon_socket;
+
+  bool show_stats = false;
+
+  bool run_benchmark = false;
+  uint32_t benchmark_iterations = 1000;
+
+  // Setting the settings writes to EEPROM, which wears out, so we do it fewer
+  // times by default.
+  uint32_t benchmark_settings_iterations = 10;
+
   bool pause = false;
 
   bool pause_on_error = false;
@@ -108,6 +159,59 @@ struct arguments
 
   bool clear_driver_error = false;
 
+  bool s_curve = false;
+  int32_t s_curve_target;
+
+  bool set_max_jerk = false;
+  uint32_t max_jerk;
+
+  bool dynamic_position = false;
+  int32_t dynamic_target;
+  std::vector<std::pair<uint8_t, uint64_t>> dynamic_steps;
+  uint64_t dynamic_max_speed = 0;
+
+  bool wait_for_position = false;
+  uint32_t wait_timeout = TIC_WAIT_FOREVER;
+
+  bool watch_slip = false;
+  uint32_t slip_threshold;
+  uint8_t slip_action = TIC_SLIP_ACTION_NONE;
+
+  bool idle_current = false;
+  uint32_t idle_current_limit;
+  bool set_idle_time = false;
+  uint32_t idle_time = 1000;
+  bool idle_watch = false;
+  uint32_t idle_watch_ms;
+
+  bool servo = false;
+  int32_t servo_target;
+  double servo_kp = 20;
+  double servo_ki = 0;
+  double servo_kd = 0;
+  uint32_t servo_interval = 2000;
+
+  bool stream = false;
+  std::string stream_filename;
+  int32_t stream_priority = 0;
+  int32_t stream_cpu = -1;
+  bool stream_lock_memory = false;
+
+  std::vector<std::string> axes;
+  std::string axis_letters;
+
+  bool sync_position = false;
+  std::vector<int32_t> sync_positions;
+
+  bool sync_halt = false;
+
+  bool sync_arrival = false;
+
+  bool gcode = false;
+  std::string gcode_filename;
+  uint32_t gcode_scale = 1;
+  uint32_t gcode_lookahead = 16;
+
   bool set_max_speed = false;
   uint32_t max_speed;
 
@@ -153,6 +257,11 @@ struct arguments
   std::string fix_settings_input_filename;
   std::string fix_settings_output_filename;
 
+  bool upgrade_firmware = false;
+  std::string upgrade_firmware_filename;
+
+  bool all_devices = false;
+
   bool get_debug_data = false;
 
   uint32_t test_procedure = 0;
@@ -175,6 +284,17 @@ struct arguments
       enter_safe_start ||
       reset ||
       clear_driver_error ||
+      s_curve ||
+      dynamic_position ||
+      servo ||
+      wait_for_position ||
+      watch_slip ||
+      idle_current ||
+      idle_watch ||
+      sync_position ||
+      sync_halt ||
+      gcode ||
+      stream ||
       set_max_speed ||
       set_starting_speed ||
       set_max_accel ||
@@ -190,7 +310,10 @@ struct arguments
       set_settings ||
       get_settings ||
       fix_settings ||
+      upgrade_firmware ||
       get_debug_data ||
+      show_stats ||
+      run_benchmark ||
       test_procedure;
   }
 };
@@ -244,9 +367,98 @@ static std::string parse_arg_string(arg_reader & arg_reader)
     return std::string(value_c);
 }
 
-static uint8_t parse_arg_step_mode(arg_reader & arg_reader)
+// Parses gains in the form "KP,KI,KD".
+static void parse_arg_gains(arg_reader & arg_reader,
+  double & kp, double & ki, double & kd)
+{
+  std::string str = parse_arg_string(arg_reader);
+  double gains[3];
+  const char * p = str.c_str();
+  for (size_t i = 0; i < 3; i++)
+  {
+    char * end;
+    gains[i] = strtod(p, &end);
+    char separator = i < 2 ? ',' : 0;
+    if (end == p || *end != separator || !(gains[i] >= 0))
+    {
+      throw exception_with_exit_code(EXIT_BAD_ARGS,
+        "The gains after '" + std::string(arg_reader.last()) +
+        "' are invalid.  They should look like '20,0.5,0'.");
+    }
+    p = end + 1;
+  }
+  kp = gains[0];
+  ki = gains[1];
+  kd = gains[2];
+}
+
+// Parses a comma-separated list.
+static std::vector<std::string> parse_arg_list(arg_reader & arg_reader)
+{
+  std::istringstream input(parse_arg_string(arg_reader));
+  std::vector<std::string> list;
+  std::string item;
+  while (std::getline(input, item, ','))
+  {
+    list.push_back(item);
+  }
+  return list;
+}
+
+static std::vector<int32_t> parse_arg_positions(arg_reader & arg_reader)
+{
+  std::vector<int32_t> positions;
+  for (const std::string & item : parse_arg_list(arg_reader))
+  {
+    int32_t position;
+    if (string_to_int(item.c_str(), &position))
+    {
+      throw exception_with_exit_code(EXIT_BAD_ARGS,
+        "The positions after '" + std::string(arg_reader.last()) +
+        "' are invalid.");
+    }
+    positions.push_back(position);
+  }
+  return positions;
+}
+
+// Parses a list of serial numbers for --axes.  Each one can have a G-code axis
+// letter in front of it, like "X=00000001".  Axes without letters get X, Y, Z,
+// A, B, and C in order.
+static void parse_arg_axes(arg_reader & arg_reader,
+  std::vector<std::string> & serial_numbers, std::string & letters)
+{
+  static const char default_letters[] = "XYZABC";
+  serial_numbers.clear();
+  letters.clear();
+  for (const std::string & item : parse_arg_list(arg_reader))
+  {
+    char letter = 0;
+    std::string serial_number = item;
+    if (item.size() >= 2 && item[1] == '=')
+    {
+      letter = toupper((unsigned char)item[0]);
+      serial_number = item.substr(2);
+    }
+    else if (serial_numbers.size() < sizeof(default_letters) - 1)
+    {
+      letter = default_letters[serial_numbers.size()];
+    }
+
+    if (letter == 0 || strchr(default_letters, letter) == NULL ||
+      letters.find(letter) != std::string::npos || serial_number.empty())
+    {
+      throw exception_with_exit_code(EXIT_BAD_ARGS,
+        "The axes after '" + std::string(arg_reader.last()) +
+        "' are invalid.");
+    }
+    serial_numbers.push_back(serial_number);
+    letters += letter;
+  }
+}
+
+static uint8_t parse_step_mode(const std::string & mode_str)
 {
-  std::string mode_str = parse_arg_string(arg_reader);
   if (mode_str == "1" || mode_str == "full"
     || mode_str == "Full step" || mode_str == "full step")
   {
@@ -295,6 +507,33 @@ static uint8_t parse_arg_step_mode(arg_reader & arg_reader)
   }
 }
 
+static uint8_t parse_arg_step_mode(arg_reader & arg_reader)
+{
+  return parse_step_mode(parse_arg_string(arg_reader));
+}
+
+// Parses a list of step modes and the speeds where they start, like
+// "4:10000000,full:60000000".
+static std::vector<std::pair<uint8_t, uint64_t>> parse_arg_step_levels(
+  arg_reader & arg_reader)
+{
+  std::vector<std::pair<uint8_t, uint64_t>> levels;
+  for (const std::string & item : parse_arg_list(arg_reader))
+  {
+    size_t colon = item.find(':');
+    uint64_t speed;
+    if (colon == std::string::npos ||
+      string_to_int(item.substr(colon + 1).c_str(), &speed))
+    {
+      throw exception_with_exit_code(EXIT_BAD_ARGS,
+        "The step modes after '" + std::string(arg_reader.last()) +
+        "' are invalid.  They should look like '4:10000000,full:60000000'.");
+    }
+    levels.push_back({ parse_step_mode(item.substr(0, colon)), speed });
+  }
+  return levels;
+}
+
 static uint8_t parse_arg_decay_mode(arg_reader & arg_reader)
 {
   std::string decay_str = parse_arg_string(arg_reader);
@@ -333,6 +572,28 @@ static uint8_t parse_arg_agc_mode(arg_reader & arg_reader)
   }
 }
 
+static uint8_t parse_arg_slip_action(arg_reader & arg_reader)
+{
+  std::string str = parse_arg_string(arg_reader);
+  if (str == "none")
+  {
+    return TIC_SLIP_ACTION_NONE;
+  }
+  else if (str == "halt")
+  {
+    return TIC_SLIP_ACTION_HALT_AND_HOLD;
+  }
+  else if (str == "deenergize")
+  {
+    return TIC_SLIP_ACTION_DEENERGIZE;
+  }
+  else
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The slip action specified is invalid.");
+  }
+}
+
 static uint8_t parse_arg_agc_bottom_current_limit(arg_reader & arg_reader)
 {
   std::string str = parse_arg_string(arg_reader);
@@ -484,6 +745,27 @@ static arguments parse_args(int argc, char ** argv)
     {
       args.show_list = true;
     }
+    else if (arg == "--daemon")
+    {
+      args.use_daemon = true;
+      args.daemon_socket = parse_arg_string(arg_reader);
+    }
+    else if (arg == "--stats")
+    {
+      args.show_stats = true;
+    }
+    else if (arg == "--benchmark")
+    {
+      args.run_benchmark = true;
+    }
+    else if (arg == "--iterations")
+    {
+      args.benchmark_iterations = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--settings-iterations")
+    {
+      args.benchmark_settings_iterations = parse_arg_int<uint32_t>(arg_reader);
+    }
     else if (arg == "--pause")
     {
       args.pause = true;
@@ -560,6 +842,121 @@ static arguments parse_args(int argc, char ** argv)
     {
       args.clear_driver_error = true;
     }
+    else if (arg == "--s-curve")
+    {
+      args.s_curve = true;
+      args.s_curve_target = parse_arg_int<int32_t>(arg_reader);
+    }
+    else if (arg == "--max-jerk")
+    {
+      args.set_max_jerk = true;
+      args.max_jerk = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--dynamic-position")
+    {
+      args.dynamic_position = true;
+      args.dynamic_target = parse_arg_int<int32_t>(arg_reader);
+    }
+    else if (arg == "--dynamic-steps")
+    {
+      args.dynamic_steps = parse_arg_step_levels(arg_reader);
+    }
+    else if (arg == "--dynamic-max-speed")
+    {
+      args.dynamic_max_speed = parse_arg_int<uint64_t>(arg_reader);
+    }
+    else if (arg == "--wait-for-position")
+    {
+      args.wait_for_position = true;
+    }
+    else if (arg == "--wait-timeout")
+    {
+      args.wait_timeout = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--watch-slip")
+    {
+      args.watch_slip = true;
+      args.slip_threshold = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--slip-action")
+    {
+      args.slip_action = parse_arg_slip_action(arg_reader);
+    }
+    else if (arg == "--idle-current")
+    {
+      args.idle_current = true;
+      args.idle_current_limit = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--idle-time")
+    {
+      args.set_idle_time = true;
+      args.idle_time = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--idle-watch")
+    {
+      args.idle_watch = true;
+      args.idle_watch_ms = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--servo")
+    {
+      args.servo = true;
+      args.servo_target = parse_arg_int<int32_t>(arg_reader);
+    }
+    else if (arg == "--servo-gains")
+    {
+      parse_arg_gains(arg_reader, args.servo_kp, args.servo_ki, args.servo_kd);
+    }
+    else if (arg == "--servo-interval")
+    {
+      args.servo_interval = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--stream")
+    {
+      args.stream = true;
+      args.stream_filename = parse_arg_string(arg_reader);
+    }
+    else if (arg == "--stream-priority")
+    {
+      args.stream_priority = parse_arg_int<int32_t>(arg_reader);
+    }
+    else if (arg == "--stream-cpu")
+    {
+      args.stream_cpu = parse_arg_int<int32_t>(arg_reader);
+    }
+    else if (arg == "--axes")
+    {
+      parse_arg_axes(arg_reader, args.axes, args.axis_letters);
+    }
+    else if (arg == "--sync-position")
+    {
+      args.sync_position = true;
+      args.sync_positions = parse_arg_positions(arg_reader);
+    }
+    else if (arg == "--sync-halt")
+    {
+      args.sync_halt = true;
+    }
+    else if (arg == "--sync-arrival")
+    {
+      args.sync_arrival = true;
+    }
+    else if (arg == "--gcode")
+    {
+      args.gcode = true;
+      args.gcode_filename = parse_arg_string(arg_reader);
+    }
+    else if (arg == "--gcode-scale")
+    {
+      args.gcode_scale = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--gcode-lookahead")
+    {
+      args.gcode_lookahead = parse_arg_int<uint32_t>(arg_reader);
+    }
+    else if (arg == "--stream-lock-memory")
+    {
+      args.stream_lock_memory = true;
+    }
     else if (arg == "--max-speed")
     {
       args.set_max_speed = true;
@@ -635,6 +1032,15 @@ static arguments parse_args(int argc, char ** argv)
       args.fix_settings_input_filename = parse_arg_string(arg_reader);
       args.fix_settings_output_filename = parse_arg_string(arg_reader);
     }
+    else if (arg == "--upgrade-firmware")
+    {
+      args.upgrade_firmware = true;
+      args.upgrade_firmware_filename = parse_arg_string(arg_reader);
+    }
+    else if (arg == "--all")
+    {
+      args.all_devices = true;
+    }
     else if (arg == "--debug")
     {
       // This is an unadvertized option for helping customers troubleshoot
@@ -652,13 +1058,68 @@ static arguments parse_args(int argc, char ** argv)
         std::string("Unknown option: '") + arg + "'.");
     }
   }
+
+  if (args.s_curve && !args.set_max_jerk)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --s-curve option requires --max-jerk.");
+  }
+
+  if (args.dynamic_position && args.dynamic_steps.empty())
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --dynamic-position option requires --dynamic-steps.");
+  }
+
+  if ((args.sync_position || args.sync_halt) && args.axes.empty())
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --sync-position and --sync-halt options require --axes.");
+  }
+
+  if (args.sync_arrival && !args.sync_position)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --sync-arrival option requires --sync-position.");
+  }
+
+  if (args.sync_position && args.sync_positions.size() != args.axes.size())
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --sync-position option needs one position for each of the --axes.");
+  }
+
+  if (args.gcode && args.axes.empty())
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --gcode option requires --axes.");
+  }
+
+  if (args.gcode_scale == 0 || args.gcode_lookahead == 0)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --gcode-scale and --gcode-lookahead options must be at least 1.");
+  }
+
+  if (args.slip_action != TIC_SLIP_ACTION_NONE && !args.watch_slip)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --slip-action option requires --watch-slip.");
+  }
+
+  if ((args.set_idle_time || args.idle_watch) && !args.idle_current)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      "The --idle-time and --idle-watch options require --idle-current.");
+  }
+
   return args;
 }
 
-static tic::handle handle(device_selector & selector)
+// All the actions share one handle, so --stats can show all their requests.
+static tic::handle & handle(device_selector & selector)
 {
-  tic::device device = selector.select_device();
-  return tic::handle(device);
+  return selector.select_handle();
 }
 
 static void print_list(device_selector & selector)
@@ -674,7 +1135,7 @@ static void print_list(device_selector & selector)
 
 static void set_current_limit_after_warning(device_selector & selector, uint32_t current_limit)
 {
-  tic::handle handle = ::handle(selector);
+  tic::handle & handle = ::handle(selector);
   uint8_t product = handle.get_device().get_product();
 
   uint32_t max_current = tic_get_max_allowed_current(product);
@@ -692,7 +1153,7 @@ static void set_current_limit_after_warning(device_selector & selector, uint32_t
 static void get_status(device_selector & selector, bool full_output)
 {
   tic::device device = selector.select_device();
-  tic::handle handle(device);
+  tic::handle & handle = ::handle(selector);
   tic::settings settings = handle.get_settings();
   tic::variables vars = handle.get_variables(true);
   std::string name = device.get_name();
@@ -737,7 +1198,7 @@ static void set_settings(device_selector & selector,
   settings.fix(&warnings);
   std::cerr << warnings;
 
-  tic::handle handle(device);
+  tic::handle & handle = ::handle(selector);
   handle.set_settings(settings);
   handle.reinitialize();
 }
@@ -758,18 +1219,210 @@ static void fix_settings(const std::string & input_filename,
 static void set_target_position_relative(device_selector & selector,
   int32_t target_position_relative)
 {
-  tic::device device = selector.select_device();
-  tic::handle handle(device);
+  tic::handle & handle = ::handle(selector);
   tic::variables variables = handle.get_variables();
   int32_t position = (uint32_t)variables.get_current_position() +
     (uint32_t)target_position_relative;
   handle.set_target_position(position);
 }
 
+// Moves to the target along an S-curve that does not go faster or accelerate
+// harder than the Tic's current limits, so it can follow the plan.
+static void s_curve_move(device_selector & selector, int32_t target,
+  uint32_t max_jerk)
+{
+  tic::handle & handle = ::handle(selector);
+  tic::variables vars = handle.get_variables();
+  uint32_t max_accel = std::min(vars.get_max_accel(),
+    vars.get_max_decel() ? vars.get_max_decel() : vars.get_max_accel());
+
+  tic::s_curve curve = tic::s_curve::create();
+  curve.set_max_speed(vars.get_max_speed());
+  curve.set_max_accel(max_accel);
+  curve.set_max_jerk(max_jerk);
+  curve.move(handle, target);
+}
+
+// Moves to the target in microsteps of the current step mode, letting a
+// microstep scheduler change the step mode with the speed.  The acceleration
+// limits come from the current ones, and the speed limit does too unless
+// --dynamic-max-speed was given.  Prints how many times the step mode changed
+// and the fastest speed, then puts back the limits from the settings.
+static void dynamic_move(device_selector & selector, const arguments & args)
+{
+  tic::handle & handle = ::handle(selector);
+  tic::variables vars = handle.get_variables();
+
+  uint8_t base_step_mode = vars.get_step_mode();
+
+  tic::microstep_scheduler scheduler = tic::microstep_scheduler::create();
+  scheduler.set_base_step_mode(base_step_mode);
+  for (const auto & level : args.dynamic_steps)
+  {
+    scheduler.add_level(level.first, level.second);
+  }
+  scheduler.set_limits(
+    args.dynamic_max_speed ? args.dynamic_max_speed : vars.get_max_speed(),
+    vars.get_max_accel(), vars.get_max_decel());
+
+  scheduler.start(handle);
+  scheduler.set_target_position(handle, args.dynamic_target);
+
+  auto start = std::chrono::steady_clock::now();
+  int64_t max_speed = 0;
+  while (true)
+  {
+    vars = scheduler.update(handle);
+    int64_t speed = std::abs(scheduler.get_velocity(vars));
+    max_speed = std::max(max_speed, speed);
+
+    if (vars.get_error_status() != 0)
+    {
+      throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+        "The motor stopped before reaching the target position because of "
+        "errors.");
+    }
+
+    if (scheduler.get_position(vars) == args.dynamic_target && speed == 0 &&
+      scheduler.get_step_mode() == base_step_mode)
+    {
+      break;
+    }
+
+    if (args.wait_timeout != TIC_WAIT_FOREVER &&
+      std::chrono::steady_clock::now() - start >
+      std::chrono::milliseconds(args.wait_timeout))
+    {
+      throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+        "The device took too long to finish.");
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  tic::settings settings = handle.get_settings();
+  handle.set_max_speed(tic_settings_get_max_speed(settings.get_pointer()));
+  handle.set_max_accel(tic_settings_get_max_accel(settings.get_pointer()));
+  handle.set_max_decel(tic_settings_get_max_decel(settings.get_pointer()));
+
+  std::cout << "switches: " << scheduler.get_switch_count() << std::endl;
+  std::cout << "max_speed: " << max_speed << std::endl;
+  std::cout << "position: " << scheduler.get_position(vars) << std::endl;
+}
+
+// Moves the motor until the encoder reaches the target, using the encoder
+// scaling from the device's settings, and prints how well the loop kept up.
+static void servo(device_selector & selector, const arguments & args)
+{
+  tic::handle & handle = ::handle(selector);
+  tic::settings settings = handle.get_settings();
+
+  tic::servo servo = tic::servo::create();
+  servo.set_gains(args.servo_kp, args.servo_ki, args.servo_kd);
+  servo.set_encoder_scaling(
+    tic_settings_get_encoder_prescaler(settings.get_pointer()),
+    tic_settings_get_encoder_postscaler(settings.get_pointer()));
+  servo.set_target(args.servo_target);
+  tic::run_servos({ &servo }, { &handle }, args.servo_interval,
+    args.wait_timeout);
+
+  std::cout << "updates: " << servo.get_update_count() << std::endl;
+  std::cout << "overruns: " << servo.get_overrun_count() << std::endl;
+  std::cout << "position: " << servo.get_position() << std::endl;
+  std::cout << "error: " << servo.get_error() << std::endl;
+  std::cout << "mean_update_us: " << servo.get_mean_update_us() << std::endl;
+  std::cout << "max_update_us: " << servo.get_max_update_us() << std::endl;
+  std::cout << "max_lateness_us: " << servo.get_max_lateness_us() << std::endl;
+}
+
+// Waits until the motor reaches its target position.  Errors that are stopping
+// the motor would keep it from getting there, so we stop waiting if there are
+// any.
+static void wait_for_position(device_selector & selector, uint32_t timeout_ms)
+{
+  tic::variables vars = handle(selector).wait_until(
+    [](const tic::variables & vars)
+    {
+      return tic_wait_position_reached(vars.get_pointer(), NULL) ||
+        vars.get_error_status() != 0;
+    }, timeout_ms);
+
+  if (!tic_wait_position_reached(vars.get_pointer(), NULL))
+  {
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+      "The motor stopped before reaching the target position because of "
+      "errors.");
+  }
+}
+
+// Checks for slips each time we read the variables, until there is a slip or
+// the timeout passes.  With --wait-for-position, this also stops when the motor
+// reaches its target, like wait_for_position().
+static void watch_slip(device_selector & selector, const arguments & args)
+{
+  tic::handle & handle = ::handle(selector);
+  tic::settings settings = handle.get_settings();
+
+  tic::slip_monitor monitor = tic::slip_monitor::create();
+  monitor.set_encoder_scaling(
+    tic_settings_get_encoder_prescaler(settings.get_pointer()),
+    tic_settings_get_encoder_postscaler(settings.get_pointer()));
+  monitor.set_threshold(args.slip_threshold);
+  monitor.set_action(args.slip_action);
+
+  bool reached = false;
+  try
+  {
+    handle.wait_until(
+      [&](const tic::variables & vars)
+      {
+        monitor.check(&handle, vars);
+        reached = tic_wait_position_reached(vars.get_pointer(), NULL);
+        return monitor.slipped() || (args.wait_for_position &&
+          (reached || vars.get_error_status() != 0));
+      }, args.wait_timeout);
+  }
+  catch (const tic::error & error)
+  {
+    // Without a target to wait for, running out of time just means we are
+    // done watching.
+    if (args.wait_for_position || !error.has_code(TIC_ERROR_TIMEOUT)) { throw; }
+  }
+
+  if (monitor.slipped())
+  {
+    std::ostringstream message;
+    message << "The motor slipped: the encoder was off by "
+      << monitor.get_deviation() << " microsteps.";
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED, message.str());
+  }
+
+  if (args.wait_for_position && !reached)
+  {
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+      "The motor stopped before reaching the target position because of "
+      "errors.");
+  }
+
+  std::cout << "max_slip_deviation: " << monitor.get_max_deviation() << std::endl;
+}
+
+// Reads the variables every 100 ms for the specified time so the handle can
+// lower the current limit once the motor has been still long enough.
+static void watch_idle(device_selector & selector, uint32_t duration_ms)
+{
+  tic::handle & handle = ::handle(selector);
+  for (uint32_t elapsed_ms = 0; ; elapsed_ms += 100)
+  {
+    handle.get_variables();
+    if (elapsed_ms >= duration_ms) { break; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
 static void print_debug_data(device_selector & selector)
 {
-  tic::device device = selector.select_device();
-  tic::handle handle(device);
+  tic::handle & handle = ::handle(selector);
 
   std::vector<uint8_t> data(4096, 0);
   handle.get_debug_data(data);
@@ -793,8 +1446,7 @@ static void test_procedure(device_selector & selector, uint32_t procedure)
   }
   else if (procedure == 2)
   {
-    tic::device device = selector.select_device();
-    tic::handle handle(device);
+    tic::handle & handle = ::handle(selector);
     while (1)
     {
       tic::variables vars = handle.get_variables();
@@ -866,12 +1518,260 @@ static void test_procedure(device_selector & selector, uint32_t procedure)
       }
     }
   }
+  else if (procedure == 4)
+  {
+    // Test publishing and reading telemetry in shared memory.
+    std::string name = "/tic_test_" + std::to_string(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+    tic::variables fake_vars(tic_variables_fake());
+
+    try
+    {
+      tic::telemetry_publisher publisher(name, "123");
+      tic::telemetry telemetry(name);
+
+      uint32_t slot;
+      std::cout << "found: " << telemetry.find_device("123", slot) << std::endl;
+      std::cout << "found other: " << telemetry.find_device("456", slot) << std::endl;
+
+      const uint64_t sample_count = TIC_TELEMETRY_HISTORY_LENGTH + 6;
+      for (uint64_t i = 0; i < sample_count; i++)
+      {
+        publisher.publish(fake_vars);
+      }
+      std::cout << "count: " << telemetry.get_sample_count(slot) << std::endl;
+
+      int64_t time_us = 0;
+      tic::variables latest = telemetry.get_sample(slot, sample_count - 1, &time_us);
+      std::cout << "latest position: " << latest.get_current_position() << std::endl;
+      // Reuse the variables object, like a reader that reads every sample.
+      telemetry.read_sample(slot, sample_count - TIC_TELEMETRY_HISTORY_LENGTH,
+        latest);
+      std::cout << "oldest position: " << latest.get_current_position() << std::endl;
+
+      for (uint64_t n : { (uint64_t)5, sample_count })
+      {
+        try
+        {
+          telemetry.get_sample(slot, n);
+          std::cout << "sample " << n << ": available" << std::endl;
+        }
+        catch (const tic::error & error)
+        {
+          std::cout << "sample " << n << ": " << error.what() << std::endl;
+        }
+      }
+
+      try
+      {
+        tic::telemetry_publisher second_publisher(name, "123");
+        std::cout << "second publisher: opened" << std::endl;
+      }
+      catch (const tic::error & error)
+      {
+        std::cout << "second publisher: " << error.message() << std::endl;
+      }
+    }
+    catch (...)
+    {
+      tic_error_free(tic_telemetry_remove(name.c_str()));
+      throw;
+    }
+    tic::telemetry::remove(name);
+  }
+  else if (procedure == 5)
+  {
+    // Print some fake latencies to test print_stats().
+    print_stats(tic::stats(tic_stats_fake()));
+  }
+  else if (procedure == 6)
+  {
+    // Test the motion planner model with some moves that are easy to work out
+    // by hand.  Speeds are in steps per second and accelerations are in steps
+    // per second per second.
+    struct move
+    {
+      const char * name;
+      uint32_t starting_speed, max_speed, accel;
+      int32_t position, velocity;
+      uint8_t planning_mode;
+      int32_t target;
+      std::vector<int64_t> times_ms;
+    };
+
+    std::vector<move> moves = {
+      { "trapezoid", 0, 1000, 1000, 0, 0,
+        TIC_PLANNING_MODE_TARGET_POSITION, 10000, { 500, 5000, 10500, 20000 } },
+      { "triangle", 0, 1000, 1000, 0, 0,
+        TIC_PLANNING_MODE_TARGET_POSITION, 400, { 200 } },
+      { "starting speed", 200, 1000, 1000, 0, 0,
+        TIC_PLANNING_MODE_TARGET_POSITION, 10000, { 0, 400 } },
+      { "turn around", 0, 1000, 1000, 0, -500,
+        TIC_PLANNING_MODE_TARGET_POSITION, 1000, { 500, 1500 } },
+      { "overshoot", 0, 1000, 1000, 0, 1000,
+        TIC_PLANNING_MODE_TARGET_POSITION, 200, { 1000 } },
+      { "velocity", 0, 1000, 1000, 0, 0,
+        TIC_PLANNING_MODE_TARGET_VELOCITY, -2000, { 500, 2000 } },
+      { "stop", 0, 1000, 1000, 0, 1000,
+        TIC_PLANNING_MODE_OFF, 0, { 500, 2000 } },
+      { "no speed", 0, 0, 1000, 0, 0,
+        TIC_PLANNING_MODE_TARGET_POSITION, 10, { 1000 } },
+    };
+
+    for (const move & move : moves)
+    {
+      tic::motion motion = tic::motion::create();
+      motion.set_starting_speed(move.starting_speed * TIC_SPEED_UNITS_PER_HZ);
+      motion.set_max_speed(move.max_speed * TIC_SPEED_UNITS_PER_HZ);
+      motion.set_max_accel(move.accel * TIC_ACCEL_UNITS_PER_HZ2);
+      motion.set_current_position(move.position);
+      motion.set_current_velocity(move.velocity * TIC_SPEED_UNITS_PER_HZ);
+      motion.set_planning_mode(move.planning_mode);
+      if (move.planning_mode == TIC_PLANNING_MODE_TARGET_POSITION)
+      {
+        motion.set_target_position(move.target);
+      }
+      if (move.planning_mode == TIC_PLANNING_MODE_TARGET_VELOCITY)
+      {
+        motion.set_target_velocity(move.target * TIC_SPEED_UNITS_PER_HZ);
+      }
+
+      std::cout << move.name << ": " << motion.get_time_to_target_us()
+        << " us" << std::endl;
+      for (int64_t time_ms : move.times_ms)
+      {
+        int32_t position, velocity;
+        motion.predict(time_ms * 1000, &position, &velocity);
+        std::cout << "  " << time_ms << " ms: " << position << ", "
+          << velocity / TIC_SPEED_UNITS_PER_HZ << std::endl;
+      }
+    }
+  }
+  else if (procedure == 7)
+  {
+    // Test the S-curve planner.  Speeds are in steps per second, accelerations
+    // are in steps per second per second, and jerks are in steps per second
+    // cubed.
+    struct move
+    {
+      const char * name;
+      uint32_t max_speed, accel, jerk;
+      int32_t start, target;
+      std::vector<int64_t> times_ms;
+    };
+
+    std::vector<move> moves = {
+      { "cruise", 1000, 1000, 10000, 0, 10000, { 100, 550, 5550, 11100 } },
+      { "no cruise", 1000, 1000, 10000, 0, 1000, { 1000 } },
+      { "no constant accel", 1000, 1000, 10000, 0, 10, { 79 } },
+      { "jerk limited", 1000, 1000, 1000, 0, 10000, { 1000 } },
+      { "reverse", 1000, 1000, 10000, 500, -9500, { 550, 11100 } },
+      { "no move", 1000, 1000, 10000, 7, 7, { 0 } },
+    };
+
+    for (const move & move : moves)
+    {
+      tic::s_curve curve = tic::s_curve::create();
+      curve.set_max_speed(move.max_speed * TIC_SPEED_UNITS_PER_HZ);
+      curve.set_max_accel(move.accel * TIC_ACCEL_UNITS_PER_HZ2);
+      curve.set_max_jerk(move.jerk);
+      curve.plan(move.start, move.target);
+
+      std::cout << move.name << ": " << curve.get_duration_us()
+        << " us" << std::endl;
+      for (int64_t time_ms : move.times_ms)
+      {
+        int32_t position, velocity;
+        curve.predict(time_ms * 1000, &position, &velocity);
+        std::cout << "  " << time_ms << " ms: " << position << ", "
+          << velocity / TIC_SPEED_UNITS_PER_HZ << std::endl;
+      }
+    }
+  }
+  else if (procedure == 8)
+  {
+    // Test the arrival planner.  For each axis, print the planned speed in
+    // steps per second, the planned time, and the time that tic_motion
+    // predicts for the Tic with those limits, which should be the same.
+    struct axis
+    {
+      uint32_t starting_speed, max_speed, accel, decel;
+      int32_t distance;
+    };
+
+    struct move
+    {
+      const char * name;
+      std::vector<axis> axes;
+      int64_t min_duration_ms;
+    };
+
+    std::vector<move> moves = {
+      { "cruise", { { 0, 1000, 1000, 0, 5000 }, { 0, 1000, 1000, 0, 2000 } }, 0 },
+      { "no cruise", { { 0, 1000, 1000, 0, 500 }, { 0, 1000, 1000, 0, -100 } }, 0 },
+      { "decel", { { 0, 2000, 500, 4000, 3000 }, { 0, 1000, 2000, 0, 3000 } }, 0 },
+      { "starting speed", { { 100, 1000, 1000, 0, 4000 }, { 200, 1000, 1000, 0, 300 } }, 0 },
+      { "too fast to wait", { { 0, 1000, 1000, 0, 4000 }, { 900, 1000, 1000, 0, 3000 } }, 0 },
+      { "no move", { { 0, 1000, 1000, 0, 3000 }, { 0, 1000, 1000, 0, 0 } }, 0 },
+      { "min duration", { { 0, 1000, 1000, 0, 5000 }, { 0, 1000, 1000, 0, 2000 } }, 8000 },
+    };
+
+    for (const move & move : moves)
+    {
+      tic::arrival arrival = tic::arrival::create();
+      std::vector<int32_t> distances;
+      for (size_t i = 0; i < move.axes.size(); i++)
+      {
+        const axis & a = move.axes[i];
+        arrival.set_axis_limits(i,
+          a.starting_speed * TIC_SPEED_UNITS_PER_HZ,
+          a.max_speed * TIC_SPEED_UNITS_PER_HZ,
+          a.accel * TIC_ACCEL_UNITS_PER_HZ2,
+          a.decel * TIC_ACCEL_UNITS_PER_HZ2);
+        distances.push_back(a.distance);
+      }
+      arrival.set_min_duration_us(move.min_duration_ms * 1000);
+      arrival.plan(distances);
+
+      std::cout << move.name << ": " << arrival.get_duration_us() / 1000
+        << " ms" << std::endl;
+      for (size_t i = 0; i < move.axes.size(); i++)
+      {
+        tic::motion motion = tic::motion::create();
+        motion.set_planning_mode(TIC_PLANNING_MODE_TARGET_POSITION);
+        motion.set_target_position(distances[i]);
+        motion.set_starting_speed(
+          move.axes[i].starting_speed * TIC_SPEED_UNITS_PER_HZ);
+        motion.set_max_speed(arrival.get_axis_max_speed(i));
+        motion.set_max_accel(arrival.get_axis_max_accel(i));
+        motion.set_max_decel(arrival.get_axis_max_decel(i));
+
+        std::cout << "  " << i << ": "
+          << arrival.get_axis_max_speed(i) / TIC_SPEED_UNITS_PER_HZ
+          << " steps/s, " << arrival.get_axis_duration_us(i) / 1000
+          << " ms, model " << motion.get_time_to_target_us() / 1000
+          << " ms" << std::endl;
+      }
+    }
+  }
   else
   {
     throw std::runtime_error("Unknown test procedure.");
   }
 }
 
+// Makes libpololu-tic open handles through ticd.
+static void use_daemon(const std::string & socket_path)
+{
+#ifdef _WIN32
+  (void)socket_path;
+  throw exception_with_exit_code(EXIT_BAD_ARGS,
+    "ticd is not supported on Windows.");
+#else
+  setenv(TICD_SOCKET_ENV_VAR, socket_path.c_str(), 1);
+#endif
+}
+
 // A note about ordering: We want to do all the setting stuff first because it
 // could affect subsequent options.  We want to show the status last, because it
 // could be affected by options before it.
@@ -883,6 +1783,11 @@ static void run(const arguments & args)
     return;
   }
 
+  if (args.use_daemon)
+  {
+    use_daemon(args.daemon_socket);
+  }
+
   device_selector selector;
   if (args.serial_number_specified)
   {
@@ -895,6 +1800,25 @@ static void run(const arguments & args)
     return;
   }
 
+  if (args.upgrade_firmware)
+  {
+    upgrade_firmware(selector, args.upgrade_firmware_filename,
+      args.all_devices);
+    return;
+  }
+
+  if (args.show_stats)
+  {
+    handle(selector).enable_stats();
+  }
+
+  // This should be before any commands that might start the motor moving so
+  // the handle can restore the full current limit first.
+  if (args.idle_current)
+  {
+    handle(selector).set_idle_current(args.idle_current_limit, args.idle_time);
+  }
+
   if (args.fix_settings)
   {
     fix_settings(args.fix_settings_input_filename,
@@ -1037,6 +1961,60 @@ static void run(const arguments & args)
     handle(selector).clear_driver_error();
   }
 
+  if (args.idle_watch)
+  {
+    watch_idle(selector, args.idle_watch_ms);
+  }
+
+  // These should be after the commands that set up and energize the motor.
+  if (args.s_curve)
+  {
+    s_curve_move(selector, args.s_curve_target, args.max_jerk);
+  }
+
+  if (args.dynamic_position)
+  {
+    dynamic_move(selector, args);
+  }
+
+  if (args.servo)
+  {
+    servo(selector, args);
+  }
+
+  if (args.sync_halt)
+  {
+    sync_axes(args.axes, {}, true, false, args.wait_timeout);
+  }
+  else if (args.sync_position)
+  {
+    sync_axes(args.axes, args.sync_positions, false, args.sync_arrival,
+      args.wait_timeout);
+  }
+
+  if (args.gcode)
+  {
+    run_gcode(args.axes, args.axis_letters, args.gcode_filename,
+      args.gcode_scale, args.gcode_lookahead, args.wait_timeout);
+  }
+
+  if (args.stream)
+  {
+    stream_targets(handle(selector), args.stream_filename,
+      args.stream_priority, args.stream_cpu, args.stream_lock_memory);
+  }
+
+  // This should be after the commands that start the motor moving and before
+  // --deenergize so that the motor gets to the target first.
+  if (args.watch_slip)
+  {
+    watch_slip(selector, args);
+  }
+  else if (args.wait_for_position)
+  {
+    wait_for_position(selector, args.wait_timeout);
+  }
+
   if (args.deenergize)
   {
     handle(selector).deenergize();
@@ -1047,6 +2025,12 @@ static void run(const arguments & args)
     print_debug_data(selector);
   }
 
+  if (args.run_benchmark)
+  {
+    benchmark(selector, args.benchmark_iterations,
+      args.benchmark_settings_iterations);
+  }
+
   if (args.test_procedure)
   {
     test_procedure(selector, args.test_procedure);
@@ -1056,6 +2040,16 @@ static void run(const arguments & args)
   {
     get_status(selector, args.full_output);
   }
+
+  if (args.idle_current)
+  {
+    print_idle_current(handle(selector).get_idle_current());
+  }
+
+  if (args.show_stats)
+  {
+    print_stats(handle(selector).get_stats());
+  }
 }
 
 int main(int argc, char ** argv)
@@ -3,6 +3,7 @@
 #include <tic.hpp>
 #include <file_util.h>
 #include <string_to_int.h>
+#include <ticd_protocol.h>
 #include "config.h"
 
 #include "arg_reader.h"
@@ -13,12 +14,14 @@
 #include <algorithm>
 #include <bitset>
 #include <cassert>
+#include <cmath>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 void print_status(const tic::variables & vars,
   const tic::settings & settings,
@@ -26,3 +29,27 @@ void print_status(const tic::variables & vars,
   const std::string & serial_number,
   const std::string & firmware_version,
   bool full_output);
+
+void print_stats(const tic::stats & stats);
+
+void print_idle_current(const tic::idle_current & idle);
+
+void benchmark(device_selector & selector, uint32_t iterations,
+  uint32_t settings_iterations);
+
+void stream_targets(tic::handle & handle, const std::string & filename,
+  int priority, int cpu, bool lock_memory);
+
+std::vector<tic::handle> open_axes(
+  const std::vector<std::string> & serial_numbers);
+
+void sync_axes(const std::vector<std::string> & serial_numbers,
+  const std::vector<int32_t> & positions, bool halt, bool arrival,
+  uint32_t timeout_ms);
+
+void run_gcode(const std::vector<std::string> & serial_numbers,
+  const std::string & axis_letters, const std::string & filename,
+  uint32_t scale, uint32_t lookahead, uint32_t timeout_ms);
+
+void upgrade_firmware(device_selector & selector,
+  const std::string & filename, bool all_devices);
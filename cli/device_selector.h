@@ -15,6 +15,13 @@ public:
     this->serial_number_specified = true;
   }
 
+  // Returns true if the serial number is allowed by the one that was
+  // specified, if any.
+  bool serial_number_matches(const std::string & serial_number) const
+  {
+    return !serial_number_specified || serial_number == this->serial_number;
+  }
+
   std::vector<tic::device> list_devices()
   {
     if (list_initialized) { return list; }
@@ -52,6 +59,14 @@ public:
     return device;
   }
 
+  // Returns a handle to the selected device, opening it the first time this
+  // is called.
+  tic::handle & select_handle()
+  {
+    if (!handle) { handle = tic::handle(select_device()); }
+    return handle;
+  }
+
 private:
 
   std::string device_not_found_message() const
@@ -89,4 +104,5 @@ private:
   std::vector<tic::device> list;
 
   tic::device device;
+  tic::handle handle;
 };
@@ -0,0 +1,360 @@
+// Code for upgrading the firmware on one or more Tics at the same time.
+
+#include "cli.h"
+
+#include <bootloader.h>
+#include <device_scanner.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+// How long to wait for devices to reappear in bootloader mode.
+static const uint32_t BOOTLOADER_WAIT_TIMEOUT_MS = 10000;
+
+// How often to print the combined progress of the upgrades.
+static const uint32_t PROGRESS_INTERVAL_MS = 100;
+
+namespace
+{
+  // Combines the status reported by the bootloader library for each device
+  // into one progress line.
+  class fleet_progress
+  {
+  public:
+    // Receives status updates for one device.
+    class listener : public bootloder_status_listener
+    {
+    public:
+      void set_status(const char * status,
+        uint32_t progress, uint32_t max_progress) override
+      {
+        owner->set_status(index, status, progress, max_progress);
+      }
+
+      fleet_progress * owner;
+      size_t index;
+    };
+
+    explicit fleet_progress(size_t device_count)
+      : fractions(device_count, 0), listeners(device_count)
+    {
+      for (size_t i = 0; i < device_count; i++)
+      {
+        listeners[i].owner = this;
+        listeners[i].index = i;
+      }
+    }
+
+    listener * get_listener(size_t index)
+    {
+      return &listeners[index];
+    }
+
+    void set_done(size_t index)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      fractions[index] = 1;
+      done_count++;
+    }
+
+    std::string get_line() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      double sum = 0;
+      for (double fraction : fractions) { sum += fraction; }
+      uint32_t percent = fractions.empty() ? 100 : 100 * sum / fractions.size();
+      return "Upgrading firmware: " + std::to_string(percent) + "% (" +
+        std::to_string(done_count) + " of " +
+        std::to_string(fractions.size()) + " devices finished)";
+    }
+
+  private:
+    void set_status(size_t index, const char * status,
+      uint32_t progress, uint32_t max_progress)
+    {
+      // Writing flash takes much longer than erasing it, so count erasing as
+      // the first 20% of the upgrade.
+      double fraction = max_progress ? (double)progress / max_progress : 0;
+      if (std::strncmp(status, "Erasing", 7) == 0)
+      {
+        fraction = 0.2 * fraction;
+      }
+      else
+      {
+        fraction = 0.2 + 0.8 * fraction;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      fractions[index] = fraction;
+    }
+
+    mutable std::mutex mutex;
+    std::vector<double> fractions;
+    size_t done_count = 0;
+    std::vector<listener> listeners;
+  };
+
+  struct upgrade_result
+  {
+    bool success = false;
+    std::string error_message;
+    bootloader_write_stats stats;
+  };
+}
+
+static void upgrade_one_device(const bootloader_instance & instance,
+  const firmware_archive::image & image,
+  bootloder_status_listener * listener,
+  upgrade_result & result)
+{
+  try
+  {
+    bootloader_handle handle(instance);
+    handle.set_status_listener(listener);
+    handle.apply_image(image);
+    handle.restart_device();
+    result.stats = handle.get_write_stats();
+    result.success = true;
+  }
+  catch (const std::exception & e)
+  {
+    result.error_message = e.what();
+  }
+}
+
+// Waits for a bootloader with each of the specified serial numbers to be
+// connected, and returns them in the same order.
+static std::vector<bootloader_instance> find_bootloaders(
+  const std::vector<std::string> & serial_numbers)
+{
+  auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(BOOTLOADER_WAIT_TIMEOUT_MS);
+
+  std::string missing;
+  for (const std::string & serial_number : serial_numbers)
+  {
+    if (!bootloader_wait_for_device(serial_number,
+        DEVICE_MODE_BOOTLOADER, deadline))
+    {
+      if (!missing.empty()) { missing += ", "; }
+      missing += serial_number;
+    }
+  }
+
+  if (!missing.empty())
+  {
+    throw exception_with_exit_code(EXIT_DEVICE_NOT_FOUND,
+      "Timed out waiting for the bootloader of these devices: " +
+      missing + ".");
+  }
+
+  std::vector<bootloader_instance> list = bootloader_list_connected_devices();
+  std::vector<bootloader_instance> found;
+  for (const std::string & serial_number : serial_numbers)
+  {
+    bootloader_instance match;
+    for (const bootloader_instance & instance : list)
+    {
+      if (instance.get_serial_number() == serial_number)
+      {
+        match = instance;
+        break;
+      }
+    }
+    if (!match)
+    {
+      throw exception_with_exit_code(EXIT_DEVICE_NOT_FOUND,
+        "The bootloader for device " + serial_number + " disappeared.");
+    }
+    found.push_back(match);
+  }
+  return found;
+}
+
+// Finds the firmware for a Tic that is running its normal firmware.  The
+// images in the archive are labeled with the USB IDs of the bootloaders, so we
+// match up the device with its bootloader by their short names.
+static const firmware_archive::image * find_image_for_device(
+  const firmware_archive::data & archive, const tic::device & device)
+{
+  std::string short_name = device.get_short_name();
+  for (const bootloader_type & type : bootloader_types)
+  {
+    if (short_name == type.short_name)
+    {
+      return archive.find_image(type.usb_vendor_id, type.usb_product_id);
+    }
+  }
+  return NULL;
+}
+
+static exception_with_exit_code no_firmware_error(
+  const std::string & serial_number, const std::string & name)
+{
+  return exception_with_exit_code(EXIT_OPERATION_FAILED,
+    "The firmware file does not contain any firmware for device " +
+    serial_number + " (" + name + ").");
+}
+
+void upgrade_firmware(device_selector & selector,
+  const std::string & filename, bool all_devices)
+{
+  firmware_archive::data archive;
+  archive.read_from_file(filename);
+
+  // Figure out which devices to upgrade: Tics running their normal firmware
+  // and Tics that are already in bootloader mode (e.g. because an earlier
+  // upgrade was interrupted).  One scan finds both kinds.
+  device_scan_result scan = scan_connected_devices();
+  std::vector<tic::device> app_devices;
+  std::vector<std::string> serial_numbers;
+  for (const tic::device & device : scan.app_devices)
+  {
+    if (selector.serial_number_matches(device.get_serial_number()))
+    {
+      app_devices.push_back(device);
+      serial_numbers.push_back(device.get_serial_number());
+    }
+  }
+  for (const bootloader_instance & instance : scan.bootloaders)
+  {
+    std::string serial_number = instance.get_serial_number();
+    if (selector.serial_number_matches(serial_number) &&
+      std::find(serial_numbers.begin(), serial_numbers.end(), serial_number)
+      == serial_numbers.end())
+    {
+      serial_numbers.push_back(serial_number);
+    }
+  }
+
+  if (serial_numbers.empty())
+  {
+    throw exception_with_exit_code(EXIT_DEVICE_NOT_FOUND,
+      "No device was found.");
+  }
+
+  if (serial_numbers.size() > 1 && !all_devices)
+  {
+    throw exception_with_exit_code(EXIT_DEVICE_MULTIPLE_FOUND,
+      "There are multiple qualifying devices connected to this computer.\n"
+      "Use the -d option to specify which device you want to upgrade,\n"
+      "or use --all to upgrade all of them.");
+  }
+
+  // Check that we have firmware for every device before we put any of them
+  // in bootloader mode, so a file for the wrong product changes nothing.
+  for (const tic::device & device : app_devices)
+  {
+    if (find_image_for_device(archive, device) == NULL)
+    {
+      throw no_firmware_error(device.get_serial_number(), device.get_name());
+    }
+  }
+  for (const bootloader_instance & instance : scan.bootloaders)
+  {
+    if (selector.serial_number_matches(instance.get_serial_number()) &&
+      archive.find_image(instance.get_vendor_id(),
+        instance.get_product_id()) == NULL)
+    {
+      throw no_firmware_error(instance.get_serial_number(), instance.type.name);
+    }
+  }
+
+  // If a device fails to start its bootloader, report it and keep going with
+  // the others so the ones that did start are not left in bootloader mode.
+  size_t start_failure_count = 0;
+  for (const tic::device & device : app_devices)
+  {
+    std::string serial_number = device.get_serial_number();
+    try
+    {
+      tic::handle(device).start_bootloader();
+    }
+    catch (const std::exception & e)
+    {
+      std::cout << serial_number << ": Error: " << e.what() << std::endl;
+      start_failure_count++;
+      serial_numbers.erase(std::find(serial_numbers.begin(),
+        serial_numbers.end(), serial_number));
+    }
+  }
+
+  std::vector<bootloader_instance> bootloaders = find_bootloaders(serial_numbers);
+
+  // Check again before erasing anything, in case a bootloader is not the one
+  // we expected.
+  std::vector<const firmware_archive::image *> images;
+  for (const bootloader_instance & instance : bootloaders)
+  {
+    const firmware_archive::image * image = archive.find_image(
+      instance.get_vendor_id(), instance.get_product_id());
+    if (image == NULL)
+    {
+      throw no_firmware_error(instance.get_serial_number(), instance.type.name);
+    }
+    images.push_back(image);
+  }
+
+  // Upgrade each device on its own thread.  The bootloader protocol is
+  // synchronous, so this is what lets the upgrades overlap.
+  size_t count = bootloaders.size();
+  fleet_progress progress(count);
+  std::vector<upgrade_result> results(count);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> finished_count{0};
+  for (size_t i = 0; i < count; i++)
+  {
+    threads.emplace_back([&, i]() {
+      upgrade_one_device(bootloaders[i], *images[i],
+        progress.get_listener(i), results[i]);
+      progress.set_done(i);
+      finished_count++;
+    });
+  }
+
+  if (count)
+  {
+    while (finished_count < count)
+    {
+      std::cout << "\r" << progress.get_line() << std::flush;
+      std::this_thread::sleep_for(
+        std::chrono::milliseconds(PROGRESS_INTERVAL_MS));
+    }
+    for (std::thread & thread : threads)
+    {
+      thread.join();
+    }
+    std::cout << "\r" << progress.get_line() << std::endl;
+  }
+
+  size_t failure_count = start_failure_count;
+  for (size_t i = 0; i < count; i++)
+  {
+    const upgrade_result & result = results[i];
+    std::cout << bootloaders[i].get_serial_number() << ": ";
+    if (result.success)
+    {
+      const bootloader_write_stats & stats = result.stats;
+      std::cout << "Done.  Wrote " << stats.bytes_written << " bytes in "
+        << std::fixed << std::setprecision(2)
+        << stats.write_time_us / 1000000.0 << " s ("
+        << std::setprecision(1) << stats.get_bytes_per_second() / 1000
+        << " kB/s), skipped " << stats.blocks_skipped << " blank blocks."
+        << std::endl;
+    }
+    else
+    {
+      std::cout << "Error: " << result.error_message << std::endl;
+      failure_count++;
+    }
+  }
+
+  if (failure_count)
+  {
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+      std::to_string(failure_count) + " of " +
+      std::to_string(count + start_failure_count) +
+      " firmware upgrades failed.");
+  }
+}
@@ -0,0 +1,644 @@
+// Runs simple G-code programs on machines where each axis has its own Tic,
+// like the XY tables that CAM software writes toolpaths for.
+//
+// These commands are supported:
+//
+//   G0, G1    Move in a straight line.  G1 moves at the feed rate from the F
+//             word, in units per minute, and G0 moves as fast as the limits
+//             from the settings allow.
+//   G4        Wait for P milliseconds or S seconds.
+//   G28       Home the named axes, or all of them, in the reverse direction.
+//   G90, G91  Use absolute or relative coordinates.
+//   G92       Set the current position of the named axes, or all of them to 0.
+//   M17       Energize the motors of the named axes, or all of them.
+//   M18       De-energize the motors of the named axes, or all of them.
+//   M2, M30   End the program.
+//
+// G17, G21, and G94 select what we do anyway, so they are accepted and
+// ignored.  Coordinates are multiplied by the scale to get microsteps.
+//
+// The program is read a few blocks ahead of the one that is running.  A run of
+// moves along the same line at the same feed rate is sent as one long move, so
+// the axes do not stop at the end of each of the short segments that CAM
+// software tends to write.  Moves are not blended across corners: each move
+// ends with every axis stopped at its target, so the axes stop at every corner
+// and at every change of feed rate.
+
+#include "cli.h"
+
+#include <deque>
+
+// How far a point where two moves meet can be from the straight line between
+// the start of the first and the end of the second, in microsteps, for us to
+// send them as one move.  This allows for rounding to whole microsteps.
+static const double merge_tolerance = 1.0;
+
+enum class gcode_action_type
+{
+  move,
+  dwell,
+  home,
+  set_position,
+  energize,
+  deenergize,
+};
+
+// One thing for the machine to do, with the coordinates already converted to
+// microsteps.
+struct gcode_action
+{
+  gcode_action_type type = gcode_action_type::move;
+  uint32_t line_number = 0;
+
+  // The axes that the action applies to, one bit per axis.
+  uint32_t axes = 0;
+
+  // For moves, the positions before and after.  For set_position, the new
+  // positions.
+  std::vector<int32_t> from;
+  std::vector<int32_t> to;
+
+  // The feed rate of a move in microsteps per second, or 0 to move as fast as
+  // possible.
+  double feed = 0;
+
+  // The number of moves in the program that this move covers.
+  uint32_t moves = 1;
+
+  uint32_t dwell_ms = 0;
+};
+
+// Reads a G-code program one action at a time, keeping track of the modal
+// state (the motion mode, coordinate mode, feed rate, and positions).
+class gcode_program
+{
+public:
+  gcode_program(const std::string & text, const std::string & axis_letters,
+    uint32_t scale, const std::vector<int32_t> & positions)
+    : input(text), axis_letters(axis_letters), scale(scale),
+      positions(positions)
+  {
+  }
+
+  // Gets the next action.  Returns false at the end of the program.
+  bool next(gcode_action & action)
+  {
+    while (pending.empty())
+    {
+      std::string line;
+      if (ended || !std::getline(input, line)) { return false; }
+      line_number++;
+      run_line(line);
+    }
+    action = pending.front();
+    pending.pop_front();
+    return true;
+  }
+
+private:
+  struct word
+  {
+    char letter;
+    double value;
+  };
+
+  [[noreturn]] void fail(const std::string & message)
+  {
+    throw exception_with_exit_code(EXIT_BAD_ARGS,
+      message + " on line " + std::to_string(line_number) + ".");
+  }
+
+  [[noreturn]] void fail_unsupported(const word & w)
+  {
+    std::ostringstream text;
+    text << w.letter << w.value;
+    fail("Unsupported G-code '" + text.str() + "'");
+  }
+
+  // Splits a line into words like "G1" and "X-2.5", skipping comments.
+  std::vector<word> parse_words(const std::string & line)
+  {
+    std::vector<word> words;
+    const char * p = line.c_str();
+    while (*p)
+    {
+      if (isspace((unsigned char)*p) || *p == '%') { p++; continue; }
+      if (*p == ';') { break; }
+      if (*p == '(')
+      {
+        const char * end = strchr(p, ')');
+        if (end == NULL) { fail("Unterminated comment"); }
+        p = end + 1;
+        continue;
+      }
+
+      // Anything after a '*' is a checksum.
+      if (*p == '*') { break; }
+
+      char letter = toupper((unsigned char)*p);
+      if (letter < 'A' || letter > 'Z')
+      {
+        fail(std::string("Unexpected character '") + *p + "'");
+      }
+      p++;
+
+      char * end;
+      double value = strtod(p, &end);
+      if (end == p || !std::isfinite(value))
+      {
+        fail(std::string("Missing number after '") + letter + "'");
+      }
+      p = end;
+      words.push_back({ letter, value });
+    }
+    return words;
+  }
+
+  int32_t to_microsteps(double value)
+  {
+    double microsteps = std::round(value * scale);
+    if (!(microsteps >= INT32_MIN && microsteps <= INT32_MAX))
+    {
+      fail("Position out of range");
+    }
+    return (int32_t)microsteps;
+  }
+
+  void run_line(const std::string & line)
+  {
+    std::vector<word> commands;
+    std::vector<double> values(axis_letters.size(), 0);
+    uint32_t axes = 0;
+    double p = -1, s = -1;
+    for (const word & w : parse_words(line))
+    {
+      size_t axis = axis_letters.find(w.letter);
+      if (w.letter == 'G' || w.letter == 'M')
+      {
+        if (w.value != std::floor(w.value)) { fail_unsupported(w); }
+        commands.push_back(w);
+      }
+      else if (axis != std::string::npos)
+      {
+        if (axes & (1 << axis))
+        {
+          fail(std::string("Repeated '") + w.letter + "'");
+        }
+        axes |= 1 << axis;
+        values[axis] = w.value;
+      }
+      else if (w.letter == 'F')
+      {
+        if (!(w.value > 0)) { fail("Invalid feed rate"); }
+        feed = w.value * scale / 60;
+      }
+      else if (w.letter == 'P') { p = w.value; }
+      else if (w.letter == 'S') { s = w.value; }
+      else if (w.letter == 'N') { }
+      else if (strchr("XYZABC", w.letter))
+      {
+        fail(std::string("Axis '") + w.letter + "' is not one of the --axes");
+      }
+      else
+      {
+        fail_unsupported(w);
+      }
+    }
+
+    uint32_t all_axes = (1 << axis_letters.size()) - 1;
+    bool axes_used = false;
+    for (const word & w : commands)
+    {
+      int code = (int)w.value;
+      gcode_action action;
+      action.line_number = line_number;
+      action.axes = axes ? axes : all_axes;
+
+      if (w.letter == 'G' && (code == 0 || code == 1))
+      {
+        motion = code;
+      }
+      else if (w.letter == 'G' && code == 4)
+      {
+        double ms = p >= 0 ? p : s >= 0 ? s * 1000 : -1;
+        if (!(ms >= 0 && ms <= UINT32_MAX)) { fail("Invalid dwell time"); }
+        action.type = gcode_action_type::dwell;
+        action.dwell_ms = (uint32_t)ms;
+        pending.push_back(action);
+      }
+      else if (w.letter == 'G' && (code == 17 || code == 21 || code == 94))
+      {
+      }
+      else if (w.letter == 'G' && code == 28)
+      {
+        // Homing finishes with the position set to 0.
+        action.type = gcode_action_type::home;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+          if (action.axes & (1 << i)) { positions[i] = 0; }
+        }
+        pending.push_back(action);
+        axes_used = true;
+      }
+      else if (w.letter == 'G' && (code == 90 || code == 91))
+      {
+        relative = code == 91;
+      }
+      else if (w.letter == 'G' && code == 92)
+      {
+        action.type = gcode_action_type::set_position;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+          if (action.axes & (1 << i)) { positions[i] = to_microsteps(values[i]); }
+        }
+        action.to = positions;
+        pending.push_back(action);
+        axes_used = true;
+      }
+      else if (w.letter == 'M' && (code == 17 || code == 18))
+      {
+        action.type = code == 17 ? gcode_action_type::energize :
+          gcode_action_type::deenergize;
+        pending.push_back(action);
+        axes_used = true;
+      }
+      else if (w.letter == 'M' && (code == 2 || code == 30))
+      {
+        ended = true;
+      }
+      else
+      {
+        fail_unsupported(w);
+      }
+    }
+
+    if (axes == 0 || axes_used) { return; }
+
+    if (motion < 0) { fail("Coordinates given before G0 or G1"); }
+    if (motion == 1 && feed == 0) { fail("G1 needs a feed rate (F)"); }
+
+    gcode_action action;
+    action.type = gcode_action_type::move;
+    action.line_number = line_number;
+    action.axes = axes;
+    action.from = positions;
+    action.feed = motion == 1 ? feed : 0;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+      if (axes & (1 << i))
+      {
+        positions[i] = to_microsteps(values[i]) +
+          (relative ? positions[i] : 0);
+      }
+    }
+    action.to = positions;
+    if (action.to != action.from) { pending.push_back(action); }
+  }
+
+  std::istringstream input;
+  std::string axis_letters;
+  uint32_t scale;
+  std::vector<int32_t> positions;
+
+  uint32_t line_number = 0;
+  int motion = -1;
+  bool relative = false;
+  double feed = 0;
+  bool ended = false;
+
+  std::deque<gcode_action> pending;
+};
+
+static double distance(const std::vector<int32_t> & a,
+  const std::vector<int32_t> & b)
+{
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    double d = (double)b[i] - a[i];
+    sum += d * d;
+  }
+  return std::sqrt(sum);
+}
+
+// Gets the distance from a point to the line through start and end.
+static double distance_from_line(const std::vector<int32_t> & point,
+  const std::vector<int32_t> & start, const std::vector<int32_t> & end)
+{
+  double length = distance(start, end);
+  if (length == 0) { return distance(start, point); }
+
+  double along = 0;
+  for (size_t i = 0; i < point.size(); i++)
+  {
+    along += ((double)point[i] - start[i]) * ((double)end[i] - start[i]);
+  }
+  along /= length;
+
+  double from_start = distance(start, point);
+  double squared = from_start * from_start - along * along;
+  return squared > 0 ? std::sqrt(squared) : 0;
+}
+
+// Runs the actions from a program on the axes, keeping a bounded queue of the
+// actions that come next.
+class gcode_machine
+{
+public:
+  gcode_machine(gcode_program & program, std::vector<tic::handle> & handles,
+    const std::string & axis_letters, size_t lookahead, uint32_t timeout_ms)
+    : program(program), handles(handles), axis_letters(axis_letters),
+      lookahead(lookahead), timeout_ms(timeout_ms)
+  {
+    std::vector<tic::handle *> handle_pointers;
+    for (tic::handle & handle : handles)
+    {
+      handle_pointers.push_back(&handle);
+      settings.push_back(handle.get_settings());
+    }
+    sync = tic::sync::create(handle_pointers);
+    arrival = tic::arrival::create();
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      arrival.set_axis_limits(i, settings[i]);
+    }
+  }
+
+  void run()
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+      fill();
+      while (!queue.empty())
+      {
+        gcode_action action = queue.front();
+        queue.pop_front();
+        fill();
+
+        if (action.type == gcode_action_type::move)
+        {
+          merge(action);
+          move(action);
+        }
+        else
+        {
+          run_action(action);
+        }
+      }
+    }
+    catch (...)
+    {
+      stop_after_error();
+      throw;
+    }
+
+    restore_limits();
+
+    elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+  void print_results() const
+  {
+    double seconds = elapsed_us / 1e6;
+    std::cout << "moves: " << moves << std::endl;
+    std::cout << "merged_moves: " << merged_moves << std::endl;
+    std::cout << "elapsed_ms: " << elapsed_us / 1000 << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "moves_per_s: " << (seconds > 0 ? moves / seconds : 0)
+      << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+private:
+  void fill()
+  {
+    gcode_action action;
+    while (queue.size() < lookahead && program.next(action))
+    {
+      queue.push_back(action);
+    }
+  }
+
+  // Extends the move with the moves after it in the queue for as long as they
+  // continue along the same line at the same feed rate.
+  void merge(gcode_action & action)
+  {
+    std::vector<std::vector<int32_t>> corners;
+    while (!queue.empty())
+    {
+      const gcode_action & next = queue.front();
+      if (next.type != gcode_action_type::move || next.feed != action.feed)
+      {
+        break;
+      }
+
+      double forward = 0;
+      for (size_t i = 0; i < action.to.size(); i++)
+      {
+        forward += ((double)action.to[i] - action.from[i]) *
+          ((double)next.to[i] - next.from[i]);
+      }
+      if (forward <= 0) { break; }
+
+      corners.push_back(action.to);
+      bool straight = true;
+      for (const std::vector<int32_t> & corner : corners)
+      {
+        if (distance_from_line(corner, action.from, next.to) > merge_tolerance)
+        {
+          straight = false;
+        }
+      }
+      if (!straight) { break; }
+
+      action.to = next.to;
+      action.axes |= next.axes;
+      action.moves += next.moves;
+      merged_moves += next.moves;
+      queue.pop_front();
+      fill();
+    }
+  }
+
+  void move(const gcode_action & action)
+  {
+    int64_t min_duration_us = 0;
+    if (action.feed != 0)
+    {
+      min_duration_us = (int64_t)(distance(action.from, action.to) /
+        action.feed * 1e6);
+    }
+    arrival.set_min_duration_us(min_duration_us);
+    arrival.move(sync, action.to);
+    limits_changed = true;
+    moves += action.moves;
+
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      tic::variables vars = handles[i].wait_until(
+        [](const tic::variables & vars)
+        {
+          return tic_wait_position_reached(vars.get_pointer(), NULL) ||
+            vars.get_error_status() != 0;
+        }, timeout_ms);
+
+      if (!tic_wait_position_reached(vars.get_pointer(), NULL))
+      {
+        fail(action, i, "stopped before reaching its target because of "
+          "errors");
+      }
+    }
+  }
+
+  void run_action(const gcode_action & action)
+  {
+    switch (action.type)
+    {
+    case gcode_action_type::dwell:
+      std::this_thread::sleep_for(std::chrono::milliseconds(action.dwell_ms));
+      break;
+
+    case gcode_action_type::home:
+      for (size_t i = 0; i < handles.size(); i++)
+      {
+        if (action.axes & (1 << i))
+        {
+          handles[i].go_home(TIC_GO_HOME_REVERSE);
+        }
+      }
+      for (size_t i = 0; i < handles.size(); i++)
+      {
+        if (!(action.axes & (1 << i))) { continue; }
+        tic::variables vars = handles[i].wait_until(
+          tic_wait_not_homing, timeout_ms);
+        if (vars.get_error_status() != 0)
+        {
+          fail(action, i, "stopped homing because of errors");
+        }
+      }
+      break;
+
+    case gcode_action_type::set_position:
+      for (size_t i = 0; i < handles.size(); i++)
+      {
+        if (action.axes & (1 << i))
+        {
+          handles[i].halt_and_set_position(action.to[i]);
+        }
+      }
+      break;
+
+    case gcode_action_type::energize:
+      for (size_t i = 0; i < handles.size(); i++)
+      {
+        if (action.axes & (1 << i))
+        {
+          handles[i].energize();
+          handles[i].exit_safe_start();
+        }
+      }
+      break;
+
+    case gcode_action_type::deenergize:
+      for (size_t i = 0; i < handles.size(); i++)
+      {
+        if (action.axes & (1 << i))
+        {
+          handles[i].deenergize();
+        }
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  // Moves change the speed and acceleration limits of the axes, so put back
+  // the ones from the settings when the program is done.
+  void restore_limits()
+  {
+    if (!limits_changed) { return; }
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      const tic_settings * s = settings[i].get_pointer();
+      handles[i].set_max_speed(tic_settings_get_max_speed(s));
+      handles[i].set_max_accel(tic_settings_get_max_accel(s));
+      handles[i].set_max_decel(tic_settings_get_max_decel(s));
+    }
+  }
+
+  // Stops the other axes and puts back their limits, without letting a second
+  // error hide the one that stopped the program.
+  void stop_after_error()
+  {
+    try
+    {
+      sync.halt_and_hold();
+    }
+    catch (const std::exception &)
+    {
+    }
+
+    try
+    {
+      restore_limits();
+    }
+    catch (const std::exception &)
+    {
+    }
+  }
+
+  [[noreturn]] void fail(const gcode_action & action, size_t axis,
+    const std::string & message)
+  {
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+      std::string("Axis ") + axis_letters[axis] + " " + message +
+      " on line " + std::to_string(action.line_number) + ".");
+  }
+
+  gcode_program & program;
+  std::vector<tic::handle> & handles;
+  std::string axis_letters;
+  size_t lookahead;
+  uint32_t timeout_ms;
+
+  std::vector<tic::settings> settings;
+  tic::sync sync;
+  tic::arrival arrival;
+  std::deque<gcode_action> queue;
+  bool limits_changed = false;
+
+  uint32_t moves = 0;
+  uint32_t merged_moves = 0;
+  int64_t elapsed_us = 0;
+};
+
+void run_gcode(const std::vector<std::string> & serial_numbers,
+  const std::string & axis_letters, const std::string & filename,
+  uint32_t scale, uint32_t lookahead, uint32_t timeout_ms)
+{
+  std::string text = read_string_from_file_or_pipe(filename);
+
+  // Read the whole program once before running it so that a mistake near the
+  // end does not leave the machine stopped halfway through.
+  std::vector<int32_t> positions(serial_numbers.size(), 0);
+  gcode_program check(text, axis_letters, scale, positions);
+  gcode_action action;
+  while (check.next(action)) { }
+
+  std::vector<tic::handle> handles = open_axes(serial_numbers);
+  for (size_t i = 0; i < handles.size(); i++)
+  {
+    positions[i] = handles[i].get_variables().get_current_position();
+  }
+
+  gcode_program program(text, axis_letters, scale, positions);
+  gcode_machine machine(program, handles, axis_letters, lookahead, timeout_ms);
+  machine.run();
+  machine.print_results();
+}
@@ -312,3 +312,80 @@ void print_status(const tic::variables & vars,
     std::cout << std::endl;
   }
 }
+
+static std::string latency_string(uint64_t us)
+{
+  return std::to_string(us) + " us";
+}
+
+void print_stats(const tic::stats & stats)
+{
+  bool any = false;
+  for (uint32_t request = 0; request < 256; request++)
+  {
+    uint64_t count = stats.get_count(request);
+    if (count == 0) { continue; }
+    any = true;
+
+    std::cout << std::left << std::setfill(' ');
+    std::cout << tic_look_up_command_name_ui(request) << ":" << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Count: "
+      << count << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Errors: "
+      << stats.get_error_count(request) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Timeouts: "
+      << stats.get_timeout_count(request) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Average: "
+      << latency_string(stats.get_total_us(request) / count) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Median: "
+      << latency_string(stats.get_percentile_us(request, 50)) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "90th percentile: "
+      << latency_string(stats.get_percentile_us(request, 90)) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "99th percentile: "
+      << latency_string(stats.get_percentile_us(request, 99)) << std::endl;
+    std::cout << "  " << std::setw(left_column_width - 2) << "Max: "
+      << latency_string(stats.get_max_us(request)) << std::endl;
+
+    // Each bucket is labeled with the longest latency it holds.
+    std::cout << "  Histogram:" << std::endl;
+    for (uint32_t bucket = 0; bucket < TIC_STATS_BUCKET_COUNT; bucket++)
+    {
+      uint64_t bucket_count = stats.get_bucket(request, bucket);
+      if (bucket_count == 0) { continue; }
+      uint64_t limit = tic_stats_get_bucket_limit_us(bucket);
+      std::string label = limit == UINT64_MAX ? "More" :
+        "Up to " + latency_string(limit);
+      std::cout << "    " << std::setw(left_column_width - 4) << label + ": "
+        << bucket_count << std::endl;
+    }
+  }
+
+  if (!any)
+  {
+    std::cout << "No requests were sent." << std::endl;
+  }
+}
+
+void print_idle_current(const tic::idle_current & idle)
+{
+  std::cout << std::left << std::setfill(' ');
+  std::cout << left_column << "Idle current reduced: "
+    << (idle.get_reduced() ? "Yes" : "No") << std::endl;
+  std::cout << left_column << "Idle current limit: "
+    << idle.get_idle_current_limit() << " mA" << std::endl;
+  std::cout << left_column << "Full current limit: "
+    << idle.get_full_current_limit() << " mA" << std::endl;
+  std::cout << left_column << "Idle reductions: "
+    << idle.get_reduction_count() << std::endl;
+  std::cout << left_column << "Idle restores: "
+    << idle.get_restore_count() << std::endl;
+  std::cout << left_column << "Idle time reduced: "
+    << idle.get_reduced_us() / 1000 << " ms" << std::endl;
+  std::cout << left_column << "Idle current^2 saved: "
+    << std::fixed << std::setprecision(4) << idle.get_saved_a2s()
+    << " A^2 s" << std::endl;
+  std::cout << left_column << "Idle max restore latency: "
+    << latency_string(idle.get_max_restore_us()) << std::endl;
+  std::cout << left_column << "Idle errors: "
+    << idle.get_error_count() << std::endl;
+}
@@ -0,0 +1,110 @@
+// Streams a timed sequence of targets from a file to the selected device.
+//
+// Each line of the file has a time in microseconds from the start of the
+// stream, the word "position" or "velocity", and a target, for example:
+//
+//   0     velocity 2000000
+//   2500  velocity 2100000
+//   5000  position 1200
+//
+// Blank lines and everything after a '#' are ignored.
+
+#include "cli.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+static void add_points(tic::stream & stream, const std::string & filename)
+{
+  std::istringstream input(read_string_from_file_or_pipe(filename));
+  std::string line;
+  uint32_t line_number = 0;
+  while (std::getline(input, line))
+  {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+
+    std::istringstream fields(line);
+    std::string time_string, kind, target_string;
+    if (!(fields >> time_string)) { continue; }
+    fields >> kind >> target_string;
+
+    std::string extra;
+    int64_t time_us;
+    int32_t target;
+    uint8_t planning_mode = 0;
+    if (kind == "position") { planning_mode = TIC_PLANNING_MODE_TARGET_POSITION; }
+    if (kind == "velocity") { planning_mode = TIC_PLANNING_MODE_TARGET_VELOCITY; }
+    if (planning_mode == 0 || fields >> extra ||
+      string_to_int(time_string.c_str(), &time_us) || time_us < 0 ||
+      string_to_int(target_string.c_str(), &target))
+    {
+      throw exception_with_exit_code(EXIT_BAD_ARGS,
+        "Invalid stream point on line " + std::to_string(line_number) +
+        ": '" + line + "'.");
+    }
+
+    stream.add_point(time_us, planning_mode, target);
+  }
+}
+
+// Locks all of our memory into RAM so page faults do not delay the stream.
+// ticcmd exits after streaming, so we never unlock it.
+static void lock_process_memory()
+{
+#ifdef _WIN32
+  throw exception_with_exit_code(EXIT_BAD_ARGS,
+    "Locking memory is not supported on Windows.");
+#else
+  if (mlockall(MCL_CURRENT | MCL_FUTURE))
+  {
+    throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+      std::string("Failed to lock memory: ") + strerror(errno) + ".");
+  }
+#endif
+}
+
+static double ns_to_us(int64_t ns)
+{
+  return ns / 1000.0;
+}
+
+// Prints how well the stream kept to its schedule as YAML, like the output of
+// --benchmark.
+static void print_stream_results(const tic::stream & stream)
+{
+  std::cout << "points: " << stream.get_point_count() << std::endl;
+  std::cout << "sent: " << stream.get_sent_count() << std::endl;
+  std::cout << "missed: " << stream.get_missed_count() << std::endl;
+  std::cout << "skipped: " << stream.get_skipped_count() << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "lateness:" << std::endl;
+  std::cout << "  p50_us: " << ns_to_us(stream.get_lateness_ns(50)) << std::endl;
+  std::cout << "  p99_us: " << ns_to_us(stream.get_lateness_ns(99)) << std::endl;
+  std::cout << "  max_us: " << ns_to_us(stream.get_lateness_ns(100)) << std::endl;
+  std::cout << "send_time:" << std::endl;
+  std::cout << "  p50_us: " << ns_to_us(stream.get_send_time_ns(50)) << std::endl;
+  std::cout << "  p99_us: " << ns_to_us(stream.get_send_time_ns(99)) << std::endl;
+  std::cout << "  max_us: " << ns_to_us(stream.get_send_time_ns(100)) << std::endl;
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+}
+
+void stream_targets(tic::handle & handle, const std::string & filename,
+  int priority, int cpu, bool lock_memory)
+{
+  tic::stream stream = tic::stream::create();
+  add_points(stream, filename);
+  stream.set_priority(priority);
+  stream.set_cpu(cpu);
+
+  if (lock_memory) { lock_process_memory(); }
+
+  stream.start(handle);
+  stream.wait();
+
+  print_stream_results(stream);
+}
@@ -0,0 +1,160 @@
+// Sends commands to several devices at the same time, for machines where each
+// axis has its own Tic.
+
+#include "cli.h"
+
+// Opens a handle to each of the devices with the given serial numbers, in the
+// same order.
+std::vector<tic::handle> open_axes(
+  const std::vector<std::string> & serial_numbers)
+{
+  std::vector<tic::device> list = tic::list_connected_devices();
+  std::vector<tic::handle> handles;
+  for (const std::string & serial_number : serial_numbers)
+  {
+    auto it = std::find_if(list.begin(), list.end(),
+      [&](const tic::device & device)
+      {
+        return device.get_serial_number() == serial_number;
+      });
+    if (it == list.end())
+    {
+      throw exception_with_exit_code(EXIT_DEVICE_NOT_FOUND,
+        "No device was found with serial number '" + serial_number + "'.");
+    }
+    handles.push_back(tic::handle(*it));
+  }
+  return handles;
+}
+
+// The speed and acceleration limits that a Tic is using.
+struct axis_limits
+{
+  uint32_t max_speed;
+  uint32_t max_accel;
+  uint32_t max_decel;
+};
+
+static void set_limits(tic::handle & handle, const axis_limits & limits)
+{
+  handle.set_max_speed(limits.max_speed);
+  handle.set_max_accel(limits.max_accel);
+  handle.set_max_decel(limits.max_decel);
+}
+
+// Waits for every axis to reach its target.
+static void wait_for_arrival(std::vector<tic::handle> & handles,
+  const std::vector<std::string> & serial_numbers, uint32_t timeout_ms)
+{
+  for (size_t i = 0; i < handles.size(); i++)
+  {
+    tic::variables vars = handles[i].wait_until(
+      [](const tic::variables & vars)
+      {
+        return tic_wait_position_reached(vars.get_pointer(), NULL) ||
+          vars.get_error_status() != 0;
+      }, timeout_ms);
+
+    if (!tic_wait_position_reached(vars.get_pointer(), NULL))
+    {
+      throw exception_with_exit_code(EXIT_OPERATION_FAILED,
+        "Device " + serial_numbers[i] + " stopped before reaching its "
+        "target because of errors.");
+    }
+  }
+}
+
+// Plans the move so that every axis finishes at the same time, using the
+// limits from each device's settings.  Prints how long the move will take and
+// the speed of each axis.
+//
+// The move changes the speed and acceleration limits of each Tic, so this
+// waits for the axes to get there and then puts back the limits they had
+// before, even if there is an error.
+static void arrival_move(tic::sync & sync, std::vector<tic::handle> & handles,
+  const std::vector<std::string> & serial_numbers,
+  const std::vector<int32_t> & positions, uint32_t timeout_ms)
+{
+  tic::arrival arrival = tic::arrival::create();
+  std::vector<axis_limits> original_limits;
+  for (size_t i = 0; i < handles.size(); i++)
+  {
+    arrival.set_axis_limits(i, handles[i].get_settings());
+
+    tic::variables vars = handles[i].get_variables();
+    original_limits.push_back({ vars.get_max_speed(), vars.get_max_accel(),
+      vars.get_max_decel() });
+  }
+
+  try
+  {
+    arrival.move(sync, positions);
+    wait_for_arrival(handles, serial_numbers, timeout_ms);
+  }
+  catch (...)
+  {
+    // Do not let an error here hide the one that stopped the move.
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      try
+      {
+        set_limits(handles[i], original_limits[i]);
+      }
+      catch (const std::exception &)
+      {
+      }
+    }
+    throw;
+  }
+
+  for (size_t i = 0; i < handles.size(); i++)
+  {
+    set_limits(handles[i], original_limits[i]);
+  }
+
+  std::cout << "duration_ms: " << arrival.get_duration_us() / 1000 << std::endl;
+  std::cout << "max_speed:" << std::endl;
+  for (size_t i = 0; i < serial_numbers.size(); i++)
+  {
+    std::cout << "  '" << serial_numbers[i] << "': "
+      << arrival.get_axis_max_speed(i) << std::endl;
+  }
+}
+
+void sync_axes(const std::vector<std::string> & serial_numbers,
+  const std::vector<int32_t> & positions, bool halt, bool arrival,
+  uint32_t timeout_ms)
+{
+  std::vector<tic::handle> handles = open_axes(serial_numbers);
+  std::vector<tic::handle *> handle_pointers;
+  for (tic::handle & handle : handles)
+  {
+    handle_pointers.push_back(&handle);
+  }
+
+  tic::sync sync = tic::sync::create(handle_pointers);
+  if (halt)
+  {
+    sync.halt_and_hold();
+  }
+  else if (arrival)
+  {
+    arrival_move(sync, handles, serial_numbers, positions, timeout_ms);
+  }
+  else
+  {
+    sync.set_target_positions(positions);
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "issue_skew_us: " << sync.get_issue_skew_ns() / 1000.0 << std::endl;
+  std::cout << "complete_skew_us: " << sync.get_complete_skew_ns() / 1000.0 << std::endl;
+  std::cout << "issue_offset_us:" << std::endl;
+  for (size_t i = 0; i < serial_numbers.size(); i++)
+  {
+    std::cout << "  '" << serial_numbers[i] << "': "
+      << sync.get_issue_offset_ns(i) / 1000.0 << std::endl;
+  }
+  std::cout.unsetf(std::ios::floatfield);
+  std::cout << std::setprecision(6);
+}
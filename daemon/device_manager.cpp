@@ -0,0 +1,285 @@
+#include "device_manager.h"
+#include <tic_usb.h>
+
+// How long the polling thread keeps reading a variable segment after the last
+// time a client asked for it.
+static const std::chrono::milliseconds POLL_KEEPALIVE(1000);
+
+// The same timeout that libpololu-tic uses for control transfers.
+static const uint32_t USB_TIMEOUT_MS = 1600;
+
+static request_result error_result(const std::string & message,
+  uint8_t error_flags = 0)
+{
+  request_result result;
+  result.status = TICD_STATUS_ERROR;
+  result.error_flags = error_flags;
+  result.data.assign(message.begin(), message.end());
+  return result;
+}
+
+// Converts the error codes of a libusbp error to the flags used in the ticd
+// protocol, which are based on the tic_error_code enum.
+static uint8_t usb_error_flags(const libusbp::error & error)
+{
+  uint8_t flags = 0;
+  if (error.has_code(LIBUSBP_ERROR_MEMORY))
+  {
+    flags |= 1 << TIC_ERROR_MEMORY;
+  }
+  if (error.has_code(LIBUSBP_ERROR_ACCESS_DENIED))
+  {
+    flags |= 1 << TIC_ERROR_ACCESS_DENIED;
+  }
+  if (error.has_code(LIBUSBP_ERROR_TIMEOUT))
+  {
+    flags |= 1 << TIC_ERROR_TIMEOUT;
+  }
+  if (error.has_code(LIBUSBP_ERROR_DEVICE_DISCONNECTED))
+  {
+    flags |= 1 << TIC_ERROR_DEVICE_DISCONNECTED;
+  }
+  return flags;
+}
+
+void device_manager::start()
+{
+  if (poll_thread.joinable()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = false;
+  }
+  poll_thread = std::thread(&device_manager::run, this);
+}
+
+void device_manager::stop()
+{
+  if (!poll_thread.joinable()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = true;
+  }
+  condition.notify_all();
+  poll_thread.join();
+}
+
+std::shared_ptr<managed_device> device_manager::acquire(
+  const std::string & serial_number)
+{
+  std::shared_ptr<managed_device> device;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<managed_device> & entry = devices[serial_number];
+    if (!entry)
+    {
+      entry = std::make_shared<managed_device>(serial_number);
+    }
+    entry->client_count++;
+    device = entry;
+  }
+
+  try
+  {
+    std::lock_guard<std::mutex> device_lock(device->mutex);
+    if (!device->handle) { open(*device); }
+  }
+  catch (...)
+  {
+    release(device);
+    throw;
+  }
+  return device;
+}
+
+void device_manager::release(const std::shared_ptr<managed_device> & device)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (--device->client_count == 0)
+  {
+    // The handle gets closed when the last reference to the device goes away,
+    // which might be in a thread that is polling it right now.
+    devices.erase(device->serial_number);
+  }
+}
+
+// Finds the Tic with the device's serial number and opens it.  The caller must
+// hold the device's mutex.
+void device_manager::open(managed_device & device)
+{
+  for (const libusbp::device & usb_device : libusbp::list_connected_devices())
+  {
+    // Let libpololu-tic decide whether this is a Tic that is ready to use.
+    tic_device * p = NULL;
+    tic::throw_if_needed(tic_device_create_from_usb_device(
+      usb_device.pointer_get(), NULL, &p));
+    tic::device tic_device(p);
+    if (!tic_device) { continue; }
+    if (tic_device.get_serial_number() != device.serial_number) { continue; }
+
+    libusbp::generic_interface usb_interface(usb_device);
+    device.handle = libusbp::generic_handle(usb_interface);
+    device.handle.set_timeout(0, USB_TIMEOUT_MS);
+    device.cached_reads.clear();
+    return;
+  }
+
+  throw std::runtime_error("No Tic with serial number '" +
+    device.serial_number + "' is connected.");
+}
+
+// Returns true for the requests that the polling thread can answer.
+bool device_manager::cacheable(const ticd_request_header & request)
+{
+  return request.request_type == 0xC0 &&
+    request.request == TIC_CMD_GET_VARIABLE &&
+    request.value == 0;
+}
+
+request_result device_manager::control_transfer(managed_device & device,
+  const ticd_request_header & request, const std::vector<uint8_t> & data)
+{
+  stats.client_requests++;
+
+  std::lock_guard<std::mutex> device_lock(device.mutex);
+
+  if (!cacheable(request))
+  {
+    // This could change the variables, so make sure no client sees variables
+    // that were read before it.
+    device.cached_reads.clear();
+    return transfer(device, request, data);
+  }
+
+  uint32_t key = (uint32_t)request.index << 16 | request.length;
+  auto now = std::chrono::steady_clock::now();
+
+  auto it = device.cached_reads.find(key);
+  if (it != device.cached_reads.end() && now - it->second.time < interval)
+  {
+    it->second.last_requested = now;
+    stats.cached_responses++;
+    request_result result;
+    result.data = it->second.data;
+    return result;
+  }
+
+  request_result result = transfer(device, request, data);
+  if (result.status == TICD_STATUS_OK)
+  {
+    managed_device::cached_read & entry = device.cached_reads[key];
+    entry.data = result.data;
+    entry.time = std::chrono::steady_clock::now();
+    entry.last_requested = now;
+  }
+  return result;
+}
+
+// Does a control transfer on the device.  The caller must hold the device's
+// mutex.
+request_result device_manager::transfer(managed_device & device,
+  const ticd_request_header & request, const std::vector<uint8_t> & data)
+{
+  try
+  {
+    // If the device was disconnected or reset, try to open it again.
+    if (!device.handle) { open(device); }
+  }
+  catch (const std::exception & e)
+  {
+    return error_result(e.what(),
+      1 << TIC_ERROR_DEVICE_DISCONNECTED);
+  }
+
+  request_result result;
+  try
+  {
+    stats.usb_transfers++;
+    if (request.request_type & 0x80)
+    {
+      result.data.resize(request.length);
+      size_t transferred = 0;
+      device.handle.control_transfer(request.request_type, request.request,
+        request.value, request.index, result.data.data(), request.length,
+        &transferred);
+      result.data.resize(transferred);
+    }
+    else
+    {
+      device.handle.control_transfer(request.request_type, request.request,
+        request.value, request.index, (void *)data.data(), data.size());
+    }
+  }
+  catch (const libusbp::error & error)
+  {
+    uint8_t flags = usb_error_flags(error);
+    if (flags & (1 << TIC_ERROR_DEVICE_DISCONNECTED))
+    {
+      device.handle.close();
+    }
+    return error_result(error.message(), flags);
+  }
+  return result;
+}
+
+void device_manager::run()
+{
+  auto next_poll = std::chrono::steady_clock::now();
+  while (true)
+  {
+    std::vector<std::shared_ptr<managed_device>> devices_copy;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait_until(lock, next_poll, [&]{ return stop_requested; });
+      if (stop_requested) { return; }
+      for (const auto & pair : devices)
+      {
+        devices_copy.push_back(pair.second);
+      }
+    }
+
+    for (const std::shared_ptr<managed_device> & device : devices_copy)
+    {
+      poll(*device);
+    }
+
+    // If polling took longer than the interval, skip the polls we missed
+    // instead of polling continuously.
+    next_poll += interval;
+    auto now = std::chrono::steady_clock::now();
+    if (next_poll < now) { next_poll = now + interval; }
+  }
+}
+
+// Refreshes the variables that clients have asked for recently.
+void device_manager::poll(managed_device & device)
+{
+  std::lock_guard<std::mutex> device_lock(device.mutex);
+  if (!device.handle) { return; }
+
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = device.cached_reads.begin(); it != device.cached_reads.end();)
+  {
+    managed_device::cached_read & entry = it->second;
+    if (now - entry.last_requested > POLL_KEEPALIVE)
+    {
+      it = device.cached_reads.erase(it);
+      continue;
+    }
+
+    ticd_request_header request = {};
+    request.request_type = 0xC0;
+    request.request = TIC_CMD_GET_VARIABLE;
+    request.index = it->first >> 16;
+    request.length = it->first & 0xFFFF;
+    request_result result = transfer(device, request, {});
+    if (result.status != TICD_STATUS_OK)
+    {
+      // Let the next client request report the error.
+      it = device.cached_reads.erase(it);
+      continue;
+    }
+    entry.data = std::move(result.data);
+    entry.time = std::chrono::steady_clock::now();
+    ++it;
+  }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <tic.hpp>
+#include <ticd_protocol.h>
+#include <libusbp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The result of a request that ticd did on behalf of a client.
+struct request_result
+{
+  uint8_t status = TICD_STATUS_OK;
+  uint8_t error_flags = 0;
+  std::vector<uint8_t> data;
+};
+
+// Counters that ticd prints when it exits, to show how much USB traffic was
+// saved by sharing devices between clients.
+struct device_manager_stats
+{
+  std::atomic<uint64_t> client_requests{0};
+  std::atomic<uint64_t> cached_responses{0};
+  std::atomic<uint64_t> usb_transfers{0};
+};
+
+// A Tic that one or more clients have opened.
+class managed_device
+{
+public:
+  explicit managed_device(const std::string & serial_number)
+    : serial_number(serial_number)
+  {
+  }
+
+  const std::string serial_number;
+
+private:
+  friend class device_manager;
+
+  // A copy of the response to a "Get variables" request, so that other
+  // clients asking for the same variables can get them without any USB
+  // traffic.
+  struct cached_read
+  {
+    std::vector<uint8_t> data;
+    std::chrono::steady_clock::time_point time;
+    std::chrono::steady_clock::time_point last_requested;
+  };
+
+  // Held while talking to the device, so requests from different clients are
+  // never interleaved.  Protects everything below.
+  std::mutex mutex;
+  libusbp::generic_handle handle;
+  std::map<uint32_t, cached_read> cached_reads;
+
+  // Protected by the device manager's mutex.
+  size_t client_count = 0;
+};
+
+// Owns the USB handles of all the Tics that ticd's clients are using.
+//
+// Every request for a device is done while holding that device's mutex, so
+// commands from different clients are serialized.  "Get variables" requests
+// that do not clear the "errors occurred" bits are the ones clients send over
+// and over to monitor a device, so a polling thread reads those variables from
+// each open device once per interval, and every client gets the latest copy
+// without any USB traffic.  Any command sent to a device discards its cached
+// variables, so a client always sees the effects of its own commands.
+class device_manager
+{
+public:
+  explicit device_manager(uint32_t interval_ms) : interval(interval_ms)
+  {
+  }
+
+  ~device_manager() { stop(); }
+
+  void start();
+  void stop();
+
+  // Returns the device with the specified serial number, opening it if no
+  // other clients are using it.  Throws an exception if it cannot be opened.
+  std::shared_ptr<managed_device> acquire(const std::string & serial_number);
+
+  // Tells the manager that a client is done with a device.  The handle is
+  // closed when no clients are using it.
+  void release(const std::shared_ptr<managed_device> & device);
+
+  // Does a control transfer on behalf of a client.
+  request_result control_transfer(managed_device & device,
+    const ticd_request_header & request, const std::vector<uint8_t> & data);
+
+  const device_manager_stats & get_stats() const { return stats; }
+
+private:
+  static bool cacheable(const ticd_request_header & request);
+
+  void open(managed_device & device);
+  request_result transfer(managed_device & device,
+    const ticd_request_header & request, const std::vector<uint8_t> & data);
+
+  void run();
+  void poll(managed_device & device);
+
+  const std::chrono::milliseconds interval;
+
+  // Protects the devices map, the client counts, and stop_requested.  To avoid
+  // deadlocks, never lock a device's mutex while holding this.
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::map<std::string, std::shared_ptr<managed_device>> devices;
+  bool stop_requested = false;
+
+  std::thread poll_thread;
+
+  device_manager_stats stats;
+};
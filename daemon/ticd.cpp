@@ -0,0 +1,306 @@
+// ticd: A daemon that owns the USB handles of the Tics connected to the
+// computer and lets many local programs use them at the same time.
+
+#include "device_manager.h"
+#include "config.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // SIGPIPE is ignored instead.
+#endif
+
+static const char help[] =
+  "ticd: Pololu Tic Daemon\n"
+  "Version " SOFTWARE_VERSION_STRING "\n"
+  "Usage: ticd OPTIONS\n"
+  "\n"
+  "Options:\n"
+  "  --socket PATH                Listen on this socket instead of\n"
+  "                               " TICD_DEFAULT_SOCKET_PATH ".\n"
+  "  --interval MS                How often to read the variables of each\n"
+  "                               device that a client is monitoring (default\n"
+  "                               20 ms).\n"
+  "  -h, --help                   Show this help screen.\n"
+  "\n"
+  "To make programs that use libpololu-tic (such as " CLI_NAME " and " GUI_NAME ")\n"
+  "talk to Tics through ticd, set the " TICD_SOCKET_ENV_VAR " environment\n"
+  "variable to the path of the socket.\n"
+  "\n";
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_signal(int)
+{
+  stop_requested = 1;
+}
+
+struct arguments
+{
+  std::string socket_path = TICD_DEFAULT_SOCKET_PATH;
+  uint32_t interval_ms = 20;
+  bool show_help = false;
+};
+
+static arguments parse_args(int argc, char ** argv)
+{
+  arguments args;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--socket" || arg == "--interval")
+    {
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Expected an argument after '" + arg + "'.");
+      }
+      std::string value = argv[++i];
+      if (arg == "--socket")
+      {
+        args.socket_path = value;
+      }
+      else
+      {
+        char * end;
+        unsigned long interval = strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end || interval == 0 || interval > 60000)
+        {
+          throw std::runtime_error("Invalid interval: '" + value + "'.");
+        }
+        args.interval_ms = interval;
+      }
+    }
+    else if (arg == "-h" || arg == "--help")
+    {
+      args.show_help = true;
+    }
+    else
+    {
+      throw std::runtime_error("Unknown option: '" + arg + "'.");
+    }
+  }
+  return args;
+}
+
+static bool read_all(int fd, uint8_t * data, size_t size)
+{
+  while (size)
+  {
+    ssize_t received = recv(fd, data, size, 0);
+    if (received < 0 && errno == EINTR) { continue; }
+    if (received <= 0) { return false; }
+    data += received;
+    size -= received;
+  }
+  return true;
+}
+
+static bool write_all(int fd, const uint8_t * data, size_t size)
+{
+  while (size)
+  {
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) { continue; }
+    if (sent <= 0) { return false; }
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+static bool send_result(int fd, const request_result & result)
+{
+  ticd_response_header header;
+  header.status = result.status;
+  header.error_flags = result.error_flags;
+  header.length = std::min<size_t>(result.data.size(), TICD_MAX_DATA_SIZE);
+
+  uint8_t buffer[TICD_RESPONSE_HEADER_SIZE];
+  ticd_response_header_encode(&header, buffer);
+  return write_all(fd, buffer, sizeof(buffer)) &&
+    write_all(fd, result.data.data(), header.length);
+}
+
+static request_result error_result(const std::string & message)
+{
+  request_result result;
+  result.status = TICD_STATUS_ERROR;
+  result.data.assign(message.begin(), message.end());
+  return result;
+}
+
+// Handles the requests from one client until it disconnects.
+static void serve_client(device_manager & manager, int fd)
+{
+  std::shared_ptr<managed_device> device;
+
+  while (true)
+  {
+    uint8_t buffer[TICD_REQUEST_HEADER_SIZE];
+    if (!read_all(fd, buffer, sizeof(buffer))) { break; }
+
+    ticd_request_header request;
+    ticd_request_header_decode(buffer, &request);
+    if (request.length > TICD_MAX_DATA_SIZE) { break; }
+
+    bool has_data = request.op == TICD_OP_OPEN ||
+      (request.op == TICD_OP_CONTROL_TRANSFER && !(request.request_type & 0x80));
+    std::vector<uint8_t> data;
+    if (has_data)
+    {
+      data.resize(request.length);
+      if (!read_all(fd, data.data(), data.size())) { break; }
+    }
+
+    request_result result;
+    if (request.op == TICD_OP_OPEN)
+    {
+      if (device)
+      {
+        manager.release(device);
+        device.reset();
+      }
+      try
+      {
+        device = manager.acquire(std::string(data.begin(), data.end()));
+      }
+      catch (const std::exception & e)
+      {
+        result = error_result(e.what());
+      }
+    }
+    else if (request.op == TICD_OP_CONTROL_TRANSFER)
+    {
+      if (device)
+      {
+        result = manager.control_transfer(*device, request, data);
+      }
+      else
+      {
+        result = error_result("No device has been opened.");
+      }
+    }
+    else
+    {
+      break;
+    }
+
+    if (!send_result(fd, result)) { break; }
+  }
+
+  if (device) { manager.release(device); }
+  close(fd);
+}
+
+// Creates the listening socket, replacing the socket file left behind by a
+// previous ticd that did not exit cleanly.
+static int listen_on(const std::string & path)
+{
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+  {
+    throw std::runtime_error("The socket path is too long.");
+  }
+  strcpy(address.sun_path, path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    throw std::runtime_error(std::string("Failed to create socket: ") +
+      strerror(errno) + ".");
+  }
+
+  if (connect(fd, (const sockaddr *)&address, sizeof(address)) == 0)
+  {
+    close(fd);
+    throw std::runtime_error("ticd is already running on " + path + ".");
+  }
+  close(fd);
+  unlink(path.c_str());
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 ||
+    bind(fd, (const sockaddr *)&address, sizeof(address)) ||
+    listen(fd, 16))
+  {
+    int error_code = errno;
+    if (fd >= 0) { close(fd); }
+    throw std::runtime_error(path + ": " + strerror(error_code) + ".");
+  }
+  return fd;
+}
+
+static void run(const arguments & args)
+{
+  int listen_fd = listen_on(args.socket_path);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  device_manager manager(args.interval_ms);
+  manager.start();
+
+  std::cerr << "ticd: Listening on " << args.socket_path << "." << std::endl;
+
+  while (!stop_requested)
+  {
+    pollfd p = { listen_fd, POLLIN, 0 };
+    int result = poll(&p, 1, 200);
+    if (result <= 0) { continue; }
+
+    int client_fd = accept(listen_fd, NULL, NULL);
+    if (client_fd < 0) { continue; }
+
+    // Clients are never waited for: when ticd exits, their connections are
+    // simply closed.
+    std::thread(serve_client, std::ref(manager), client_fd).detach();
+  }
+
+  close(listen_fd);
+  unlink(args.socket_path.c_str());
+
+  const device_manager_stats & stats = manager.get_stats();
+  std::cerr << "ticd: " << stats.client_requests << " client requests, "
+    << stats.cached_responses << " answered from cache, "
+    << stats.usb_transfers << " USB transfers." << std::endl;
+
+  // Exit without destroying the device manager, since client threads might
+  // still be using it.
+  std::_Exit(0);
+}
+
+int main(int argc, char ** argv)
+{
+  try
+  {
+    arguments args = parse_args(argc, argv);
+    if (args.show_help)
+    {
+      std::cout << help;
+      return 0;
+    }
+    run(args);
+  }
+  catch (const std::exception & e)
+  {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
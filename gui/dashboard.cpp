@@ -0,0 +1,241 @@
+#include "dashboard.h"
+
+void dashboard_poller::start()
+{
+  if (running()) { return; }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = false;
+    cursor = 0;
+    next_cycle_time = std::chrono::steady_clock::now();
+  }
+
+  for (size_t i = 0; i < worker_count; i++)
+  {
+    workers.emplace_back(&dashboard_poller::run, this);
+  }
+}
+
+void dashboard_poller::stop()
+{
+  if (!running()) { return; }
+
+  std::vector<std::shared_ptr<entry>> entries_copy;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = true;
+    entries_copy = entries;
+  }
+  condition.notify_all();
+
+  for (std::thread & worker : workers)
+  {
+    worker.join();
+  }
+  workers.clear();
+
+  for (const std::shared_ptr<entry> & e : entries_copy)
+  {
+    std::lock_guard<std::mutex> entry_lock(e->mutex);
+    e->handle.close();
+  }
+}
+
+void dashboard_poller::set_devices(const std::vector<tic::device> & device_list)
+{
+  std::vector<std::shared_ptr<entry>> new_entries;
+  new_entries.reserve(device_list.size());
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (const tic::device & device : device_list)
+  {
+    std::string os_id = device.get_os_id();
+
+    // Keep the existing entry for this device so we don't need to open a new
+    // handle.  This is a linear search, but it only happens when the device
+    // list changes.
+    std::shared_ptr<entry> e;
+    for (const std::shared_ptr<entry> & candidate : entries)
+    {
+      if (candidate->row.os_id == os_id)
+      {
+        e = candidate;
+        break;
+      }
+    }
+
+    if (!e)
+    {
+      e = std::make_shared<entry>(device);
+      e->row.os_id = os_id;
+      e->row.name = device.get_short_name();
+      e->row.serial_number = device.get_serial_number();
+      e->row.main_device = (os_id == main_device_os_id);
+    }
+    new_entries.push_back(e);
+  }
+
+  // Entries that were removed get destroyed (closing their handles) once
+  // any worker that is polling them finishes.
+  entries.swap(new_entries);
+  if (cursor > entries.size()) { cursor = entries.size(); }
+}
+
+void dashboard_poller::set_main_device(const tic::device & device)
+{
+  std::string os_id = device ? device.get_os_id() : "";
+
+  std::shared_ptr<entry> main_entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    main_device_os_id = os_id;
+    for (const std::shared_ptr<entry> & e : entries)
+    {
+      bool main_device = (e->row.os_id == os_id);
+      if (main_device)
+      {
+        main_entry = e;
+      }
+      if (main_device != e->row.main_device)
+      {
+        e->row.main_device = main_device;
+        e->row.valid = false;
+        e->row.error_message.clear();
+      }
+    }
+  }
+
+  if (main_entry)
+  {
+    // Wait for any poll that is in progress to finish and then close our
+    // handle.  Workers will not open it again because of the main_device
+    // flag set above.
+    std::lock_guard<std::mutex> entry_lock(main_entry->mutex);
+    main_entry->handle.close();
+  }
+}
+
+void dashboard_poller::set_main_device_variables(const tic::variables & vars)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const std::shared_ptr<entry> & e : entries)
+  {
+    dashboard_row & row = e->row;
+    if (!row.main_device) { continue; }
+
+    row.valid = true;
+    row.error_message.clear();
+    row.operation_state = vars.get_operation_state();
+    row.energized = vars.get_energized();
+    row.current_position = vars.get_current_position();
+    row.current_velocity = vars.get_current_velocity();
+    row.error_status = vars.get_error_status();
+    row.vin_voltage = vars.get_vin_voltage();
+  }
+}
+
+std::vector<dashboard_row> dashboard_poller::get_rows() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<dashboard_row> rows;
+  rows.reserve(entries.size());
+  for (const std::shared_ptr<entry> & e : entries)
+  {
+    rows.push_back(e->row);
+  }
+  return rows;
+}
+
+// Returns the next entry that needs to be polled, waiting for the start of the
+// next polling cycle if every device has been polled in this cycle.  Returns
+// null if the poller is stopping.
+std::shared_ptr<dashboard_poller::entry> dashboard_poller::take_next_entry()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stop_requested)
+  {
+    if (cursor < entries.size())
+    {
+      return entries[cursor++];
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_cycle_time)
+    {
+      cursor = 0;
+      next_cycle_time = now + interval;
+      continue;
+    }
+
+    condition.wait_until(lock, next_cycle_time);
+  }
+  return nullptr;
+}
+
+void dashboard_poller::run()
+{
+  while (true)
+  {
+    std::shared_ptr<entry> e = take_next_entry();
+    if (!e) { break; }
+
+    // If the previous poll of this device is taking longer than a whole
+    // cycle, skip it instead of having two workers wait on the same device.
+    std::unique_lock<std::mutex> entry_lock(e->mutex, std::try_to_lock);
+    if (!entry_lock.owns_lock()) { continue; }
+
+    poll(*e);
+  }
+}
+
+// Reads the variables from the device.  The caller must hold the entry's
+// mutex.
+void dashboard_poller::poll(entry & e)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e.row.main_device) { return; }
+  }
+
+  dashboard_row row;
+  try
+  {
+    if (!e.handle)
+    {
+      e.handle = tic::handle(e.device);
+    }
+
+    // Don't clear the "errors occurred" bits because the dashboard does not
+    // display them and another program might be using them.
+    tic::variables vars = e.handle.get_variables(false);
+
+    row.valid = true;
+    row.operation_state = vars.get_operation_state();
+    row.energized = vars.get_energized();
+    row.current_position = vars.get_current_position();
+    row.current_velocity = vars.get_current_velocity();
+    row.error_status = vars.get_error_status();
+    row.vin_voltage = vars.get_vin_voltage();
+  }
+  catch (const std::exception & ex)
+  {
+    // Close the handle so the next poll tries to open it again, in case the
+    // problem was something like the device being reset.
+    e.handle.close();
+    row.valid = false;
+    row.error_message = ex.what();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (e.row.main_device)
+  {
+    // The main window connected to this device while we were polling it.
+    return;
+  }
+  row.os_id = e.row.os_id;
+  row.name = e.row.name;
+  row.serial_number = e.row.serial_number;
+  e.row = row;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "tic.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A summary of the status of one device, as shown in the dashboard.
+struct dashboard_row
+{
+  std::string os_id;
+  std::string name;
+  std::string serial_number;
+
+  // True if this device is the one that the main window is connected to.  The
+  // dashboard does not open its own handle to that device.
+  bool main_device = false;
+
+  // True if the status fields below are valid.  If false, error_message says
+  // what went wrong.
+  bool valid = false;
+  std::string error_message;
+
+  uint8_t operation_state = 0;
+  bool energized = false;
+  int32_t current_position = 0;
+  int32_t current_velocity = 0;
+  uint16_t error_status = 0;
+  uint32_t vin_voltage = 0;
+};
+
+// Polls every connected Tic concurrently so the dashboard can show their
+// status at the same time.  A fixed pool of worker threads shares the devices:
+// every polling cycle, each device is handed to whichever worker is free
+// next, so one slow or unresponsive device does not hold up the others.
+//
+// Each device except the one the main window is connected to gets its own
+// handle, which is opened the first time it is polled and kept open until the
+// device goes away or the poller is stopped.
+class dashboard_poller
+{
+public:
+  dashboard_poller(size_t worker_count, uint32_t interval_ms)
+    : worker_count(worker_count), interval(interval_ms)
+  {
+  }
+
+  ~dashboard_poller() { stop(); }
+
+  void start();
+
+  // Stops the workers and closes all the handles opened by the poller.
+  void stop();
+
+  bool running() const { return !workers.empty(); }
+
+  // Sets the list of devices to show.  Devices that are no longer in the list
+  // have their handles closed.
+  void set_devices(const std::vector<tic::device> & device_list);
+
+  // Tells the poller which device the main window is connected to (or a null
+  // device if it is not connected).  The poller closes its own handle to that
+  // device before returning, since some operating systems only allow one
+  // handle per device, and then shows the variables passed to
+  // set_main_device_variables() for it instead.
+  void set_main_device(const tic::device & device);
+
+  void set_main_device_variables(const tic::variables & variables);
+
+  // Returns a copy of the latest status of each device, in the same order as
+  // the device list.
+  std::vector<dashboard_row> get_rows() const;
+
+private:
+  struct entry
+  {
+    explicit entry(const tic::device & device) : device(device) { }
+
+    tic::device device;
+
+    // Protects the handle.  A worker holds this while it polls the device.
+    // To avoid deadlocks, never try to lock this while holding the poller's
+    // main mutex.
+    std::mutex mutex;
+    tic::handle handle;
+
+    // Protected by the poller's main mutex, so the GUI can read it without
+    // waiting for a USB transfer to finish.
+    dashboard_row row;
+  };
+
+  std::shared_ptr<entry> take_next_entry();
+  void run();
+  void poll(entry & e);
+
+  const size_t worker_count;
+  const std::chrono::milliseconds interval;
+
+  // Protects entries, the rows, cursor, next_cycle_time, stop_requested, and
+  // main_device_os_id.
+  mutable std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<std::shared_ptr<entry>> entries;
+  size_t cursor = 0;
+  std::chrono::steady_clock::time_point next_cycle_time;
+  bool stop_requested = false;
+
+  std::vector<std::thread> workers;
+  std::string main_device_os_id;
+};
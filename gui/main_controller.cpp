@@ -1,5 +1,6 @@
 #include "main_controller.h"
 #include "main_window.h"
+#include <device_scanner.h>
 #include <file_util.h>
 
 #include <cassert>
@@ -11,6 +12,10 @@ static const uint32_t UPDATE_INTERVAL_MS = 50;
 // Only update the device list once per second to save CPU time.
 static const uint32_t UPDATE_DEVICE_LIST_DIVIDER = 20;
 
+// This is how often we fetch the variables from the device while the plot
+// window is open.
+static const uint32_t PLOT_SAMPLE_INTERVAL_US = 2000;
+
 static bool settings_have_limit_switch(const tic::settings & settings)
 {
   for (uint8_t i = 0; i < TIC_CONTROL_PIN_COUNT; i++)
@@ -40,6 +45,9 @@ void main_controller::start()
 
   window->adjust_ui_for_product(TIC_PRODUCT_T825);
 
+  // Leave slip detection off until the user picks a threshold.
+  slip_monitor.set_threshold(0);
+
   handle_model_changed();
 }
 
@@ -93,6 +101,7 @@ void main_controller::clear_driver_error()
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.clear_driver_error();
   }
   catch (const std::exception & e)
@@ -106,6 +115,7 @@ void main_controller::go_home(uint8_t direction)
   if (!connected()) { return; }
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.go_home(direction);
   }
   catch (const std::exception & e)
@@ -121,19 +131,25 @@ void main_controller::connect_device(const tic::device & device)
   try
   {
     // Close the old handle in case one is already open.
+    sampler.stop();
     device_handle.close();
 
+    // Make the dashboard close its handle to the device before we open ours.
+    dashboard.set_main_device(device);
+
     connection_error = false;
     disconnected_by_user = false;
     send_reset_command_timeout = false;
     suppress_high_current_limit_warning = false;
     suppress_potential_high_current_limit_warning = false;
+    slip_monitor.reset();
 
     // Open a handle to the specified device.
     device_handle = tic::handle(device);
   }
   catch (const std::exception & e)
   {
+    dashboard.set_main_device(tic::device());
     set_connection_error("Failed to connect to device.");
     show_exception(e, "There was an error connecting to the device.");
     handle_model_changed();
@@ -161,6 +177,8 @@ void main_controller::connect_device(const tic::device & device)
     show_exception(e, "There was an error getting the status of the device.");
   }
 
+  update_telemetry_sampler();
+
   handle_model_changed();
 }
 
@@ -173,7 +191,9 @@ void main_controller::disconnect_device_by_error(const std::string & error_messa
 
 void main_controller::really_disconnect()
 {
+  sampler.stop();
   device_handle.close();
+  dashboard.set_main_device(tic::device());
   settings_modified = false;
 }
 
@@ -196,7 +216,10 @@ void main_controller::reload_settings(bool ask)
 
   try
   {
-    settings = device_handle.get_settings();
+    {
+      std::lock_guard<std::mutex> lock(handle_mutex);
+      settings = device_handle.get_settings();
+    }
     // Note: for future products, consider running settings.fix() here and showing
     // all the warnings, instead of just letting GUI controls silently fix some things.
     handle_settings_applied();
@@ -226,6 +249,7 @@ void main_controller::restore_default_settings()
   bool restore_success = false;
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.restore_defaults();
     restore_success = true;
   }
@@ -246,6 +270,8 @@ void main_controller::restore_default_settings()
 
 void main_controller::upgrade_firmware()
 {
+  std::string serial_number;
+
   if (connected())
   {
     std::string question =
@@ -258,8 +284,11 @@ void main_controller::upgrade_firmware()
       return;
     }
 
+    serial_number = device_handle.get_device().get_serial_number();
+
     try
     {
+      std::lock_guard<std::mutex> lock(handle_mutex);
       device_handle.start_bootloader();
     }
     catch (const std::exception & e)
@@ -273,7 +302,86 @@ void main_controller::upgrade_firmware()
     handle_model_changed();
   }
 
-  window->open_bootloader_window();
+  bootloader_window * bootloader = window->open_bootloader_window();
+
+  // The window selects the bootloader as soon as it appears.
+  if (!serial_number.empty())
+  {
+    bootloader->wait_for_bootloader(serial_number);
+  }
+}
+
+void main_controller::open_plot()
+{
+  window->open_plot_window(telemetry);
+  plot_open = true;
+  update_telemetry_sampler();
+}
+
+void main_controller::handle_plot_closed()
+{
+  plot_open = false;
+  update_telemetry_sampler();
+}
+
+void main_controller::open_dashboard()
+{
+  window->open_dashboard_window();
+  dashboard.set_devices(device_list);
+  dashboard.set_main_device(
+    connected() ? device_handle.get_device() : tic::device());
+  dashboard.start();
+  dashboard_open = true;
+  update_dashboard();
+}
+
+void main_controller::handle_dashboard_closed()
+{
+  dashboard.stop();
+  dashboard_open = false;
+}
+
+void main_controller::update_dashboard()
+{
+  if (!dashboard_open) { return; }
+
+  if (connected() && !variables_update_failed)
+  {
+    dashboard.set_main_device_variables(variables);
+  }
+
+  window->set_dashboard_rows(dashboard.get_rows());
+}
+
+void main_controller::update_telemetry_sampler()
+{
+  if (!plot_open)
+  {
+    sampler.stop();
+    return;
+  }
+
+  if (!connected())
+  {
+    sampler.stop();
+    window->set_plot_status("Not connected.");
+    return;
+  }
+
+  if (!sampler.running())
+  {
+    telemetry.clear();
+    sampler.start(device_handle.get_pointer(), handle_mutex,
+      PLOT_SAMPLE_INTERVAL_US);
+  }
+
+  std::string status = std::to_string(telemetry.size()) + " samples";
+  uint32_t error_count = sampler.get_error_count();
+  if (error_count != 0)
+  {
+    status += ", " + std::to_string(error_count) + " failed";
+  }
+  window->set_plot_status(status);
 }
 
 // Returns true if the device list includes the specified device.
@@ -300,6 +408,7 @@ void main_controller::update()
     successfully_updated_list = update_device_list();
     if (successfully_updated_list && device_list_changed)
     {
+      dashboard.set_devices(device_list);
       window->set_device_list_contents(device_list);
       if (connected())
       {
@@ -329,6 +438,9 @@ void main_controller::update()
       {
         reload_variables();
 
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        slip_monitor.check(&device_handle, variables);
+
         if (send_reset_command_timeout)
         {
           // Reset command timeout AFTER reloading the variables so we can
@@ -377,6 +489,9 @@ void main_controller::update()
       connect_device(device_list.at(0));
     }
   }
+
+  update_telemetry_sampler();
+  update_dashboard();
 }
 
 bool main_controller::exit()
@@ -420,7 +535,7 @@ bool main_controller::update_device_list()
 {
   try
   {
-    std::vector<tic::device> new_device_list = tic::list_connected_devices();
+    std::vector<tic::device> new_device_list = scan_connected_devices().app_devices;
     if (device_lists_different(device_list, new_device_list))
     {
       device_list_changed = true;
@@ -467,7 +582,12 @@ void main_controller::handle_device_changed()
     const tic::device & device = device_handle.get_device();
     window->set_device_name(device.get_name(), true);
     window->set_serial_number(device.get_serial_number());
-    window->set_firmware_version(device_handle.get_firmware_version_string());
+    std::string firmware_version;
+    {
+      std::lock_guard<std::mutex> lock(handle_mutex);
+      firmware_version = device_handle.get_firmware_version_string();
+    }
+    window->set_firmware_version(firmware_version);
     window->set_device_reset(
       tic_look_up_device_reset_name_ui(variables.get_device_reset()));
 
@@ -530,6 +650,7 @@ void main_controller::handle_variables_changed()
   window->set_up_time(variables.get_up_time());
 
   window->set_encoder_position(variables.get_encoder_position());
+  window->set_encoder_slip(slip_monitor.get_deviation(), slip_monitor.slipped());
   window->set_input_state(
     tic_look_up_input_state_name_ui(variables.get_input_state()),
     variables.get_input_state());
@@ -664,6 +785,10 @@ void main_controller::update_motor_status_message(bool prompt_to_resume)
     {
       msg = "Reverse limit switch active.";
     }
+    else if (slip_monitor.slipped())
+    {
+      msg = "Encoder slip detected.";
+    }
     else if (!variables.get_energized())
     {
       // This should not happen: when you de-energize it is always an error.
@@ -697,7 +822,14 @@ void main_controller::update_motor_status_message(bool prompt_to_resume)
   }
   else if (error_status & (1 << TIC_ERROR_INTENTIONALLY_DEENERGIZED))
   {
-    msg = "Motor intentionally de-energized.";
+    if (slip_monitor.slipped())
+    {
+      msg = "Motor de-energized because the encoder slipped.";
+    }
+    else
+    {
+      msg = "Motor intentionally de-energized.";
+    }
   }
   else
   {
@@ -890,6 +1022,10 @@ void main_controller::handle_settings_applied()
 
   update_menu_enables();
 
+  slip_monitor.set_encoder_scaling(
+    tic_settings_get_encoder_prescaler(settings.get_pointer()),
+    tic_settings_get_encoder_postscaler(settings.get_pointer()));
+
   // this must be last so the preceding code can compare old and new settings
   cached_settings = settings;
 }
@@ -1392,11 +1528,24 @@ void main_controller::handle_pin_analog_input(uint8_t pin, bool analog)
   handle_settings_changed();
 }
 
+void main_controller::handle_slip_threshold_input(uint32_t threshold)
+{
+  slip_monitor.set_threshold(threshold);
+  slip_monitor.reset();
+}
+
+void main_controller::handle_slip_action_input(uint8_t action)
+{
+  slip_monitor.set_action(action);
+}
+
 void main_controller::handle_upload_complete()
 {
   // After a firmware upgrade is complete, allow the GUI to reconnect to the
-  // device automatically.
+  // device automatically, and check the device list on the next update so
+  // that happens right away.
   disconnected_by_user = false;
+  update_device_list_counter = 1;
 }
 
 void main_controller::set_target_position(int32_t position)
@@ -1405,6 +1554,7 @@ void main_controller::set_target_position(int32_t position)
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.set_target_position(position);
     send_reset_command_timeout = true;
   }
@@ -1420,6 +1570,7 @@ void main_controller::set_target_velocity(int32_t velocity)
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.set_target_velocity(velocity);
     send_reset_command_timeout = true;
   }
@@ -1435,7 +1586,9 @@ void main_controller::halt_and_set_position(int32_t position)
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.halt_and_set_position(position);
+    slip_monitor.reset();
   }
   catch (const std::exception & e)
   {
@@ -1449,6 +1602,7 @@ void main_controller::halt_and_hold()
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.halt_and_hold();
   }
   catch (const std::exception & e)
@@ -1463,6 +1617,7 @@ void main_controller::deenergize()
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.deenergize();
   }
   catch (const std::exception & e)
@@ -1477,9 +1632,11 @@ void main_controller::resume()
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     device_handle.energize();
     device_handle.exit_safe_start();
     send_reset_command_timeout = true;
+    slip_monitor.reset();
   }
   catch (const std::exception & e)
   {
@@ -1593,8 +1750,11 @@ void main_controller::apply_settings()
       window->confirm(warnings + "\nAccept these changes and apply settings?"))
     {
       settings = fixed_settings;
-      device_handle.set_settings(settings);
-      device_handle.reinitialize();
+      {
+        std::lock_guard<std::mutex> lock(handle_mutex);
+        device_handle.set_settings(settings);
+        device_handle.reinitialize();
+      }
       handle_settings_applied();
       settings_modified = false;  // this must be last in case exceptions are thrown
     }
@@ -1684,6 +1844,7 @@ void main_controller::reload_variables()
 
   try
   {
+    std::lock_guard<std::mutex> lock(handle_mutex);
     variables = device_handle.get_variables(true);
     variables_update_failed = false;
   }
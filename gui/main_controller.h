@@ -1,6 +1,8 @@
 #pragma once
 
 #include "tic.hpp"
+#include "telemetry.h"
+#include "dashboard.h"
 
 class main_window;
 
@@ -38,6 +40,19 @@ public:
   // This is called when the user wants to upgrade some firmware.
   void upgrade_firmware();
 
+  // This is called when the user wants to see a plot of the variables.
+  void open_plot();
+
+  // This is called when the plot window is closed.
+  void handle_plot_closed();
+
+  // This is called when the user wants to see the status of all the connected
+  // devices at once.
+  void open_dashboard();
+
+  // This is called when the dashboard window is closed.
+  void handle_dashboard_closed();
+
   // This is called when it is time to check if the status of the device has
   // changed.
   void update();
@@ -155,6 +170,11 @@ public:
   void handle_pin_polarity_input(uint8_t pin, bool polarity);
   void handle_pin_analog_input(uint8_t pin, bool analog);
 
+  // These are called when the user changes how we watch for encoder slips.
+  // They are not device settings, so they take effect right away.
+  void handle_slip_threshold_input(uint32_t threshold);
+  void handle_slip_action_input(uint8_t action);
+
   void handle_upload_complete();
 
   uint8_t get_product() { return settings.get_product(); }
@@ -177,6 +197,12 @@ private:
   // Holds an open handle to a device or a null handle if we are not connected.
   tic::handle device_handle;
 
+  // The telemetry sampler uses device_handle from its own thread, so anything
+  // that sends a request through the handle must hold this mutex.  Opening
+  // and closing the handle do not need it because the sampler is stopped
+  // first.
+  std::mutex handle_mutex;
+
   // True if the last connection or connection attempt resulted in an error.  If
   // true, connection_error_essage provides some information about the error.
   bool connection_error = false;
@@ -218,6 +244,35 @@ private:
 
   void reload_variables();
 
+  // Checks the variables for encoder slips each time we reload them.
+  tic::slip_monitor slip_monitor = tic::slip_monitor::create();
+
+  // Shows the latest status of each device in the dashboard window, if it is
+  // open.
+  void update_dashboard();
+
+  // Starts the telemetry sampler if the plot window is open and we are
+  // connected, or stops it otherwise.
+  void update_telemetry_sampler();
+
+  // Holds the samples shown in the plot window: about 8 minutes worth at the
+  // rate used by the sampler.
+  telemetry_buffer telemetry{1 << 18};
+
+  // Reads samples into the telemetry buffer from a separate thread while the
+  // plot window is open.  This is declared after device_handle so that it is
+  // destroyed (and the thread is stopped) before the handle is closed.
+  telemetry_sampler sampler{telemetry};
+
+  // True if the plot window is open.
+  bool plot_open = false;
+
+  // Polls all the other devices while the dashboard window is open.
+  dashboard_poller dashboard{8, 200};
+
+  // True if the dashboard window is open.
+  bool dashboard_open = false;
+
   // Returns true if we are currently connected to a device.
   bool connected() const { return device_handle; }
 
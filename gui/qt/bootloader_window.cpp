@@ -1,5 +1,4 @@
 #include "bootloader_window.h"
-#include "file_util.h"
 
 #include <bootloader.h>
 
@@ -13,7 +12,6 @@
 #include <QMessageBox>
 #include <QProgressBar>
 #include <QPushButton>
-#include <QThread>
 #include <QTimer>
 #include <QWidget>
 
@@ -137,6 +135,9 @@ void bootloader_window::setup_window()
   update_timer->setObjectName("update_timer");
   update_timer->start(500);
 
+  wait_timer = new QTimer(this);
+  wait_timer->setObjectName("wait_timer");
+
   QMetaObject::connectSlotsByName(this);
 
   on_update_timer_timeout();
@@ -147,6 +148,62 @@ void bootloader_window::on_update_timer_timeout()
   update_device_combo_box(*device_chooser, device_was_selected);
 }
 
+void bootloader_window::wait_for_bootloader(const std::string & serial_number)
+{
+  start_wait(serial_number, DEVICE_MODE_BOOTLOADER);
+}
+
+void bootloader_window::start_wait(const std::string & serial_number,
+  uint8_t modes)
+{
+  wait_serial_number = serial_number;
+  wait_modes = modes;
+  wait_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  wait_timer->start(50);
+}
+
+void bootloader_window::on_wait_timer_timeout()
+{
+  // A deadline that has already passed makes bootloader_wait_for_device()
+  // check the device list once and return right away.
+  auto now = std::chrono::steady_clock::now();
+  uint8_t mode = 0;
+  try
+  {
+    mode = bootloader_wait_for_device(wait_serial_number, wait_modes, now);
+  }
+  catch (const std::exception &)
+  {
+    // The device list is checked again on the next timeout.
+  }
+
+  if (mode == 0 && now < wait_deadline) { return; }
+  finish_wait(mode);
+}
+
+void bootloader_window::finish_wait(uint8_t mode)
+{
+  wait_timer->stop();
+
+  if (wait_modes == DEVICE_MODE_APP)
+  {
+    // The upload is complete, whether or not the device came back in time.
+    emit upload_complete();
+    close();
+    return;
+  }
+
+  if (mode != 0)
+  {
+    // Select the bootloader we were waiting for.
+    update_device_combo_box(*device_chooser, device_was_selected);
+    int index = device_chooser->findText(
+      QString::fromStdString(" #" + wait_serial_number),
+      Qt::MatchEndsWith);
+    if (index != -1) { device_chooser->setCurrentIndex(index); }
+  }
+}
+
 void bootloader_window::on_browse_button_clicked()
 {
   QString filename = QFileDialog::getOpenFileName(this,
@@ -171,23 +228,11 @@ void bootloader_window::on_program_button_clicked()
     return;
   }
 
-  // Read in the firmware file.
-  std::string file_contents;
-  try
-  {
-    file_contents = read_string_from_file(filename);
-  }
-  catch (const std::exception & e)
-  {
-    show_error_message(e.what());
-    return;
-  }
-
-  // Parse the firmware file.
+  // Read in and parse the firmware file.
   firmware_archive::data data;
   try
   {
-    data.read_from_string(file_contents);
+    data.read_from_file(filename);
   }
   catch (const std::exception & e)
   {
@@ -268,9 +313,11 @@ void bootloader_window::on_program_button_clicked()
       handle.restart_device();
     }
     set_status("Upload complete.", 100, 100);
-    emit upload_complete();
-    QThread::usleep(500000);
-    close();
+
+    // Wait for the device to start running its new firmware so the main
+    // window can connect to it right away.  on_wait_timer_timeout() closes
+    // this window when it does.
+    start_wait(device.get_serial_number(), DEVICE_MODE_APP);
   }
   catch (const std::exception & e)
   {
@@ -18,6 +18,10 @@ class bootloader_window : public QMainWindow, bootloder_status_listener
 public:
   bootloader_window(QWidget * parent = 0);
 
+  // Watches for the device with the specified serial number to appear as a
+  // bootloader, and selects it when it does.
+  void wait_for_bootloader(const std::string & serial_number);
+
 signals:
   void upload_complete();
 
@@ -31,6 +35,16 @@ private:
   QPushButton * program_button;
   QTimer * update_timer;
 
+  // While a device is re-enumerating, wait_timer checks for it without
+  // blocking the event loop.
+  QTimer * wait_timer;
+  std::string wait_serial_number;
+  uint8_t wait_modes = 0;
+  std::chrono::steady_clock::time_point wait_deadline;
+
+  void start_wait(const std::string & serial_number, uint8_t modes);
+  void finish_wait(uint8_t mode);
+
   void setup_window();
   void set_interface_enabled(bool enabled);
   void set_status(const char * status, uint32_t progress, uint32_t max_progress);
@@ -40,6 +54,7 @@ private:
 
 private slots:
   void on_update_timer_timeout();
+  void on_wait_timer_timeout();
   void on_browse_button_clicked();
   void on_program_button_clicked();
 };
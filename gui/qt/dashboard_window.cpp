@@ -0,0 +1,267 @@
+#include "dashboard_window.h"
+#include "to_string.h"
+
+#include <QBrush>
+#include <QCloseEvent>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableView>
+#include <QVBoxLayout>
+
+static bool same_devices(const std::vector<dashboard_row> & list1,
+  const std::vector<dashboard_row> & list2)
+{
+  if (list1.size() != list2.size()) { return false; }
+  for (size_t i = 0; i < list1.size(); i++)
+  {
+    if (list1[i].os_id != list2[i].os_id) { return false; }
+  }
+  return true;
+}
+
+static std::string error_status_string(uint16_t error_status)
+{
+  if (error_status == 0) { return "None"; }
+
+  std::string str;
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    uint32_t error = 1 << i;
+    if (error_status & error)
+    {
+      if (!str.empty()) { str += ", "; }
+      str += tic_look_up_error_name_ui(error);
+    }
+  }
+  return str;
+}
+
+void dashboard_model::set_rows(std::vector<dashboard_row> && new_rows)
+{
+  if (same_devices(rows, new_rows))
+  {
+    // The usual case: just the status changed.  The view will only repaint
+    // the cells that are visible.
+    rows = std::move(new_rows);
+    if (!rows.empty())
+    {
+      emit dataChanged(index(0, 0), index(rows.size() - 1, COLUMN_COUNT - 1));
+    }
+  }
+  else
+  {
+    beginResetModel();
+    rows = std::move(new_rows);
+    endResetModel();
+  }
+}
+
+std::string dashboard_model::os_id_at(int row) const
+{
+  if (row < 0 || (size_t)row >= rows.size()) { return ""; }
+  return rows[row].os_id;
+}
+
+int dashboard_model::rowCount(const QModelIndex & parent) const
+{
+  return parent.isValid() ? 0 : rows.size();
+}
+
+int dashboard_model::columnCount(const QModelIndex & parent) const
+{
+  return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant dashboard_model::data(const QModelIndex & index, int role) const
+{
+  if (!index.isValid() || (size_t)index.row() >= rows.size())
+  {
+    return QVariant();
+  }
+
+  const dashboard_row & row = rows[index.row()];
+
+  switch (role)
+  {
+  case Qt::DisplayRole:
+    return cell_text(row, index.column());
+
+  case Qt::ToolTipRole:
+    if (!row.error_message.empty())
+    {
+      return QString::fromStdString(row.error_message);
+    }
+    return QVariant();
+
+  case Qt::ForegroundRole:
+    if (!row.error_message.empty() || (row.valid && row.error_status))
+    {
+      return QBrush(Qt::red);
+    }
+    return QVariant();
+
+  case Qt::TextAlignmentRole:
+    switch (index.column())
+    {
+    case POSITION_COLUMN:
+    case VELOCITY_COLUMN:
+    case VIN_COLUMN:
+      return (int)(Qt::AlignRight | Qt::AlignVCenter);
+    default:
+      return (int)(Qt::AlignLeft | Qt::AlignVCenter);
+    }
+
+  default:
+    return QVariant();
+  }
+}
+
+QString dashboard_model::cell_text(const dashboard_row & row, int column) const
+{
+  switch (column)
+  {
+  case DEVICE_COLUMN:
+    if (row.main_device)
+    {
+      return tr("%1 (main window)").arg(QString::fromStdString(row.name));
+    }
+    return QString::fromStdString(row.name);
+
+  case SERIAL_NUMBER_COLUMN:
+    return QString::fromStdString(row.serial_number);
+
+  case STATE_COLUMN:
+    if (!row.valid)
+    {
+      return row.error_message.empty() ? QString() : tr("Error");
+    }
+    return tic_look_up_operation_state_name_ui(row.operation_state);
+  }
+
+  if (!row.valid) { return QString(); }
+
+  switch (column)
+  {
+  case ENERGIZED_COLUMN:
+    return row.energized ? tr("Yes") : tr("No");
+  case POSITION_COLUMN:
+    return QString::number(row.current_position);
+  case VELOCITY_COLUMN:
+    return QString::fromStdString(
+      convert_speed_to_pps_string(row.current_velocity));
+  case ERRORS_COLUMN:
+    return QString::fromStdString(error_status_string(row.error_status));
+  case VIN_COLUMN:
+    return QString::fromStdString(convert_mv_to_v_string(row.vin_voltage));
+  default:
+    return QString();
+  }
+}
+
+QVariant dashboard_model::headerData(int section,
+  Qt::Orientation orientation, int role) const
+{
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+  {
+    return QAbstractTableModel::headerData(section, orientation, role);
+  }
+
+  switch (section)
+  {
+  case DEVICE_COLUMN: return tr("Device");
+  case SERIAL_NUMBER_COLUMN: return tr("Serial number");
+  case STATE_COLUMN: return tr("State");
+  case ENERGIZED_COLUMN: return tr("Energized");
+  case POSITION_COLUMN: return tr("Position");
+  case VELOCITY_COLUMN: return tr("Velocity");
+  case ERRORS_COLUMN: return tr("Errors");
+  case VIN_COLUMN: return tr("VIN");
+  default: return QVariant();
+  }
+}
+
+dashboard_window::dashboard_window(QWidget * parent)
+{
+  setup_window();
+
+  // Set the parent this way so that the dashboard is a separate top-level
+  // window that stays on top of the main window.
+  setParent(parent, Qt::Window);
+}
+
+void dashboard_window::setup_window()
+{
+  setWindowTitle(tr("Dashboard"));
+
+  QWidget * central_widget = new QWidget();
+  QVBoxLayout * layout = new QVBoxLayout();
+
+  model = new dashboard_model(this);
+
+  table = new QTableView();
+  table->setObjectName("table");
+  table->setModel(model);
+  table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  table->setSelectionMode(QAbstractItemView::SingleSelection);
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  table->setWordWrap(false);
+  table->horizontalHeader()->setStretchLastSection(true);
+  table->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+
+  // Use a fixed row height so the view never has to measure the contents of
+  // every row.
+  table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  table->verticalHeader()->setDefaultSectionSize(
+    table->fontMetrics().height() + 6);
+  table->verticalHeader()->hide();
+
+  table->setColumnWidth(dashboard_model::DEVICE_COLUMN,
+    table->fontMetrics().width("Tic T500 (main window)") + 20);
+  table->setColumnWidth(dashboard_model::SERIAL_NUMBER_COLUMN,
+    table->fontMetrics().width("00000000000000") + 20);
+  table->setColumnWidth(dashboard_model::STATE_COLUMN,
+    table->fontMetrics().width("Waiting for ERR line") + 20);
+  layout->addWidget(table, 1);
+
+  summary_label = new QLabel();
+  layout->addWidget(summary_label);
+
+  central_widget->setLayout(layout);
+  setCentralWidget(central_widget);
+
+  resize(900, 500);
+
+  QMetaObject::connectSlotsByName(this);
+}
+
+void dashboard_window::set_rows(std::vector<dashboard_row> && rows)
+{
+  size_t error_count = 0;
+  for (const dashboard_row & row : rows)
+  {
+    if (!row.error_message.empty() || (row.valid && row.error_status))
+    {
+      error_count++;
+    }
+  }
+
+  summary_label->setText(tr("%1 devices, %2 with errors")
+    .arg(rows.size()).arg(error_count));
+
+  model->set_rows(std::move(rows));
+}
+
+void dashboard_window::closeEvent(QCloseEvent * event)
+{
+  emit closed();
+  QMainWindow::closeEvent(event);
+}
+
+void dashboard_window::on_table_doubleClicked(const QModelIndex & index)
+{
+  std::string os_id = model->os_id_at(index.row());
+  if (!os_id.empty())
+  {
+    emit device_activated(QString::fromStdString(os_id));
+  }
+}
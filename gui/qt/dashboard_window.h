@@ -0,0 +1,77 @@
+#pragma once
+
+#include "dashboard.h"
+
+#include <QAbstractTableModel>
+#include <QMainWindow>
+
+class QLabel;
+class QTableView;
+
+// Presents the rows from the dashboard poller to a QTableView.  The view only
+// asks for the data of the cells that are visible, so the cost of updating the
+// dashboard does not depend much on the number of devices.
+class dashboard_model : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum column
+  {
+    DEVICE_COLUMN,
+    SERIAL_NUMBER_COLUMN,
+    STATE_COLUMN,
+    ENERGIZED_COLUMN,
+    POSITION_COLUMN,
+    VELOCITY_COLUMN,
+    ERRORS_COLUMN,
+    VIN_COLUMN,
+    COLUMN_COUNT
+  };
+
+  dashboard_model(QObject * parent = 0) : QAbstractTableModel(parent) { }
+
+  void set_rows(std::vector<dashboard_row> && rows);
+
+  std::string os_id_at(int row) const;
+
+  int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex & index, int role) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+    int role) const override;
+
+private:
+  QString cell_text(const dashboard_row & row, int column) const;
+
+  std::vector<dashboard_row> rows;
+};
+
+class dashboard_window : public QMainWindow
+{
+  Q_OBJECT
+
+public:
+  dashboard_window(QWidget * parent = 0);
+
+  void set_rows(std::vector<dashboard_row> && rows);
+
+signals:
+  void closed();
+
+  // Emitted when the user double-clicks on a device.
+  void device_activated(QString os_id);
+
+protected:
+  void closeEvent(QCloseEvent *) override;
+
+private:
+  void setup_window();
+
+  dashboard_model * model;
+  QTableView * table;
+  QLabel * summary_label;
+
+private slots:
+  void on_table_doubleClicked(const QModelIndex & index);
+};
@@ -99,6 +99,48 @@ bootloader_window * main_window::open_bootloader_window()
   return window;
 }
 
+void main_window::open_plot_window(telemetry_buffer & buffer)
+{
+  if (plot == NULL)
+  {
+    plot = new plot_window(buffer, this);
+    connect(plot, &plot_window::closed,
+      this, &main_window::plot_window_closed);
+    plot->setAttribute(Qt::WA_DeleteOnClose);
+  }
+  plot->show();
+  plot->raise();
+  plot->activateWindow();
+}
+
+void main_window::set_plot_status(const std::string & status)
+{
+  if (plot == NULL) { return; }
+  plot->set_status(status);
+}
+
+void main_window::open_dashboard_window()
+{
+  if (dashboard == NULL)
+  {
+    dashboard = new dashboard_window(this);
+    connect(dashboard, &dashboard_window::closed,
+      this, &main_window::dashboard_window_closed);
+    connect(dashboard, &dashboard_window::device_activated,
+      this, &main_window::dashboard_device_activated);
+    dashboard->setAttribute(Qt::WA_DeleteOnClose);
+  }
+  dashboard->show();
+  dashboard->raise();
+  dashboard->activateWindow();
+}
+
+void main_window::set_dashboard_rows(std::vector<dashboard_row> && rows)
+{
+  if (dashboard == NULL) { return; }
+  dashboard->set_rows(std::move(rows));
+}
+
 void main_window::set_update_timer_interval(uint32_t interval_ms)
 {
   assert(update_timer);
@@ -481,6 +523,16 @@ void main_window::set_encoder_position(int32_t encoder_position)
   encoder_position_value->setText(QString::number(encoder_position));
 }
 
+void main_window::set_encoder_slip(double deviation, bool slipped)
+{
+  QString text = QString::number(deviation, 'f', 0);
+  if (slipped)
+  {
+    text = tr("%1 (slipped)").arg(text);
+  }
+  encoder_slip_value->setText(text);
+}
+
 void main_window::set_input_before_scaling(uint16_t input_before_scaling, uint8_t control_mode)
 {
   bool input_not_null = (input_before_scaling != TIC_INPUT_NULL);
@@ -1670,6 +1722,16 @@ void main_window::on_upgrade_firmware_action_triggered()
   controller->upgrade_firmware();
 }
 
+void main_window::on_plot_action_triggered()
+{
+  controller->open_plot();
+}
+
+void main_window::on_dashboard_action_triggered()
+{
+  controller->open_dashboard();
+}
+
 void main_window::on_control_mode_value_currentIndexChanged(int index)
 {
   if (suppress_events) { return; }
@@ -1782,6 +1844,19 @@ void main_window::on_encoder_unlimited_check_stateChanged(int state)
   controller->handle_encoder_unlimited_input(state == Qt::Checked);
 }
 
+void main_window::on_slip_threshold_value_valueChanged(int value)
+{
+  if (suppress_events) { return; }
+  controller->handle_slip_threshold_input(value);
+}
+
+void main_window::on_slip_action_value_currentIndexChanged(int index)
+{
+  if (suppress_events) { return; }
+  uint8_t action = slip_action_value->itemData(index).toUInt();
+  controller->handle_slip_action_input(action);
+}
+
 void main_window::on_input_averaging_enabled_check_stateChanged(int state)
 {
   if (suppress_events) { return; }
@@ -2093,6 +2168,32 @@ void main_window::upload_complete()
   controller->handle_upload_complete();
 }
 
+void main_window::plot_window_closed()
+{
+  plot = NULL;
+  controller->handle_plot_closed();
+}
+
+void main_window::dashboard_window_closed()
+{
+  dashboard = NULL;
+  controller->handle_dashboard_closed();
+}
+
+void main_window::dashboard_device_activated(QString os_id)
+{
+  if (controller->disconnect_device())
+  {
+    controller->connect_device_with_os_id(os_id.toStdString());
+  }
+  else
+  {
+    // User canceled disconnect when prompted about settings that have not been
+    // applied.
+    controller->handle_model_changed();
+  }
+}
+
 // On macOS, field labels are usually right-aligned, but we want to
 // use the fusion style so we will do left-alignment instead.
 //
@@ -2403,6 +2504,16 @@ void main_window::setup_menu_bar()
   upgrade_firmware_action->setObjectName("upgrade_firmware_action");
   device_menu->addAction(upgrade_firmware_action);
 
+  window_menu = menu_bar->addMenu("");
+
+  plot_action = new QAction(this);
+  plot_action->setObjectName("plot_action");
+  window_menu->addAction(plot_action);
+
+  dashboard_action = new QAction(this);
+  dashboard_action->setObjectName("dashboard_action");
+  window_menu->addAction(dashboard_action);
+
   help_menu = menu_bar->addMenu("");
 
   documentation_action = new QAction(this);
@@ -2552,6 +2663,7 @@ QWidget * main_window::setup_input_status_box()
   int row = 0;
 
   setup_read_only_text_field(layout, row++, 0, 2, &encoder_position_label, &encoder_position_value);
+  setup_read_only_text_field(layout, row++, 0, 2, &encoder_slip_label, &encoder_slip_value);
   setup_read_only_text_field(layout, row++, 0, 2, &input_state_label, &input_state_value);
   setup_read_only_text_field(layout, row++, 0, 2, &input_after_averaging_label, &input_after_averaging_value);
   setup_read_only_text_field(layout, row++, 0, 2, &input_after_hysteresis_label, &input_after_hysteresis_value);
@@ -2569,6 +2681,11 @@ QWidget * main_window::setup_input_status_box()
     input_after_scaling_value->setText(QString::number(-INT_MAX));
 
     encoder_position_value->setFixedSize(input_after_scaling_value->sizeHint());
+
+    encoder_slip_value->setText(tr("%1 (slipped)").arg(-INT_MAX));
+    encoder_slip_value->setFixedSize(encoder_slip_value->sizeHint());
+    encoder_slip_value->setText(QString());
+
     input_state_value->setFixedSize(input_after_scaling_value->sizeHint());
     input_after_averaging_value->setFixedSize(input_after_scaling_value->sizeHint());
     input_after_hysteresis_value->setFixedSize(input_after_scaling_value->sizeHint());
@@ -3101,6 +3218,32 @@ QWidget * main_window::setup_encoder_settings_box()
     row++;
   }
 
+  // Slip detection is done by this program, not the device, so these are not
+  // saved with the settings.
+  {
+    slip_threshold_value = new QSpinBox();
+    slip_threshold_value->setObjectName("slip_threshold_value");
+    slip_threshold_value->setRange(0, INT32_MAX);
+    slip_threshold_label = new QLabel();
+    slip_threshold_label->setBuddy(slip_threshold_value);
+    layout->addWidget(slip_threshold_label, row, 0, FIELD_LABEL_ALIGNMENT);
+    layout->addWidget(slip_threshold_value, row, 1, 1, 2, Qt::AlignLeft);
+    row++;
+  }
+
+  {
+    slip_action_value = new QComboBox();
+    slip_action_value->setObjectName("slip_action_value");
+    slip_action_value->addItem("None", TIC_SLIP_ACTION_NONE);
+    slip_action_value->addItem("Halt and hold", TIC_SLIP_ACTION_HALT_AND_HOLD);
+    slip_action_value->addItem("De-energize", TIC_SLIP_ACTION_DEENERGIZE);
+    slip_action_label = new QLabel();
+    slip_action_label->setBuddy(slip_action_value);
+    layout->addWidget(slip_action_label, row, 0, FIELD_LABEL_ALIGNMENT);
+    layout->addWidget(slip_action_value, row, 1, 1, 2, Qt::AlignLeft);
+    row++;
+  }
+
   layout->setColumnStretch(1, 1);
   layout->setRowStretch(row, 1);
 
@@ -3872,6 +4015,9 @@ void main_window::retranslate()
   restore_defaults_action->setText(tr("&Restore default settings"));
   apply_settings_action->setText(tr("&Apply settings"));
   upgrade_firmware_action->setText(tr("&Upgrade firmware..."));
+  window_menu->setTitle(tr("&Window"));
+  plot_action->setText(tr("&Plot..."));
+  dashboard_action->setText(tr("&Dashboard..."));
   help_menu->setTitle(tr("&Help"));
   documentation_action->setText(tr("&Online documentation..."));
   about_action->setText(tr("&About..."));
@@ -3889,6 +4035,7 @@ void main_window::retranslate()
 
   input_status_box->setTitle(tr("Inputs"));
   encoder_position_label->setText(tr("Encoder position:"));
+  encoder_slip_label->setText(tr("Encoder slip:"));
   input_state_label->setText(tr("Input state:"));
   input_after_averaging_label->setText(tr("Input after averaging:"));
   input_after_hysteresis_label->setText(tr("Input after hysteresis:"));
@@ -3967,6 +4114,13 @@ void main_window::retranslate()
   encoder_prescaler_label->setText(tr("Prescaler:"));
   encoder_postscaler_label->setText(tr("Postscaler:"));
   encoder_unlimited_check->setText(tr("Enable unbounded position control"));
+  slip_threshold_label->setText(tr("Slip threshold:"));
+  slip_threshold_value->setSpecialValueText(tr("Off"));
+  slip_threshold_value->setSuffix(tr(" microsteps"));
+  slip_threshold_value->setToolTip(tr(
+      "How far the scaled encoder position can drift from the current "
+      "position before this program reports that the motor slipped."));
+  slip_action_label->setText(tr("On slip:"));
 
   conditioning_settings_box->setTitle(tr("Input conditioning"));
   input_averaging_enabled_check->setText(tr("Enable input averaging"));
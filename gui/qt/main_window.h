@@ -5,8 +5,10 @@
 #include "tic.hpp"
 
 #include "bootloader_window.h"
+#include "dashboard_window.h"
 #include "elided_label.h"
 #include "InputWizard.h"
+#include "plot_window.h"
 
 #include <QMainWindow>
 
@@ -100,6 +102,20 @@ public:
 
   bootloader_window * open_bootloader_window();
 
+  // Opens the plot window, or brings it to the front if it is already open.
+  void open_plot_window(telemetry_buffer & buffer);
+
+  // Sets the status text shown at the bottom of the plot window, if it is
+  // open.
+  void set_plot_status(const std::string & status);
+
+  // Opens the dashboard window, or brings it to the front if it is already
+  // open.
+  void open_dashboard_window();
+
+  // Updates the dashboard window, if it is open.
+  void set_dashboard_rows(std::vector<dashboard_row> && rows);
+
   // This causes the window to call the controller's update() function
   // periodically, on the same thread as everything else.
   //
@@ -171,6 +187,7 @@ public:
   void set_up_time(uint32_t up_time);
 
   void set_encoder_position(int32_t encoder_position);
+  void set_encoder_slip(double deviation, bool slipped);
   void set_input_state(const std::string & input_state, uint8_t input_state_raw);
   void set_input_after_averaging(uint16_t input_after_averaging);
   void set_input_after_hysteresis(uint16_t input_after_hysteresis);
@@ -340,6 +357,8 @@ private slots:
   void on_decelerate_button_clicked();
   void on_apply_settings_action_triggered();
   void on_upgrade_firmware_action_triggered();
+  void on_plot_action_triggered();
+  void on_dashboard_action_triggered();
 
   // [all-settings]
 
@@ -361,6 +380,8 @@ private slots:
   void on_encoder_prescaler_value_valueChanged(int value);
   void on_encoder_postscaler_value_valueChanged(int value);
   void on_encoder_unlimited_check_stateChanged(int state);
+  void on_slip_threshold_value_valueChanged(int value);
+  void on_slip_action_value_currentIndexChanged(int index);
 
   void on_input_hysteresis_value_valueChanged(int value);
   void on_input_averaging_enabled_check_stateChanged(int state);
@@ -411,6 +432,9 @@ private slots:
   void on_homing_speed_away_value_valueChanged(int value);
 
   void upload_complete();
+  void plot_window_closed();
+  void dashboard_window_closed();
+  void dashboard_device_activated(QString os_id);
 
 private:
   bool start_event_reported = false;
@@ -422,6 +446,12 @@ private:
 
   QTimer * update_timer = NULL;
 
+  // The plot window, or NULL if it is not open.
+  plot_window * plot = NULL;
+
+  // The dashboard window, or NULL if it is not open.
+  dashboard_window * dashboard = NULL;
+
   // These are low-level functions called in the constructor that set up the
   // GUI elements.
   void setup_window();
@@ -487,6 +517,9 @@ private:
   QAction * restore_defaults_action;
   QAction * apply_settings_action;
   QAction * upgrade_firmware_action;
+  QMenu * window_menu;
+  QAction * plot_action;
+  QAction * dashboard_action;
   QMenu * help_menu;
   QAction * documentation_action;
   QAction * about_action;
@@ -527,6 +560,8 @@ private:
   QGridLayout * input_status_box_layout;
   QLabel * encoder_position_label;
   QLabel * encoder_position_value;
+  QLabel * encoder_slip_label;
+  QLabel * encoder_slip_value;
   QLabel * input_state_label;
   QLabel * input_state_value;
   QLabel * input_after_averaging_label;
@@ -641,6 +676,10 @@ private:
   QLabel * encoder_postscaler_label;
   QSpinBox * encoder_postscaler_value;
   QCheckBox * encoder_unlimited_check;
+  QLabel * slip_threshold_label;
+  QSpinBox * slip_threshold_value;
+  QLabel * slip_action_label;
+  QComboBox * slip_action_value;
 
   QGroupBox * conditioning_settings_box;
   QGridLayout * conditioning_settings_box_layout;
@@ -0,0 +1,299 @@
+#include "plot_window.h"
+#include "to_string.h"
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPainter>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <cassert>
+
+// How often the plot is redrawn.
+static const int REDRAW_INTERVAL_MS = 50;
+
+static std::string telemetry_value_string(telemetry_channel channel,
+  int32_t value)
+{
+  switch (channel)
+  {
+  case TELEMETRY_CURRENT_VELOCITY:
+    return convert_speed_to_pps_string(value);
+  case TELEMETRY_VIN_VOLTAGE:
+    return convert_mv_to_v_string(value);
+  default:
+    return std::to_string(value);
+  }
+}
+
+plot_widget::plot_widget(const telemetry_buffer & buffer, QWidget * parent)
+  : QWidget(parent), buffer(buffer)
+{
+  channel_enabled.fill(true);
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+  setAutoFillBackground(true);
+  QPalette p = palette();
+  p.setColor(QPalette::Window, Qt::white);
+  setPalette(p);
+}
+
+void plot_widget::set_channel_enabled(telemetry_channel channel, bool enabled)
+{
+  channel_enabled[channel] = enabled;
+  update();
+}
+
+void plot_widget::set_span_us(int64_t span_us)
+{
+  this->span_us = span_us;
+  update();
+}
+
+void plot_widget::set_paused(bool paused)
+{
+  if (paused && !this->paused)
+  {
+    paused_end_us = buffer.now_us();
+  }
+  this->paused = paused;
+  update();
+}
+
+QSize plot_widget::sizeHint() const
+{
+  return QSize(800, 500);
+}
+
+void plot_widget::paintEvent(QPaintEvent *)
+{
+  QPainter painter(this);
+
+  int enabled_count = std::count(
+    channel_enabled.begin(), channel_enabled.end(), true);
+  if (enabled_count == 0) { return; }
+
+  int64_t end_us = paused ? paused_end_us : buffer.now_us();
+
+  int strip_height = height() / enabled_count;
+  int strip_index = 0;
+  for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+  {
+    if (!channel_enabled[i]) { continue; }
+    QRect area(0, strip_index * strip_height, width(), strip_height);
+    draw_channel(painter, (telemetry_channel)i, area, end_us);
+    strip_index++;
+  }
+}
+
+void plot_widget::draw_channel(QPainter & painter, telemetry_channel channel,
+  const QRect & area, int64_t end_us)
+{
+  const int text_height = painter.fontMetrics().height();
+  const int margin = 4;
+
+  QRect plot_area = area.adjusted(margin, text_height + margin,
+    -margin, -margin);
+  if (plot_area.width() <= 0 || plot_area.height() <= 0) { return; }
+
+  painter.setPen(Qt::lightGray);
+  painter.drawRect(plot_area);
+
+  columns.resize(plot_area.width());
+  buffer.decimate(channel, end_us, span_us, columns);
+
+  bool have_data = false;
+  int32_t min = 0, max = 0;
+  int32_t last = 0;
+  for (const telemetry_column & column : columns)
+  {
+    if (!column.valid) { continue; }
+    if (!have_data)
+    {
+      min = column.min;
+      max = column.max;
+      have_data = true;
+    }
+    min = std::min(min, column.min);
+    max = std::max(max, column.max);
+    last = column.max;
+  }
+
+  std::string title = telemetry_channel_name(channel);
+  if (have_data)
+  {
+    title += ": " + telemetry_value_string(channel, last) +
+      "  (range " + telemetry_value_string(channel, min) +
+      " to " + telemetry_value_string(channel, max) + ")";
+  }
+  painter.setPen(Qt::black);
+  painter.drawText(area.left() + margin, area.top(),
+    area.width() - 2 * margin, text_height,
+    Qt::AlignLeft | Qt::AlignVCenter, QString::fromStdString(title));
+
+  if (!have_data) { return; }
+
+  // Add a little room above and below the data so that flat lines are not
+  // drawn on top of the border.
+  double low = min, high = max;
+  double pad = (high - low) * 0.05;
+  if (pad == 0) { pad = 1; }
+  low -= pad;
+  high += pad;
+  double scale = (plot_area.height() - 1) / (high - low);
+
+  auto y_for = [&](int32_t value) -> int
+  {
+    return plot_area.bottom() - (int)((value - low) * scale + 0.5);
+  };
+
+  // Draw each column as a vertical line from its minimum to its maximum, and
+  // connect neighboring columns so the trace looks continuous when there are
+  // fewer samples than pixels.
+  painter.setPen(Qt::darkBlue);
+  int previous_x = -1;
+  int previous_y = 0;
+  for (size_t i = 0; i < columns.size(); i++)
+  {
+    const telemetry_column & column = columns[i];
+    if (!column.valid) { continue; }
+    int x = plot_area.left() + i;
+    int y_min = y_for(column.min);
+    int y_max = y_for(column.max);
+    int y_mid = (y_min + y_max) / 2;
+    if (previous_x >= 0)
+    {
+      painter.drawLine(previous_x, previous_y, x, y_mid);
+    }
+    painter.drawLine(x, y_min, x, y_max);
+    previous_x = x;
+    previous_y = y_mid;
+  }
+}
+
+plot_window::plot_window(telemetry_buffer & buffer, QWidget * parent)
+  : buffer(buffer)
+{
+  setup_window();
+
+  // Set the parent this way so that the plot is a separate top-level window
+  // that stays on top of the main window.
+  setParent(parent, Qt::Window);
+}
+
+void plot_window::setup_window()
+{
+  setWindowTitle(tr("Plot"));
+
+  QWidget * central_widget = new QWidget();
+  QVBoxLayout * layout = new QVBoxLayout();
+
+  QHBoxLayout * channel_layout = new QHBoxLayout();
+  for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+  {
+    QCheckBox * check = new QCheckBox();
+    check->setText(telemetry_channel_name((telemetry_channel)i));
+    check->setChecked(true);
+    connect(check, &QCheckBox::toggled,
+      this, &plot_window::channel_check_toggled);
+    channel_checks[i] = check;
+    channel_layout->addWidget(check);
+  }
+  channel_layout->addStretch(1);
+  layout->addLayout(channel_layout);
+
+  plot = new plot_widget(buffer);
+  layout->addWidget(plot, 1);
+
+  QHBoxLayout * control_layout = new QHBoxLayout();
+
+  QLabel * span_label = new QLabel();
+  span_label->setText(tr("Time span:"));
+  control_layout->addWidget(span_label);
+
+  span_value = new QComboBox();
+  span_value->setObjectName("span_value");
+  span_value->addItem(tr("1 s"), 1);
+  span_value->addItem(tr("5 s"), 5);
+  span_value->addItem(tr("10 s"), 10);
+  span_value->addItem(tr("30 s"), 30);
+  span_value->addItem(tr("1 min"), 60);
+  span_value->addItem(tr("5 min"), 300);
+  span_value->setCurrentIndex(span_value->findData(10));
+  control_layout->addWidget(span_value);
+
+  status_label = new QLabel();
+  control_layout->addWidget(status_label, 1);
+
+  pause_button = new QPushButton();
+  pause_button->setObjectName("pause_button");
+  pause_button->setText(tr("&Pause"));
+  control_layout->addWidget(pause_button);
+
+  clear_button = new QPushButton();
+  clear_button->setObjectName("clear_button");
+  clear_button->setText(tr("&Clear"));
+  control_layout->addWidget(clear_button);
+
+  layout->addLayout(control_layout);
+
+  central_widget->setLayout(layout);
+  setCentralWidget(central_widget);
+
+  update_timer = new QTimer(this);
+  update_timer->setObjectName("update_timer");
+  update_timer->start(REDRAW_INTERVAL_MS);
+
+  QMetaObject::connectSlotsByName(this);
+}
+
+void plot_window::set_status(const std::string & status)
+{
+  status_label->setText(QString::fromStdString(status));
+}
+
+void plot_window::closeEvent(QCloseEvent * event)
+{
+  emit closed();
+  QMainWindow::closeEvent(event);
+}
+
+void plot_window::on_update_timer_timeout()
+{
+  if (!plot->is_paused())
+  {
+    plot->update();
+  }
+}
+
+void plot_window::on_span_value_currentIndexChanged(int index)
+{
+  int64_t seconds = span_value->itemData(index).toInt();
+  plot->set_span_us(seconds * 1000000);
+}
+
+void plot_window::on_pause_button_clicked()
+{
+  bool paused = !plot->is_paused();
+  plot->set_paused(paused);
+  pause_button->setText(paused ? tr("&Resume") : tr("&Pause"));
+}
+
+void plot_window::on_clear_button_clicked()
+{
+  buffer.clear();
+  plot->update();
+}
+
+void plot_window::channel_check_toggled()
+{
+  for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+  {
+    plot->set_channel_enabled((telemetry_channel)i,
+      channel_checks[i]->isChecked());
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "telemetry.h"
+
+#include <array>
+#include <vector>
+
+#include <QMainWindow>
+#include <QWidget>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QPushButton;
+class QTimer;
+
+// Draws the recent history of the enabled telemetry channels, one channel per
+// horizontal strip.  Each strip is scaled automatically to fit the data that
+// is visible.
+class plot_widget : public QWidget
+{
+  Q_OBJECT
+
+public:
+  plot_widget(const telemetry_buffer & buffer, QWidget * parent = 0);
+
+  void set_channel_enabled(telemetry_channel channel, bool enabled);
+  void set_span_us(int64_t span_us);
+
+  // When paused, the plot stops scrolling so the data can be inspected.
+  void set_paused(bool paused);
+  bool is_paused() const { return paused; }
+
+protected:
+  void paintEvent(QPaintEvent *) override;
+  QSize sizeHint() const override;
+
+private:
+  void draw_channel(QPainter & painter, telemetry_channel channel,
+    const QRect & area, int64_t end_us);
+
+  const telemetry_buffer & buffer;
+  std::array<bool, TELEMETRY_CHANNEL_COUNT> channel_enabled;
+  int64_t span_us = 10000000;
+  bool paused = false;
+  int64_t paused_end_us = 0;
+
+  // Reused on every paint to avoid allocating memory.
+  std::vector<telemetry_column> columns;
+};
+
+class plot_window : public QMainWindow
+{
+  Q_OBJECT
+
+public:
+  plot_window(telemetry_buffer & buffer, QWidget * parent = 0);
+
+  // Shows a short message about the state of the sampler, e.g. that we are
+  // not connected to a device.
+  void set_status(const std::string & status);
+
+signals:
+  void closed();
+
+protected:
+  void closeEvent(QCloseEvent *) override;
+
+private:
+  void setup_window();
+
+  telemetry_buffer & buffer;
+
+  plot_widget * plot;
+  std::array<QCheckBox *, TELEMETRY_CHANNEL_COUNT> channel_checks;
+  QComboBox * span_value;
+  QPushButton * pause_button;
+  QPushButton * clear_button;
+  QLabel * status_label;
+  QTimer * update_timer;
+
+private slots:
+  void on_update_timer_timeout();
+  void on_span_value_currentIndexChanged(int index);
+  void on_pause_button_clicked();
+  void on_clear_button_clicked();
+  void channel_check_toggled();
+};
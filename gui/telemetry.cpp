@@ -0,0 +1,264 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cassert>
+
+const char * telemetry_channel_name(telemetry_channel channel)
+{
+  switch (channel)
+  {
+  case TELEMETRY_CURRENT_POSITION: return "Current position";
+  case TELEMETRY_CURRENT_VELOCITY: return "Current velocity";
+  case TELEMETRY_ENCODER_POSITION: return "Encoder position";
+  case TELEMETRY_INPUT_AFTER_SCALING: return "Input after scaling";
+  case TELEMETRY_VIN_VOLTAGE: return "VIN voltage";
+  default: return "";
+  }
+}
+
+telemetry_buffer::telemetry_buffer(size_t capacity)
+  : samples(capacity)
+{
+  assert(capacity > 0);
+  start_time = std::chrono::steady_clock::now();
+
+  // Only use block sizes that divide the capacity, so the blocks never
+  // straddle the end of the ring.
+  for (size_t bits = block_bits; bits < 64; bits += block_bits)
+  {
+    size_t size = (size_t)1 << bits;
+    if (size > capacity || capacity % size != 0) { break; }
+    levels.emplace_back(capacity / size);
+  }
+}
+
+static void add_to_column(telemetry_column & column, int32_t min, int32_t max)
+{
+  if (!column.valid)
+  {
+    column.valid = true;
+    column.min = min;
+    column.max = max;
+  }
+  else
+  {
+    column.min = std::min(column.min, min);
+    column.max = std::max(column.max, max);
+  }
+}
+
+static void add_to_block(telemetry_block & block, const telemetry_sample & sample)
+{
+  if (block.count == 0)
+  {
+    block.first_us = sample.time_us;
+    for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+    {
+      block.min[i] = block.max[i] = sample.value[i];
+    }
+  }
+  else
+  {
+    for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++)
+    {
+      block.min[i] = std::min(block.min[i], sample.value[i]);
+      block.max[i] = std::max(block.max[i], sample.value[i]);
+    }
+  }
+  block.last_us = sample.time_us;
+  block.count++;
+}
+
+void telemetry_buffer::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  next = 0;
+  count = 0;
+  start_time = std::chrono::steady_clock::now();
+}
+
+void telemetry_buffer::push(const telemetry_sample & sample)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  samples[next] = sample;
+
+  // A sample at the start of a block replaces the whole block.
+  for (size_t level = 0; level < levels.size(); level++)
+  {
+    size_t bits = block_bits * (level + 1);
+    telemetry_block & block = levels[level][next >> bits];
+    if ((next & (((size_t)1 << bits) - 1)) == 0) { block.count = 0; }
+    add_to_block(block, sample);
+  }
+
+  next = (next + 1) % samples.size();
+  if (count < samples.size()) { count++; }
+}
+
+size_t telemetry_buffer::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+
+bool telemetry_buffer::latest(telemetry_sample & sample) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (count == 0) { return false; }
+  sample = samples[(next + samples.size() - 1) % samples.size()];
+  return true;
+}
+
+void telemetry_buffer::decimate(telemetry_channel channel,
+  int64_t end_us, int64_t span_us,
+  std::vector<telemetry_column> & columns) const
+{
+  for (telemetry_column & column : columns)
+  {
+    column.valid = false;
+  }
+
+  size_t column_count = columns.size();
+  if (column_count == 0 || span_us <= 0) { return; }
+
+  int64_t start_us = end_us - span_us;
+
+  auto column_index = [&](int64_t time_us)
+  {
+    size_t c = (time_us - start_us) * column_count / span_us;
+    return std::min(c, column_count - 1);
+  };
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Walk backwards from the newest sample so we can stop as soon as we get
+  // to samples that are older than the interval being plotted.  Before each
+  // sample, try to take the biggest block that ends there instead.
+  size_t end = next == 0 ? samples.size() : next;
+  size_t remaining = count;
+  while (remaining > 0)
+  {
+    bool used_block = false;
+    for (size_t level = levels.size(); level-- > 0; )
+    {
+      size_t size = (size_t)1 << (block_bits * (level + 1));
+      if (end % size != 0 || remaining < size) { continue; }
+
+      const telemetry_block & block = levels[level][end / size - 1];
+      if (block.count != size) { continue; }
+      if (block.last_us < start_us) { return; }
+      if (block.first_us > end_us)
+      {
+        used_block = true;
+      }
+      else if (block.first_us >= start_us && block.last_us <= end_us &&
+        column_index(block.first_us) == column_index(block.last_us))
+      {
+        add_to_column(columns[column_index(block.first_us)],
+          block.min[channel], block.max[channel]);
+        used_block = true;
+      }
+
+      if (used_block)
+      {
+        end -= size;
+        remaining -= size;
+        break;
+      }
+    }
+
+    if (!used_block)
+    {
+      end--;
+      remaining--;
+      const telemetry_sample & sample = samples[end];
+      if (sample.time_us < start_us) { return; }
+      if (sample.time_us <= end_us)
+      {
+        int32_t value = sample.value[channel];
+        add_to_column(columns[column_index(sample.time_us)], value, value);
+      }
+    }
+
+    if (end == 0) { end = samples.size(); }
+  }
+}
+
+int64_t telemetry_buffer::now_us() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start_time).count();
+}
+
+void telemetry_sampler::start(tic_handle * handle, std::mutex & handle_mutex,
+  uint32_t interval_us)
+{
+  assert(handle != NULL);
+  stop();
+  stop_requested = false;
+  error_count = 0;
+  thread = std::thread(&telemetry_sampler::run, this, handle, &handle_mutex,
+    interval_us);
+}
+
+void telemetry_sampler::stop()
+{
+  if (!thread.joinable()) { return; }
+  stop_requested = true;
+  thread.join();
+}
+
+void telemetry_sampler::run(tic_handle * handle, std::mutex * handle_mutex,
+  uint32_t interval_us)
+{
+  auto interval = std::chrono::microseconds(interval_us);
+  auto next_time = std::chrono::steady_clock::now();
+
+  while (!stop_requested)
+  {
+    tic_variables * vars = NULL;
+
+    // Don't clear the "errors occurred" bits: the main window shows those to
+    // the user and it should not miss any because of the sampler.
+    tic_error * error;
+    {
+      std::lock_guard<std::mutex> lock(*handle_mutex);
+      error = tic_get_variables(handle, &vars, false);
+    }
+    if (error != NULL)
+    {
+      tic_error_free(error);
+      error_count++;
+    }
+    else
+    {
+      telemetry_sample sample;
+      sample.time_us = buffer.now_us();
+      sample.value[TELEMETRY_CURRENT_POSITION] =
+        tic_variables_get_current_position(vars);
+      sample.value[TELEMETRY_CURRENT_VELOCITY] =
+        tic_variables_get_current_velocity(vars);
+      sample.value[TELEMETRY_ENCODER_POSITION] =
+        tic_variables_get_encoder_position(vars);
+      sample.value[TELEMETRY_INPUT_AFTER_SCALING] =
+        tic_variables_get_input_after_scaling(vars);
+      sample.value[TELEMETRY_VIN_VOLTAGE] =
+        tic_variables_get_vin_voltage(vars);
+      tic_variables_free(vars);
+      buffer.push(sample);
+    }
+
+    // Schedule samples at fixed times instead of sleeping for a fixed amount
+    // after each one, so the sample rate does not depend on how long the USB
+    // transfer took.  If we fell behind (e.g. the computer was busy), don't
+    // try to catch up with a burst of samples.
+    next_time += interval;
+    auto now = std::chrono::steady_clock::now();
+    if (next_time < now)
+    {
+      next_time = now;
+    }
+    std::this_thread::sleep_until(next_time);
+  }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "tic.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The quantities that are recorded for each telemetry sample.
+enum telemetry_channel
+{
+  TELEMETRY_CURRENT_POSITION,
+  TELEMETRY_CURRENT_VELOCITY,
+  TELEMETRY_ENCODER_POSITION,
+  TELEMETRY_INPUT_AFTER_SCALING,
+  TELEMETRY_VIN_VOLTAGE,
+  TELEMETRY_CHANNEL_COUNT
+};
+
+const char * telemetry_channel_name(telemetry_channel channel);
+
+struct telemetry_sample
+{
+  // Time in microseconds since the telemetry buffer was created or cleared.
+  int64_t time_us;
+
+  int32_t value[TELEMETRY_CHANNEL_COUNT];
+};
+
+// The range of values seen by one pixel column of a plot.
+struct telemetry_column
+{
+  bool valid;
+  int32_t min;
+  int32_t max;
+};
+
+// The minimum and maximum of each channel over a block of consecutive samples
+// in a telemetry_buffer.
+struct telemetry_block
+{
+  int64_t first_us;
+  int64_t last_us;
+  uint32_t count;
+  int32_t min[TELEMETRY_CHANNEL_COUNT];
+  int32_t max[TELEMETRY_CHANNEL_COUNT];
+};
+
+// A fixed-capacity ring buffer of telemetry samples.  Once the buffer is full,
+// new samples overwrite the oldest ones.  Samples are added by the sampling
+// thread and read by the GUI thread, so all access is protected by a mutex.
+//
+// Besides the samples, the buffer keeps a pyramid of blocks: level 0 has the
+// minimum and maximum of every 64 samples, level 1 of every 4096, and so on.
+// Each level is a ring that lines up with the samples, so pushing a sample
+// only updates one block per level.
+class telemetry_buffer
+{
+public:
+  explicit telemetry_buffer(size_t capacity);
+
+  void clear();
+
+  void push(const telemetry_sample &);
+
+  // Returns the number of samples currently stored.
+  size_t size() const;
+
+  // Gets the most recent sample.  Returns false if the buffer is empty.
+  bool latest(telemetry_sample & sample) const;
+
+  // Divides the time interval from end_us - span_us to end_us into
+  // columns.size() equal columns and records the minimum and maximum value of
+  // the specified channel for the samples that fall in each column.  Blocks
+  // that fit in one column are used instead of their samples, so the work done
+  // depends mostly on the number of columns, and the plot only has to draw one
+  // line per column no matter how many samples there are.
+  void decimate(telemetry_channel channel, int64_t end_us, int64_t span_us,
+    std::vector<telemetry_column> & columns) const;
+
+  // Returns the time in microseconds since the buffer was created or cleared.
+  int64_t now_us() const;
+
+private:
+  static const size_t block_bits = 6;
+
+  mutable std::mutex mutex;
+  std::vector<telemetry_sample> samples;
+  std::vector<std::vector<telemetry_block>> levels;
+  size_t next = 0;
+  size_t count = 0;
+  std::chrono::steady_clock::time_point start_time;
+};
+
+// Runs a background thread that reads the variables from a Tic at a regular
+// interval and stores them in a telemetry_buffer.  The GUI only fetches
+// variables every 50 ms, so this lets us see what the motor is doing on a
+// much finer time scale.
+//
+// The sampler shares the device handle with the rest of the GUI.  A handle
+// can only be used by one thread at a time, so the sampler holds the mutex
+// passed to start() while it reads the variables, and the GUI must hold it
+// too while it uses the handle.  The handle must not be closed while the
+// sampler is running.
+class telemetry_sampler
+{
+public:
+  telemetry_sampler(telemetry_buffer & buffer) : buffer(buffer) { }
+
+  ~telemetry_sampler() { stop(); }
+
+  void start(tic_handle * handle, std::mutex & handle_mutex,
+    uint32_t interval_us);
+
+  void stop();
+
+  bool running() const { return thread.joinable(); }
+
+  // The number of times that reading the variables has failed since the
+  // sampler was started.
+  uint32_t get_error_count() const { return error_count; }
+
+private:
+  void run(tic_handle * handle, std::mutex * handle_mutex,
+    uint32_t interval_us);
+
+  telemetry_buffer & buffer;
+  std::thread thread;
+  std::atomic<bool> stop_requested{false};
+  std::atomic<uint32_t> error_count{0};
+};
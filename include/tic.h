@@ -46,6 +46,19 @@
 ///
 /// Many of the functions in this file refer to numeric constant macros defined
 /// in tic_protocol.h.
+///
+/// To see where the time goes in a program that uses this library, set the
+/// TIC_TRACE environment variable to the name of a file.  The library records
+/// when each call that talks to the device (or parses or fixes settings) and
+/// each USB transfer starts and ends, and writes that to the file in the Chrome
+/// trace event format when the program exits.
+///
+/// To debug a program without hardware, set the TIC_RECORD environment
+/// variable to the name of a file while running it with the device connected.
+/// The library writes every USB transfer to that file.  Later, set TIC_REPLAY
+/// to the name of that file: the library will list the recorded devices and
+/// give back the recorded responses in order, and report an error if the
+/// program makes a request that is different from the one recorded.
 
 #pragma once
 
@@ -96,6 +109,7 @@ extern "C" {
 /// Certain functions in the library return a newly-created string and require
 /// the caller to call this function to free the string.  Passing a NULL pointer
 /// to this function is OK.  Do not free the same non-NULL string twice.
+TIC_API
 void tic_string_free(char *);
 
 
@@ -176,6 +190,13 @@ const char * tic_look_up_pin_state_name_ui(uint8_t pin_state);
 TIC_API
 const char * tic_look_up_planning_mode_name_ui(uint8_t planning_mode);
 
+/// Looks up the string corresponding to the specified request code, e.g.
+/// "Set target position".  The command argument should be one of the
+/// TIC_CMD_* macros, but if it is not, this function returns "(Unknown)".  The
+/// returned string will be valid indefinitely and should not be freed.
+TIC_API
+const char * tic_look_up_command_name_ui(uint8_t command);
+
 /// Looks up the string corresponding to the specified motor driver error.
 /// The argument should be one of the TIC_MOTOR_DRIVER_ERROR_* macros
 /// (e.g. the return value of tic_variables_get_last_motor_driver_error()),
@@ -1645,6 +1666,153 @@ uint32_t tic_variables_get_last_hp_driver_errors(const tic_variables *);
 TIC_API
 tic_variables * tic_variables_fake(void);
 
+// Undocumented function for benchmarking.  Not part of the public API.
+// Decodes a 256-byte buffer of variables in the format the device sends.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_variables_decode(const uint8_t * buffer, uint8_t product,
+  tic_variables ** variables);
+
+
+// tic_motion ///////////////////////////////////////////////////////////////////
+
+/// Represents a model of the Tic's motion planner, which can predict where the
+/// motor will be in the future without talking to the Tic.
+///
+/// You would typically fill it with tic_motion_set_from_variables() and then
+/// call tic_motion_predict() to estimate the position and velocity between
+/// reads of the variables, or tic_motion_get_time_to_target_us() to find out
+/// when a move will finish.  You can also use the setters to plan a move
+/// before sending any commands.
+///
+/// All the quantities use the same units as the Tic: positions in microsteps,
+/// velocities and speeds in microsteps per 10000 seconds
+/// (::TIC_SPEED_UNITS_PER_HZ), and accelerations in microsteps per 100 square
+/// seconds (::TIC_ACCEL_UNITS_PER_HZ2).  A max deceleration of 0 means that
+/// the max acceleration is used for deceleration too.
+///
+/// The model assumes that the velocity changes at a constant rate, that it
+/// can change instantly between zero and the starting speed, and that the
+/// motor does not hit a limit switch or get stopped by an error, so
+/// predictions far in the future can differ from the Tic by a few
+/// milliseconds.
+typedef struct tic_motion tic_motion;
+
+/// Creates a new motion object with everything set to zero.
+///
+/// The motion parameter should be a non-null pointer to a tic_motion pointer,
+/// which will receive a pointer to a new object if and only if this function
+/// is successful.  The caller must free the object later by calling
+/// tic_motion_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_motion_create(tic_motion ** motion);
+
+/// Copies a motion object.  If this function is successful, the caller must
+/// free the copy later by calling tic_motion_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_motion_copy(const tic_motion * source, tic_motion ** dest);
+
+/// Frees a motion object.  It is OK to pass NULL to this function.
+TIC_API
+void tic_motion_free(tic_motion *);
+
+/// Sets the planning mode, targets, limits, current position, and current
+/// velocity from the variables read from a Tic.
+TIC_API
+void tic_motion_set_from_variables(tic_motion *, const tic_variables *);
+
+/// Sets the planning mode, which should be one of the TIC_PLANNING_MODE_*
+/// macros.  If it is TIC_PLANNING_MODE_OFF, the model decelerates to a stop.
+TIC_API
+void tic_motion_set_planning_mode(tic_motion *, uint8_t mode);
+
+/// Gets the planning mode described in tic_motion_set_planning_mode().
+TIC_API
+uint8_t tic_motion_get_planning_mode(const tic_motion *);
+
+/// Sets the target position and the planning mode to
+/// TIC_PLANNING_MODE_TARGET_POSITION, like tic_set_target_position().
+TIC_API
+void tic_motion_set_target_position(tic_motion *, int32_t position);
+
+/// Gets the target position described in tic_motion_set_target_position().
+TIC_API
+int32_t tic_motion_get_target_position(const tic_motion *);
+
+/// Sets the target velocity and the planning mode to
+/// TIC_PLANNING_MODE_TARGET_VELOCITY, like tic_set_target_velocity().
+TIC_API
+void tic_motion_set_target_velocity(tic_motion *, int32_t velocity);
+
+/// Gets the target velocity described in tic_motion_set_target_velocity().
+TIC_API
+int32_t tic_motion_get_target_velocity(const tic_motion *);
+
+/// Sets the starting speed.
+TIC_API
+void tic_motion_set_starting_speed(tic_motion *, uint32_t speed);
+
+/// Gets the starting speed described in tic_motion_set_starting_speed().
+TIC_API
+uint32_t tic_motion_get_starting_speed(const tic_motion *);
+
+/// Sets the max speed.
+TIC_API
+void tic_motion_set_max_speed(tic_motion *, uint32_t speed);
+
+/// Gets the max speed described in tic_motion_set_max_speed().
+TIC_API
+uint32_t tic_motion_get_max_speed(const tic_motion *);
+
+/// Sets the max acceleration.
+TIC_API
+void tic_motion_set_max_accel(tic_motion *, uint32_t accel);
+
+/// Gets the max acceleration described in tic_motion_set_max_accel().
+TIC_API
+uint32_t tic_motion_get_max_accel(const tic_motion *);
+
+/// Sets the max deceleration.
+TIC_API
+void tic_motion_set_max_decel(tic_motion *, uint32_t decel);
+
+/// Gets the max deceleration described in tic_motion_set_max_decel().
+TIC_API
+uint32_t tic_motion_get_max_decel(const tic_motion *);
+
+/// Sets the current position.
+TIC_API
+void tic_motion_set_current_position(tic_motion *, int32_t position);
+
+/// Gets the current position, rounded to the nearest microstep.
+TIC_API
+int32_t tic_motion_get_current_position(const tic_motion *);
+
+/// Sets the current velocity.
+TIC_API
+void tic_motion_set_current_velocity(tic_motion *, int32_t velocity);
+
+/// Gets the current velocity.
+TIC_API
+int32_t tic_motion_get_current_velocity(const tic_motion *);
+
+/// Predicts the position and velocity of the motor the given number of
+/// microseconds from now.  Either output pointer can be NULL.
+TIC_API
+void tic_motion_predict(const tic_motion *, int64_t time_us,
+  int32_t * position, int32_t * velocity);
+
+/// Changes the current position and velocity to the ones predicted for the
+/// given number of microseconds from now.
+TIC_API
+void tic_motion_advance(tic_motion *, int64_t time_us);
+
+/// Returns the number of microseconds until the motor reaches the target
+/// position and stops (in position mode), reaches the target velocity (in
+/// velocity mode), or stops (otherwise).  Returns 0 if that has already
+/// happened, and -1 if it never will (e.g. because the max speed is 0).
+TIC_API
+int64_t tic_motion_get_time_to_target_us(const tic_motion *);
+
 
 // tic_device ///////////////////////////////////////////////////////////////////
 
@@ -1722,6 +1890,152 @@ TIC_API TIC_WARN_UNUSED
 uint16_t tic_device_get_firmware_version(const tic_device *);
 
 
+// tic_stats ////////////////////////////////////////////////////////////////////
+
+/// The number of buckets in each latency histogram of a tic_stats object.
+#define TIC_STATS_BUCKET_COUNT 124
+
+/// A snapshot of the latencies of the requests sent through a tic_handle,
+/// broken down by request code (one of the TIC_CMD_* macros, or 6 for the
+/// USB "Get descriptor" request used by tic_get_firmware_version_string()).
+///
+/// For each request code, there is a histogram of latencies.  Buckets 0
+/// through 3 hold latencies of 0 to 3 microseconds, and after that each power
+/// of two is split into four buckets, so each bucket is at most 25% wider
+/// than the latencies it holds.  The last bucket holds all latencies that are
+/// too long for the others.
+///
+/// See tic_handle_get_stats().
+typedef struct tic_stats tic_stats;
+
+/// Frees a stats object.
+TIC_API
+void tic_stats_free(tic_stats *);
+
+/// Copies a stats object.  If this function is successful, the caller must free
+/// the copy with tic_stats_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_stats_copy(const tic_stats * source, tic_stats ** dest);
+
+/// Gets the number of requests with the specified code, including ones that
+/// failed.
+TIC_API
+uint64_t tic_stats_get_count(const tic_stats *, uint8_t request);
+
+/// Gets the number of requests with the specified code that failed, including
+/// ones that timed out.
+TIC_API
+uint64_t tic_stats_get_error_count(const tic_stats *, uint8_t request);
+
+/// Gets the number of requests with the specified code that timed out.
+TIC_API
+uint64_t tic_stats_get_timeout_count(const tic_stats *, uint8_t request);
+
+/// Gets the sum of the latencies of the requests with the specified code, in
+/// microseconds.
+TIC_API
+uint64_t tic_stats_get_total_us(const tic_stats *, uint8_t request);
+
+/// Gets the longest latency of the requests with the specified code, in
+/// microseconds.
+TIC_API
+uint64_t tic_stats_get_max_us(const tic_stats *, uint8_t request);
+
+/// Gets the number of requests with the specified code whose latencies fell
+/// in the specified bucket, which should be less than TIC_STATS_BUCKET_COUNT.
+TIC_API
+uint64_t tic_stats_get_bucket(const tic_stats *, uint8_t request,
+  uint32_t bucket);
+
+/// Gets the longest latency, in microseconds, that falls in the specified
+/// bucket.
+TIC_API
+uint64_t tic_stats_get_bucket_limit_us(uint32_t bucket);
+
+/// Estimates a percentile (between 0 and 100) of the latencies of the requests
+/// with the specified code, in microseconds.  The estimate is the upper limit
+/// of the bucket that holds the percentile, so it is never too low by more
+/// than the width of that bucket.  Returns 0 if there were no requests.
+TIC_API
+uint64_t tic_stats_get_percentile_us(const tic_stats *, uint8_t request,
+  double percentile);
+
+// Undocumented function for testing.  Not part of the public API.
+TIC_API
+tic_stats * tic_stats_fake(void);
+
+
+// tic_idle_current /////////////////////////////////////////////////////////////
+
+/// A snapshot of what a handle did to lower the current limit of an idle
+/// motor.  See tic_handle_set_idle_current() and
+/// tic_handle_get_idle_current().
+///
+/// The heat that the motor's coils make is proportional to the square of the
+/// current, so the savings are reported in A^2*s: multiply by the resistance
+/// of a coil in ohms to estimate the energy saved in each coil in joules.
+typedef struct tic_idle_current tic_idle_current;
+
+/// Frees an idle current object.
+TIC_API
+void tic_idle_current_free(tic_idle_current *);
+
+/// Copies an idle current object.  If this function is successful, the caller
+/// must free the copy with tic_idle_current_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_idle_current_copy(const tic_idle_current * source,
+  tic_idle_current ** dest);
+
+/// Returns true if the current limit was lowered and has not been restored.
+TIC_API
+bool tic_idle_current_get_reduced(const tic_idle_current *);
+
+/// Gets the current limit, in milliamps, that was in effect the last time the
+/// handle lowered it.
+TIC_API
+uint32_t tic_idle_current_get_full_current_limit(const tic_idle_current *);
+
+/// Gets the current limit, in milliamps, that the handle last lowered it to.
+/// This is the closest current limit that the Tic supports to the one passed
+/// to tic_handle_set_idle_current().
+TIC_API
+uint32_t tic_idle_current_get_idle_current_limit(const tic_idle_current *);
+
+/// Gets the number of times the current limit was lowered.
+TIC_API
+uint64_t tic_idle_current_get_reduction_count(const tic_idle_current *);
+
+/// Gets the number of times the full current limit was restored.
+TIC_API
+uint64_t tic_idle_current_get_restore_count(const tic_idle_current *);
+
+/// Gets the total time that the current limit was low, in microseconds.
+TIC_API
+uint64_t tic_idle_current_get_reduced_us(const tic_idle_current *);
+
+/// Gets the integral over time of the difference between the squares of the
+/// full and idle current limits, in A^2*s.
+TIC_API
+double tic_idle_current_get_saved_a2s(const tic_idle_current *);
+
+/// Gets the total time spent restoring the full current limit before commands,
+/// in microseconds.
+TIC_API
+uint64_t tic_idle_current_get_total_restore_us(const tic_idle_current *);
+
+/// Gets the longest time that restoring the full current limit delayed a
+/// command, in microseconds.
+TIC_API
+uint64_t tic_idle_current_get_max_restore_us(const tic_idle_current *);
+
+/// Gets the number of times that lowering the current limit, or restoring it
+/// after the motor started moving without a command from the handle, failed
+/// while the variables were being read.  These errors do not make
+/// tic_get_variables() fail.
+TIC_API
+uint64_t tic_idle_current_get_error_count(const tic_idle_current *);
+
+
 // tic_handle ///////////////////////////////////////////////////////////////////
 
 /// Represents an open handle that can be used to read and write data from a
@@ -1734,6 +2048,12 @@ typedef struct tic_handle tic_handle;
 /// On Windows, if another applications has a handle open already, then this
 /// function will fail and the returned error will have code
 /// ::TIC_ERROR_ACCESS_DENIED.
+///
+/// If the TIC_DAEMON_SOCKET environment variable is set to the path of the
+/// socket of a running ticd (the Tic daemon), this function connects to ticd
+/// instead of opening the device directly, and ticd does all the
+/// communication with the device on behalf of the handle.  This allows many
+/// programs to use the same device at the same time.
 TIC_API TIC_WARN_UNUSED
 tic_error * tic_handle_open(const tic_device *, tic_handle **);
 
@@ -2101,6 +2421,50 @@ tic_error * tic_set_settings(tic_handle *, const tic_settings *);
 TIC_API TIC_WARN_UNUSED
 tic_error * tic_restore_defaults(tic_handle * handle);
 
+/// A condition for tic_wait_until().  It should return true if the variables
+/// show that we are done waiting.  The context parameter is the one passed to
+/// tic_wait_until().
+typedef bool tic_wait_condition(const tic_variables * variables, void * context);
+
+/// Pass this as the timeout to tic_wait_until() to wait without a time limit.
+#define TIC_WAIT_FOREVER 0xFFFFFFFF
+
+/// Reads the variables repeatedly until the condition is true for them or the
+/// timeout (in milliseconds) passes.  If the timeout passes first, the returned
+/// error has the ::TIC_ERROR_TIMEOUT code.
+///
+/// While the motor is moving, this function uses the current velocity and the
+/// acceleration limits to predict when the motor will reach its target and
+/// reads the variables more often as that time gets closer.  Otherwise, it
+/// reads them every 10 ms.
+///
+/// If the variables parameter is not NULL and this function is successful, it
+/// receives the variables that satisfied the condition, which the caller must
+/// free with tic_variables_free().
+///
+/// Some conditions are provided below, and the context parameter is ignored
+/// for them.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_wait_until(tic_handle *, tic_wait_condition * condition,
+  void * context, uint32_t timeout_ms, tic_variables ** variables);
+
+/// A condition for tic_wait_until() that is true if the Tic is in position
+/// mode and its current position is equal to its target position.
+TIC_API
+bool tic_wait_position_reached(const tic_variables *, void * context);
+
+/// A condition for tic_wait_until() that is true if the Tic is not homing.
+TIC_API
+bool tic_wait_not_homing(const tic_variables *, void * context);
+
+/// A condition for tic_wait_until() that is true if the motor is energized.
+TIC_API
+bool tic_wait_energized(const tic_variables *, void * context);
+
+/// A condition for tic_wait_until() that is true if the current velocity is 0.
+TIC_API
+bool tic_wait_velocity_zero(const tic_variables *, void * context);
+
 /// Causes the Tic to reload all of its settings from EEPROM and make them take
 /// effect.  See also tic_reset().
 TIC_API TIC_WARN_UNUSED
@@ -2111,6 +2475,73 @@ tic_error * tic_reinitialize(tic_handle * handle);
 TIC_API TIC_WARN_UNUSED
 tic_error * tic_start_bootloader(tic_handle * handle);
 
+/// Starts publishing the variables read by tic_get_variables() to a shared
+/// memory segment, where other processes on the same computer can read them
+/// with the tic_telemetry_* functions.
+///
+/// The name argument is the name of the shared memory segment, which should
+/// start with a slash (e.g. "/tic_telemetry").  Pass NULL to stop publishing.
+///
+/// See tic_telemetry_publisher_open() for details.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_publish_telemetry(tic_handle *, const char * name);
+
+/// Starts or stops measuring the latency of every request sent to the device
+/// through this handle.  See tic_handle_get_stats().
+///
+/// Measuring adds two clock readings to each request.  Stopping discards the
+/// measurements.  Do not call this while other threads are using the handle.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_enable_stats(tic_handle *, bool enable);
+
+/// Takes a snapshot of the latencies measured since
+/// tic_handle_enable_stats() was called.  If stats are not enabled, the
+/// snapshot is empty.
+///
+/// The stats parameter should be a non-null pointer to a tic_stats pointer,
+/// which will receive a pointer to a new stats object if and only if this
+/// function is successful.  The caller must free the stats later by calling
+/// tic_stats_free().
+///
+/// This can be called while other threads are sending requests.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_get_stats(tic_handle *, tic_stats ** stats);
+
+/// Makes the handle lower the current limit of the motor to
+/// idle_current_limit (in milliamps) once it has been energized and still for
+/// idle_time_ms milliseconds, to keep it from heating up while it holds its
+/// position.  The handle only checks when tic_get_variables() is called, so
+/// call it regularly.  If sending the lower current limit fails, the handle
+/// counts the error and tries again the next time; see
+/// tic_idle_current_get_error_count().
+///
+/// Before the handle sends a command that can start the motor moving
+/// (tic_set_target_position(), tic_set_target_velocity(), tic_go_home(),
+/// tic_energize(), or tic_exit_safe_start()), it sends the full current limit
+/// first.  Setting the current limit through
+/// the handle makes the new one the full current limit.  Closing the handle
+/// restores the full current limit.
+///
+/// Calling this again changes the settings but keeps the totals.  Do not call
+/// this while other threads are using the handle.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_set_idle_current(tic_handle *,
+  uint32_t idle_current_limit, uint32_t idle_time_ms);
+
+/// Restores the full current limit if needed and stops lowering it.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_disable_idle_current(tic_handle *);
+
+/// Takes a snapshot of what the handle did to lower the current limit since
+/// tic_handle_set_idle_current() was called.
+///
+/// The idle parameter should be a non-null pointer to a tic_idle_current
+/// pointer, which will receive a pointer to a new object if and only if this
+/// function is successful.  The caller must free it later by calling
+/// tic_idle_current_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_handle_get_idle_current(tic_handle *, tic_idle_current ** idle);
+
 /// \cond
 TIC_API TIC_WARN_UNUSED
 tic_error * tic_get_debug_data(tic_handle *, uint8_t * data, size_t * size);
@@ -2158,6 +2589,859 @@ uint32_t tic_current_limit_code_to_ma(uint8_t product, uint8_t code);
 TIC_API
 uint8_t tic_current_limit_ma_to_code(uint8_t product, uint32_t ma);
 
+
+// tic_telemetry ////////////////////////////////////////////////////////////////
+
+/// The number of devices that can publish to one telemetry segment.
+#define TIC_TELEMETRY_SLOT_COUNT 32
+
+/// The number of recent samples kept for each device in a telemetry segment.
+#define TIC_TELEMETRY_HISTORY_LENGTH 64
+
+/// Publishes the variables of a Tic to a POSIX shared memory segment.
+///
+/// Each device gets a slot in the segment that holds its latest
+/// TIC_TELEMETRY_HISTORY_LENGTH samples.  Publishing a sample never blocks and
+/// does not make any system calls other than reading the clock.  Readers use a
+/// tic_telemetry object, and they never block the publisher.
+///
+/// Telemetry is not supported on Windows.
+///
+/// Most programs do not need to use this directly: see
+/// tic_handle_publish_telemetry().
+typedef struct tic_telemetry_publisher tic_telemetry_publisher;
+
+/// Opens (and creates if needed) the shared memory segment with the specified
+/// name and claims a slot in it for the device with the specified serial
+/// number.
+///
+/// A device gets the same slot it had before, if any.  Only one publisher can
+/// use a slot at a time, but a slot whose publisher exited without closing it
+/// can be taken over.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_telemetry_publisher_open(const char * name,
+  const char * serial_number, tic_telemetry_publisher ** publisher);
+
+/// Releases the publisher's slot and frees the publisher.  The samples it
+/// published stay in the segment.
+TIC_API
+void tic_telemetry_publisher_close(tic_telemetry_publisher *);
+
+/// Publishes a sample with the specified variables and the current time.
+TIC_API
+void tic_telemetry_publish(tic_telemetry_publisher *, const tic_variables *);
+
+/// Reads the variables that are being published to a shared memory segment.
+///
+/// Reading does not involve any system calls or locks: if a sample is changed
+/// while it is being read, the read is simply retried.
+typedef struct tic_telemetry tic_telemetry;
+
+/// Opens an existing telemetry segment for reading.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_telemetry_open(const char * name, tic_telemetry ** telemetry);
+
+/// Closes the telemetry segment and frees the object.
+TIC_API
+void tic_telemetry_close(tic_telemetry *);
+
+/// Finds the slot of the device with the specified serial number.  Returns
+/// true and writes to the slot argument if it was found.
+///
+/// A device keeps its slot while it is disconnected or its publisher is closed,
+/// so you only need to look it up once.
+TIC_API
+bool tic_telemetry_find_device(const tic_telemetry *,
+  const char * serial_number, uint32_t * slot);
+
+/// Gets the number of samples that have been published to the slot.  The latest
+/// sample is number count - 1, and samples older than
+/// count - TIC_TELEMETRY_HISTORY_LENGTH are no longer available.
+TIC_API
+uint64_t tic_telemetry_get_sample_count(const tic_telemetry *, uint32_t slot);
+
+/// Reads a sample from the slot's history.
+///
+/// The variables parameter should be a non-null pointer to a tic_variables
+/// pointer, which will receive a pointer to a new variables object if and only
+/// if this function is successful.  The caller must free the variables later by
+/// calling tic_variables_free().
+///
+/// If time_us is non-null, it receives the time when the sample was published,
+/// in microseconds, from the same monotonic clock for all processes.
+///
+/// Returns an error if the sample was overwritten by newer samples or has not
+/// been published yet.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_telemetry_get_sample(const tic_telemetry *, uint32_t slot,
+  uint64_t sample_number, tic_variables ** variables, int64_t * time_us);
+
+/// Reads a sample from the slot's history into a variables object that you
+/// already have, like tic_telemetry_get_sample().  This does not allocate
+/// memory or make system calls unless there is an error, so you can use it to
+/// read every sample at high rates.
+///
+/// The variables parameter should be a non-null pointer to a variables object,
+/// for example one returned by an earlier call to tic_telemetry_get_sample().
+/// If there is an error, its contents are unspecified.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_telemetry_read_sample(const tic_telemetry *, uint32_t slot,
+  uint64_t sample_number, tic_variables * variables, int64_t * time_us);
+
+/// Removes the name of a telemetry segment.  Processes that have it open can
+/// keep using it, but new publishers will create a new segment.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_telemetry_remove(const char * name);
+
+
+// tic_stream ///////////////////////////////////////////////////////////////////
+
+/// Sends a timed sequence of target positions and target velocities to a Tic
+/// from a dedicated thread.
+///
+/// The thread sleeps until the absolute time of each point, so a point that is
+/// sent late does not delay the points after it.  If the thread falls so far
+/// behind that the next point is already due, the stale point is skipped.
+/// After the stream finishes, you can get the number of missed deadlines and
+/// statistics about how late each point was sent.
+///
+/// Streaming is not supported on Windows.
+typedef struct tic_stream tic_stream;
+
+/// Creates a new stream with no points.
+///
+/// The stream parameter should be a non-null pointer to a tic_stream pointer,
+/// which will receive a pointer to a new stream object if and only if this
+/// function is successful.  The caller must free the stream later by calling
+/// tic_stream_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_stream_create(tic_stream ** stream);
+
+/// Frees a stream, stopping it first if it is running.
+TIC_API
+void tic_stream_free(tic_stream *);
+
+/// Adds a point to the end of the stream.
+///
+/// The time_us argument is the time to send the point, in microseconds after
+/// the stream starts.  Points must be added in time order.
+///
+/// The planning_mode argument should be TIC_PLANNING_MODE_TARGET_POSITION to
+/// send the target with tic_set_target_position(), or
+/// TIC_PLANNING_MODE_TARGET_VELOCITY to send it with
+/// tic_set_target_velocity().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_stream_add_point(tic_stream *, int64_t time_us,
+  uint8_t planning_mode, int32_t target);
+
+/// Gets the number of points in the stream.
+TIC_API
+size_t tic_stream_get_point_count(const tic_stream *);
+
+/// Sets the SCHED_FIFO priority of the streaming thread.  The default is 0,
+/// which means the thread gets the normal priority.  Real-time priorities
+/// usually require special permissions.
+TIC_API
+void tic_stream_set_priority(tic_stream *, int priority);
+
+/// Sets the CPU that the streaming thread runs on.  The default is -1, which
+/// means any CPU.  This is only supported on Linux.
+TIC_API
+void tic_stream_set_cpu(tic_stream *, int cpu);
+
+/// Sets how late a point can be sent, in microseconds, before it counts as a
+/// missed deadline.  The default is 1000.
+TIC_API
+void tic_stream_set_max_lateness_us(tic_stream *, uint32_t max_lateness_us);
+
+/// Starts sending the points to the specified handle from a new thread.  The
+/// time of the first point is measured from when this function is called.
+///
+/// You should not use the handle from other threads, or free the stream or the
+/// handle, until tic_stream_wait() returns.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_stream_start(tic_stream *, tic_handle *);
+
+/// Asks the streaming thread to stop before sending its next point.  If the
+/// thread is waiting for the time of the next point, it stops right away.
+/// This can be called from any thread.  You still need to call
+/// tic_stream_wait().
+TIC_API
+void tic_stream_stop(tic_stream *);
+
+/// Waits for the streaming thread to finish.  Returns the error that stopped
+/// it, if any.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_stream_wait(tic_stream *);
+
+/// Gets the number of points that were sent during the last run.
+TIC_API
+size_t tic_stream_get_sent_count(const tic_stream *);
+
+/// Gets the number of points that were sent more than the maximum lateness
+/// after their time, or were skipped, during the last run.
+TIC_API
+size_t tic_stream_get_missed_count(const tic_stream *);
+
+/// Gets the number of points that were skipped during the last run because the
+/// next point was already due.  Points are not skipped while replaying a USB
+/// recording.
+TIC_API
+size_t tic_stream_get_skipped_count(const tic_stream *);
+
+/// Gets a percentile (from 0 to 100) of how late the points were sent during
+/// the last run, in nanoseconds.  Use 100 to get the maximum.
+TIC_API
+int64_t tic_stream_get_lateness_ns(const tic_stream *, double percent);
+
+/// Gets a percentile (from 0 to 100) of how long it took to send the points
+/// during the last run, in nanoseconds.
+TIC_API
+int64_t tic_stream_get_send_time_ns(const tic_stream *, double percent);
+
+
+// tic_s_curve //////////////////////////////////////////////////////////////////
+
+/// Plans and performs jerk-limited (S-curve) moves.
+///
+/// The Tic's own planner changes the velocity at a constant rate, so the
+/// acceleration jumps at the start and end of each ramp, which can make some
+/// mechanical systems ring.  An S-curve move ramps the acceleration up and
+/// down too.  tic_s_curve_move() does this by sending a new target velocity
+/// every few milliseconds, using the current position from the Tic to correct
+/// for any drift, and then sending the final target position so the Tic lands
+/// on it exactly.
+///
+/// Speeds are in microsteps per 10000 seconds, accelerations are in microsteps
+/// per 100 square seconds, like the Tic's settings, and jerks are in microsteps
+/// per cubic second.
+typedef struct tic_s_curve tic_s_curve;
+
+/// Creates a new S-curve object.  You must set its max speed, max
+/// acceleration, and max jerk before using it.
+///
+/// The curve parameter should be a non-null pointer to a tic_s_curve pointer,
+/// which will receive a pointer to a new object if and only if this function
+/// is successful.  The caller must free the object later by calling
+/// tic_s_curve_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_s_curve_create(tic_s_curve ** curve);
+
+/// Frees an S-curve object.
+TIC_API
+void tic_s_curve_free(tic_s_curve *);
+
+/// Sets the maximum speed of the move.  To follow the plan, the Tic's max speed
+/// must be at least this high.
+TIC_API
+void tic_s_curve_set_max_speed(tic_s_curve *, uint32_t speed);
+
+/// Gets the maximum speed described in tic_s_curve_set_max_speed().
+TIC_API
+uint32_t tic_s_curve_get_max_speed(const tic_s_curve *);
+
+/// Sets the maximum acceleration and deceleration of the move.  To follow the
+/// plan, the Tic's max acceleration and max deceleration must be at least this
+/// high.
+TIC_API
+void tic_s_curve_set_max_accel(tic_s_curve *, uint32_t accel);
+
+/// Gets the maximum acceleration described in tic_s_curve_set_max_accel().
+TIC_API
+uint32_t tic_s_curve_get_max_accel(const tic_s_curve *);
+
+/// Sets the maximum jerk (rate of change of acceleration) of the move.
+TIC_API
+void tic_s_curve_set_max_jerk(tic_s_curve *, uint32_t jerk);
+
+/// Gets the maximum jerk described in tic_s_curve_set_max_jerk().
+TIC_API
+uint32_t tic_s_curve_get_max_jerk(const tic_s_curve *);
+
+/// Sets how often tic_s_curve_move() sends a new target velocity, in
+/// microseconds.  The default is 2000.
+TIC_API
+void tic_s_curve_set_update_interval_us(tic_s_curve *, uint32_t interval_us);
+
+/// Gets the update interval described in
+/// tic_s_curve_set_update_interval_us().
+TIC_API
+uint32_t tic_s_curve_get_update_interval_us(const tic_s_curve *);
+
+/// Plans a move from rest at the start position to rest at the target
+/// position.  You do not need to call this before tic_s_curve_move(), but you
+/// can use it to see what a move would look like.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_s_curve_plan(tic_s_curve *,
+  int32_t start_position, int32_t target_position);
+
+/// Gets the duration of the planned move in microseconds.
+TIC_API
+int64_t tic_s_curve_get_duration_us(const tic_s_curve *);
+
+/// Gets the planned position and velocity at the specified time after the
+/// start of the planned move.  Either output pointer can be null.
+TIC_API
+void tic_s_curve_predict(const tic_s_curve *, int64_t time_us,
+  int32_t * position, int32_t * velocity);
+
+/// Moves the motor from its current position to the target position along an
+/// S-curve, and returns when the final target position has been sent.  The
+/// motor should be stopped and the Tic should be ready to move it.
+///
+/// Use tic_wait_until() with tic_wait_position_reached() if you need to wait
+/// until the motor gets there.
+///
+/// If there is an error after the motor has started moving, this function
+/// tries to set the target velocity to 0 before returning the error.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_s_curve_move(tic_s_curve *, tic_handle *,
+  int32_t target_position);
+
+
+// tic_servo ////////////////////////////////////////////////////////////////////
+
+/// Closes a position loop on the Tic's encoder input from the computer.
+///
+/// The Tic counts quadrature encoder pulses but does not use them to correct
+/// its own position.  A servo object reads the encoder position and sends a
+/// corrected target velocity on each update, using a PID controller with a
+/// feed-forward velocity.  Each update takes one request to read the part of
+/// the variables that it needs and one request to set the target velocity.
+///
+/// The integral term is limited, and it does not grow while the output is
+/// saturated at the max speed, so it does not wind up when the motor is
+/// blocked or has a long way to go.
+///
+/// Speeds are in microsteps per 10000 seconds, like the Tic's settings.
+typedef struct tic_servo tic_servo;
+
+/// Creates a new servo object with a proportional gain of 20, no integral or
+/// derivative gain, and encoder scaling of 1.
+///
+/// The servo parameter should be a non-null pointer to a tic_servo pointer,
+/// which will receive a pointer to a new object if and only if this function
+/// is successful.  The caller must free the object later by calling
+/// tic_servo_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_servo_create(tic_servo ** servo);
+
+/// Frees a servo object.
+TIC_API
+void tic_servo_free(tic_servo *);
+
+/// Sets the gains of the PID controller.  With a position error in
+/// microsteps, kp is in microsteps per second per microstep of error, ki is
+/// in microsteps per second per microstep-second of error, and kd is in
+/// microsteps per second per microstep per second of motion.
+TIC_API
+void tic_servo_set_gains(tic_servo *, double kp, double ki, double kd);
+
+/// Gets the gains described in tic_servo_set_gains().  Any of the output
+/// pointers can be null.
+TIC_API
+void tic_servo_get_gains(const tic_servo *,
+  double * kp, double * ki, double * kd);
+
+/// Sets how to convert encoder counts to microsteps: the position in
+/// microsteps is the encoder position times the postscaler divided by the
+/// prescaler.  This matches the encoder_prescaler and encoder_postscaler
+/// settings, which you can pass here.
+TIC_API
+void tic_servo_set_encoder_scaling(tic_servo *,
+  uint32_t prescaler, uint32_t postscaler);
+
+/// Sets the maximum speed of the output.  The default is 0, which means the
+/// Tic's current max speed.  The output never goes faster than the Tic's max
+/// speed.
+TIC_API
+void tic_servo_set_max_speed(tic_servo *, uint32_t speed);
+
+/// Sets the maximum speed that the integral term can contribute to the
+/// output.  The default is 0, which means the same as the max speed.
+TIC_API
+void tic_servo_set_integral_limit(tic_servo *, uint32_t speed);
+
+/// Sets how close the encoder position needs to be to the target, in
+/// microsteps, for the servo to count as settled.  The default is 0.5.
+TIC_API
+void tic_servo_set_tolerance(tic_servo *, double tolerance);
+
+/// Sets the target position, in microsteps, which can have a fractional part.
+/// Also sets the feed-forward velocity, which is added to the output: if the
+/// target is moving, this should be its velocity.
+TIC_API
+void tic_servo_set_target(tic_servo *, double position, int32_t velocity);
+
+/// Clears the state of the controller and the timing statistics.
+TIC_API
+void tic_servo_reset(tic_servo *);
+
+/// Reads the encoder position and sends a new target velocity.  The
+/// interval_us argument is the time since the last update, in microseconds.
+///
+/// Returns an error if the Tic is not moving the motor because of errors.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_servo_update(tic_servo *, tic_handle *, uint32_t interval_us);
+
+/// Gets the encoder position read by the last update, in microsteps.
+TIC_API
+double tic_servo_get_position(const tic_servo *);
+
+/// Gets the target position minus the encoder position from the last update,
+/// in microsteps.
+TIC_API
+double tic_servo_get_error(const tic_servo *);
+
+/// Gets the target velocity sent by the last update.
+TIC_API
+int32_t tic_servo_get_output(const tic_servo *);
+
+/// Returns true if the error from the last update was within the tolerance
+/// set by tic_servo_set_tolerance().
+TIC_API
+bool tic_servo_is_settled(const tic_servo *);
+
+/// Gets the number of updates since the servo was created or reset.
+TIC_API
+uint64_t tic_servo_get_update_count(const tic_servo *);
+
+/// Gets the number of times tic_servo_run() missed an update time because the
+/// updates took longer than the interval.
+TIC_API
+uint64_t tic_servo_get_overrun_count(const tic_servo *);
+
+/// Gets the average time that an update took, in microseconds.
+TIC_API
+uint64_t tic_servo_get_mean_update_us(const tic_servo *);
+
+/// Gets the longest time that an update took, in microseconds.
+TIC_API
+uint64_t tic_servo_get_max_update_us(const tic_servo *);
+
+/// Gets the latest that tic_servo_run() started an update after its
+/// scheduled time, in microseconds.
+TIC_API
+uint64_t tic_servo_get_max_lateness_us(const tic_servo *);
+
+/// Updates several servos at a fixed interval until all of them are settled,
+/// and then sets their target velocities to 0.  Each servo uses the handle
+/// with the same index.  Servos are updated one after the other, so a single
+/// thread can control several axes.
+///
+/// Update times are scheduled from the start, so slow updates do not make
+/// later updates drift.  If the updates take longer than the interval, the
+/// missed update times are skipped and counted as overruns.
+///
+/// Pass TIC_WAIT_FOREVER as the timeout to keep going until an error happens.
+/// If there is an error or the timeout passes, this function tries to set the
+/// target velocity of every axis to 0 before returning the error.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_servo_run(tic_servo * const * servos,
+  tic_handle * const * handles, size_t count,
+  uint32_t interval_us, uint32_t timeout_ms);
+
+
+// tic_slip_monitor /////////////////////////////////////////////////////////////
+
+/// Detects when the motor stalls or loses steps by comparing the encoder
+/// position to the Tic's current position.
+///
+/// The Tic does not use its encoder input to correct its position, so a
+/// motor that stalls keeps getting steps that it does not take.  A slip
+/// monitor remembers the difference between the scaled encoder position and
+/// the current position when the motor is energized, and flags a slip as
+/// soon as that difference changes by more than a threshold.
+///
+/// The monitor does not read from the Tic itself: you pass it the variables
+/// that you already read, so you can check for slips in any loop that polls
+/// the Tic without adding traffic to it.  A slip is noticed on the first poll
+/// after it happens.
+typedef struct tic_slip_monitor tic_slip_monitor;
+
+#define TIC_SLIP_ACTION_NONE 0
+#define TIC_SLIP_ACTION_HALT_AND_HOLD 1
+#define TIC_SLIP_ACTION_DEENERGIZE 2
+
+/// Creates a new slip monitor with a threshold of 200 microsteps, encoder
+/// scaling of 1, and no action.
+///
+/// The monitor parameter should be a non-null pointer to a tic_slip_monitor
+/// pointer, which will receive a pointer to a new object if and only if this
+/// function is successful.  The caller must free the object later by calling
+/// tic_slip_monitor_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_slip_monitor_create(tic_slip_monitor ** monitor);
+
+/// Frees a slip monitor.
+TIC_API
+void tic_slip_monitor_free(tic_slip_monitor *);
+
+/// Sets how to convert encoder counts to microsteps, like
+/// tic_servo_set_encoder_scaling().  Changing the scaling makes the monitor
+/// take a new reference on the next check.
+TIC_API
+void tic_slip_monitor_set_encoder_scaling(tic_slip_monitor *,
+  uint32_t prescaler, uint32_t postscaler);
+
+/// Sets how far, in microsteps, the encoder can get ahead of or behind the
+/// current position before the monitor flags a slip.  0 turns off detection.
+TIC_API
+void tic_slip_monitor_set_threshold(tic_slip_monitor *, uint32_t threshold);
+
+/// Gets the threshold described in tic_slip_monitor_set_threshold().
+TIC_API
+uint32_t tic_slip_monitor_get_threshold(const tic_slip_monitor *);
+
+/// Sets what the monitor does when it flags a slip: one of the
+/// TIC_SLIP_ACTION_* macros.  The action is only done once per slip.
+TIC_API
+void tic_slip_monitor_set_action(tic_slip_monitor *, uint8_t action);
+
+/// Gets the action described in tic_slip_monitor_set_action().
+TIC_API
+uint8_t tic_slip_monitor_get_action(const tic_slip_monitor *);
+
+/// Clears a flagged slip and the maximum deviation, and makes the monitor take
+/// a new reference on the next check.  Call this after you move the motor
+/// without stepping it or change the current position with
+/// tic_halt_and_set_position().
+TIC_API
+void tic_slip_monitor_reset(tic_slip_monitor *);
+
+/// Checks the given variables for a slip.  If there is a new slip and the
+/// monitor has an action, it sends the command to the handle, which can be
+/// null if the action is TIC_SLIP_ACTION_NONE.
+///
+/// While the motor is not energized, the monitor does not flag slips and
+/// takes a new reference when the motor is energized again.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_slip_monitor_check(tic_slip_monitor *, tic_handle *,
+  const tic_variables *);
+
+/// Returns true if the monitor has flagged a slip since it was created or
+/// reset.
+TIC_API
+bool tic_slip_monitor_slipped(const tic_slip_monitor *);
+
+/// Gets how far the encoder was ahead of the current position at the last
+/// check, relative to the reference, in microsteps.
+TIC_API
+double tic_slip_monitor_get_deviation(const tic_slip_monitor *);
+
+/// Gets the largest deviation seen since the monitor was created or reset, in
+/// microsteps.
+TIC_API
+double tic_slip_monitor_get_max_deviation(const tic_slip_monitor *);
+
+
+// tic_sync /////////////////////////////////////////////////////////////////////
+
+/// Sends commands to several Tics at nearly the same time.
+///
+/// Sending a command to each Tic in turn delays the later ones by the time it
+/// takes to send the earlier ones.  A sync group keeps one thread per Tic
+/// waiting for commands.  Each command is prepared for every Tic first, and
+/// then all the threads are released at once, so the difference between when
+/// the Tics get the command is mostly down to the operating system and USB.
+///
+/// The group measures that difference (the skew) each time it sends a
+/// command.  It uses the same handles as the caller, so do not send other
+/// commands to those handles from other threads while a group command is in
+/// progress.
+///
+/// This is not supported on Windows.
+typedef struct tic_sync tic_sync;
+
+/// Creates a sync group for the given handles and starts its threads.  The
+/// handles must stay open until the group is freed.
+///
+/// The sync parameter should be a non-null pointer to a tic_sync pointer,
+/// which will receive a pointer to a new object if and only if this function
+/// is successful.  The caller must free the object later by calling
+/// tic_sync_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_sync_create(tic_handle * const * handles, size_t count,
+  tic_sync ** sync);
+
+/// Stops the threads of a sync group and frees it.
+TIC_API
+void tic_sync_free(tic_sync *);
+
+/// Gets the number of Tics in the group.
+TIC_API
+size_t tic_sync_get_count(const tic_sync *);
+
+/// Gets the handle with the given index that was passed to tic_sync_create().
+TIC_API
+tic_handle * tic_sync_get_handle(const tic_sync *, size_t index);
+
+/// Sets the target position of every Tic in the group at the same time with
+/// tic_set_target_position().  The positions array should have one entry for
+/// each handle, in the same order.
+///
+/// Returns after all the commands have been sent.  If any of them failed, the
+/// error is for the first Tic that failed.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_sync_set_target_positions(tic_sync *, const int32_t * positions);
+
+/// Sends tic_halt_and_hold() to every Tic in the group at the same time.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_sync_halt_and_hold(tic_sync *);
+
+/// Gets the time between when the first and last Tic started getting the last
+/// command, in nanoseconds.
+TIC_API
+int64_t tic_sync_get_issue_skew_ns(const tic_sync *);
+
+/// Gets the time between when the first and last Tic finished getting the last
+/// command, in nanoseconds.
+TIC_API
+int64_t tic_sync_get_complete_skew_ns(const tic_sync *);
+
+/// Gets how long after the first Tic the Tic with the given index started
+/// getting the last command, in nanoseconds.
+TIC_API
+int64_t tic_sync_get_issue_offset_ns(const tic_sync *, size_t index);
+
+
+// tic_arrival //////////////////////////////////////////////////////////////////
+
+/// Plans multi-axis moves that finish on every axis at the same time.
+///
+/// Each axis has its own starting speed, max speed, max acceleration, and max
+/// deceleration.  For each move, the planner works out how long the slowest
+/// axis takes and lowers the max speed of the other axes so that they take
+/// just as long, keeping their acceleration limits.  The planning is done in
+/// closed form without allocating memory, so it is cheap enough to do for
+/// every move.
+///
+/// The plan assumes that every axis starts at rest.  An axis with a high
+/// starting speed cannot go slower than that speed, so it might still finish
+/// early.
+///
+/// Speeds and accelerations use the same units as the Tic's settings.
+typedef struct tic_arrival tic_arrival;
+
+/// The maximum number of axes in an arrival plan.
+#define TIC_ARRIVAL_MAX_AXES 16
+
+/// Creates a new arrival planner with the limits of every axis set to 0.
+///
+/// The arrival parameter should be a non-null pointer to a tic_arrival
+/// pointer, which will receive a pointer to a new object if and only if this
+/// function is successful.  The caller must free the object later by calling
+/// tic_arrival_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_arrival_create(tic_arrival ** arrival);
+
+/// Frees an arrival planner.
+TIC_API
+void tic_arrival_free(tic_arrival *);
+
+/// Sets the limits of the axis with the given index.  These should be the
+/// fastest that the axis can go: moves never go faster.  A max deceleration
+/// of 0 means the same as the max acceleration.
+TIC_API
+void tic_arrival_set_axis_limits(tic_arrival *, size_t index,
+  uint32_t starting_speed, uint32_t max_speed,
+  uint32_t max_accel, uint32_t max_decel);
+
+/// Sets the limits of the axis with the given index from the starting speed,
+/// max speed, max acceleration, and max deceleration settings.
+TIC_API
+void tic_arrival_set_axis_limits_from_settings(tic_arrival *, size_t index,
+  const tic_settings *);
+
+/// Sets the shortest time that planned moves can take, in microseconds.  This
+/// lets you limit the speed along the path: for example, a move of length L
+/// at feed rate F should take at least L / F.  The default is 0.  Moves where
+/// no axis moves still take no time.
+TIC_API
+void tic_arrival_set_min_duration_us(tic_arrival *, int64_t duration_us);
+
+/// Gets the time described in tic_arrival_set_min_duration_us().
+TIC_API
+int64_t tic_arrival_get_min_duration_us(const tic_arrival *);
+
+/// Plans a move where each axis goes the given distance in microsteps.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_arrival_plan(tic_arrival *, size_t count,
+  const int32_t * distances);
+
+/// Gets how long the planned move takes, in microseconds.
+TIC_API
+int64_t tic_arrival_get_duration_us(const tic_arrival *);
+
+/// Gets the max speed that the plan uses for the given axis.
+TIC_API
+uint32_t tic_arrival_get_axis_max_speed(const tic_arrival *, size_t index);
+
+/// Gets the max acceleration that the plan uses for the given axis.
+TIC_API
+uint32_t tic_arrival_get_axis_max_accel(const tic_arrival *, size_t index);
+
+/// Gets the max deceleration that the plan uses for the given axis.
+TIC_API
+uint32_t tic_arrival_get_axis_max_decel(const tic_arrival *, size_t index);
+
+/// Gets how long the given axis takes in the planned move, in microseconds.
+/// This is only shorter than tic_arrival_get_duration_us() if the axis does
+/// not move or its starting speed is too high for it to go slower.
+TIC_API
+int64_t tic_arrival_get_axis_duration_us(const tic_arrival *, size_t index);
+
+/// Plans a move from the current positions of the Tics in the sync group to
+/// the given targets, sets the max speed, max acceleration, and max
+/// deceleration of each Tic from the plan, and then sets all the target
+/// positions together with tic_sync_set_target_positions().
+///
+/// The limits set by this function stay in effect after the move, so set
+/// them back if you send other commands later.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_arrival_move(tic_arrival *, tic_sync *, const int32_t * targets);
+
+
+// tic_microstep_scheduler /////////////////////////////////////////////////////
+
+/// Switches the Tic to coarser step modes as the motor speeds up and back to
+/// finer ones as it slows down.
+///
+/// The Tic cannot send more than 50 kHz of step pulses
+/// (TIC_MAX_ALLOWED_SPEED), so a fine step mode limits the top speed of the
+/// motor.  With the scheduler, the motor can use a fine step mode for smooth,
+/// precise motion at low speeds and a coarse one for fast moves.
+///
+/// All positions, speeds, and accelerations that you give the scheduler or get
+/// from it are in microsteps of the base step mode, no matter which step mode
+/// the Tic is using.  The scheduler converts targets and limits to the Tic's
+/// current step mode when it sends them.
+///
+/// The scheduler only changes the step mode when you call
+/// tic_microstep_scheduler_update(), so you should call it every few
+/// milliseconds while the motor is moving.  After a change, the scheduler
+/// keeps the motor at the same speed by briefly raising the Tic's acceleration
+/// or deceleration limit, and it sets the normal limits again on the next
+/// update.
+///
+/// The Tic does not report exactly when it changes step modes, so the position
+/// can be off by about half the steps that the Tic takes during a USB request
+/// each time the step mode changes.  If that matters, go back to the base step
+/// mode and home the motor from time to time.
+typedef struct tic_microstep_scheduler tic_microstep_scheduler;
+
+/// The maximum number of step modes that a scheduler can use, including the
+/// base step mode.
+#define TIC_MICROSTEP_MAX_LEVELS 10
+
+/// Creates a new microstep scheduler with no step modes.  The hysteresis is
+/// 10% and the limits are 0.
+///
+/// The scheduler parameter should be a non-null pointer to a
+/// tic_microstep_scheduler pointer, which will receive a pointer to a new
+/// object if and only if this function is successful.  The caller must free
+/// the object later by calling tic_microstep_scheduler_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_create(tic_microstep_scheduler ** scheduler);
+
+/// Frees a microstep scheduler.
+TIC_API
+void tic_microstep_scheduler_free(tic_microstep_scheduler *);
+
+/// Sets the step mode to use at low speeds and removes any other step modes.
+/// The step_mode argument should be one of the TIC_STEP_MODE_* macros.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_set_base_step_mode(
+  tic_microstep_scheduler *, uint8_t step_mode);
+
+/// Adds a step mode to use at speeds of at least the given speed, in
+/// microsteps of the base step mode per 10000 seconds.  Each step mode must be
+/// coarser than the one added before it and start at a higher speed.
+///
+/// The motor cannot get faster than 50 kHz in the step mode before, so the
+/// speed should be less than that to make sure that the change happens.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_add_level(tic_microstep_scheduler *,
+  uint8_t step_mode, uint64_t speed);
+
+/// Sets how much slower than the speed where a step mode starts the motor must
+/// go before the scheduler changes back to the finer step mode, as a
+/// percentage of that speed.  This keeps the step mode from changing back and
+/// forth when the speed is close to a threshold.
+TIC_API
+void tic_microstep_scheduler_set_hysteresis_percent(
+  tic_microstep_scheduler *, uint8_t percent);
+
+/// Gets the hysteresis described in
+/// tic_microstep_scheduler_set_hysteresis_percent().
+TIC_API
+uint8_t tic_microstep_scheduler_get_hysteresis_percent(
+  const tic_microstep_scheduler *);
+
+/// Sets the max speed, max acceleration, and max deceleration of the motor, in
+/// base microsteps.  The max speed can be higher than TIC_MAX_ALLOWED_SPEED
+/// since the Tic only has to reach it in coarser step modes.  A max
+/// deceleration of 0 means the same as the max acceleration.
+///
+/// This takes effect the next time the scheduler sends limits to the Tic.
+TIC_API
+void tic_microstep_scheduler_set_limits(tic_microstep_scheduler *,
+  uint64_t max_speed, uint64_t max_accel, uint64_t max_decel);
+
+/// Sets the Tic to the base step mode, sets its limits, and takes its current
+/// position as the position in base microsteps.  Call this before the other
+/// functions that take a handle.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_start(tic_microstep_scheduler *,
+  tic_handle *);
+
+/// Sets the target position in base microsteps.  The scheduler sends it again
+/// whenever the step mode changes.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_set_target_position(
+  tic_microstep_scheduler *, tic_handle *, int64_t position);
+
+/// Sets the target velocity in base microsteps per 10000 seconds.  The
+/// scheduler sends it again whenever the step mode changes.
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_set_target_velocity(
+  tic_microstep_scheduler *, tic_handle *, int64_t velocity);
+
+/// Reads the variables from the Tic and changes the step mode if the speed
+/// calls for it.
+///
+/// Once the motor is resting at its target in the base step mode, this also
+/// sets the Tic's current position to the position in base microsteps, so
+/// that other software sees the right position.
+///
+/// If the variables argument is not NULL, it receives the latest variables,
+/// so you can use them without reading them again.  The caller must free them
+/// later with tic_variables_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_microstep_scheduler_update(tic_microstep_scheduler *,
+  tic_handle *, tic_variables ** variables);
+
+/// Gets the current position from the variables in base microsteps.
+TIC_API
+int64_t tic_microstep_scheduler_get_position(const tic_microstep_scheduler *,
+  const tic_variables *);
+
+/// Gets the current velocity from the variables in base microsteps per 10000
+/// seconds.
+TIC_API
+int64_t tic_microstep_scheduler_get_velocity(const tic_microstep_scheduler *,
+  const tic_variables *);
+
+/// Gets the step mode that the scheduler is using now.
+TIC_API
+uint8_t tic_microstep_scheduler_get_step_mode(const tic_microstep_scheduler *);
+
+/// Gets the number of times the scheduler changed the step mode since it was
+/// started.
+TIC_API
+uint32_t tic_microstep_scheduler_get_switch_count(
+  const tic_microstep_scheduler *);
+
 #ifdef __cplusplus
 }
 #endif
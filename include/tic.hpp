@@ -13,8 +13,10 @@
 
 #include "tic.h"
 #include <cstddef>
+#include <exception>
 #include <utility>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -84,12 +86,108 @@ namespace tic
     return copy;
   }
 
+  /// Wrapper for tic_stats_free().
+  inline void pointer_free(tic_stats * p) noexcept
+  {
+    tic_stats_free(p);
+  }
+
+  /// Wrapper for tic_stats_copy().
+  inline tic_stats * pointer_copy(const tic_stats * p)
+  {
+    tic_stats * copy;
+    throw_if_needed(tic_stats_copy(p, &copy));
+    return copy;
+  }
+
+  /// Wrapper for tic_idle_current_free().
+  inline void pointer_free(tic_idle_current * p) noexcept
+  {
+    tic_idle_current_free(p);
+  }
+
+  /// Wrapper for tic_idle_current_copy().
+  inline tic_idle_current * pointer_copy(const tic_idle_current * p)
+  {
+    tic_idle_current * copy;
+    throw_if_needed(tic_idle_current_copy(p, &copy));
+    return copy;
+  }
+
+  /// Wrapper for tic_motion_free().
+  inline void pointer_free(tic_motion * p) noexcept
+  {
+    tic_motion_free(p);
+  }
+
+  /// Wrapper for tic_motion_copy().
+  inline tic_motion * pointer_copy(const tic_motion * p)
+  {
+    tic_motion * copy;
+    throw_if_needed(tic_motion_copy(p, &copy));
+    return copy;
+  }
+
   /// Wrapper for tic_handle_close().
   inline void pointer_free(tic_handle * p) noexcept
   {
     tic_handle_close(p);
   }
 
+  /// Wrapper for tic_telemetry_publisher_close().
+  inline void pointer_free(tic_telemetry_publisher * p) noexcept
+  {
+    tic_telemetry_publisher_close(p);
+  }
+
+  /// Wrapper for tic_telemetry_close().
+  inline void pointer_free(tic_telemetry * p) noexcept
+  {
+    tic_telemetry_close(p);
+  }
+
+  /// Wrapper for tic_stream_free().
+  inline void pointer_free(tic_stream * p) noexcept
+  {
+    tic_stream_free(p);
+  }
+
+  /// Wrapper for tic_s_curve_free().
+  inline void pointer_free(tic_s_curve * p) noexcept
+  {
+    tic_s_curve_free(p);
+  }
+
+  /// Wrapper for tic_servo_free().
+  inline void pointer_free(tic_servo * p) noexcept
+  {
+    tic_servo_free(p);
+  }
+
+  /// Wrapper for tic_slip_monitor_free().
+  inline void pointer_free(tic_slip_monitor * p) noexcept
+  {
+    tic_slip_monitor_free(p);
+  }
+
+  /// Wrapper for tic_sync_free().
+  inline void pointer_free(tic_sync * p) noexcept
+  {
+    tic_sync_free(p);
+  }
+
+  /// Wrapper for tic_arrival_free().
+  inline void pointer_free(tic_arrival * p) noexcept
+  {
+    tic_arrival_free(p);
+  }
+
+  /// Wrapper for tic_microstep_scheduler_free().
+  inline void pointer_free(tic_microstep_scheduler * p) noexcept
+  {
+    tic_microstep_scheduler_free(p);
+  }
+
   /// This class is not part of the public API of the library and you should
   /// not use it directly, but you can use the public methods it provides to
   /// the classes that inherit from it.
@@ -590,6 +688,158 @@ namespace tic
     }
   };
 
+  /// Represents a model of the Tic's motion planner.  See tic_motion.
+  class motion : public unique_pointer_wrapper_with_copy<tic_motion>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit motion(tic_motion * p = NULL) noexcept :
+      unique_pointer_wrapper_with_copy(p)
+    {
+    }
+
+    /// Wrapper for tic_motion_create().
+    static motion create()
+    {
+      tic_motion * p;
+      throw_if_needed(tic_motion_create(&p));
+      return motion(p);
+    }
+
+    /// Wrapper for tic_motion_set_from_variables().
+    void set_from_variables(const variables & vars) noexcept
+    {
+      tic_motion_set_from_variables(pointer, vars.get_pointer());
+    }
+
+    /// Wrapper for tic_motion_set_planning_mode().
+    void set_planning_mode(uint8_t mode) noexcept
+    {
+      tic_motion_set_planning_mode(pointer, mode);
+    }
+
+    /// Wrapper for tic_motion_get_planning_mode().
+    uint8_t get_planning_mode() const noexcept
+    {
+      return tic_motion_get_planning_mode(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_target_position().
+    void set_target_position(int32_t position) noexcept
+    {
+      tic_motion_set_target_position(pointer, position);
+    }
+
+    /// Wrapper for tic_motion_get_target_position().
+    int32_t get_target_position() const noexcept
+    {
+      return tic_motion_get_target_position(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_target_velocity().
+    void set_target_velocity(int32_t velocity) noexcept
+    {
+      tic_motion_set_target_velocity(pointer, velocity);
+    }
+
+    /// Wrapper for tic_motion_get_target_velocity().
+    int32_t get_target_velocity() const noexcept
+    {
+      return tic_motion_get_target_velocity(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_starting_speed().
+    void set_starting_speed(uint32_t speed) noexcept
+    {
+      tic_motion_set_starting_speed(pointer, speed);
+    }
+
+    /// Wrapper for tic_motion_get_starting_speed().
+    uint32_t get_starting_speed() const noexcept
+    {
+      return tic_motion_get_starting_speed(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_max_speed().
+    void set_max_speed(uint32_t speed) noexcept
+    {
+      tic_motion_set_max_speed(pointer, speed);
+    }
+
+    /// Wrapper for tic_motion_get_max_speed().
+    uint32_t get_max_speed() const noexcept
+    {
+      return tic_motion_get_max_speed(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_max_accel().
+    void set_max_accel(uint32_t accel) noexcept
+    {
+      tic_motion_set_max_accel(pointer, accel);
+    }
+
+    /// Wrapper for tic_motion_get_max_accel().
+    uint32_t get_max_accel() const noexcept
+    {
+      return tic_motion_get_max_accel(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_max_decel().
+    void set_max_decel(uint32_t decel) noexcept
+    {
+      tic_motion_set_max_decel(pointer, decel);
+    }
+
+    /// Wrapper for tic_motion_get_max_decel().
+    uint32_t get_max_decel() const noexcept
+    {
+      return tic_motion_get_max_decel(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_current_position().
+    void set_current_position(int32_t position) noexcept
+    {
+      tic_motion_set_current_position(pointer, position);
+    }
+
+    /// Wrapper for tic_motion_get_current_position().
+    int32_t get_current_position() const noexcept
+    {
+      return tic_motion_get_current_position(pointer);
+    }
+
+    /// Wrapper for tic_motion_set_current_velocity().
+    void set_current_velocity(int32_t velocity) noexcept
+    {
+      tic_motion_set_current_velocity(pointer, velocity);
+    }
+
+    /// Wrapper for tic_motion_get_current_velocity().
+    int32_t get_current_velocity() const noexcept
+    {
+      return tic_motion_get_current_velocity(pointer);
+    }
+
+    /// Wrapper for tic_motion_predict().
+    void predict(int64_t time_us, int32_t * position, int32_t * velocity)
+      const noexcept
+    {
+      tic_motion_predict(pointer, time_us, position, velocity);
+    }
+
+    /// Wrapper for tic_motion_advance().
+    void advance(int64_t time_us) noexcept
+    {
+      tic_motion_advance(pointer, time_us);
+    }
+
+    /// Wrapper for tic_motion_get_time_to_target_us().
+    int64_t get_time_to_target_us() const noexcept
+    {
+      return tic_motion_get_time_to_target_us(pointer);
+    }
+  };
+
   /// Represents a Tic that is or was connected to the computer.  Can also be in
   /// a null state where it does not represent a device.
   class device : public unique_pointer_wrapper_with_copy<tic_device>
@@ -663,6 +913,132 @@ namespace tic
     return vector;
   }
 
+  /// A snapshot of the request latencies measured by a handle.  See
+  /// tic_handle_get_stats().
+  class stats : public unique_pointer_wrapper_with_copy<tic_stats>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit stats(tic_stats * p = NULL) noexcept :
+      unique_pointer_wrapper_with_copy(p)
+    {
+    }
+
+    /// Wrapper for tic_stats_get_count().
+    uint64_t get_count(uint8_t request) const noexcept
+    {
+      return tic_stats_get_count(pointer, request);
+    }
+
+    /// Wrapper for tic_stats_get_error_count().
+    uint64_t get_error_count(uint8_t request) const noexcept
+    {
+      return tic_stats_get_error_count(pointer, request);
+    }
+
+    /// Wrapper for tic_stats_get_timeout_count().
+    uint64_t get_timeout_count(uint8_t request) const noexcept
+    {
+      return tic_stats_get_timeout_count(pointer, request);
+    }
+
+    /// Wrapper for tic_stats_get_total_us().
+    uint64_t get_total_us(uint8_t request) const noexcept
+    {
+      return tic_stats_get_total_us(pointer, request);
+    }
+
+    /// Wrapper for tic_stats_get_max_us().
+    uint64_t get_max_us(uint8_t request) const noexcept
+    {
+      return tic_stats_get_max_us(pointer, request);
+    }
+
+    /// Wrapper for tic_stats_get_bucket().
+    uint64_t get_bucket(uint8_t request, uint32_t bucket) const noexcept
+    {
+      return tic_stats_get_bucket(pointer, request, bucket);
+    }
+
+    /// Wrapper for tic_stats_get_percentile_us().
+    uint64_t get_percentile_us(uint8_t request, double percentile) const noexcept
+    {
+      return tic_stats_get_percentile_us(pointer, request, percentile);
+    }
+  };
+
+  /// A snapshot of what a handle did to lower the current limit of an idle
+  /// motor.  See tic_handle_get_idle_current().
+  class idle_current : public unique_pointer_wrapper_with_copy<tic_idle_current>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit idle_current(tic_idle_current * p = NULL) noexcept :
+      unique_pointer_wrapper_with_copy(p)
+    {
+    }
+
+    /// Wrapper for tic_idle_current_get_reduced().
+    bool get_reduced() const noexcept
+    {
+      return tic_idle_current_get_reduced(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_full_current_limit().
+    uint32_t get_full_current_limit() const noexcept
+    {
+      return tic_idle_current_get_full_current_limit(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_idle_current_limit().
+    uint32_t get_idle_current_limit() const noexcept
+    {
+      return tic_idle_current_get_idle_current_limit(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_reduction_count().
+    uint64_t get_reduction_count() const noexcept
+    {
+      return tic_idle_current_get_reduction_count(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_restore_count().
+    uint64_t get_restore_count() const noexcept
+    {
+      return tic_idle_current_get_restore_count(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_reduced_us().
+    uint64_t get_reduced_us() const noexcept
+    {
+      return tic_idle_current_get_reduced_us(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_saved_a2s().
+    double get_saved_a2s() const noexcept
+    {
+      return tic_idle_current_get_saved_a2s(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_total_restore_us().
+    uint64_t get_total_restore_us() const noexcept
+    {
+      return tic_idle_current_get_total_restore_us(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_max_restore_us().
+    uint64_t get_max_restore_us() const noexcept
+    {
+      return tic_idle_current_get_max_restore_us(pointer);
+    }
+
+    /// Wrapper for tic_idle_current_get_error_count().
+    uint64_t get_error_count() const noexcept
+    {
+      return tic_idle_current_get_error_count(pointer);
+    }
+  };
+
   /// Represents an open handle that can be used to read and write data from a
   /// device.  Can also be in a null state where it does not represent a device.
   class handle : public unique_pointer_wrapper<tic_handle>
@@ -871,6 +1247,53 @@ namespace tic
       throw_if_needed(tic_restore_defaults(pointer));
     }
 
+    /// Wrapper for tic_wait_until() that takes one of the conditions from
+    /// tic.h, like tic_wait_position_reached().
+    variables wait_until(tic_wait_condition * condition,
+      uint32_t timeout_ms = TIC_WAIT_FOREVER)
+    {
+      tic_variables * v;
+      throw_if_needed(tic_wait_until(pointer, condition, NULL, timeout_ms, &v));
+      return variables(v);
+    }
+
+    /// Wrapper for tic_wait_until() that takes a function object that accepts
+    /// a tic::variables object and returns true when we are done waiting.  If
+    /// the function object throws an exception, the wait stops and the
+    /// exception is rethrown.
+    template <typename Condition>
+    variables wait_until(Condition condition,
+      uint32_t timeout_ms = TIC_WAIT_FOREVER)
+    {
+      struct context_type
+      {
+        Condition & condition;
+        std::exception_ptr exception;
+      } context { condition, nullptr };
+
+      auto check = [](const tic_variables * p, void * c) -> bool
+      {
+        context_type & context = *static_cast<context_type *>(c);
+        try
+        {
+          return context.condition(variables(pointer_copy(p)));
+        }
+        catch (...)
+        {
+          context.exception = std::current_exception();
+          return true;
+        }
+      };
+
+      tic_variables * v;
+      tic_error * error = tic_wait_until(pointer, check, &context,
+        timeout_ms, &v);
+      throw_if_needed(error);
+      variables result(v);
+      if (context.exception) { std::rethrow_exception(context.exception); }
+      return result;
+    }
+
     /// Wrapper for tic_reinitialize().
     void reinitialize()
     {
@@ -883,6 +1306,48 @@ namespace tic
       throw_if_needed(tic_start_bootloader(pointer));
     }
 
+    /// Wrapper for tic_handle_publish_telemetry().  Pass NULL to stop
+    /// publishing.
+    void publish_telemetry(const char * name)
+    {
+      throw_if_needed(tic_handle_publish_telemetry(pointer, name));
+    }
+
+    /// Wrapper for tic_handle_enable_stats().
+    void enable_stats(bool enable = true)
+    {
+      throw_if_needed(tic_handle_enable_stats(pointer, enable));
+    }
+
+    /// Wrapper for tic_handle_get_stats().
+    tic::stats get_stats()
+    {
+      tic_stats * p;
+      throw_if_needed(tic_handle_get_stats(pointer, &p));
+      return tic::stats(p);
+    }
+
+    /// Wrapper for tic_handle_set_idle_current().
+    void set_idle_current(uint32_t idle_current_limit, uint32_t idle_time_ms)
+    {
+      throw_if_needed(tic_handle_set_idle_current(pointer,
+        idle_current_limit, idle_time_ms));
+    }
+
+    /// Wrapper for tic_handle_disable_idle_current().
+    void disable_idle_current()
+    {
+      throw_if_needed(tic_handle_disable_idle_current(pointer));
+    }
+
+    /// Wrapper for tic_handle_get_idle_current().
+    tic::idle_current get_idle_current()
+    {
+      tic_idle_current * p;
+      throw_if_needed(tic_handle_get_idle_current(pointer, &p));
+      return tic::idle_current(p);
+    }
+
     /// \cond
     void get_debug_data(std::vector<uint8_t> & data)
     {
@@ -894,6 +1359,774 @@ namespace tic
 
   };
 
+  /// Publishes variables to a telemetry segment in shared memory.  See
+  /// tic_telemetry_publisher_open().
+  class telemetry_publisher : public unique_pointer_wrapper<tic_telemetry_publisher>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit telemetry_publisher(tic_telemetry_publisher * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_telemetry_publisher_open().
+    telemetry_publisher(const std::string & name,
+      const std::string & serial_number)
+    {
+      throw_if_needed(tic_telemetry_publisher_open(
+        name.c_str(), serial_number.c_str(), &pointer));
+    }
+
+    /// Wrapper for tic_telemetry_publish().
+    void publish(const variables & vars) noexcept
+    {
+      tic_telemetry_publish(pointer, vars.get_pointer());
+    }
+  };
+
+  /// Reads variables from a telemetry segment in shared memory.  See
+  /// tic_telemetry_open().
+  class telemetry : public unique_pointer_wrapper<tic_telemetry>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit telemetry(tic_telemetry * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_telemetry_open().
+    explicit telemetry(const std::string & name)
+    {
+      throw_if_needed(tic_telemetry_open(name.c_str(), &pointer));
+    }
+
+    /// Wrapper for tic_telemetry_find_device().
+    bool find_device(const std::string & serial_number, uint32_t & slot) const
+    {
+      return tic_telemetry_find_device(pointer, serial_number.c_str(), &slot);
+    }
+
+    /// Wrapper for tic_telemetry_get_sample_count().
+    uint64_t get_sample_count(uint32_t slot) const noexcept
+    {
+      return tic_telemetry_get_sample_count(pointer, slot);
+    }
+
+    /// Wrapper for tic_telemetry_get_sample().
+    variables get_sample(uint32_t slot, uint64_t sample_number,
+      int64_t * time_us = NULL) const
+    {
+      tic_variables * p;
+      throw_if_needed(tic_telemetry_get_sample(
+        pointer, slot, sample_number, &p, time_us));
+      return variables(p);
+    }
+
+    /// Wrapper for tic_telemetry_read_sample().  The variables object must not
+    /// be empty.
+    void read_sample(uint32_t slot, uint64_t sample_number,
+      variables & vars, int64_t * time_us = NULL) const
+    {
+      throw_if_needed(tic_telemetry_read_sample(
+        pointer, slot, sample_number, vars.get_pointer(), time_us));
+    }
+
+    /// Wrapper for tic_telemetry_remove().
+    static void remove(const std::string & name)
+    {
+      throw_if_needed(tic_telemetry_remove(name.c_str()));
+    }
+  };
+
+  /// Sends a timed sequence of targets to a Tic from a dedicated thread.  See
+  /// tic_stream.
+  class stream : public unique_pointer_wrapper<tic_stream>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit stream(tic_stream * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_stream_create().
+    static stream create()
+    {
+      tic_stream * p;
+      throw_if_needed(tic_stream_create(&p));
+      return stream(p);
+    }
+
+    /// Wrapper for tic_stream_add_point().
+    void add_point(int64_t time_us, uint8_t planning_mode, int32_t target)
+    {
+      throw_if_needed(tic_stream_add_point(
+        pointer, time_us, planning_mode, target));
+    }
+
+    /// Wrapper for tic_stream_get_point_count().
+    size_t get_point_count() const noexcept
+    {
+      return tic_stream_get_point_count(pointer);
+    }
+
+    /// Wrapper for tic_stream_set_priority().
+    void set_priority(int priority) noexcept
+    {
+      tic_stream_set_priority(pointer, priority);
+    }
+
+    /// Wrapper for tic_stream_set_cpu().
+    void set_cpu(int cpu) noexcept
+    {
+      tic_stream_set_cpu(pointer, cpu);
+    }
+
+    /// Wrapper for tic_stream_set_max_lateness_us().
+    void set_max_lateness_us(uint32_t max_lateness_us) noexcept
+    {
+      tic_stream_set_max_lateness_us(pointer, max_lateness_us);
+    }
+
+    /// Wrapper for tic_stream_start().
+    void start(handle & h)
+    {
+      throw_if_needed(tic_stream_start(pointer, h.get_pointer()));
+    }
+
+    /// Wrapper for tic_stream_stop().
+    void stop() noexcept
+    {
+      tic_stream_stop(pointer);
+    }
+
+    /// Wrapper for tic_stream_wait().
+    void wait()
+    {
+      throw_if_needed(tic_stream_wait(pointer));
+    }
+
+    /// Wrapper for tic_stream_get_sent_count().
+    size_t get_sent_count() const noexcept
+    {
+      return tic_stream_get_sent_count(pointer);
+    }
+
+    /// Wrapper for tic_stream_get_missed_count().
+    size_t get_missed_count() const noexcept
+    {
+      return tic_stream_get_missed_count(pointer);
+    }
+
+    /// Wrapper for tic_stream_get_skipped_count().
+    size_t get_skipped_count() const noexcept
+    {
+      return tic_stream_get_skipped_count(pointer);
+    }
+
+    /// Wrapper for tic_stream_get_lateness_ns().
+    int64_t get_lateness_ns(double percent) const noexcept
+    {
+      return tic_stream_get_lateness_ns(pointer, percent);
+    }
+
+    /// Wrapper for tic_stream_get_send_time_ns().
+    int64_t get_send_time_ns(double percent) const noexcept
+    {
+      return tic_stream_get_send_time_ns(pointer, percent);
+    }
+  };
+
+  /// Plans and performs jerk-limited moves.  See tic_s_curve.
+  class s_curve : public unique_pointer_wrapper<tic_s_curve>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit s_curve(tic_s_curve * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_s_curve_create().
+    static s_curve create()
+    {
+      tic_s_curve * p;
+      throw_if_needed(tic_s_curve_create(&p));
+      return s_curve(p);
+    }
+
+    /// Wrapper for tic_s_curve_set_max_speed().
+    void set_max_speed(uint32_t speed) noexcept
+    {
+      tic_s_curve_set_max_speed(pointer, speed);
+    }
+
+    /// Wrapper for tic_s_curve_get_max_speed().
+    uint32_t get_max_speed() const noexcept
+    {
+      return tic_s_curve_get_max_speed(pointer);
+    }
+
+    /// Wrapper for tic_s_curve_set_max_accel().
+    void set_max_accel(uint32_t accel) noexcept
+    {
+      tic_s_curve_set_max_accel(pointer, accel);
+    }
+
+    /// Wrapper for tic_s_curve_get_max_accel().
+    uint32_t get_max_accel() const noexcept
+    {
+      return tic_s_curve_get_max_accel(pointer);
+    }
+
+    /// Wrapper for tic_s_curve_set_max_jerk().
+    void set_max_jerk(uint32_t jerk) noexcept
+    {
+      tic_s_curve_set_max_jerk(pointer, jerk);
+    }
+
+    /// Wrapper for tic_s_curve_get_max_jerk().
+    uint32_t get_max_jerk() const noexcept
+    {
+      return tic_s_curve_get_max_jerk(pointer);
+    }
+
+    /// Wrapper for tic_s_curve_set_update_interval_us().
+    void set_update_interval_us(uint32_t interval_us) noexcept
+    {
+      tic_s_curve_set_update_interval_us(pointer, interval_us);
+    }
+
+    /// Wrapper for tic_s_curve_get_update_interval_us().
+    uint32_t get_update_interval_us() const noexcept
+    {
+      return tic_s_curve_get_update_interval_us(pointer);
+    }
+
+    /// Wrapper for tic_s_curve_plan().
+    void plan(int32_t start_position, int32_t target_position)
+    {
+      throw_if_needed(tic_s_curve_plan(
+        pointer, start_position, target_position));
+    }
+
+    /// Wrapper for tic_s_curve_get_duration_us().
+    int64_t get_duration_us() const noexcept
+    {
+      return tic_s_curve_get_duration_us(pointer);
+    }
+
+    /// Wrapper for tic_s_curve_predict().
+    void predict(int64_t time_us, int32_t * position, int32_t * velocity)
+      const noexcept
+    {
+      tic_s_curve_predict(pointer, time_us, position, velocity);
+    }
+
+    /// Wrapper for tic_s_curve_move().
+    void move(handle & h, int32_t target_position)
+    {
+      throw_if_needed(tic_s_curve_move(
+        pointer, h.get_pointer(), target_position));
+    }
+  };
+
+  /// Closes a position loop on the encoder from the computer.  See tic_servo.
+  class servo : public unique_pointer_wrapper<tic_servo>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit servo(tic_servo * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_servo_create().
+    static servo create()
+    {
+      tic_servo * p;
+      throw_if_needed(tic_servo_create(&p));
+      return servo(p);
+    }
+
+    /// Wrapper for tic_servo_set_gains().
+    void set_gains(double kp, double ki, double kd) noexcept
+    {
+      tic_servo_set_gains(pointer, kp, ki, kd);
+    }
+
+    /// Wrapper for tic_servo_get_gains().
+    void get_gains(double * kp, double * ki, double * kd) const noexcept
+    {
+      tic_servo_get_gains(pointer, kp, ki, kd);
+    }
+
+    /// Wrapper for tic_servo_set_encoder_scaling().
+    void set_encoder_scaling(uint32_t prescaler, uint32_t postscaler) noexcept
+    {
+      tic_servo_set_encoder_scaling(pointer, prescaler, postscaler);
+    }
+
+    /// Wrapper for tic_servo_set_max_speed().
+    void set_max_speed(uint32_t speed) noexcept
+    {
+      tic_servo_set_max_speed(pointer, speed);
+    }
+
+    /// Wrapper for tic_servo_set_integral_limit().
+    void set_integral_limit(uint32_t speed) noexcept
+    {
+      tic_servo_set_integral_limit(pointer, speed);
+    }
+
+    /// Wrapper for tic_servo_set_tolerance().
+    void set_tolerance(double tolerance) noexcept
+    {
+      tic_servo_set_tolerance(pointer, tolerance);
+    }
+
+    /// Wrapper for tic_servo_set_target().
+    void set_target(double position, int32_t velocity = 0) noexcept
+    {
+      tic_servo_set_target(pointer, position, velocity);
+    }
+
+    /// Wrapper for tic_servo_reset().
+    void reset() noexcept
+    {
+      tic_servo_reset(pointer);
+    }
+
+    /// Wrapper for tic_servo_update().
+    void update(handle & h, uint32_t interval_us)
+    {
+      throw_if_needed(tic_servo_update(pointer, h.get_pointer(), interval_us));
+    }
+
+    /// Wrapper for tic_servo_get_position().
+    double get_position() const noexcept
+    {
+      return tic_servo_get_position(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_error().
+    double get_error() const noexcept
+    {
+      return tic_servo_get_error(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_output().
+    int32_t get_output() const noexcept
+    {
+      return tic_servo_get_output(pointer);
+    }
+
+    /// Wrapper for tic_servo_is_settled().
+    bool is_settled() const noexcept
+    {
+      return tic_servo_is_settled(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_update_count().
+    uint64_t get_update_count() const noexcept
+    {
+      return tic_servo_get_update_count(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_overrun_count().
+    uint64_t get_overrun_count() const noexcept
+    {
+      return tic_servo_get_overrun_count(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_mean_update_us().
+    uint64_t get_mean_update_us() const noexcept
+    {
+      return tic_servo_get_mean_update_us(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_max_update_us().
+    uint64_t get_max_update_us() const noexcept
+    {
+      return tic_servo_get_max_update_us(pointer);
+    }
+
+    /// Wrapper for tic_servo_get_max_lateness_us().
+    uint64_t get_max_lateness_us() const noexcept
+    {
+      return tic_servo_get_max_lateness_us(pointer);
+    }
+  };
+
+  /// Wrapper for tic_servo_run().
+  inline void run_servos(std::vector<servo *> servos,
+    std::vector<handle *> handles, uint32_t interval_us, uint32_t timeout_ms)
+  {
+    if (servos.size() != handles.size())
+    {
+      throw std::invalid_argument("Each servo needs one handle.");
+    }
+    std::vector<tic_servo *> servo_pointers;
+    std::vector<tic_handle *> handle_pointers;
+    for (size_t i = 0; i < servos.size(); i++)
+    {
+      servo_pointers.push_back(servos[i]->get_pointer());
+      handle_pointers.push_back(handles[i]->get_pointer());
+    }
+    throw_if_needed(tic_servo_run(servo_pointers.data(),
+      handle_pointers.data(), servos.size(), interval_us, timeout_ms));
+  }
+
+  /// Detects when the motor stalls or loses steps.  See tic_slip_monitor.
+  class slip_monitor : public unique_pointer_wrapper<tic_slip_monitor>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit slip_monitor(tic_slip_monitor * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_slip_monitor_create().
+    static slip_monitor create()
+    {
+      tic_slip_monitor * p;
+      throw_if_needed(tic_slip_monitor_create(&p));
+      return slip_monitor(p);
+    }
+
+    /// Wrapper for tic_slip_monitor_set_encoder_scaling().
+    void set_encoder_scaling(uint32_t prescaler, uint32_t postscaler) noexcept
+    {
+      tic_slip_monitor_set_encoder_scaling(pointer, prescaler, postscaler);
+    }
+
+    /// Wrapper for tic_slip_monitor_set_threshold().
+    void set_threshold(uint32_t threshold) noexcept
+    {
+      tic_slip_monitor_set_threshold(pointer, threshold);
+    }
+
+    /// Wrapper for tic_slip_monitor_get_threshold().
+    uint32_t get_threshold() const noexcept
+    {
+      return tic_slip_monitor_get_threshold(pointer);
+    }
+
+    /// Wrapper for tic_slip_monitor_set_action().
+    void set_action(uint8_t action) noexcept
+    {
+      tic_slip_monitor_set_action(pointer, action);
+    }
+
+    /// Wrapper for tic_slip_monitor_get_action().
+    uint8_t get_action() const noexcept
+    {
+      return tic_slip_monitor_get_action(pointer);
+    }
+
+    /// Wrapper for tic_slip_monitor_reset().
+    void reset() noexcept
+    {
+      tic_slip_monitor_reset(pointer);
+    }
+
+    /// Wrapper for tic_slip_monitor_check().  The handle can be null if the
+    /// action is TIC_SLIP_ACTION_NONE.
+    void check(handle * h, const variables & vars)
+    {
+      throw_if_needed(tic_slip_monitor_check(pointer,
+        h ? h->get_pointer() : NULL, vars.get_pointer()));
+    }
+
+    /// Wrapper for tic_slip_monitor_slipped().
+    bool slipped() const noexcept
+    {
+      return tic_slip_monitor_slipped(pointer);
+    }
+
+    /// Wrapper for tic_slip_monitor_get_deviation().
+    double get_deviation() const noexcept
+    {
+      return tic_slip_monitor_get_deviation(pointer);
+    }
+
+    /// Wrapper for tic_slip_monitor_get_max_deviation().
+    double get_max_deviation() const noexcept
+    {
+      return tic_slip_monitor_get_max_deviation(pointer);
+    }
+  };
+
+  /// Sends commands to several devices at nearly the same time.  See tic_sync.
+  class sync : public unique_pointer_wrapper<tic_sync>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit sync(tic_sync * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_sync_create().
+    static sync create(std::vector<handle *> handles)
+    {
+      std::vector<tic_handle *> handle_pointers;
+      for (handle * h : handles)
+      {
+        handle_pointers.push_back(h->get_pointer());
+      }
+      tic_sync * p;
+      throw_if_needed(tic_sync_create(handle_pointers.data(),
+        handle_pointers.size(), &p));
+      return sync(p);
+    }
+
+    /// Wrapper for tic_sync_get_count().
+    size_t get_count() const noexcept
+    {
+      return tic_sync_get_count(pointer);
+    }
+
+    /// Wrapper for tic_sync_set_target_positions().
+    void set_target_positions(const std::vector<int32_t> & positions)
+    {
+      if (positions.size() != get_count())
+      {
+        throw std::invalid_argument("Each device needs one target position.");
+      }
+      throw_if_needed(tic_sync_set_target_positions(pointer, positions.data()));
+    }
+
+    /// Wrapper for tic_sync_halt_and_hold().
+    void halt_and_hold()
+    {
+      throw_if_needed(tic_sync_halt_and_hold(pointer));
+    }
+
+    /// Wrapper for tic_sync_get_issue_skew_ns().
+    int64_t get_issue_skew_ns() const noexcept
+    {
+      return tic_sync_get_issue_skew_ns(pointer);
+    }
+
+    /// Wrapper for tic_sync_get_complete_skew_ns().
+    int64_t get_complete_skew_ns() const noexcept
+    {
+      return tic_sync_get_complete_skew_ns(pointer);
+    }
+
+    /// Wrapper for tic_sync_get_issue_offset_ns().
+    int64_t get_issue_offset_ns(size_t index) const noexcept
+    {
+      return tic_sync_get_issue_offset_ns(pointer, index);
+    }
+  };
+
+  /// Plans multi-axis moves that finish on every axis at the same time.  See
+  /// tic_arrival.
+  class arrival : public unique_pointer_wrapper<tic_arrival>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit arrival(tic_arrival * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_arrival_create().
+    static arrival create()
+    {
+      tic_arrival * p;
+      throw_if_needed(tic_arrival_create(&p));
+      return arrival(p);
+    }
+
+    /// Wrapper for tic_arrival_set_axis_limits().
+    void set_axis_limits(size_t index, uint32_t starting_speed,
+      uint32_t max_speed, uint32_t max_accel, uint32_t max_decel) noexcept
+    {
+      tic_arrival_set_axis_limits(pointer, index, starting_speed, max_speed,
+        max_accel, max_decel);
+    }
+
+    /// Wrapper for tic_arrival_set_axis_limits_from_settings().
+    void set_axis_limits(size_t index, const settings & s) noexcept
+    {
+      tic_arrival_set_axis_limits_from_settings(pointer, index, s.get_pointer());
+    }
+
+    /// Wrapper for tic_arrival_set_min_duration_us().
+    void set_min_duration_us(int64_t duration_us) noexcept
+    {
+      tic_arrival_set_min_duration_us(pointer, duration_us);
+    }
+
+    /// Wrapper for tic_arrival_get_min_duration_us().
+    int64_t get_min_duration_us() const noexcept
+    {
+      return tic_arrival_get_min_duration_us(pointer);
+    }
+
+    /// Wrapper for tic_arrival_plan().
+    void plan(const std::vector<int32_t> & distances)
+    {
+      throw_if_needed(tic_arrival_plan(pointer, distances.size(),
+        distances.data()));
+    }
+
+    /// Wrapper for tic_arrival_get_duration_us().
+    int64_t get_duration_us() const noexcept
+    {
+      return tic_arrival_get_duration_us(pointer);
+    }
+
+    /// Wrapper for tic_arrival_get_axis_max_speed().
+    uint32_t get_axis_max_speed(size_t index) const noexcept
+    {
+      return tic_arrival_get_axis_max_speed(pointer, index);
+    }
+
+    /// Wrapper for tic_arrival_get_axis_max_accel().
+    uint32_t get_axis_max_accel(size_t index) const noexcept
+    {
+      return tic_arrival_get_axis_max_accel(pointer, index);
+    }
+
+    /// Wrapper for tic_arrival_get_axis_max_decel().
+    uint32_t get_axis_max_decel(size_t index) const noexcept
+    {
+      return tic_arrival_get_axis_max_decel(pointer, index);
+    }
+
+    /// Wrapper for tic_arrival_get_axis_duration_us().
+    int64_t get_axis_duration_us(size_t index) const noexcept
+    {
+      return tic_arrival_get_axis_duration_us(pointer, index);
+    }
+
+    /// Wrapper for tic_arrival_move().
+    void move(sync & group, const std::vector<int32_t> & targets)
+    {
+      if (targets.size() != group.get_count())
+      {
+        throw std::invalid_argument("Each device needs one target position.");
+      }
+      throw_if_needed(tic_arrival_move(pointer, group.get_pointer(),
+        targets.data()));
+    }
+  };
+
+  /// Switches the step mode with the speed of the motor.  See
+  /// tic_microstep_scheduler.
+  class microstep_scheduler :
+    public unique_pointer_wrapper<tic_microstep_scheduler>
+  {
+  public:
+    /// Constructor that takes a pointer from the C API.
+    explicit microstep_scheduler(tic_microstep_scheduler * p = NULL) noexcept
+      : unique_pointer_wrapper(p)
+    {
+    }
+
+    /// Wrapper for tic_microstep_scheduler_create().
+    static microstep_scheduler create()
+    {
+      tic_microstep_scheduler * p;
+      throw_if_needed(tic_microstep_scheduler_create(&p));
+      return microstep_scheduler(p);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_set_base_step_mode().
+    void set_base_step_mode(uint8_t step_mode)
+    {
+      throw_if_needed(tic_microstep_scheduler_set_base_step_mode(
+        pointer, step_mode));
+    }
+
+    /// Wrapper for tic_microstep_scheduler_add_level().
+    void add_level(uint8_t step_mode, uint64_t speed)
+    {
+      throw_if_needed(tic_microstep_scheduler_add_level(
+        pointer, step_mode, speed));
+    }
+
+    /// Wrapper for tic_microstep_scheduler_set_hysteresis_percent().
+    void set_hysteresis_percent(uint8_t percent) noexcept
+    {
+      tic_microstep_scheduler_set_hysteresis_percent(pointer, percent);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_get_hysteresis_percent().
+    uint8_t get_hysteresis_percent() const noexcept
+    {
+      return tic_microstep_scheduler_get_hysteresis_percent(pointer);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_set_limits().
+    void set_limits(uint64_t max_speed, uint64_t max_accel,
+      uint64_t max_decel) noexcept
+    {
+      tic_microstep_scheduler_set_limits(pointer, max_speed, max_accel,
+        max_decel);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_start().
+    void start(handle & h)
+    {
+      throw_if_needed(tic_microstep_scheduler_start(pointer, h.get_pointer()));
+    }
+
+    /// Wrapper for tic_microstep_scheduler_set_target_position().
+    void set_target_position(handle & h, int64_t position)
+    {
+      throw_if_needed(tic_microstep_scheduler_set_target_position(
+        pointer, h.get_pointer(), position));
+    }
+
+    /// Wrapper for tic_microstep_scheduler_set_target_velocity().
+    void set_target_velocity(handle & h, int64_t velocity)
+    {
+      throw_if_needed(tic_microstep_scheduler_set_target_velocity(
+        pointer, h.get_pointer(), velocity));
+    }
+
+    /// Wrapper for tic_microstep_scheduler_update().
+    variables update(handle & h)
+    {
+      tic_variables * v;
+      throw_if_needed(tic_microstep_scheduler_update(
+        pointer, h.get_pointer(), &v));
+      return variables(v);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_get_position().
+    int64_t get_position(const variables & v) const noexcept
+    {
+      return tic_microstep_scheduler_get_position(pointer, v.get_pointer());
+    }
+
+    /// Wrapper for tic_microstep_scheduler_get_velocity().
+    int64_t get_velocity(const variables & v) const noexcept
+    {
+      return tic_microstep_scheduler_get_velocity(pointer, v.get_pointer());
+    }
+
+    /// Wrapper for tic_microstep_scheduler_get_step_mode().
+    uint8_t get_step_mode() const noexcept
+    {
+      return tic_microstep_scheduler_get_step_mode(pointer);
+    }
+
+    /// Wrapper for tic_microstep_scheduler_get_switch_count().
+    uint32_t get_switch_count() const noexcept
+    {
+      return tic_microstep_scheduler_get_switch_count(pointer);
+    }
+  };
+
   /// Wrapper for tic_get_recommended_current_limit_codes().
   inline const std::vector<uint8_t> get_recommended_current_limit_codes(
     uint8_t product)
@@ -0,0 +1,37 @@
+// Functions from libpololu-tic that take libusbp types.  These are used by the
+// bootloader library and ticd, which list the USB devices themselves; they are
+// not part of the public API of libpololu-tic, which does not expose libusbp.
+
+#pragma once
+
+#include <tic.h>
+#include <libusbp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Creates a device object for a USB device that was found with libusbp.
+//
+// This is for programs that list the USB devices themselves because they are
+// interested in other devices too (e.g. Tics in bootloader mode), so they do
+// not have to list the devices a second time with
+// tic_list_connected_devices().
+//
+// If the USB device is not a Tic, or is a Tic whose USB interface is not ready
+// to be used yet, this function sets device to NULL and returns NULL.
+//
+// If serial_number is not NULL, it is used as the serial number of the device
+// instead of reading the serial number from the operating system.
+//
+// If this function is successful and returns a device, you must later free it
+// by calling tic_device_free().
+TIC_API TIC_WARN_UNUSED
+tic_error * tic_device_create_from_usb_device(
+  const libusbp_device * usb_device,
+  const char * serial_number,
+  tic_device ** device);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+// Constants and helpers for the protocol that ticd, the Tic daemon, uses to
+// talk to its clients over a Unix domain socket.  This is used by ticd and by
+// libpololu-tic; it is not part of the public API of libpololu-tic.
+//
+// A client opens a connection, sends an open request with the serial number of
+// the Tic it wants to use, and then sends control transfer requests that ticd
+// performs on the Tic for it.  This mirrors how libpololu-tic talks to the Tic
+// over USB, so every tic_handle function works the same way through ticd.
+//
+// Every request is answered with exactly one response, in order.
+//
+// Request format:
+//   byte 0: Operation (TICD_OP_*)
+//   byte 1: bmRequestType
+//   byte 2: bRequest
+//   byte 3: Reserved, must be 0
+//   bytes 4-5: wValue (little-endian)
+//   bytes 6-7: wIndex (little-endian)
+//   bytes 8-9: wLength (little-endian)
+//   Followed by wLength bytes of data for TICD_OP_OPEN (the serial number, not
+//   null-terminated) and for control transfers where bit 7 of bmRequestType is
+//   0 (host to device).
+//
+// Response format:
+//   byte 0: Status (TICD_STATUS_*)
+//   byte 1: Error code flags: bit n is set if the error has the code n from
+//     the tic_error_code enum in tic.h.
+//   bytes 2-3: Data length (little-endian)
+//   bytes 4-5: Reserved
+//   Followed by the data: the bytes read from the device for a successful
+//   device-to-host control transfer, or an error message (not
+//   null-terminated) if the status is TICD_STATUS_ERROR.
+
+#pragma once
+
+#include <stdint.h>
+
+// The path of the socket if the user does not specify one.
+#define TICD_DEFAULT_SOCKET_PATH "/tmp/ticd.sock"
+
+// If this environment variable is set to the path of a ticd socket,
+// tic_handle_open() connects to ticd instead of opening the device directly.
+#define TICD_SOCKET_ENV_VAR "TIC_DAEMON_SOCKET"
+
+#define TICD_OP_OPEN 1
+#define TICD_OP_CONTROL_TRANSFER 2
+
+#define TICD_STATUS_OK 0
+#define TICD_STATUS_ERROR 1
+
+#define TICD_REQUEST_HEADER_SIZE 10
+#define TICD_RESPONSE_HEADER_SIZE 6
+
+// The maximum length of the data following a request or response header.
+#define TICD_MAX_DATA_SIZE 1024
+
+typedef struct ticd_request_header
+{
+  uint8_t op;
+  uint8_t request_type;
+  uint8_t request;
+  uint16_t value;
+  uint16_t index;
+  uint16_t length;
+} ticd_request_header;
+
+typedef struct ticd_response_header
+{
+  uint8_t status;
+  uint8_t error_flags;
+  uint16_t length;
+} ticd_response_header;
+
+static inline void ticd_request_header_encode(
+  const ticd_request_header * h, uint8_t * buf)
+{
+  buf[0] = h->op;
+  buf[1] = h->request_type;
+  buf[2] = h->request;
+  buf[3] = 0;
+  buf[4] = h->value & 0xFF;
+  buf[5] = h->value >> 8 & 0xFF;
+  buf[6] = h->index & 0xFF;
+  buf[7] = h->index >> 8 & 0xFF;
+  buf[8] = h->length & 0xFF;
+  buf[9] = h->length >> 8 & 0xFF;
+}
+
+static inline void ticd_request_header_decode(
+  const uint8_t * buf, ticd_request_header * h)
+{
+  h->op = buf[0];
+  h->request_type = buf[1];
+  h->request = buf[2];
+  h->value = buf[4] | buf[5] << 8;
+  h->index = buf[6] | buf[7] << 8;
+  h->length = buf[8] | buf[9] << 8;
+}
+
+static inline void ticd_response_header_encode(
+  const ticd_response_header * h, uint8_t * buf)
+{
+  buf[0] = h->status;
+  buf[1] = h->error_flags;
+  buf[2] = h->length & 0xFF;
+  buf[3] = h->length >> 8 & 0xFF;
+  buf[4] = 0;
+  buf[5] = 0;
+}
+
+static inline void ticd_response_header_decode(
+  const uint8_t * buf, ticd_response_header * h)
+{
+  h->status = buf[0];
+  h->error_flags = buf[1];
+  h->length = buf[2] | buf[3] << 8;
+}
@@ -0,0 +1,310 @@
+// Functions for planning multi-axis moves that finish on every axis at once.
+//
+// Starting from rest, the Tic jumps to the starting speed, accelerates to a
+// peak speed, cruises, decelerates to the starting speed, and stops.  For a
+// distance D with starting speed s, acceleration a, and deceleration d, let
+// k = 1/(2a) + 1/(2d).  A move that peaks at speed v takes
+//
+//   T = (v - s) * 2k + (D - (v^2 - s^2) * k) / v
+//
+// which is the time of the two ramps plus the time spent cruising.  The
+// fastest move uses the highest peak that the distance and the max speed
+// allow.  The slowest axis sets the time of the whole move, and the other
+// axes keep their acceleration limits but cruise at a lower speed.  That
+// speed is the smaller root of the quadratic we get from multiplying the
+// equation above by v:
+//
+//   k v^2 - (T + 2ks) v + (k s^2 + D) = 0
+//
+// The smaller root is the one that leaves a cruise phase of zero or more.
+// Everything is stored in the planner, so planning a move does not allocate
+// memory.
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+typedef struct tic_arrival_axis
+{
+  // The limits, in the Tic's units.
+  uint32_t starting_speed;
+  uint32_t max_speed;
+  uint32_t max_accel;
+  uint32_t max_decel;
+
+  // The results of the last plan.
+  uint32_t speed;
+  int64_t duration_us;
+} tic_arrival_axis;
+
+struct tic_arrival
+{
+  tic_arrival_axis axes[TIC_ARRIVAL_MAX_AXES];
+  size_t count;
+  int64_t min_duration_us;
+  int64_t duration_us;
+};
+
+tic_error * tic_arrival_create(tic_arrival ** arrival)
+{
+  if (arrival == NULL)
+  {
+    return tic_error_create("Arrival planner output pointer is null.");
+  }
+
+  *arrival = NULL;
+
+  tic_arrival * new_arrival = calloc(1, sizeof(tic_arrival));
+  if (new_arrival == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  *arrival = new_arrival;
+  return NULL;
+}
+
+void tic_arrival_free(tic_arrival * arrival)
+{
+  free(arrival);
+}
+
+void tic_arrival_set_axis_limits(tic_arrival * arrival, size_t index,
+  uint32_t starting_speed, uint32_t max_speed,
+  uint32_t max_accel, uint32_t max_decel)
+{
+  if (arrival == NULL || index >= TIC_ARRIVAL_MAX_AXES) { return; }
+  tic_arrival_axis * axis = &arrival->axes[index];
+  axis->starting_speed = starting_speed;
+  axis->max_speed = max_speed;
+  axis->max_accel = max_accel;
+  axis->max_decel = max_decel ? max_decel : max_accel;
+}
+
+void tic_arrival_set_axis_limits_from_settings(tic_arrival * arrival,
+  size_t index, const tic_settings * settings)
+{
+  tic_arrival_set_axis_limits(arrival, index,
+    tic_settings_get_starting_speed(settings),
+    tic_settings_get_max_speed(settings),
+    tic_settings_get_max_accel(settings),
+    tic_settings_get_max_decel(settings));
+}
+
+void tic_arrival_set_min_duration_us(tic_arrival * arrival, int64_t duration_us)
+{
+  if (arrival == NULL) { return; }
+  arrival->min_duration_us = duration_us;
+}
+
+int64_t tic_arrival_get_min_duration_us(const tic_arrival * arrival)
+{
+  if (arrival == NULL) { return 0; }
+  return arrival->min_duration_us;
+}
+
+// Computes the time that a move takes in seconds, given the peak speed, the
+// distance, the starting speed, and k as described at the top of this file.
+static double tic_arrival_time(double peak, double distance,
+  double start, double k)
+{
+  return (peak - start) * 2 * k + (distance - (peak * peak - start * start) * k) / peak;
+}
+
+tic_error * tic_arrival_plan(tic_arrival * arrival, size_t count,
+  const int32_t * distances)
+{
+  if (arrival == NULL)
+  {
+    return tic_error_create("Arrival planner is null.");
+  }
+
+  if (distances == NULL)
+  {
+    return tic_error_create("Distances are null.");
+  }
+
+  if (count > TIC_ARRIVAL_MAX_AXES)
+  {
+    return tic_error_create("An arrival plan can have at most %u axes.",
+      TIC_ARRIVAL_MAX_AXES);
+  }
+
+  arrival->count = count;
+  arrival->duration_us = 0;
+
+  // Find the fastest peak speed and time for each axis.
+  double peaks[TIC_ARRIVAL_MAX_AXES];
+  double times[TIC_ARRIVAL_MAX_AXES];
+  double longest = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const tic_arrival_axis * axis = &arrival->axes[i];
+    double distance = fabs((double)distances[i]);
+    double vmax = (double)axis->max_speed / TIC_SPEED_UNITS_PER_HZ;
+    double start = (double)axis->starting_speed / TIC_SPEED_UNITS_PER_HZ;
+    if (start > vmax) { start = vmax; }
+
+    peaks[i] = vmax;
+    times[i] = 0;
+    if (distance == 0) { continue; }
+
+    if (vmax <= 0 || axis->max_accel == 0)
+    {
+      return tic_error_create(
+        "Axis %u cannot move because its max speed or max acceleration is 0.",
+        (unsigned int)i);
+    }
+
+    double k = TIC_ACCEL_UNITS_PER_HZ2 / (2.0 * axis->max_accel) +
+      TIC_ACCEL_UNITS_PER_HZ2 / (2.0 * axis->max_decel);
+    double peak = sqrt(distance / k + start * start);
+    if (peak > vmax) { peak = vmax; }
+    if (peak < start || peak <= 0) { peak = start; }
+
+    peaks[i] = peak;
+    times[i] = tic_arrival_time(peak, distance, start, k);
+    if (times[i] > longest) { longest = times[i]; }
+  }
+
+  // A move that is slower than it needs to be is planned the same way as
+  // one where the slowest axis takes that long.
+  if (longest > 0 && longest < arrival->min_duration_us / 1e6)
+  {
+    longest = arrival->min_duration_us / 1e6;
+  }
+
+  // Slow down the other axes so they take as long as the slowest one.
+  for (size_t i = 0; i < count; i++)
+  {
+    tic_arrival_axis * axis = &arrival->axes[i];
+    double distance = fabs((double)distances[i]);
+    double start = (double)axis->starting_speed / TIC_SPEED_UNITS_PER_HZ;
+    double peak = peaks[i];
+    double time = times[i];
+
+    if (distance != 0 && time < longest)
+    {
+      double k = TIC_ACCEL_UNITS_PER_HZ2 / (2.0 * axis->max_accel) +
+        TIC_ACCEL_UNITS_PER_HZ2 / (2.0 * axis->max_decel);
+      double b = longest + 2 * k * start;
+      double discriminant = b * b - 4 * k * (k * start * start + distance);
+      if (discriminant < 0) { discriminant = 0; }
+      peak = (b - sqrt(discriminant)) / (2 * k);
+
+      // The Tic does not go slower than its starting speed, so an axis with a
+      // high starting speed might get there early.
+      if (peak < start) { peak = start; }
+      time = tic_arrival_time(peak, distance, start, k);
+    }
+
+    axis->speed = (uint32_t)floor(peak * TIC_SPEED_UNITS_PER_HZ + 0.5);
+    if (axis->speed > axis->max_speed) { axis->speed = axis->max_speed; }
+    axis->duration_us = (int64_t)floor(time * 1e6 + 0.5);
+  }
+
+  arrival->duration_us = (int64_t)floor(longest * 1e6 + 0.5);
+  return NULL;
+}
+
+int64_t tic_arrival_get_duration_us(const tic_arrival * arrival)
+{
+  if (arrival == NULL) { return 0; }
+  return arrival->duration_us;
+}
+
+uint32_t tic_arrival_get_axis_max_speed(const tic_arrival * arrival, size_t index)
+{
+  if (arrival == NULL || index >= TIC_ARRIVAL_MAX_AXES) { return 0; }
+  return arrival->axes[index].speed;
+}
+
+uint32_t tic_arrival_get_axis_max_accel(const tic_arrival * arrival, size_t index)
+{
+  if (arrival == NULL || index >= TIC_ARRIVAL_MAX_AXES) { return 0; }
+  return arrival->axes[index].max_accel;
+}
+
+uint32_t tic_arrival_get_axis_max_decel(const tic_arrival * arrival, size_t index)
+{
+  if (arrival == NULL || index >= TIC_ARRIVAL_MAX_AXES) { return 0; }
+  return arrival->axes[index].max_decel;
+}
+
+int64_t tic_arrival_get_axis_duration_us(const tic_arrival * arrival, size_t index)
+{
+  if (arrival == NULL || index >= TIC_ARRIVAL_MAX_AXES) { return 0; }
+  return arrival->axes[index].duration_us;
+}
+
+tic_error * tic_arrival_move(tic_arrival * arrival, tic_sync * sync,
+  const int32_t * targets)
+{
+  if (arrival == NULL)
+  {
+    return tic_error_create("Arrival planner is null.");
+  }
+
+  if (targets == NULL)
+  {
+    return tic_error_create("Targets are null.");
+  }
+
+  size_t count = tic_sync_get_count(sync);
+  if (count > TIC_ARRIVAL_MAX_AXES)
+  {
+    return tic_error_create("An arrival plan can have at most %u axes.",
+      TIC_ARRIVAL_MAX_AXES);
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_error * error = NULL;
+
+  int32_t distances[TIC_ARRIVAL_MAX_AXES];
+  for (size_t i = 0; error == NULL && i < count; i++)
+  {
+    uint8_t buffer[4];
+    error = tic_get_variable_segment(tic_sync_get_handle(sync, i),
+      TIC_VAR_CURRENT_POSITION, sizeof(buffer), buffer, false);
+    if (error == NULL)
+    {
+      distances[i] = (int32_t)((uint32_t)targets[i] - (uint32_t)read_i32(buffer));
+    }
+  }
+
+  if (error == NULL)
+  {
+    error = tic_arrival_plan(arrival, count, distances);
+  }
+
+  // Sending the limits does not need to be synchronized because nothing moves
+  // until the targets are sent.
+  for (size_t i = 0; error == NULL && i < count; i++)
+  {
+    tic_handle * handle = tic_sync_get_handle(sync, i);
+    const tic_arrival_axis * axis = &arrival->axes[i];
+    error = tic_set_max_speed(handle, axis->speed);
+    if (error == NULL)
+    {
+      error = tic_set_max_accel(handle, axis->max_accel);
+    }
+    if (error == NULL)
+    {
+      error = tic_set_max_decel(handle, axis->max_decel);
+    }
+  }
+
+  if (error == NULL)
+  {
+    error = tic_sync_set_target_positions(sync, targets);
+  }
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error, "There was an error starting a synchronized move.");
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
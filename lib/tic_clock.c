@@ -0,0 +1,64 @@
+#include "tic_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Returns the time in microseconds from a clock that is never adjusted and is
+// the same for every process on the computer.
+int64_t tic_clock_us(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER frequency, count;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return (int64_t)(count.QuadPart / frequency.QuadPart * 1000000 +
+    count.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// Returns the time in nanoseconds from the same clock as tic_clock_us().
+int64_t tic_clock_ns(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER frequency, count;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return (int64_t)(count.QuadPart / frequency.QuadPart * 1000000000 +
+    count.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// Sleeps until tic_clock_ns() reaches the deadline.  Sleeping until an
+// absolute time instead of for a duration means that time spent between
+// deadlines does not accumulate into drift.
+void tic_sleep_until_ns(int64_t deadline_ns)
+{
+#if defined(__linux__)
+  struct timespec ts;
+  ts.tv_sec = deadline_ns / 1000000000;
+  ts.tv_nsec = deadline_ns % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+#else
+  // Other systems do not have clock_nanosleep, so sleep for the time left.
+  while (true)
+  {
+    int64_t left_ns = deadline_ns - tic_clock_ns();
+    if (left_ns <= 0) { break; }
+#ifdef _WIN32
+    Sleep((DWORD)((left_ns + 999999) / 1000000));
+#else
+    struct timespec ts = { left_ns / 1000000000, left_ns % 1000000000 };
+    nanosleep(&ts, NULL);
+#endif
+  }
+#endif
+}
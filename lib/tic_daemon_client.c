@@ -0,0 +1,323 @@
+// Functions for talking to a Tic through ticd, the Tic daemon, instead of
+// opening it directly.  See ticd_protocol.h for a description of the protocol.
+
+#include "tic_internal.h"
+#include <ticd_protocol.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+// How long to wait for a response from ticd.  Requests for a device are done
+// one at a time, so this needs to be longer than the USB timeout.
+#define TICD_RESPONSE_TIMEOUT_MS 10000
+
+struct tic_daemon_connection
+{
+  // -1 after a request failed partway, since a late or partial response
+  // would get mixed up with the response to the next request.
+  int fd;
+};
+
+#ifdef _WIN32
+
+tic_error * tic_daemon_connect(const char * socket_path,
+  const char * serial_number, tic_daemon_connection ** connection)
+{
+  (void)socket_path;
+  (void)serial_number;
+  *connection = NULL;
+  return tic_error_create("ticd is not supported on Windows.");
+}
+
+void tic_daemon_disconnect(tic_daemon_connection * connection)
+{
+  (void)connection;
+}
+
+tic_error * tic_daemon_control_transfer(tic_daemon_connection * connection,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred)
+{
+  (void)connection;
+  (void)request_type;
+  (void)request;
+  (void)value;
+  (void)index;
+  (void)buffer;
+  (void)length;
+  if (transferred) { *transferred = 0; }
+  return tic_error_create("ticd is not supported on Windows.");
+}
+
+#else
+
+static tic_error * tic_daemon_lost_connection(const char * what)
+{
+  tic_error * error = tic_error_create(
+    "Lost the connection to ticd while %s: %s.", what, strerror(errno));
+  return tic_error_add_code(error, TIC_ERROR_DEVICE_DISCONNECTED);
+}
+
+static tic_error * tic_daemon_send(tic_daemon_connection * connection,
+  const uint8_t * data, size_t size)
+{
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  flags = MSG_NOSIGNAL;
+#endif
+
+  while (size)
+  {
+    ssize_t sent = send(connection->fd, data, size, flags);
+    if (sent < 0 && errno == EINTR) { continue; }
+    if (sent <= 0)
+    {
+      return tic_daemon_lost_connection("sending a request");
+    }
+    data += sent;
+    size -= sent;
+  }
+  return NULL;
+}
+
+static tic_error * tic_daemon_receive(tic_daemon_connection * connection,
+  uint8_t * data, size_t size)
+{
+  while (size)
+  {
+    ssize_t received = recv(connection->fd, data, size, 0);
+    if (received < 0 && errno == EINTR) { continue; }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      tic_error * error = tic_error_create(
+        "Timed out waiting for a response from ticd.");
+      return tic_error_add_code(error, TIC_ERROR_TIMEOUT);
+    }
+    if (received == 0) { errno = ECONNRESET; }
+    if (received <= 0)
+    {
+      return tic_daemon_lost_connection("receiving a response");
+    }
+    data += received;
+    size -= received;
+  }
+  return NULL;
+}
+
+// Sends a request and reads the response.  If the response has data, up to
+// response_size bytes of it are stored in the response buffer and the rest is
+// discarded.
+//
+// If anything goes wrong with sending or receiving, the connection is closed
+// and later requests fail.
+static tic_error * tic_daemon_request(tic_daemon_connection * connection,
+  const ticd_request_header * request, const void * request_data,
+  void * response, size_t response_size, size_t * transferred)
+{
+  if (transferred) { *transferred = 0; }
+
+  if (connection->fd < 0)
+  {
+    return tic_error_add_code(
+      tic_error_create("The connection to ticd was closed after an error."),
+      TIC_ERROR_DEVICE_DISCONNECTED);
+  }
+
+  uint8_t request_buffer[TICD_REQUEST_HEADER_SIZE];
+  ticd_request_header_encode(request, request_buffer);
+  tic_error * error = tic_daemon_send(connection,
+    request_buffer, sizeof(request_buffer));
+
+  if (error == NULL && request_data != NULL && request->length)
+  {
+    error = tic_daemon_send(connection, request_data, request->length);
+  }
+
+  uint8_t response_buffer[TICD_RESPONSE_HEADER_SIZE];
+  if (error == NULL)
+  {
+    error = tic_daemon_receive(connection,
+      response_buffer, sizeof(response_buffer));
+  }
+
+  ticd_response_header header = { 0, 0, 0 };
+  if (error == NULL)
+  {
+    ticd_response_header_decode(response_buffer, &header);
+    if (header.length > TICD_MAX_DATA_SIZE)
+    {
+      error = tic_error_create("Invalid response from ticd.");
+    }
+  }
+
+  uint8_t data[TICD_MAX_DATA_SIZE + 1];
+  if (error == NULL)
+  {
+    error = tic_daemon_receive(connection, data, header.length);
+  }
+
+  if (error != NULL)
+  {
+    close(connection->fd);
+    connection->fd = -1;
+  }
+
+  if (error == NULL && header.status != TICD_STATUS_OK)
+  {
+    data[header.length] = 0;
+    error = tic_error_create("%s", data);
+    for (uint32_t code = 1; code < 8; code++)
+    {
+      if (header.error_flags >> code & 1)
+      {
+        error = tic_error_add_code(error, code);
+      }
+    }
+  }
+
+  if (error == NULL)
+  {
+    size_t size = header.length;
+    if (size > response_size) { size = response_size; }
+    if (size) { memcpy(response, data, size); }
+    if (transferred) { *transferred = size; }
+  }
+
+  return error;
+}
+
+tic_error * tic_daemon_connect(const char * socket_path,
+  const char * serial_number, tic_daemon_connection ** connection)
+{
+  assert(connection != NULL);
+
+  *connection = NULL;
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address.sun_path))
+  {
+    return tic_error_create("The ticd socket path is too long: %s", socket_path);
+  }
+  strcpy(address.sun_path, socket_path);
+
+  size_t serial_number_length = strlen(serial_number);
+  if (serial_number_length > TICD_MAX_DATA_SIZE)
+  {
+    return tic_error_create("The serial number is too long.");
+  }
+
+  tic_error * error = NULL;
+
+  tic_daemon_connection * new_connection = NULL;
+  if (error == NULL)
+  {
+    new_connection = calloc(1, sizeof(tic_daemon_connection));
+    if (new_connection == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  if (error == NULL)
+  {
+    new_connection->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (new_connection->fd < 0)
+    {
+      error = tic_error_create("Failed to create a socket: %s.",
+        strerror(errno));
+    }
+  }
+
+  if (error == NULL)
+  {
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(new_connection->fd, SOL_SOCKET, SO_NOSIGPIPE,
+      &one, sizeof(one));
+#endif
+
+    struct timeval timeout;
+    timeout.tv_sec = TICD_RESPONSE_TIMEOUT_MS / 1000;
+    timeout.tv_usec = TICD_RESPONSE_TIMEOUT_MS % 1000 * 1000;
+    setsockopt(new_connection->fd, SOL_SOCKET, SO_RCVTIMEO,
+      &timeout, sizeof(timeout));
+
+    if (connect(new_connection->fd,
+        (const struct sockaddr *)&address, sizeof(address)))
+    {
+      error = tic_error_create("Failed to connect to ticd at %s: %s.",
+        socket_path, strerror(errno));
+    }
+  }
+
+  if (error == NULL)
+  {
+    ticd_request_header request = { 0 };
+    request.op = TICD_OP_OPEN;
+    request.length = serial_number_length;
+    error = tic_daemon_request(new_connection, &request, serial_number,
+      NULL, 0, NULL);
+  }
+
+  if (error == NULL)
+  {
+    // Success.  Pass the connection to the caller.
+    *connection = new_connection;
+    new_connection = NULL;
+  }
+
+  tic_daemon_disconnect(new_connection);
+
+  return error;
+}
+
+void tic_daemon_disconnect(tic_daemon_connection * connection)
+{
+  if (connection != NULL)
+  {
+    if (connection->fd >= 0) { close(connection->fd); }
+    free(connection);
+  }
+}
+
+tic_error * tic_daemon_control_transfer(tic_daemon_connection * connection,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred)
+{
+  assert(connection != NULL);
+
+  if (transferred) { *transferred = 0; }
+
+  if (length > TICD_MAX_DATA_SIZE)
+  {
+    return tic_error_create("Control transfer is too long for ticd.");
+  }
+
+  bool device_to_host = request_type & 0x80;
+
+  ticd_request_header header;
+  header.op = TICD_OP_CONTROL_TRANSFER;
+  header.request_type = request_type;
+  header.request = request;
+  header.value = value;
+  header.index = index;
+  header.length = length;
+
+  if (device_to_host)
+  {
+    return tic_daemon_request(connection, &header, NULL,
+      buffer, length, transferred);
+  }
+
+  tic_error * error = tic_daemon_request(connection, &header, buffer,
+    NULL, 0, NULL);
+  if (error == NULL && transferred) { *transferred = length; }
+  return error;
+}
+
+#endif
@@ -11,6 +11,161 @@ struct tic_device
   uint8_t product;
 };
 
+// Returns the TIC_PRODUCT_* code for a USB product ID, or 0 if the product ID
+// is not one of the Tic's.
+static uint8_t tic_product_from_usb_product_id(uint16_t product_id)
+{
+  switch (product_id)
+  {
+  case TIC_PRODUCT_ID_T825: return TIC_PRODUCT_T825;
+  case TIC_PRODUCT_ID_T834: return TIC_PRODUCT_T834;
+  case TIC_PRODUCT_ID_T500: return TIC_PRODUCT_T500;
+  case TIC_PRODUCT_ID_N825: return TIC_PRODUCT_N825;
+  case TIC_PRODUCT_ID_T249: return TIC_PRODUCT_T249;
+  case TIC_PRODUCT_ID_36V4: return TIC_PRODUCT_36V4;
+  default: return 0;
+  }
+}
+
+tic_error * tic_device_create_from_usb_device(
+  const libusbp_device * usb_device,
+  const char * serial_number,
+  tic_device ** device)
+{
+  if (device == NULL)
+  {
+    return tic_error_create("Device output pointer is null.");
+  }
+
+  *device = NULL;
+
+  if (usb_device == NULL)
+  {
+    return tic_error_create("USB device is null.");
+  }
+
+  // Check the USB vendor ID.
+  uint16_t vendor_id;
+  tic_error * error = tic_usb_error(
+    libusbp_device_get_vendor_id(usb_device, &vendor_id));
+  if (error) { return error; }
+  if (vendor_id != TIC_VENDOR_ID) { return NULL; }
+
+  // Check the USB product ID.
+  uint16_t product_id;
+  error = tic_usb_error(libusbp_device_get_product_id(usb_device, &product_id));
+  if (error) { return error; }
+  uint8_t product = tic_product_from_usb_product_id(product_id);
+  if (product == 0) { return NULL; }
+
+  // Get the USB interface.
+  libusbp_generic_interface * usb_interface = NULL;
+  {
+    uint8_t interface_number = 0;
+    bool composite = false;
+    libusbp_error * usb_error = libusbp_generic_interface_create(
+      usb_device, interface_number, composite, &usb_interface);
+    if (usb_error)
+    {
+      if (libusbp_error_has_code(usb_error, LIBUSBP_ERROR_NOT_READY))
+      {
+        // An error occurred that is normal if the interface is simply
+        // not ready to use yet.  Silently ignore this device.
+        libusbp_error_free(usb_error);
+        return NULL;
+      }
+      return tic_usb_error(usb_error);
+    }
+  }
+
+  // Allocate the new device.
+  tic_device * new_device = calloc(1, sizeof(tic_device));
+  if (new_device == NULL)
+  {
+    libusbp_generic_interface_free(usb_interface);
+    return &tic_error_no_memory;
+  }
+
+  // Store the USB interface.  Must do this here so that it will get freed
+  // if any of the calls below fail.
+  new_device->usb_interface = usb_interface;
+  new_device->product = product;
+
+  // Get the serial number, unless the caller already knows it.
+  if (serial_number != NULL)
+  {
+    new_device->serial_number = strdup(serial_number);
+    if (new_device->serial_number == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+  else
+  {
+    error = tic_usb_error(libusbp_device_get_serial_number(
+        usb_device, &new_device->serial_number));
+  }
+
+  // Get the OS ID.
+  if (error == NULL)
+  {
+    error = tic_usb_error(libusbp_device_get_os_id(
+        usb_device, &new_device->os_id));
+  }
+
+  // Get the firmware version.
+  if (error == NULL)
+  {
+    error = tic_usb_error(libusbp_device_get_revision(
+        usb_device, &new_device->firmware_version));
+  }
+
+  if (error == NULL)
+  {
+    // Success.  Give the device to the caller.
+    *device = new_device;
+    new_device = NULL;
+  }
+
+  tic_device_free(new_device);
+
+  return error;
+}
+
+tic_error * tic_device_create_replayed(const char * serial_number,
+  const char * os_id, uint8_t product, uint16_t firmware_version,
+  tic_device ** device)
+{
+  *device = NULL;
+
+  tic_device * new_device = calloc(1, sizeof(tic_device));
+  if (new_device == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  tic_error * error = NULL;
+
+  new_device->product = product;
+  new_device->firmware_version = firmware_version;
+  new_device->serial_number = strdup(serial_number);
+  new_device->os_id = strdup(os_id);
+  if (new_device->serial_number == NULL || new_device->os_id == NULL)
+  {
+    error = &tic_error_no_memory;
+  }
+
+  if (error == NULL)
+  {
+    *device = new_device;
+    new_device = NULL;
+  }
+
+  tic_device_free(new_device);
+
+  return error;
+}
+
 tic_error * tic_list_connected_devices(
   tic_device *** device_list,
   size_t * device_count)
@@ -24,6 +179,14 @@ tic_error * tic_list_connected_devices(
 
   *device_list = NULL;
 
+  if (tic_replay_enabled())
+  {
+    // Pretend that the devices in the USB recording are connected.
+    return tic_replay_list_devices(device_list, device_count);
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   libusbp_device ** usb_device_list = NULL;
@@ -49,103 +212,12 @@ tic_error * tic_list_connected_devices(
 
   for (size_t i = 0; error == NULL && i < usb_device_count; i++)
   {
-    libusbp_device * usb_device = usb_device_list[i];
-
-    // Check the USB vendor ID.
-    uint16_t vendor_id;
-    error = tic_usb_error(libusbp_device_get_vendor_id(usb_device, &vendor_id));
-    if (error) { break; }
-    if (vendor_id != TIC_VENDOR_ID) { continue; }
-
-    // Check the USB product ID.
-    uint16_t product_id;
-    error = tic_usb_error(libusbp_device_get_product_id(usb_device, &product_id));
-    if (error) { break; }
-    if (product_id != TIC_PRODUCT_ID_T825 &&
-      product_id != TIC_PRODUCT_ID_T834 &&
-      product_id != TIC_PRODUCT_ID_T500 &&
-      product_id != TIC_PRODUCT_ID_N825 &&
-      product_id != TIC_PRODUCT_ID_T249 &&
-      product_id != TIC_PRODUCT_ID_36V4)
-    {
-      continue;
-    }
-
-    // Get the USB interface.
-    libusbp_generic_interface * usb_interface = NULL;
-    {
-      uint8_t interface_number = 0;
-      bool composite = false;
-      libusbp_error * usb_error = libusbp_generic_interface_create(
-        usb_device, interface_number, composite, &usb_interface);
-      if (usb_error)
-      {
-        if (libusbp_error_has_code(usb_error, LIBUSBP_ERROR_NOT_READY))
-        {
-          // An error occurred that is normal if the interface is simply
-          // not ready to use yet.  Silently ignore this device.
-          continue;
-        }
-        error = tic_usb_error(usb_error);
-        break;
-      }
-    }
-
-    // Allocate the new device.
-    tic_device * new_device = calloc(1, sizeof(tic_device));
-    if (new_device == NULL)
-    {
-      error = &tic_error_no_memory;
-      break;
-    }
-    tic_device_list[tic_device_count++] = new_device;
-
-    // Store the USB interface.  Must do this here so that it will get freed
-    // if any of the calls below fail.
-    new_device->usb_interface = usb_interface;
-
-    // Get the serial number.
-    error = tic_usb_error(libusbp_device_get_serial_number(
-        usb_device, &new_device->serial_number));
-    if (error) { break; }
-
-    // Get the OS ID.
-    error = tic_usb_error(libusbp_device_get_os_id(
-        usb_device, &new_device->os_id));
-    if (error) { break; }
-
-    // Get the firmware version.
-    error = tic_usb_error(libusbp_device_get_revision(
-        usb_device, &new_device->firmware_version));
-    if (error) { break; }
-
-    // Get the product code.
-    switch (product_id)
+    tic_device * new_device = NULL;
+    error = tic_device_create_from_usb_device(
+      usb_device_list[i], NULL, &new_device);
+    if (new_device != NULL)
     {
-    case TIC_PRODUCT_ID_T825:
-      new_device->product = TIC_PRODUCT_T825;
-      break;
-    case TIC_PRODUCT_ID_T834:
-      new_device->product = TIC_PRODUCT_T834;
-      break;
-    case TIC_PRODUCT_ID_T500:
-      new_device->product = TIC_PRODUCT_T500;
-      break;
-    case TIC_PRODUCT_ID_N825:
-      new_device->product = TIC_PRODUCT_N825;
-      break;
-    case TIC_PRODUCT_ID_T249:
-      new_device->product = TIC_PRODUCT_T249;
-      break;
-    case TIC_PRODUCT_ID_36V4:
-      new_device->product = TIC_PRODUCT_36V4;
-      break;
-    }
-    if (new_device->product == 0)
-    {
-      // Should not ever happen.
-      error = tic_error_create("Unknown product.");
-      break;
+      tic_device_list[tic_device_count++] = new_device;
     }
   }
 
@@ -172,6 +244,7 @@ tic_error * tic_list_connected_devices(
 
   libusbp_list_free(usb_device_list);
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -202,7 +275,8 @@ tic_error * tic_device_copy(const tic_device * source, tic_device ** dest)
     error = &tic_error_no_memory;
   }
 
-  if (error == NULL)
+  // Devices from a USB recording have no interface.
+  if (error == NULL && source->usb_interface != NULL)
   {
     error = tic_usb_error(libusbp_generic_interface_copy(
         source->usb_interface, &new_device->usb_interface));
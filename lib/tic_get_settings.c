@@ -404,6 +404,8 @@ tic_error * tic_get_settings(tic_handle * handle, tic_settings ** settings)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   // Allocate the new settings object.
@@ -461,6 +463,7 @@ tic_error * tic_get_settings(tic_handle * handle, tic_settings ** settings)
       "There was an error reading settings from the device.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
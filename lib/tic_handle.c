@@ -1,14 +1,88 @@
 // Functions for communicating with Tic devices over USB.
 
 #include "tic_internal.h"
+#include <ticd_protocol.h>
 
 struct tic_handle
 {
+  // Exactly one of these is non-NULL, depending on whether we talk to the
+  // device directly, through ticd, or are replaying a USB recording.
   libusbp_generic_handle * usb_handle;
+  tic_daemon_connection * daemon;
+  tic_replay_device * replay;
+
+  // The index of the device in the USB recording, or -1 if not recording.
+  int record_device;
+
   tic_device * device;
   char * cached_firmware_version_string;
+
+  // Non-NULL if the variables we read are being published to shared memory.
+  tic_telemetry_publisher * telemetry;
+
+  // Non-NULL if we are measuring request latencies.
+  tic_stats * stats;
+
+  // Non-NULL if we lower the current limit of an idle motor.
+  tic_idle_current * idle_current;
 };
 
+// Every request to the device goes through this function.
+static tic_error * tic_control_transfer(tic_handle * handle,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred)
+{
+  // The full current limit needs to be back before the motor moves.
+  if (handle->idle_current != NULL)
+  {
+    tic_error * error = tic_idle_current_before_request(
+      handle->idle_current, handle, request);
+    if (error != NULL) { return error; }
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+  bool recording = handle->record_device >= 0;
+  int64_t start_us = (handle->stats || recording) ? tic_clock_us() : 0;
+
+  // The recorder needs to know how much data came back.
+  size_t local_transferred = 0;
+  if (transferred == NULL) { transferred = &local_transferred; }
+
+  tic_error * error;
+  if (handle->replay != NULL)
+  {
+    error = tic_replay_control_transfer(handle->replay,
+      request_type, request, value, index, buffer, length, transferred);
+  }
+  else if (handle->daemon != NULL)
+  {
+    error = tic_daemon_control_transfer(handle->daemon,
+      request_type, request, value, index, buffer, length, transferred);
+  }
+  else
+  {
+    error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
+      request_type, request, value, index, buffer, length, transferred));
+  }
+
+  if (handle->stats)
+  {
+    tic_stats_record(handle->stats, request, tic_clock_us() - start_us, error);
+  }
+
+  if (recording)
+  {
+    tic_recorder_add_transfer(handle->record_device, start_us,
+      tic_clock_us() - start_us, request_type, request, value, index,
+      length, buffer, *transferred, error);
+  }
+
+  tic_trace_end_transfer(trace_start_us,
+    request_type, request, value, index, length, error);
+
+  return error;
+}
+
 tic_error * tic_handle_open(const tic_device * device, tic_handle ** handle)
 {
   if (handle == NULL)
@@ -23,6 +97,8 @@ tic_error * tic_handle_open(const tic_device * device, tic_handle ** handle)
     return tic_error_create("Device is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   if (error == NULL)
@@ -52,8 +128,29 @@ tic_error * tic_handle_open(const tic_device * device, tic_handle ** handle)
     error = tic_device_copy(device, &new_handle->device);
   }
 
-
   if (error == NULL)
+  {
+    error = tic_recorder_add_device(device, &new_handle->record_device);
+  }
+
+  bool use_replay = tic_replay_enabled();
+
+  if (error == NULL && use_replay)
+  {
+    error = tic_replay_open(device, &new_handle->replay);
+  }
+
+  const char * daemon_socket_path = getenv(TICD_SOCKET_ENV_VAR);
+  bool use_daemon = !use_replay &&
+    daemon_socket_path != NULL && daemon_socket_path[0] != 0;
+
+  if (error == NULL && use_daemon)
+  {
+    error = tic_daemon_connect(daemon_socket_path,
+      tic_device_get_serial_number(device), &new_handle->daemon);
+  }
+
+  if (error == NULL && !use_daemon && !use_replay)
   {
     const libusbp_generic_interface * usb_interface =
       tic_device_get_generic_interface(device);
@@ -61,7 +158,7 @@ tic_error * tic_handle_open(const tic_device * device, tic_handle ** handle)
         usb_interface, &new_handle->usb_handle));
   }
 
-  if (error == NULL)
+  if (error == NULL && !use_daemon && !use_replay)
   {
     // Set a timeout for all control transfers to prevent the program from
     // hanging indefinitely.  Want it to be at least 1500 ms because that is how
@@ -80,6 +177,7 @@ tic_error * tic_handle_open(const tic_device * device, tic_handle ** handle)
 
   tic_handle_close(new_handle);
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -87,7 +185,14 @@ void tic_handle_close(tic_handle * handle)
 {
   if (handle != NULL)
   {
+    // Do not leave a motor with a low current limit that the next program
+    // does not know about.
+    tic_error_free(tic_idle_current_restore(handle->idle_current, handle));
+    tic_idle_current_free(handle->idle_current);
     libusbp_generic_handle_close(handle->usb_handle);
+    tic_daemon_disconnect(handle->daemon);
+    tic_telemetry_publisher_close(handle->telemetry);
+    tic_stats_free(handle->stats);
     tic_device_free(handle->device);
     free(handle->cached_firmware_version_string);
     free(handle);
@@ -100,6 +205,134 @@ const tic_device * tic_handle_get_device(const tic_handle * handle)
   return handle->device;
 }
 
+tic_error * tic_handle_publish_telemetry(tic_handle * handle, const char * name)
+{
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  tic_telemetry_publisher_close(handle->telemetry);
+  handle->telemetry = NULL;
+
+  if (name == NULL) { return NULL; }
+
+  return tic_telemetry_publisher_open(name,
+    tic_device_get_serial_number(handle->device), &handle->telemetry);
+}
+
+tic_error * tic_handle_enable_stats(tic_handle * handle, bool enable)
+{
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (!enable)
+  {
+    tic_stats_free(handle->stats);
+    handle->stats = NULL;
+    return NULL;
+  }
+
+  if (handle->stats != NULL) { return NULL; }
+
+  return tic_stats_create(&handle->stats);
+}
+
+tic_error * tic_handle_get_stats(tic_handle * handle, tic_stats ** stats)
+{
+  if (stats == NULL)
+  {
+    return tic_error_create("Stats output pointer is null.");
+  }
+
+  *stats = NULL;
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (handle->stats == NULL)
+  {
+    return tic_stats_create(stats);
+  }
+
+  return tic_stats_copy(handle->stats, stats);
+}
+
+tic_error * tic_handle_set_idle_current(tic_handle * handle,
+  uint32_t idle_current_limit, uint32_t idle_time_ms)
+{
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (handle->idle_current == NULL)
+  {
+    tic_error * error = tic_idle_current_create(&handle->idle_current);
+    if (error != NULL) { return error; }
+  }
+
+  tic_idle_current_configure(handle->idle_current,
+    idle_current_limit, idle_time_ms);
+  return NULL;
+}
+
+tic_error * tic_handle_disable_idle_current(tic_handle * handle)
+{
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  tic_error * error = tic_idle_current_restore(handle->idle_current, handle);
+  if (error != NULL) { return error; }
+
+  tic_idle_current_free(handle->idle_current);
+  handle->idle_current = NULL;
+  return NULL;
+}
+
+tic_error * tic_handle_get_idle_current(tic_handle * handle,
+  tic_idle_current ** idle)
+{
+  if (idle == NULL)
+  {
+    return tic_error_create("Idle current output pointer is null.");
+  }
+
+  *idle = NULL;
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  tic_error * error;
+  if (handle->idle_current == NULL)
+  {
+    error = tic_idle_current_create(idle);
+  }
+  else
+  {
+    error = tic_idle_current_copy(handle->idle_current, idle);
+  }
+
+  // Count the time up to now if the current limit is still low.
+  tic_idle_current_account(*idle, tic_clock_us());
+  return error;
+}
+
+void tic_handle_publish_variables(tic_handle * handle,
+  const tic_variables * variables)
+{
+  tic_telemetry_publish(handle->telemetry, variables);
+  tic_idle_current_check(handle->idle_current, handle, variables);
+}
+
 const char * tic_get_firmware_version_string(tic_handle * handle)
 {
   if (handle == NULL) { return ""; }
@@ -136,15 +369,16 @@ const char * tic_get_firmware_version_string(tic_handle * handle)
   // Get the firmware modification string from the device.
   size_t transferred = 0;
   uint8_t buffer[256];
-  libusbp_error * usb_error = libusbp_control_transfer(handle->usb_handle,
+  tic_error * error = tic_control_transfer(handle,
     0x80, USB_REQUEST_GET_DESCRIPTOR,
     (USB_DESCRIPTOR_TYPE_STRING << 8) | TIC_FIRMWARE_MODIFICATION_STRING_INDEX,
     0,
     buffer, sizeof(buffer), &transferred);
-  if (usb_error)
+  if (error)
   {
     // Let's make this be a non-fatal error because it's not so important.
     // Just add a question mark so we can tell if something is wrong.
+    tic_error_free(error);
     new_string[index++] = '0';
   }
 
@@ -174,12 +408,14 @@ tic_error * tic_set_target_position(tic_handle * handle, int32_t position)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)position & 0xFFFF;
   uint16_t wIndex = (uint32_t)position >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_TARGET_POSITION, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_TARGET_POSITION, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -187,6 +423,7 @@ tic_error * tic_set_target_position(tic_handle * handle, int32_t position)
       "There was an error setting the target position.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -197,12 +434,14 @@ tic_error * tic_set_target_velocity(tic_handle * handle, int32_t velocity)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)velocity & 0xFFFF;
   uint16_t wIndex = (uint32_t)velocity >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_TARGET_VELOCITY, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_TARGET_VELOCITY, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -210,6 +449,7 @@ tic_error * tic_set_target_velocity(tic_handle * handle, int32_t velocity)
       "There was an error setting the target velocity.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -220,12 +460,14 @@ tic_error * tic_halt_and_set_position(tic_handle * handle, int32_t position)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)position & 0xFFFF;
   uint16_t wIndex = (uint32_t)position >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_HALT_AND_SET_POSITION, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_HALT_AND_SET_POSITION, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -233,6 +475,7 @@ tic_error * tic_halt_and_set_position(tic_handle * handle, int32_t position)
       "There was an error halting and setting the position.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -243,10 +486,12 @@ tic_error * tic_halt_and_hold(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_HALT_AND_HOLD, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_HALT_AND_HOLD, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -254,6 +499,7 @@ tic_error * tic_halt_and_hold(tic_handle * handle)
       "There was an error halting.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -264,10 +510,12 @@ tic_error * tic_go_home(tic_handle * handle, uint8_t direction)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_GO_HOME, direction, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_GO_HOME, direction, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -275,6 +523,7 @@ tic_error * tic_go_home(tic_handle * handle, uint8_t direction)
       "There was an error sending the 'Go home' command.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -285,10 +534,12 @@ tic_error * tic_reset_command_timeout(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_RESET_COMMAND_TIMEOUT, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_RESET_COMMAND_TIMEOUT, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -296,6 +547,7 @@ tic_error * tic_reset_command_timeout(tic_handle * handle)
       "There was an error resetting the command timeout.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -306,10 +558,12 @@ tic_error * tic_deenergize(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_DEENERGIZE, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_DEENERGIZE, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -317,6 +571,7 @@ tic_error * tic_deenergize(tic_handle * handle)
       "There was an error deenergizing.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -327,10 +582,12 @@ tic_error * tic_energize(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_ENERGIZE, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_ENERGIZE, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -338,6 +595,7 @@ tic_error * tic_energize(tic_handle * handle)
       "There was an error energizing.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -348,10 +606,12 @@ tic_error * tic_exit_safe_start(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_EXIT_SAFE_START, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_EXIT_SAFE_START, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -359,6 +619,7 @@ tic_error * tic_exit_safe_start(tic_handle * handle)
       "There was an error exiting safe start.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -369,10 +630,12 @@ tic_error * tic_enter_safe_start(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_ENTER_SAFE_START, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_ENTER_SAFE_START, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -380,6 +643,7 @@ tic_error * tic_enter_safe_start(tic_handle * handle)
       "There was an error entering safe start.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -390,10 +654,12 @@ tic_error * tic_reset(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_RESET, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_RESET, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -401,6 +667,7 @@ tic_error * tic_reset(tic_handle * handle)
       "There was an error sending the Reset command.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -411,10 +678,12 @@ tic_error * tic_clear_driver_error(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_CLEAR_DRIVER_ERROR, 0, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_CLEAR_DRIVER_ERROR, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -422,6 +691,7 @@ tic_error * tic_clear_driver_error(tic_handle * handle)
       "There was an error clearing the driver error.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -432,12 +702,14 @@ tic_error * tic_set_max_speed(tic_handle * handle, uint32_t max_speed)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)max_speed & 0xFFFF;
   uint16_t wIndex = (uint32_t)max_speed >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_MAX_SPEED, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_MAX_SPEED, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -445,6 +717,7 @@ tic_error * tic_set_max_speed(tic_handle * handle, uint32_t max_speed)
       "There was an error setting the maximum speed.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -455,12 +728,14 @@ tic_error * tic_set_starting_speed(tic_handle * handle, uint32_t starting_speed)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)starting_speed & 0xFFFF;
   uint16_t wIndex = (uint32_t)starting_speed >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_STARTING_SPEED, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_STARTING_SPEED, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -468,6 +743,7 @@ tic_error * tic_set_starting_speed(tic_handle * handle, uint32_t starting_speed)
       "There was an error setting the starting speed.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -478,12 +754,14 @@ tic_error * tic_set_max_accel(tic_handle * handle, uint32_t max_accel)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)max_accel & 0xFFFF;
   uint16_t wIndex = (uint32_t)max_accel >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_MAX_ACCEL, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_MAX_ACCEL, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -491,6 +769,7 @@ tic_error * tic_set_max_accel(tic_handle * handle, uint32_t max_accel)
       "There was an error setting the maximum acceleration.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -501,12 +780,14 @@ tic_error * tic_set_max_decel(tic_handle * handle, uint32_t max_decel)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = (uint32_t)max_decel & 0xFFFF;
   uint16_t wIndex = (uint32_t)max_decel >> 16 & 0xFFFF;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_MAX_DECEL, wValue, wIndex, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_MAX_DECEL, wValue, wIndex, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -514,6 +795,7 @@ tic_error * tic_set_max_decel(tic_handle * handle, uint32_t max_decel)
       "There was an error setting the maximum deceleration.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -524,11 +806,13 @@ tic_error * tic_set_step_mode(tic_handle * handle, uint8_t step_mode)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = step_mode;
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_STEP_MODE, wValue, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_STEP_MODE, wValue, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -536,6 +820,7 @@ tic_error * tic_set_step_mode(tic_handle * handle, uint8_t step_mode)
       "There was an error setting the step mode.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -560,10 +845,12 @@ tic_error * tic_set_current_limit_code(tic_handle * handle, uint8_t code)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_CURRENT_LIMIT, code, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_CURRENT_LIMIT, code, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -571,6 +858,7 @@ tic_error * tic_set_current_limit_code(tic_handle * handle, uint8_t code)
       "There was an error setting the current limit.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -581,6 +869,8 @@ tic_error * tic_set_decay_mode(tic_handle * handle, uint8_t decay_mode)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint8_t product = tic_device_get_product(tic_handle_get_device(handle));
@@ -608,8 +898,8 @@ tic_error * tic_set_decay_mode(tic_handle * handle, uint8_t decay_mode)
   if (error == NULL)
   {
     uint16_t wValue = decay_mode;
-    error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-      0x40, TIC_CMD_SET_DECAY_MODE, wValue, 0, NULL, 0, NULL));
+    error = tic_control_transfer(handle,
+      0x40, TIC_CMD_SET_DECAY_MODE, wValue, 0, NULL, 0, NULL);
   }
 
   if (error != NULL)
@@ -618,6 +908,7 @@ tic_error * tic_set_decay_mode(tic_handle * handle, uint8_t decay_mode)
       "There was an error setting the decay mode.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -637,11 +928,13 @@ static tic_error * tic_set_agc_option(tic_handle * handle,
       "This Tic does not support AGC or the commands to configure it.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   uint16_t wValue = ((option & 0x07) << 4) | (value & 0x0F);
-  error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_AGC_OPTION, wValue, 0, NULL, 0, NULL));
+  error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_AGC_OPTION, wValue, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -649,6 +942,7 @@ static tic_error * tic_set_agc_option(tic_handle * handle,
       "There was an error setting an AGC option (%d,%d).", option, value);
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -677,8 +971,8 @@ tic_error * tic_set_setting_byte(tic_handle * handle,
 {
   assert(handle != NULL);
 
-  tic_error * error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_SET_SETTING, byte, address, NULL, 0, NULL));
+  tic_error * error = tic_control_transfer(handle,
+    0x40, TIC_CMD_SET_SETTING, byte, address, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -707,8 +1001,8 @@ tic_error * tic_get_setting_segment(tic_handle * handle,
   assert(length && length <= TIC_MAX_USB_RESPONSE_SIZE);
 
   size_t transferred;
-  tic_error * error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0xC0, TIC_CMD_GET_SETTING, 0, index, output, length, &transferred));
+  tic_error * error = tic_control_transfer(handle,
+    0xC0, TIC_CMD_GET_SETTING, 0, index, output, length, &transferred);
   if (error != NULL)
   {
     return error;
@@ -738,8 +1032,8 @@ tic_error * tic_get_variable_segment(tic_handle * handle,
     cmd = TIC_CMD_GET_VARIABLE_AND_CLEAR_ERRORS_OCCURRED;
   }
   size_t transferred;
-  tic_error * error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0xC0, cmd, 0, index, output, length, &transferred));
+  tic_error * error = tic_control_transfer(handle,
+    0xC0, cmd, 0, index, output, length, &transferred);
   if (error != NULL)
   {
     return error;
@@ -756,6 +1050,18 @@ tic_error * tic_get_variable_segment(tic_handle * handle,
 }
 
 
+static tic_error * tic_settings_initialized(tic_handle * handle,
+  void * context, bool * done, uint32_t * interval_us)
+{
+  (void)context;
+  (void)interval_us;
+  uint8_t not_initialized;
+  tic_error * error = tic_get_setting_segment(handle,
+    TIC_SETTING_NOT_INITIALIZED, 1, &not_initialized);
+  *done = error == NULL && !not_initialized;
+  return error;
+}
+
 tic_error * tic_restore_defaults(tic_handle * handle)
 {
   if (handle == NULL)
@@ -763,6 +1069,8 @@ tic_error * tic_restore_defaults(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   if (error == NULL)
@@ -779,33 +1087,7 @@ tic_error * tic_restore_defaults(tic_handle * handle)
   // Wait until the device succeeds in reinitializing its settings.
   if (error == NULL)
   {
-    time_t start = time(0);
-    while (true)
-    {
-      usleep(10000);
-
-      uint8_t not_initialized;
-      error = tic_get_setting_segment(handle, TIC_SETTING_NOT_INITIALIZED,
-        1, &not_initialized);
-      if (error != NULL)
-      {
-        // Communication error
-        break;
-      }
-
-      if (!not_initialized)
-      {
-        // Success
-        break;
-      }
-
-      if (difftime(time(0), start) >= 3)
-      {
-        // Time out after 2 to 3 seconds.
-        error = tic_error_create("The device took too long to finish.");
-        break;
-      }
-    }
+    error = tic_poll_until(handle, tic_settings_initialized, NULL, 3000);
   }
 
   if (error != NULL)
@@ -814,6 +1096,7 @@ tic_error * tic_restore_defaults(tic_handle * handle)
       "There was an error restoring the default settings.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -824,8 +1107,10 @@ tic_error * tic_reinitialize(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
-  tic_error * error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_REINITIALIZE, 0, 0, NULL, 0, NULL));
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_error * error = tic_control_transfer(handle,
+    0x40, TIC_CMD_REINITIALIZE, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -833,6 +1118,7 @@ tic_error * tic_reinitialize(tic_handle * handle)
       "There was an error reinitializing the device.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -843,8 +1129,10 @@ tic_error * tic_start_bootloader(tic_handle * handle)
     return tic_error_create("Handle is null.");
   }
 
-  tic_error * error = tic_usb_error(libusbp_control_transfer(handle->usb_handle,
-    0x40, TIC_CMD_START_BOOTLOADER, 0, 0, NULL, 0, NULL));
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_error * error = tic_control_transfer(handle,
+    0x40, TIC_CMD_START_BOOTLOADER, 0, 0, NULL, 0, NULL);
 
   if (error != NULL)
   {
@@ -852,6 +1140,7 @@ tic_error * tic_start_bootloader(tic_handle * handle)
       "There was an error starting the bootloader.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -872,16 +1161,13 @@ tic_error * tic_get_debug_data(tic_handle * handle, uint8_t * data, size_t * siz
     return tic_error_create("Size output pointer is null.");
   }
 
-  size_t transferred;
-  libusbp_error * usb_error = libusbp_control_transfer(handle->usb_handle,
-    0xC0, TIC_CMD_GET_DEBUG_DATA, 0, 0, data, *size, &transferred);
-  if (usb_error)
-  {
-    *size = 0;
-    return tic_usb_error(usb_error);
-  }
+  int64_t trace_start_us = tic_trace_begin();
 
-  *size = transferred;
+  size_t transferred = 0;
+  tic_error * error = tic_control_transfer(handle,
+    0xC0, TIC_CMD_GET_DEBUG_DATA, 0, 0, data, *size, &transferred);
+  *size = error ? 0 : transferred;
 
-  return NULL;
+  tic_trace_end(__func__, trace_start_us);
+  return error;
 }
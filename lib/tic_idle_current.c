@@ -0,0 +1,346 @@
+// Functions for lowering the current limit of motors that are not moving.
+//
+// The supervisor looks at the variables every time they are read through the
+// handle.  Once an energized motor has been still for the idle time, it sends
+// the lower current limit.  Every request sent through the handle passes
+// through tic_idle_current_before_request() first, so a command that can
+// start the motor moving puts the full current limit back before it is sent.
+// That costs one extra request, and only for the first such command.
+//
+// The motor is still if its velocity is 0 and the Tic is not about to move
+// it: it is not homing and its target position or velocity has been reached.
+// The time since the last step reported by the Tic lets us tell that a motor
+// has been still for a while the first time we see it.
+//
+// The heat that a coil makes is proportional to the square of its current,
+// so the savings are measured as the integral of the difference between the
+// squares of the full and idle currents.
+
+#include "tic_internal.h"
+
+struct tic_idle_current
+{
+  // The settings.
+  uint32_t idle_current_limit;
+  uint32_t idle_time_ms;
+
+  // True while we are sending a current limit ourselves.
+  bool sending;
+
+  // The time when we first saw the motor still, if it is still.
+  bool still;
+  int64_t still_since_us;
+
+  // What we did the last time we lowered the current limit.
+  bool reduced;
+  uint8_t full_code;
+  uint8_t idle_code;
+  uint32_t full_ma;
+  uint32_t idle_ma;
+  int64_t accounted_us;
+
+  // Totals.
+  uint64_t reduction_count;
+  uint64_t restore_count;
+  uint64_t reduced_us;
+  uint64_t total_restore_us;
+  uint64_t max_restore_us;
+  uint64_t error_count;
+  double saved_a2s;
+};
+
+tic_error * tic_idle_current_create(tic_idle_current ** idle)
+{
+  if (idle == NULL)
+  {
+    return tic_error_create("Idle current output pointer is null.");
+  }
+
+  *idle = calloc(1, sizeof(tic_idle_current));
+  if (*idle == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  return NULL;
+}
+
+void tic_idle_current_free(tic_idle_current * idle)
+{
+  free(idle);
+}
+
+tic_error * tic_idle_current_copy(const tic_idle_current * source,
+  tic_idle_current ** dest)
+{
+  if (dest == NULL)
+  {
+    return tic_error_create("Idle current output pointer is null.");
+  }
+
+  *dest = NULL;
+
+  if (source == NULL)
+  {
+    return NULL;
+  }
+
+  tic_idle_current * new_idle = malloc(sizeof(tic_idle_current));
+  if (new_idle == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  *new_idle = *source;
+  *dest = new_idle;
+  return NULL;
+}
+
+void tic_idle_current_configure(tic_idle_current * idle,
+  uint32_t idle_current_limit, uint32_t idle_time_ms)
+{
+  if (idle == NULL) { return; }
+  idle->idle_current_limit = idle_current_limit;
+  idle->idle_time_ms = idle_time_ms;
+}
+
+// Adds the time since the savings were last accounted for to the totals.
+void tic_idle_current_account(tic_idle_current * idle, int64_t now_us)
+{
+  if (idle == NULL || !idle->reduced) { return; }
+
+  int64_t elapsed_us = now_us - idle->accounted_us;
+  if (elapsed_us <= 0) { return; }
+
+  double full_a = idle->full_ma / 1000.0;
+  double idle_a = idle->idle_ma / 1000.0;
+  idle->reduced_us += elapsed_us;
+  idle->saved_a2s += (full_a * full_a - idle_a * idle_a) * elapsed_us / 1e6;
+  idle->accounted_us = now_us;
+}
+
+tic_error * tic_idle_current_restore(tic_idle_current * idle, tic_handle * handle)
+{
+  if (idle == NULL || !idle->reduced) { return NULL; }
+
+  int64_t start_us = tic_clock_us();
+  idle->sending = true;
+  tic_error * error = tic_set_current_limit_code(handle, idle->full_code);
+  idle->sending = false;
+  int64_t latency_us = tic_clock_us() - start_us;
+
+  if (error != NULL)
+  {
+    return tic_error_add(error,
+      "There was an error restoring the full current limit.");
+  }
+
+  tic_idle_current_account(idle, start_us);
+  idle->reduced = false;
+  idle->still = false;
+  idle->restore_count++;
+  idle->total_restore_us += latency_us;
+  if ((uint64_t)latency_us > idle->max_restore_us)
+  {
+    idle->max_restore_us = latency_us;
+  }
+  return NULL;
+}
+
+tic_error * tic_idle_current_before_request(tic_idle_current * idle,
+  tic_handle * handle, uint8_t request)
+{
+  if (idle == NULL || idle->sending) { return NULL; }
+
+  switch (request)
+  {
+  case TIC_CMD_SET_TARGET_POSITION:
+  case TIC_CMD_SET_TARGET_VELOCITY:
+  case TIC_CMD_GO_HOME:
+  case TIC_CMD_ENERGIZE:
+  case TIC_CMD_EXIT_SAFE_START:
+    // Energizing the motor or exiting safe start can let the Tic start moving
+    // toward a target it already has.
+    idle->still = false;
+    return tic_idle_current_restore(idle, handle);
+
+  case TIC_CMD_SET_CURRENT_LIMIT:
+    // Someone else is choosing the current limit, so it becomes the full
+    // current limit and we forget the one we saved.
+    tic_idle_current_account(idle, tic_clock_us());
+    idle->reduced = false;
+    idle->still = false;
+    return NULL;
+
+  default:
+    return NULL;
+  }
+}
+
+static bool tic_idle_current_motor_still(const tic_variables * variables)
+{
+  if (!tic_variables_get_energized(variables)) { return false; }
+  if (tic_variables_get_current_velocity(variables) != 0) { return false; }
+  if (tic_variables_get_homing_active(variables)) { return false; }
+
+  switch (tic_variables_get_planning_mode(variables))
+  {
+  case TIC_PLANNING_MODE_TARGET_POSITION:
+    return tic_variables_get_current_position(variables) ==
+      tic_variables_get_target_position(variables);
+  case TIC_PLANNING_MODE_TARGET_VELOCITY:
+    return tic_variables_get_target_velocity(variables) == 0;
+  default:
+    return true;
+  }
+}
+
+// Errors in tic_idle_current_check() should not make reading the variables
+// fail, so they are counted instead.
+static void tic_idle_current_count_error(tic_idle_current * idle,
+  tic_error * error)
+{
+  if (error == NULL) { return; }
+  idle->error_count++;
+  tic_error_free(error);
+}
+
+void tic_idle_current_check(tic_idle_current * idle,
+  tic_handle * handle, const tic_variables * variables)
+{
+  if (idle == NULL || idle->sending) { return; }
+
+  int64_t now_us = tic_clock_us();
+  bool still = tic_idle_current_motor_still(variables);
+  uint8_t code = tic_variables_get_current_limit_code(variables);
+
+  if (idle->reduced)
+  {
+    if (code != idle->idle_code)
+    {
+      // The current limit was changed without going through this handle.
+      tic_idle_current_account(idle, now_us);
+      idle->reduced = false;
+      idle->still = false;
+      return;
+    }
+
+    // The motor moved without a command from this handle (e.g. from the STEP
+    // input or another program), so all we can do is catch up.
+    if (!still)
+    {
+      tic_idle_current_count_error(idle,
+        tic_idle_current_restore(idle, handle));
+      return;
+    }
+
+    tic_idle_current_account(idle, now_us);
+    return;
+  }
+
+  if (!still)
+  {
+    idle->still = false;
+    return;
+  }
+
+  if (!idle->still)
+  {
+    // The time since the last step is in units of 1/3 microseconds.
+    idle->still = true;
+    idle->still_since_us = now_us -
+      tic_variables_get_time_since_last_step(variables) / 3;
+  }
+
+  if (now_us - idle->still_since_us < (int64_t)idle->idle_time_ms * 1000)
+  {
+    return;
+  }
+
+  uint8_t product = tic_device_get_product(tic_handle_get_device(handle));
+  uint8_t idle_code = tic_current_limit_ma_to_code(product,
+    idle->idle_current_limit);
+  uint32_t full_ma = tic_current_limit_code_to_ma(product, code);
+  uint32_t idle_ma = tic_current_limit_code_to_ma(product, idle_code);
+  if (idle_ma >= full_ma) { return; }
+
+  idle->sending = true;
+  tic_error * error = tic_set_current_limit_code(handle, idle_code);
+  idle->sending = false;
+
+  if (error != NULL)
+  {
+    // We will try again the next time the variables are read.
+    tic_idle_current_count_error(idle, error);
+    return;
+  }
+
+  idle->reduced = true;
+  idle->full_code = code;
+  idle->idle_code = idle_code;
+  idle->full_ma = full_ma;
+  idle->idle_ma = idle_ma;
+  idle->accounted_us = now_us;
+  idle->reduction_count++;
+  return;
+}
+
+bool tic_idle_current_get_reduced(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return false; }
+  return idle->reduced;
+}
+
+uint32_t tic_idle_current_get_full_current_limit(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->full_ma;
+}
+
+uint32_t tic_idle_current_get_idle_current_limit(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->idle_ma;
+}
+
+uint64_t tic_idle_current_get_reduction_count(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->reduction_count;
+}
+
+uint64_t tic_idle_current_get_restore_count(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->restore_count;
+}
+
+uint64_t tic_idle_current_get_reduced_us(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->reduced_us;
+}
+
+double tic_idle_current_get_saved_a2s(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->saved_a2s;
+}
+
+uint64_t tic_idle_current_get_total_restore_us(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->total_restore_us;
+}
+
+uint64_t tic_idle_current_get_max_restore_us(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->max_restore_us;
+}
+
+uint64_t tic_idle_current_get_error_count(const tic_idle_current * idle)
+{
+  if (idle == NULL) { return 0; }
+  return idle->error_count;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <tic.h>
+#include <tic_usb.h>
 #include <config.h>
 
 #include <libusbp.h>
@@ -80,6 +81,18 @@ extern const tic_name tic_hp_driver_error_names_ui[];
 
 void tic_variables_set_from_device(tic_variables *, const uint8_t * buffer);
 
+tic_error * tic_variables_create(tic_variables ** variables);
+
+// The size of the tic_variables struct, for code that stores copies of it.
+extern const size_t tic_variables_size;
+
+
+// Internal clock functions.
+
+int64_t tic_clock_us(void);
+int64_t tic_clock_ns(void);
+void tic_sleep_until_ns(int64_t deadline_ns);
+
 
 // Internal settings conversion functions.
 
@@ -92,6 +105,10 @@ uint16_t tic_baud_rate_to_brg(uint32_t baud_rate);
 const libusbp_generic_interface *
 tic_device_get_generic_interface(const tic_device * device);
 
+tic_error * tic_device_create_replayed(const char * serial_number,
+  const char * os_id, uint8_t product, uint16_t firmware_version,
+  tic_device ** device);
+
 
 // Internal tic_handle functions.
 
@@ -105,6 +122,104 @@ tic_error * tic_get_variable_segment(tic_handle * handle,
   size_t index, size_t length, uint8_t * buf,
   bool clear_errors_occurred);
 
+void tic_handle_publish_variables(tic_handle * handle,
+  const tic_variables * variables);
+
+
+// Internal functions for waiting.
+
+// Checks whether we are done waiting.  If not, it can set interval_us to say
+// how long to sleep before checking again.
+typedef tic_error * tic_poll_function(tic_handle * handle, void * context,
+  bool * done, uint32_t * interval_us);
+
+// Calls the poll function until it says we are done, returns an error, or the
+// timeout (in milliseconds, or TIC_WAIT_FOREVER) passes.
+tic_error * tic_poll_until(tic_handle * handle, tic_poll_function * poll,
+  void * context, uint32_t timeout_ms);
+
+
+// Internal tic_stats functions.
+
+tic_error * tic_stats_create(tic_stats ** stats);
+
+void tic_stats_record(tic_stats * stats, uint8_t request,
+  uint64_t latency_us, const tic_error * error);
+
+
+// Internal tic_idle_current functions.
+
+tic_error * tic_idle_current_create(tic_idle_current ** idle);
+
+void tic_idle_current_configure(tic_idle_current * idle,
+  uint32_t idle_current_limit, uint32_t idle_time_ms);
+
+void tic_idle_current_account(tic_idle_current * idle, int64_t now_us);
+
+// Sends the full current limit if it was lowered.
+tic_error * tic_idle_current_restore(tic_idle_current * idle,
+  tic_handle * handle);
+
+// Called before each request is sent through the handle.
+tic_error * tic_idle_current_before_request(tic_idle_current * idle,
+  tic_handle * handle, uint8_t request);
+
+// Called each time variables are read through the handle.  Errors are
+// counted instead of returned so they do not make the read fail.
+void tic_idle_current_check(tic_idle_current * idle,
+  tic_handle * handle, const tic_variables * variables);
+
+
+// Internal tracing functions.  A traced function calls tic_trace_begin() and
+// passes the result to tic_trace_end(), which does nothing if tracing is off.
+
+int64_t tic_trace_begin(void);
+
+void tic_trace_end(const char * name, int64_t start_us);
+
+void tic_trace_end_transfer(int64_t start_us,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  uint16_t length, const tic_error * error);
+
+
+// Internal functions for recording and replaying USB transfers.
+
+tic_error * tic_recorder_add_device(const tic_device * device,
+  int * device_index);
+
+void tic_recorder_add_transfer(int device_index, int64_t start_us,
+  int64_t duration_us, uint8_t request_type, uint8_t request,
+  uint16_t value, uint16_t index, uint16_t length,
+  const void * buffer, size_t transferred, const tic_error * error);
+
+typedef struct tic_replay_device tic_replay_device;
+
+bool tic_replay_enabled(void);
+
+tic_error * tic_replay_list_devices(tic_device *** device_list,
+  size_t * device_count);
+
+tic_error * tic_replay_open(const tic_device * device,
+  tic_replay_device ** replay_device);
+
+tic_error * tic_replay_control_transfer(tic_replay_device * device,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred);
+
+
+// Internal functions for talking to ticd.
+
+typedef struct tic_daemon_connection tic_daemon_connection;
+
+tic_error * tic_daemon_connect(const char * socket_path,
+  const char * serial_number, tic_daemon_connection ** connection);
+
+void tic_daemon_disconnect(tic_daemon_connection * connection);
+
+tic_error * tic_daemon_control_transfer(tic_daemon_connection * connection,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred);
+
 
 // Error creation functions.
 
@@ -0,0 +1,534 @@
+// Functions for switching the step mode with the speed of the motor.
+//
+// The Tic counts positions, speeds, and accelerations in whatever microsteps
+// the current step mode uses, and it does not convert them when the step mode
+// changes.  The scheduler hides this by working in microsteps of the base
+// step mode.  It remembers a pair of positions, one in the Tic's units and one
+// in base microsteps, from the last time the step mode changed, and converts
+// targets and limits with the ratio between the base step mode and the current
+// one.
+//
+// After a change, the Tic's current velocity counts bigger or smaller steps
+// than it did before, so the motor would suddenly speed up or slow down.  To
+// keep it going at the same speed, the scheduler briefly limits the Tic to the
+// converted speed with the highest acceleration the Tic allows, and puts the
+// normal limits back on the next update.
+
+#include "tic_internal.h"
+
+typedef struct tic_microstep_level
+{
+  uint8_t step_mode;
+  uint64_t speed;
+
+  // The number of base microsteps in one microstep of this step mode.
+  uint32_t scale;
+} tic_microstep_level;
+
+struct tic_microstep_scheduler
+{
+  tic_microstep_level levels[TIC_MICROSTEP_MAX_LEVELS];
+  size_t level_count;
+  uint8_t hysteresis_percent;
+
+  uint64_t max_speed;
+  uint64_t max_accel;
+  uint64_t max_decel;
+
+  bool started;
+  size_t level;
+  int32_t device_offset;
+  int64_t offset;
+  bool transient;
+  uint32_t switch_count;
+
+  // The last target, in base microsteps.
+  uint8_t planning_mode;
+  int64_t target;
+};
+
+// Gets the number of microsteps in a full step for the given step mode, or 0
+// if the step mode is not valid.
+static uint32_t tic_microstep_per_step(uint8_t step_mode)
+{
+  switch (step_mode)
+  {
+  case TIC_STEP_MODE_MICROSTEP1: return 1;
+  case TIC_STEP_MODE_MICROSTEP2: return 2;
+  case TIC_STEP_MODE_MICROSTEP2_100P: return 2;
+  case TIC_STEP_MODE_MICROSTEP4: return 4;
+  case TIC_STEP_MODE_MICROSTEP8: return 8;
+  case TIC_STEP_MODE_MICROSTEP16: return 16;
+  case TIC_STEP_MODE_MICROSTEP32: return 32;
+  case TIC_STEP_MODE_MICROSTEP64: return 64;
+  case TIC_STEP_MODE_MICROSTEP128: return 128;
+  case TIC_STEP_MODE_MICROSTEP256: return 256;
+  default: return 0;
+  }
+}
+
+tic_error * tic_microstep_scheduler_create(tic_microstep_scheduler ** scheduler)
+{
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler output pointer is null.");
+  }
+
+  *scheduler = NULL;
+
+  tic_microstep_scheduler * new_scheduler =
+    calloc(1, sizeof(tic_microstep_scheduler));
+  if (new_scheduler == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  new_scheduler->hysteresis_percent = 10;
+
+  *scheduler = new_scheduler;
+  return NULL;
+}
+
+void tic_microstep_scheduler_free(tic_microstep_scheduler * scheduler)
+{
+  free(scheduler);
+}
+
+tic_error * tic_microstep_scheduler_set_base_step_mode(
+  tic_microstep_scheduler * scheduler, uint8_t step_mode)
+{
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler is null.");
+  }
+
+  if (tic_microstep_per_step(step_mode) == 0)
+  {
+    return tic_error_create("Invalid step mode: %u.", step_mode);
+  }
+
+  tic_microstep_level * level = &scheduler->levels[0];
+  level->step_mode = step_mode;
+  level->speed = 0;
+  level->scale = 1;
+  scheduler->level_count = 1;
+  scheduler->started = false;
+  return NULL;
+}
+
+tic_error * tic_microstep_scheduler_add_level(
+  tic_microstep_scheduler * scheduler, uint8_t step_mode, uint64_t speed)
+{
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler is null.");
+  }
+
+  if (scheduler->level_count == 0)
+  {
+    return tic_error_create("The base step mode must be set first.");
+  }
+
+  if (scheduler->level_count >= TIC_MICROSTEP_MAX_LEVELS)
+  {
+    return tic_error_create("A microstep scheduler can have at most %u levels.",
+      TIC_MICROSTEP_MAX_LEVELS);
+  }
+
+  const tic_microstep_level * previous =
+    &scheduler->levels[scheduler->level_count - 1];
+  uint32_t base = tic_microstep_per_step(scheduler->levels[0].step_mode);
+  uint32_t per_step = tic_microstep_per_step(step_mode);
+  if (per_step == 0)
+  {
+    return tic_error_create("Invalid step mode: %u.", step_mode);
+  }
+
+  if (base % per_step != 0 || base / per_step <= previous->scale)
+  {
+    return tic_error_create(
+      "Each step mode must be coarser than the one before it.");
+  }
+
+  if (speed <= previous->speed)
+  {
+    return tic_error_create(
+      "Each step mode must start at a higher speed than the one before it.");
+  }
+
+  tic_microstep_level * level = &scheduler->levels[scheduler->level_count++];
+  level->step_mode = step_mode;
+  level->speed = speed;
+  level->scale = base / per_step;
+  scheduler->started = false;
+  return NULL;
+}
+
+void tic_microstep_scheduler_set_hysteresis_percent(
+  tic_microstep_scheduler * scheduler, uint8_t percent)
+{
+  if (scheduler == NULL) { return; }
+  scheduler->hysteresis_percent = percent > 100 ? 100 : percent;
+}
+
+uint8_t tic_microstep_scheduler_get_hysteresis_percent(
+  const tic_microstep_scheduler * scheduler)
+{
+  if (scheduler == NULL) { return 0; }
+  return scheduler->hysteresis_percent;
+}
+
+void tic_microstep_scheduler_set_limits(tic_microstep_scheduler * scheduler,
+  uint64_t max_speed, uint64_t max_accel, uint64_t max_decel)
+{
+  if (scheduler == NULL) { return; }
+  scheduler->max_speed = max_speed;
+  scheduler->max_accel = max_accel;
+  scheduler->max_decel = max_decel ? max_decel : max_accel;
+}
+
+static uint32_t tic_microstep_clamp(uint64_t value, uint32_t min, uint32_t max)
+{
+  if (value < min) { return min; }
+  if (value > max) { return max; }
+  return (uint32_t)value;
+}
+
+static tic_error * tic_microstep_send_limits(tic_handle * handle,
+  uint32_t max_speed, uint32_t max_accel, uint32_t max_decel)
+{
+  tic_error * error = tic_set_max_speed(handle, max_speed);
+  if (error == NULL)
+  {
+    error = tic_set_max_accel(handle, max_accel);
+  }
+  if (error == NULL)
+  {
+    error = tic_set_max_decel(handle, max_decel);
+  }
+  return error;
+}
+
+// Sends the limits for the current step mode.
+static tic_error * tic_microstep_send_normal_limits(
+  const tic_microstep_scheduler * scheduler, tic_handle * handle)
+{
+  uint32_t scale = scheduler->levels[scheduler->level].scale;
+  return tic_microstep_send_limits(handle,
+    tic_microstep_clamp(scheduler->max_speed / scale,
+      0, TIC_MAX_ALLOWED_SPEED),
+    tic_microstep_clamp(scheduler->max_accel / scale,
+      TIC_MIN_ALLOWED_ACCEL, TIC_MAX_ALLOWED_ACCEL),
+    tic_microstep_clamp(scheduler->max_decel / scale,
+      TIC_MIN_ALLOWED_ACCEL, TIC_MAX_ALLOWED_ACCEL));
+}
+
+// Sends the last target, converted to the current step mode.
+static tic_error * tic_microstep_send_target(
+  const tic_microstep_scheduler * scheduler, tic_handle * handle)
+{
+  int64_t scale = scheduler->levels[scheduler->level].scale;
+  if (scheduler->planning_mode == TIC_PLANNING_MODE_TARGET_POSITION)
+  {
+    int64_t distance = scheduler->target - scheduler->offset;
+    int64_t steps = (distance >= 0 ? distance + scale / 2 :
+      distance - scale / 2) / scale;
+    return tic_set_target_position(handle,
+      (int32_t)((uint32_t)scheduler->device_offset + (uint32_t)steps));
+  }
+  if (scheduler->planning_mode == TIC_PLANNING_MODE_TARGET_VELOCITY)
+  {
+    int64_t velocity = scheduler->target / scale;
+    if (velocity > TIC_MAX_ALLOWED_SPEED) { velocity = TIC_MAX_ALLOWED_SPEED; }
+    if (velocity < -TIC_MAX_ALLOWED_SPEED) { velocity = -TIC_MAX_ALLOWED_SPEED; }
+    return tic_set_target_velocity(handle, (int32_t)velocity);
+  }
+  return NULL;
+}
+
+tic_error * tic_microstep_scheduler_start(tic_microstep_scheduler * scheduler,
+  tic_handle * handle)
+{
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler is null.");
+  }
+
+  if (scheduler->level_count == 0)
+  {
+    return tic_error_create("The base step mode has not been set.");
+  }
+
+  tic_error * error = NULL;
+
+  scheduler->level = 0;
+  scheduler->transient = false;
+  scheduler->planning_mode = TIC_PLANNING_MODE_OFF;
+  scheduler->switch_count = 0;
+
+  error = tic_set_step_mode(handle, scheduler->levels[0].step_mode);
+
+  uint8_t buffer[4];
+  if (error == NULL)
+  {
+    error = tic_get_variable_segment(handle, TIC_VAR_CURRENT_POSITION,
+      sizeof(buffer), buffer, false);
+  }
+
+  if (error == NULL)
+  {
+    scheduler->device_offset = read_i32(buffer);
+    scheduler->offset = scheduler->device_offset;
+    error = tic_microstep_send_normal_limits(scheduler, handle);
+  }
+
+  if (error == NULL)
+  {
+    scheduler->started = true;
+  }
+  else
+  {
+    error = tic_error_add(error,
+      "There was an error starting the microstep scheduler.");
+  }
+
+  return error;
+}
+
+static tic_error * tic_microstep_set_target(
+  tic_microstep_scheduler * scheduler, tic_handle * handle,
+  uint8_t planning_mode, int64_t target)
+{
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler is null.");
+  }
+
+  if (!scheduler->started)
+  {
+    return tic_error_create("The microstep scheduler has not been started.");
+  }
+
+  scheduler->planning_mode = planning_mode;
+  scheduler->target = target;
+  return tic_microstep_send_target(scheduler, handle);
+}
+
+tic_error * tic_microstep_scheduler_set_target_position(
+  tic_microstep_scheduler * scheduler, tic_handle * handle, int64_t position)
+{
+  return tic_microstep_set_target(scheduler, handle,
+    TIC_PLANNING_MODE_TARGET_POSITION, position);
+}
+
+tic_error * tic_microstep_scheduler_set_target_velocity(
+  tic_microstep_scheduler * scheduler, tic_handle * handle, int64_t velocity)
+{
+  return tic_microstep_set_target(scheduler, handle,
+    TIC_PLANNING_MODE_TARGET_VELOCITY, velocity);
+}
+
+// Changes to the given level, using the variables read just before.
+static tic_error * tic_microstep_switch(tic_microstep_scheduler * scheduler,
+  tic_handle * handle, const tic_variables * variables, size_t level)
+{
+  uint32_t old_scale = scheduler->levels[scheduler->level].scale;
+  uint32_t new_scale = scheduler->levels[level].scale;
+  int32_t before = tic_variables_get_current_position(variables);
+  int32_t velocity = tic_variables_get_current_velocity(variables);
+
+  tic_error * error = tic_set_step_mode(handle, scheduler->levels[level].step_mode);
+
+  uint8_t buffer[4];
+  if (error == NULL)
+  {
+    error = tic_get_variable_segment(handle, TIC_VAR_CURRENT_POSITION,
+      sizeof(buffer), buffer, false);
+  }
+
+  if (error != NULL) { return error; }
+
+  // The step mode changed somewhere between the two readings of the position,
+  // so we count half of the steps in between as steps of the old step mode.
+  int32_t after = read_i32(buffer);
+  int32_t switch_position = (int32_t)((uint32_t)before +
+    (uint32_t)(((int64_t)after - before) / 2));
+  scheduler->offset += ((int64_t)switch_position - scheduler->device_offset) *
+    old_scale;
+  scheduler->device_offset = switch_position;
+  scheduler->level = level;
+  scheduler->switch_count++;
+
+  if (velocity == 0)
+  {
+    error = tic_microstep_send_normal_limits(scheduler, handle);
+  }
+  else
+  {
+    uint64_t speed = (uint64_t)(velocity < 0 ? -(int64_t)velocity : velocity) *
+      old_scale / new_scale;
+    uint32_t normal_max_speed = tic_microstep_clamp(
+      scheduler->max_speed / new_scale, 0, TIC_MAX_ALLOWED_SPEED);
+    uint32_t accel = tic_microstep_clamp(scheduler->max_accel / new_scale,
+      TIC_MIN_ALLOWED_ACCEL, TIC_MAX_ALLOWED_ACCEL);
+    uint32_t decel = tic_microstep_clamp(scheduler->max_decel / new_scale,
+      TIC_MIN_ALLOWED_ACCEL, TIC_MAX_ALLOWED_ACCEL);
+
+    // Only raise the limit that gets the velocity counter to the new speed
+    // so the Tic does not stop abruptly if it needs to slow down.
+    if (new_scale > old_scale) { decel = TIC_MAX_ALLOWED_ACCEL; }
+    else { accel = TIC_MAX_ALLOWED_ACCEL; }
+
+    error = tic_microstep_send_limits(handle,
+      tic_microstep_clamp(speed, 0, normal_max_speed), accel, decel);
+    scheduler->transient = true;
+  }
+
+  if (error == NULL)
+  {
+    error = tic_microstep_send_target(scheduler, handle);
+  }
+
+  return error;
+}
+
+// Makes the Tic's position match the position in base microsteps again, so
+// that other software sees the right position.  This is only safe while the
+// motor is resting at its target in the base step mode.
+static tic_error * tic_microstep_realign(tic_microstep_scheduler * scheduler,
+  tic_handle * handle, const tic_variables * variables)
+{
+  int64_t position = tic_microstep_scheduler_get_position(scheduler, variables);
+  if (position < INT32_MIN || position > INT32_MAX) { return NULL; }
+
+  tic_error * error = tic_halt_and_set_position(handle, (int32_t)position);
+  if (error == NULL)
+  {
+    scheduler->offset = position;
+    scheduler->device_offset = (int32_t)position;
+    error = tic_microstep_send_target(scheduler, handle);
+  }
+  return error;
+}
+
+tic_error * tic_microstep_scheduler_update(tic_microstep_scheduler * scheduler,
+  tic_handle * handle, tic_variables ** variables)
+{
+  if (variables) { *variables = NULL; }
+
+  if (scheduler == NULL)
+  {
+    return tic_error_create("Microstep scheduler is null.");
+  }
+
+  if (!scheduler->started)
+  {
+    return tic_error_create("The microstep scheduler has not been started.");
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_error * error = NULL;
+
+  tic_variables * new_variables = NULL;
+  error = tic_get_variables(handle, &new_variables, false);
+  bool changed = false;
+
+  if (error == NULL && scheduler->transient)
+  {
+    scheduler->transient = false;
+    error = tic_microstep_send_normal_limits(scheduler, handle);
+  }
+
+  if (error == NULL)
+  {
+    int32_t velocity = tic_variables_get_current_velocity(new_variables);
+    uint64_t speed = (uint64_t)(velocity < 0 ? -(int64_t)velocity : velocity) *
+      scheduler->levels[scheduler->level].scale;
+
+    // Go to a coarser step mode as soon as we are fast enough, but wait until
+    // we are a little slower than that before going back.
+    size_t level = scheduler->level;
+    while (level + 1 < scheduler->level_count &&
+      speed >= scheduler->levels[level + 1].speed)
+    {
+      level++;
+    }
+    while (level > 0 && speed < scheduler->levels[level].speed *
+      (100 - scheduler->hysteresis_percent) / 100)
+    {
+      level--;
+    }
+
+    if (level != scheduler->level)
+    {
+      error = tic_microstep_switch(scheduler, handle, new_variables, level);
+      changed = true;
+    }
+    else if (level == 0 && velocity == 0 &&
+      scheduler->offset != scheduler->device_offset &&
+      scheduler->planning_mode == TIC_PLANNING_MODE_TARGET_POSITION &&
+      tic_variables_get_current_position(new_variables) ==
+      tic_variables_get_target_position(new_variables))
+    {
+      error = tic_microstep_realign(scheduler, handle, new_variables);
+      changed = true;
+    }
+  }
+
+  // Our variables are from before the changes, so read them again.
+  if (error == NULL && changed && variables)
+  {
+    tic_variables_free(new_variables);
+    new_variables = NULL;
+    error = tic_get_variables(handle, &new_variables, false);
+  }
+
+  if (error == NULL && variables)
+  {
+    *variables = new_variables;
+    new_variables = NULL;
+  }
+
+  tic_variables_free(new_variables);
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error,
+      "There was an error updating the microstep scheduler.");
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
+
+int64_t tic_microstep_scheduler_get_position(
+  const tic_microstep_scheduler * scheduler, const tic_variables * variables)
+{
+  if (scheduler == NULL || scheduler->level_count == 0) { return 0; }
+  int32_t position = tic_variables_get_current_position(variables);
+  return scheduler->offset + ((int64_t)position - scheduler->device_offset) *
+    scheduler->levels[scheduler->level].scale;
+}
+
+int64_t tic_microstep_scheduler_get_velocity(
+  const tic_microstep_scheduler * scheduler, const tic_variables * variables)
+{
+  if (scheduler == NULL || scheduler->level_count == 0) { return 0; }
+  return (int64_t)tic_variables_get_current_velocity(variables) *
+    scheduler->levels[scheduler->level].scale;
+}
+
+uint8_t tic_microstep_scheduler_get_step_mode(
+  const tic_microstep_scheduler * scheduler)
+{
+  if (scheduler == NULL || scheduler->level_count == 0) { return 0; }
+  return scheduler->levels[scheduler->level].step_mode;
+}
+
+uint32_t tic_microstep_scheduler_get_switch_count(
+  const tic_microstep_scheduler * scheduler)
+{
+  if (scheduler == NULL) { return 0; }
+  return scheduler->switch_count;
+}
@@ -0,0 +1,505 @@
+// Functions for predicting how the Tic will move the motor.
+//
+// The Tic's planner changes the velocity at a constant rate: the maximum
+// acceleration when the speed is increasing, and the maximum deceleration when
+// it is decreasing.  It can change the velocity instantly between zero and the
+// starting speed.  In position mode, it starts decelerating just in time to
+// stop at the target, and if it cannot stop in time, it overshoots and comes
+// back.
+//
+// Instead of simulating that step by step, we plan the whole motion as a short
+// list of phases with constant acceleration, which lets us predict the state
+// at any time in the future with a few multiplications.
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+// A plan never needs more phases than this, even when the motor has to slow
+// down to the max speed, stop, and come back from an overshoot.
+#define TIC_MOTION_MAX_PHASES 8
+
+struct tic_motion
+{
+  uint8_t planning_mode;
+  int32_t target_position;
+  int32_t target_velocity;
+  uint32_t starting_speed;
+  uint32_t max_speed;
+  uint32_t max_accel;
+  uint32_t max_decel;
+
+  // Fractional microsteps, so tic_motion_advance() does not accumulate
+  // rounding errors.
+  double position;
+
+  // Microsteps per second.
+  double velocity;
+};
+
+// All velocities are in microsteps per second and all accelerations are in
+// microsteps per second per second.
+typedef struct tic_motion_phase
+{
+  // The velocity at the start of the phase.  It can be different from the
+  // velocity at the end of the previous phase because of an instant change.
+  double start_velocity;
+  double accel;
+  double duration;
+} tic_motion_phase;
+
+typedef struct tic_motion_plan
+{
+  tic_motion_phase phases[TIC_MOTION_MAX_PHASES];
+  size_t phase_count;
+
+  // The velocity after the last phase, which lasts forever.
+  double final_velocity;
+
+  // True if the motor will never reach the target.
+  bool unreachable;
+} tic_motion_plan;
+
+// The parameters of the motion in microsteps and seconds.  An acceleration of
+// 0 means that the velocity changes instantly.
+typedef struct tic_motion_limits
+{
+  double starting_speed;
+  double max_speed;
+  double accel;
+  double decel;
+} tic_motion_limits;
+
+static double tic_motion_sign(double x)
+{
+  return x < 0 ? -1 : 1;
+}
+
+// Adds a phase that changes the velocity from *v to the given velocity at the
+// given rate, and updates *x and *v to the state at the end of it.
+static void tic_motion_ramp(tic_motion_plan * plan, double * x, double * v,
+  double new_velocity, double rate)
+{
+  if (new_velocity == *v) { return; }
+  if (rate > 0 && plan->phase_count < TIC_MOTION_MAX_PHASES)
+  {
+    tic_motion_phase * phase = &plan->phases[plan->phase_count++];
+    phase->start_velocity = *v;
+    phase->accel = new_velocity > *v ? rate : -rate;
+    phase->duration = fabs(new_velocity - *v) / rate;
+    *x += (*v + new_velocity) / 2 * phase->duration;
+  }
+  *v = new_velocity;
+}
+
+// Adds a phase with constant velocity that covers the given distance.
+static void tic_motion_cruise(tic_motion_plan * plan, double * x, double v,
+  double distance)
+{
+  if (distance <= 0 || v == 0) { return; }
+  if (plan->phase_count < TIC_MOTION_MAX_PHASES)
+  {
+    tic_motion_phase * phase = &plan->phases[plan->phase_count++];
+    phase->start_velocity = v;
+    phase->accel = 0;
+    phase->duration = distance / fabs(v);
+  }
+  *x += distance * tic_motion_sign(v);
+}
+
+// The distance it takes to change speed from one value to another, where both
+// speeds are positive.
+static double tic_motion_ramp_distance(double from, double to, double rate)
+{
+  if (rate <= 0) { return 0; }
+  return fabs(to * to - from * from) / (2 * rate);
+}
+
+static void tic_motion_plan_position(tic_motion_plan * plan,
+  const tic_motion_limits * limits, double x, double v, double target)
+{
+  double vs = limits->starting_speed;
+  double vmax = limits->max_speed;
+  double a = limits->accel;
+  double d = limits->decel;
+
+  // Each pass handles a situation that needs to be fixed before the final
+  // approach, like moving away from the target, so a few passes is enough.
+  for (int pass = 0; pass < 4; pass++)
+  {
+    double distance = fabs(target - x);
+    if (distance < 1e-9 && fabs(v) <= vs) { break; }
+
+    double dir = distance < 1e-9 ? tic_motion_sign(v) : tic_motion_sign(target - x);
+    double speed = v * dir;
+
+    if (speed < 0)
+    {
+      // Moving away from the target: slow down, stop, and turn around.
+      if (-speed > vs) { tic_motion_ramp(plan, &x, &v, -dir * vs, d); }
+      v = 0;
+      continue;
+    }
+
+    if (speed > vmax)
+    {
+      // The max speed was lowered while moving.
+      tic_motion_ramp(plan, &x, &v, dir * vmax, d);
+      continue;
+    }
+
+    if (speed > vs && tic_motion_ramp_distance(speed, vs, d) > distance + 1e-9)
+    {
+      // Too fast to stop at the target: overshoot and come back.
+      tic_motion_ramp(plan, &x, &v, dir * vs, d);
+      v = 0;
+      continue;
+    }
+
+    // Final approach: accelerate to a peak speed, cruise, and decelerate so
+    // the speed gets to the starting speed right at the target.
+    double start = speed < vs ? vs : speed;
+    double inv_2a = a > 0 ? 1 / (2 * a) : 0;
+    double inv_2d = d > 0 ? 1 / (2 * d) : 0;
+    double peak = vmax;
+    if (inv_2a + inv_2d > 0)
+    {
+      peak = sqrt((distance + start * start * inv_2a + vs * vs * inv_2d) /
+        (inv_2a + inv_2d));
+    }
+    if (peak > vmax) { peak = vmax; }
+    if (peak < start) { peak = start; }
+    if (peak <= 0)
+    {
+      plan->unreachable = true;
+      break;
+    }
+
+    v = dir * start;
+    tic_motion_ramp(plan, &x, &v, dir * peak, a);
+    double cruise = distance - tic_motion_ramp_distance(start, peak, a) -
+      tic_motion_ramp_distance(vs, peak, d);
+    tic_motion_cruise(plan, &x, v, cruise);
+    tic_motion_ramp(plan, &x, &v, dir * vs, d);
+    x = target;
+    v = 0;
+    break;
+  }
+
+  plan->final_velocity = 0;
+}
+
+static void tic_motion_plan_velocity(tic_motion_plan * plan,
+  const tic_motion_limits * limits, double x, double v, double target)
+{
+  double vs = limits->starting_speed;
+
+  if (target > limits->max_speed) { target = limits->max_speed; }
+  if (target < -limits->max_speed) { target = -limits->max_speed; }
+
+  if (v != 0 && (target == 0 || tic_motion_sign(target) != tic_motion_sign(v)))
+  {
+    // Slow down and stop before going the other way.
+    if (fabs(v) > vs) { tic_motion_ramp(plan, &x, &v, tic_motion_sign(v) * vs,
+        limits->decel); }
+    v = 0;
+  }
+
+  if (fabs(target) > fabs(v))
+  {
+    // Speed up, starting at the starting speed.
+    if (fabs(v) < vs)
+    {
+      v = tic_motion_sign(target) * (fabs(target) < vs ? fabs(target) : vs);
+    }
+    tic_motion_ramp(plan, &x, &v, target, limits->accel);
+  }
+  else
+  {
+    // Slow down, stopping instantly once we get below the starting speed.
+    double slowest = fabs(target) < vs ? tic_motion_sign(v) * vs : target;
+    if (fabs(v) > fabs(slowest))
+    {
+      tic_motion_ramp(plan, &x, &v, slowest, limits->decel);
+    }
+  }
+
+  plan->final_velocity = target;
+}
+
+static void tic_motion_get_plan(const tic_motion * motion,
+  tic_motion_plan * plan)
+{
+  memset(plan, 0, sizeof(tic_motion_plan));
+
+  tic_motion_limits limits;
+  limits.max_speed = (double)motion->max_speed / TIC_SPEED_UNITS_PER_HZ;
+  limits.starting_speed = (double)motion->starting_speed / TIC_SPEED_UNITS_PER_HZ;
+  if (limits.starting_speed > limits.max_speed)
+  {
+    limits.starting_speed = limits.max_speed;
+  }
+  limits.accel = (double)motion->max_accel / TIC_ACCEL_UNITS_PER_HZ2;
+  limits.decel = (double)(motion->max_decel ? motion->max_decel :
+    motion->max_accel) / TIC_ACCEL_UNITS_PER_HZ2;
+
+  switch (motion->planning_mode)
+  {
+  case TIC_PLANNING_MODE_TARGET_POSITION:
+    tic_motion_plan_position(plan, &limits, motion->position, motion->velocity,
+      motion->target_position);
+    break;
+
+  case TIC_PLANNING_MODE_TARGET_VELOCITY:
+    tic_motion_plan_velocity(plan, &limits, motion->position, motion->velocity,
+      (double)motion->target_velocity / TIC_SPEED_UNITS_PER_HZ);
+    break;
+
+  default:
+    // The motor is stopping.
+    tic_motion_plan_velocity(plan, &limits, motion->position, motion->velocity, 0);
+    break;
+  }
+}
+
+// Computes the position and velocity at the given time in seconds.
+static void tic_motion_evaluate(const tic_motion * motion, double t,
+  double * position, double * velocity)
+{
+  tic_motion_plan plan;
+  tic_motion_get_plan(motion, &plan);
+
+  double x = motion->position;
+  for (size_t i = 0; i < plan.phase_count; i++)
+  {
+    const tic_motion_phase * phase = &plan.phases[i];
+    if (t < phase->duration)
+    {
+      *position = x + phase->start_velocity * t + phase->accel * t * t / 2;
+      *velocity = phase->start_velocity + phase->accel * t;
+      return;
+    }
+    x += phase->start_velocity * phase->duration +
+      phase->accel * phase->duration * phase->duration / 2;
+    t -= phase->duration;
+  }
+
+  // Position mode plans end exactly at the target.
+  if (motion->planning_mode == TIC_PLANNING_MODE_TARGET_POSITION &&
+    !plan.unreachable)
+  {
+    x = motion->target_position;
+  }
+
+  *position = x + plan.final_velocity * t;
+  *velocity = plan.final_velocity;
+}
+
+tic_error * tic_motion_create(tic_motion ** motion)
+{
+  if (motion == NULL)
+  {
+    return tic_error_create("Motion output pointer is null.");
+  }
+
+  *motion = calloc(1, sizeof(tic_motion));
+  if (*motion == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  return NULL;
+}
+
+tic_error * tic_motion_copy(const tic_motion * source, tic_motion ** dest)
+{
+  if (dest == NULL)
+  {
+    return tic_error_create("Motion output pointer is null.");
+  }
+
+  *dest = NULL;
+
+  if (source == NULL)
+  {
+    return NULL;
+  }
+
+  tic_motion * new_motion = malloc(sizeof(tic_motion));
+  if (new_motion == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  memcpy(new_motion, source, sizeof(tic_motion));
+  *dest = new_motion;
+  return NULL;
+}
+
+void tic_motion_free(tic_motion * motion)
+{
+  free(motion);
+}
+
+void tic_motion_set_from_variables(tic_motion * motion,
+  const tic_variables * variables)
+{
+  if (motion == NULL || variables == NULL) { return; }
+  motion->planning_mode = tic_variables_get_planning_mode(variables);
+  motion->target_position = tic_variables_get_target_position(variables);
+  motion->target_velocity = tic_variables_get_target_velocity(variables);
+  motion->starting_speed = tic_variables_get_starting_speed(variables);
+  motion->max_speed = tic_variables_get_max_speed(variables);
+  motion->max_accel = tic_variables_get_max_accel(variables);
+  motion->max_decel = tic_variables_get_max_decel(variables);
+  motion->position = tic_variables_get_current_position(variables);
+  motion->velocity = (double)tic_variables_get_current_velocity(variables) /
+    TIC_SPEED_UNITS_PER_HZ;
+}
+
+void tic_motion_set_planning_mode(tic_motion * motion, uint8_t mode)
+{
+  if (motion == NULL) { return; }
+  motion->planning_mode = mode;
+}
+
+uint8_t tic_motion_get_planning_mode(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->planning_mode;
+}
+
+void tic_motion_set_target_position(tic_motion * motion, int32_t position)
+{
+  if (motion == NULL) { return; }
+  motion->planning_mode = TIC_PLANNING_MODE_TARGET_POSITION;
+  motion->target_position = position;
+}
+
+int32_t tic_motion_get_target_position(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->target_position;
+}
+
+void tic_motion_set_target_velocity(tic_motion * motion, int32_t velocity)
+{
+  if (motion == NULL) { return; }
+  motion->planning_mode = TIC_PLANNING_MODE_TARGET_VELOCITY;
+  motion->target_velocity = velocity;
+}
+
+int32_t tic_motion_get_target_velocity(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->target_velocity;
+}
+
+void tic_motion_set_starting_speed(tic_motion * motion, uint32_t speed)
+{
+  if (motion == NULL) { return; }
+  motion->starting_speed = speed;
+}
+
+uint32_t tic_motion_get_starting_speed(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->starting_speed;
+}
+
+void tic_motion_set_max_speed(tic_motion * motion, uint32_t speed)
+{
+  if (motion == NULL) { return; }
+  motion->max_speed = speed;
+}
+
+uint32_t tic_motion_get_max_speed(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->max_speed;
+}
+
+void tic_motion_set_max_accel(tic_motion * motion, uint32_t accel)
+{
+  if (motion == NULL) { return; }
+  motion->max_accel = accel;
+}
+
+uint32_t tic_motion_get_max_accel(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->max_accel;
+}
+
+void tic_motion_set_max_decel(tic_motion * motion, uint32_t decel)
+{
+  if (motion == NULL) { return; }
+  motion->max_decel = decel;
+}
+
+uint32_t tic_motion_get_max_decel(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return motion->max_decel;
+}
+
+void tic_motion_set_current_position(tic_motion * motion, int32_t position)
+{
+  if (motion == NULL) { return; }
+  motion->position = position;
+}
+
+int32_t tic_motion_get_current_position(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return (int32_t)floor(motion->position + 0.5);
+}
+
+void tic_motion_set_current_velocity(tic_motion * motion, int32_t velocity)
+{
+  if (motion == NULL) { return; }
+  motion->velocity = (double)velocity / TIC_SPEED_UNITS_PER_HZ;
+}
+
+int32_t tic_motion_get_current_velocity(const tic_motion * motion)
+{
+  if (motion == NULL) { return 0; }
+  return (int32_t)floor(motion->velocity * TIC_SPEED_UNITS_PER_HZ + 0.5);
+}
+
+void tic_motion_predict(const tic_motion * motion, int64_t time_us,
+  int32_t * position, int32_t * velocity)
+{
+  double x = 0, v = 0;
+  if (motion != NULL)
+  {
+    tic_motion_evaluate(motion, time_us / 1e6, &x, &v);
+  }
+  if (position) { *position = (int32_t)floor(x + 0.5); }
+  if (velocity) { *velocity = (int32_t)floor(v * TIC_SPEED_UNITS_PER_HZ + 0.5); }
+}
+
+void tic_motion_advance(tic_motion * motion, int64_t time_us)
+{
+  if (motion == NULL) { return; }
+  double x, v;
+  tic_motion_evaluate(motion, time_us / 1e6, &x, &v);
+  motion->position = x;
+  motion->velocity = v;
+}
+
+int64_t tic_motion_get_time_to_target_us(const tic_motion * motion)
+{
+  if (motion == NULL) { return -1; }
+
+  tic_motion_plan plan;
+  tic_motion_get_plan(motion, &plan);
+  if (plan.unreachable) { return -1; }
+
+  double t = 0;
+  for (size_t i = 0; i < plan.phase_count; i++)
+  {
+    t += plan.phases[i].duration;
+  }
+  return (int64_t)floor(t * 1e6 + 0.5);
+}
@@ -218,6 +218,40 @@ const tic_name tic_planning_mode_names_ui[] =
   { NULL, 0 },
 };
 
+const tic_name tic_command_names_ui[] =
+{
+  { "Set target position", TIC_CMD_SET_TARGET_POSITION },
+  { "Set target velocity", TIC_CMD_SET_TARGET_VELOCITY },
+  { "Halt and set position", TIC_CMD_HALT_AND_SET_POSITION },
+  { "Halt and hold", TIC_CMD_HALT_AND_HOLD },
+  { "Go home", TIC_CMD_GO_HOME },
+  { "Reset command timeout", TIC_CMD_RESET_COMMAND_TIMEOUT },
+  { "De-energize", TIC_CMD_DEENERGIZE },
+  { "Energize", TIC_CMD_ENERGIZE },
+  { "Exit safe start", TIC_CMD_EXIT_SAFE_START },
+  { "Enter safe start", TIC_CMD_ENTER_SAFE_START },
+  { "Reset", TIC_CMD_RESET },
+  { "Clear driver error", TIC_CMD_CLEAR_DRIVER_ERROR },
+  { "Set max speed", TIC_CMD_SET_MAX_SPEED },
+  { "Set starting speed", TIC_CMD_SET_STARTING_SPEED },
+  { "Set max acceleration", TIC_CMD_SET_MAX_ACCEL },
+  { "Set max deceleration", TIC_CMD_SET_MAX_DECEL },
+  { "Set step mode", TIC_CMD_SET_STEP_MODE },
+  { "Set current limit", TIC_CMD_SET_CURRENT_LIMIT },
+  { "Set decay mode", TIC_CMD_SET_DECAY_MODE },
+  { "Set AGC option", TIC_CMD_SET_AGC_OPTION },
+  { "Get variable", TIC_CMD_GET_VARIABLE },
+  { "Get variable and clear errors occurred",
+    TIC_CMD_GET_VARIABLE_AND_CLEAR_ERRORS_OCCURRED },
+  { "Get setting", TIC_CMD_GET_SETTING },
+  { "Set setting", TIC_CMD_SET_SETTING },
+  { "Reinitialize", TIC_CMD_REINITIALIZE },
+  { "Start bootloader", TIC_CMD_START_BOOTLOADER },
+  { "Get debug data", TIC_CMD_GET_DEBUG_DATA },
+  { "Get USB descriptor", USB_REQUEST_GET_DESCRIPTOR },
+  { NULL, 0 },
+};
+
 const tic_name tic_control_mode_names[] =
 {
   { "serial", TIC_CONTROL_MODE_SERIAL },
@@ -450,6 +484,13 @@ const char * tic_look_up_planning_mode_name_ui(uint8_t planning_mode)
   return str;
 }
 
+const char * tic_look_up_command_name_ui(uint8_t command)
+{
+  const char * str = "(Unknown)";
+  tic_code_to_name(tic_command_names_ui, command, &str);
+  return str;
+}
+
 const char * tic_look_up_hp_decmod_name_ui(uint8_t mode)
 {
   const char * str = "(Unknown)";
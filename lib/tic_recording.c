@@ -0,0 +1,685 @@
+// Functions for recording the USB transfers that the library does and
+// replaying them later without any hardware.
+//
+// If the TIC_RECORD environment variable is set to a file name, every device
+// that is opened and every control transfer done on it is written to that
+// file.  If the TIC_REPLAY environment variable is set to the name of a
+// recording, the devices in the recording are listed instead of the ones
+// connected to the computer, and the recorded responses are given back in the
+// same order as they were recorded.
+//
+// A recording starts with an 8-byte header (TIC_RECORDING_MAGIC and a 16-bit
+// version) and then has records that start with a type byte.  All numbers are
+// little-endian.
+//
+// Device record:
+//   device index (1 byte), product (1), firmware version (2),
+//   serial number length (1), serial number, OS ID length (2), OS ID
+//
+// Transfer record:
+//   device index (1 byte), start time in microseconds since the recording
+//   started (8), duration in microseconds (4), request type (1), request (1),
+//   value (2), index (2), length (2), error flags (1), payload length (2),
+//   error message length (2), error message, payload
+//
+// The payload is the data sent for OUT transfers and the data received for IN
+// transfers.  The error flags have bit n set if the error had tic error code
+// n, and bit 7 set if there was an error.
+
+#include "tic_internal.h"
+
+#define TIC_RECORD_ENV_VAR "TIC_RECORD"
+#define TIC_REPLAY_ENV_VAR "TIC_REPLAY"
+
+#define TIC_RECORDING_MAGIC "TICREC"
+#define TIC_RECORDING_VERSION 1
+#define TIC_RECORDING_HEADER_SIZE 8
+
+#define TIC_RECORD_TYPE_DEVICE 1
+#define TIC_RECORD_TYPE_TRANSFER 2
+
+#define TIC_RECORD_FLAG_ERROR 0x80
+
+#define TIC_RECORDING_MAX_DEVICES 255
+
+static void write_u16(uint8_t * p, uint16_t value)
+{
+  p[0] = value & 0xFF;
+  p[1] = value >> 8 & 0xFF;
+}
+
+static void write_u32(uint8_t * p, uint32_t value)
+{
+  write_u16(p, value & 0xFFFF);
+  write_u16(p + 2, value >> 16);
+}
+
+static void write_u64(uint8_t * p, uint64_t value)
+{
+  write_u32(p, value & 0xFFFFFFFF);
+  write_u32(p + 4, value >> 32);
+}
+
+// Gets the value of an environment variable, or NULL if it is empty.
+static const char * tic_recording_env(const char * name)
+{
+  const char * value = getenv(name);
+  if (value == NULL || value[0] == 0) { return NULL; }
+  return value;
+}
+
+
+//// Recorder
+
+typedef struct tic_recorder
+{
+  FILE * file;
+  int64_t start_us;
+  size_t device_count;
+  char * serial_numbers[TIC_RECORDING_MAX_DEVICES];
+} tic_recorder;
+
+static tic_recorder tic_recorder_state;
+
+// Protects tic_recorder_state while devices are added.  Transfers only need
+// the file, and each record is written with one fwrite call, which stdio
+// already makes thread-safe.
+static bool tic_recorder_lock;
+
+static void tic_recorder_acquire(void)
+{
+  while (__atomic_test_and_set(&tic_recorder_lock, __ATOMIC_ACQUIRE)) { }
+}
+
+static void tic_recorder_release(void)
+{
+  __atomic_clear(&tic_recorder_lock, __ATOMIC_RELEASE);
+}
+
+static tic_error * tic_recorder_write(const uint8_t * data, size_t size)
+{
+  FILE * file = tic_recorder_state.file;
+  if (fwrite(data, 1, size, file) != size || fflush(file))
+  {
+    return tic_error_create("Failed to write to the USB recording: %s.",
+      strerror(errno));
+  }
+  return NULL;
+}
+
+// Opens the recording file if this is the first device.  The caller must hold
+// the lock.
+static tic_error * tic_recorder_start(const char * path)
+{
+  if (tic_recorder_state.file != NULL) { return NULL; }
+
+  FILE * file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    return tic_error_create("Failed to open %s to record USB transfers: %s.",
+      path, strerror(errno));
+  }
+
+  tic_recorder_state.file = file;
+  tic_recorder_state.start_us = tic_clock_us();
+
+  uint8_t header[TIC_RECORDING_HEADER_SIZE] = TIC_RECORDING_MAGIC;
+  write_u16(header + 6, TIC_RECORDING_VERSION);
+  return tic_recorder_write(header, sizeof(header));
+}
+
+tic_error * tic_recorder_add_device(const tic_device * device, int * device_index)
+{
+  *device_index = -1;
+
+  const char * path = tic_recording_env(TIC_RECORD_ENV_VAR);
+  if (path == NULL) { return NULL; }
+
+  const char * serial_number = tic_device_get_serial_number(device);
+  const char * os_id = tic_device_get_os_id(device);
+  size_t serial_number_length = strlen(serial_number);
+  size_t os_id_length = strlen(os_id);
+  if (serial_number_length > 0xFF || os_id_length > 0xFFFF)
+  {
+    return tic_error_create("The device's identifiers are too long to record.");
+  }
+
+  tic_recorder_acquire();
+
+  tic_error * error = tic_recorder_start(path);
+
+  // A device opened more than once keeps the same index, so a replay serves
+  // its transfers in order no matter which handle asks for them.
+  size_t index = 0;
+  while (error == NULL && index < tic_recorder_state.device_count &&
+    strcmp(tic_recorder_state.serial_numbers[index], serial_number))
+  {
+    index++;
+  }
+
+  bool new_device = error == NULL && index == tic_recorder_state.device_count;
+
+  if (new_device && index == TIC_RECORDING_MAX_DEVICES)
+  {
+    error = tic_error_create("Too many devices to record.");
+  }
+
+  char * serial_number_copy = NULL;
+  if (new_device && error == NULL)
+  {
+    serial_number_copy = malloc(serial_number_length + 1);
+    if (serial_number_copy == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  uint8_t * record = NULL;
+  size_t record_size = 8 + serial_number_length + os_id_length;
+  if (new_device && error == NULL)
+  {
+    record = malloc(record_size);
+    if (record == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  if (new_device && error == NULL)
+  {
+    uint8_t * p = record;
+    *p++ = TIC_RECORD_TYPE_DEVICE;
+    *p++ = index;
+    *p++ = tic_device_get_product(device);
+    write_u16(p, tic_device_get_firmware_version(device));
+    p += 2;
+    *p++ = serial_number_length;
+    memcpy(p, serial_number, serial_number_length);
+    p += serial_number_length;
+    write_u16(p, os_id_length);
+    p += 2;
+    memcpy(p, os_id, os_id_length);
+    error = tic_recorder_write(record, record_size);
+  }
+
+  if (new_device && error == NULL)
+  {
+    strcpy(serial_number_copy, serial_number);
+    tic_recorder_state.serial_numbers[index] = serial_number_copy;
+    tic_recorder_state.device_count++;
+    serial_number_copy = NULL;
+  }
+
+  tic_recorder_release();
+
+  free(record);
+  free(serial_number_copy);
+
+  if (error == NULL)
+  {
+    *device_index = index;
+  }
+
+  return error;
+}
+
+static uint8_t tic_recording_error_flags(const tic_error * error)
+{
+  if (error == NULL) { return 0; }
+  uint8_t flags = TIC_RECORD_FLAG_ERROR;
+  for (uint32_t code = 1; code < 7; code++)
+  {
+    if (tic_error_has_code(error, code)) { flags |= 1 << code; }
+  }
+  return flags;
+}
+
+void tic_recorder_add_transfer(int device_index, int64_t start_us,
+  int64_t duration_us, uint8_t request_type, uint8_t request,
+  uint16_t value, uint16_t index, uint16_t length,
+  const void * buffer, size_t transferred, const tic_error * error)
+{
+  if (device_index < 0) { return; }
+
+  const char * message = error ? tic_error_get_message(error) : "";
+  size_t message_length = strlen(message);
+  if (message_length > 0xFFFF) { message_length = 0xFFFF; }
+
+  size_t payload_length;
+  if (request_type & 0x80)
+  {
+    payload_length = error ? 0 : transferred;
+  }
+  else
+  {
+    payload_length = buffer ? length : 0;
+  }
+
+  size_t record_size = 27 + message_length + payload_length;
+  uint8_t * record = malloc(record_size);
+  if (record == NULL) { return; }
+
+  uint8_t * p = record;
+  *p++ = TIC_RECORD_TYPE_TRANSFER;
+  *p++ = device_index;
+  write_u64(p, start_us - tic_recorder_state.start_us);
+  p += 8;
+  write_u32(p, duration_us);
+  p += 4;
+  *p++ = request_type;
+  *p++ = request;
+  write_u16(p, value);
+  p += 2;
+  write_u16(p, index);
+  p += 2;
+  write_u16(p, length);
+  p += 2;
+  *p++ = tic_recording_error_flags(error);
+  write_u16(p, payload_length);
+  p += 2;
+  write_u16(p, message_length);
+  p += 2;
+  memcpy(p, message, message_length);
+  p += message_length;
+  if (payload_length) { memcpy(p, buffer, payload_length); }
+
+  // Recording is only for debugging, so it should not make transfers fail.
+  tic_error_free(tic_recorder_write(record, record_size));
+  free(record);
+}
+
+
+//// Replayer
+
+typedef struct tic_replay_transfer
+{
+  uint8_t request_type;
+  uint8_t request;
+  uint16_t value;
+  uint16_t index;
+  uint16_t length;
+  uint8_t error_flags;
+  uint16_t payload_length;
+  const char * message;
+  uint16_t message_length;
+  const uint8_t * payload;
+} tic_replay_transfer;
+
+struct tic_replay_device
+{
+  char * serial_number;
+  char * os_id;
+  uint8_t product;
+  uint16_t firmware_version;
+
+  tic_replay_transfer * transfers;
+  size_t transfer_count;
+
+  // The index of the next transfer to replay.
+  size_t next_transfer;
+};
+
+typedef struct tic_replay
+{
+  uint8_t * data;
+  tic_replay_device devices[TIC_RECORDING_MAX_DEVICES];
+  size_t device_count;
+  tic_error * load_error;
+} tic_replay;
+
+static tic_replay * tic_replay_state;
+
+bool tic_replay_enabled(void)
+{
+  return tic_recording_env(TIC_REPLAY_ENV_VAR) != NULL;
+}
+
+static tic_error * tic_replay_read_file(const char * path,
+  uint8_t ** data, size_t * size)
+{
+  FILE * file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return tic_error_create("Failed to open USB recording %s: %s.",
+      path, strerror(errno));
+  }
+
+  tic_error * error = NULL;
+
+  long file_size = -1;
+  if (fseek(file, 0, SEEK_END) == 0)
+  {
+    file_size = ftell(file);
+  }
+  if (file_size < 0 || fseek(file, 0, SEEK_SET))
+  {
+    error = tic_error_create("Failed to get the size of %s.", path);
+  }
+
+  if (error == NULL)
+  {
+    *data = malloc(file_size ? file_size : 1);
+    if (*data == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  if (error == NULL && fread(*data, 1, file_size, file) != (size_t)file_size)
+  {
+    error = tic_error_create("Failed to read %s.", path);
+  }
+
+  if (error == NULL)
+  {
+    *size = file_size;
+  }
+
+  fclose(file);
+  return error;
+}
+
+static tic_error * tic_replay_add_transfer(tic_replay_device * device,
+  const tic_replay_transfer * transfer)
+{
+  if ((device->transfer_count & (device->transfer_count - 1)) == 0)
+  {
+    // The count is 0 or a power of two, so the array is full.
+    size_t capacity = device->transfer_count ? device->transfer_count * 2 : 16;
+    tic_replay_transfer * transfers =
+      realloc(device->transfers, capacity * sizeof(tic_replay_transfer));
+    if (transfers == NULL) { return &tic_error_no_memory; }
+    device->transfers = transfers;
+  }
+  device->transfers[device->transfer_count++] = *transfer;
+  return NULL;
+}
+
+static char * tic_replay_string(const uint8_t * data, size_t length)
+{
+  char * string = malloc(length + 1);
+  if (string == NULL) { return NULL; }
+  memcpy(string, data, length);
+  string[length] = 0;
+  return string;
+}
+
+static tic_error * tic_replay_parse(tic_replay * replay, size_t size)
+{
+  const uint8_t * data = replay->data;
+  const uint8_t * end = data + size;
+
+  if (size < TIC_RECORDING_HEADER_SIZE ||
+    memcmp(data, TIC_RECORDING_MAGIC, 6) ||
+    read_u16(data + 6) != TIC_RECORDING_VERSION)
+  {
+    return tic_error_create("The file is not a USB recording "
+      "made by this version of the library.");
+  }
+
+  const uint8_t * p = data + TIC_RECORDING_HEADER_SIZE;
+  while (p < end)
+  {
+    uint8_t type = *p;
+    if (type == TIC_RECORD_TYPE_DEVICE && end - p >= 6)
+    {
+      uint8_t index = p[1];
+      size_t serial_number_length = p[5];
+      const uint8_t * serial_number = p + 6;
+      if (index != replay->device_count ||
+        replay->device_count >= TIC_RECORDING_MAX_DEVICES ||
+        end - serial_number < (ptrdiff_t)serial_number_length + 2)
+      {
+        break;
+      }
+      size_t os_id_length = read_u16(serial_number + serial_number_length);
+      const uint8_t * os_id = serial_number + serial_number_length + 2;
+      if (end - os_id < (ptrdiff_t)os_id_length) { break; }
+
+      tic_replay_device * device = &replay->devices[replay->device_count++];
+      device->product = p[2];
+      device->firmware_version = read_u16(p + 3);
+      device->serial_number = tic_replay_string(serial_number, serial_number_length);
+      device->os_id = tic_replay_string(os_id, os_id_length);
+      if (device->serial_number == NULL || device->os_id == NULL)
+      {
+        return &tic_error_no_memory;
+      }
+      p = os_id + os_id_length;
+    }
+    else if (type == TIC_RECORD_TYPE_TRANSFER && end - p >= 27)
+    {
+      uint8_t device_index = p[1];
+      if (device_index >= replay->device_count) { break; }
+
+      tic_replay_transfer transfer;
+      transfer.request_type = p[14];
+      transfer.request = p[15];
+      transfer.value = read_u16(p + 16);
+      transfer.index = read_u16(p + 18);
+      transfer.length = read_u16(p + 20);
+      transfer.error_flags = p[22];
+      transfer.payload_length = read_u16(p + 23);
+      transfer.message_length = read_u16(p + 25);
+      if (end - p < 27 + (ptrdiff_t)transfer.message_length +
+        (ptrdiff_t)transfer.payload_length)
+      {
+        break;
+      }
+      transfer.message = (const char *)p + 27;
+      transfer.payload = p + 27 + transfer.message_length;
+      const uint8_t * next = transfer.payload + transfer.payload_length;
+
+      // The recorder never stores more data than the transfer asked for, so
+      // this record was damaged and replaying it could overflow a buffer.
+      if ((transfer.request_type & 0x80) &&
+        transfer.payload_length > transfer.length)
+      {
+        return tic_error_create("The USB recording is corrupt: transfer %u "
+          "of device %u has more data than it asked for.",
+          (unsigned int)replay->devices[device_index].transfer_count,
+          (unsigned int)device_index);
+      }
+
+      tic_error * error = tic_replay_add_transfer(
+        &replay->devices[device_index], &transfer);
+      if (error) { return error; }
+      p = next;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  // A recording can be cut off if the program that made it crashed, so
+  // everything before a bad record can still be used.
+  return NULL;
+}
+
+static void tic_replay_free(tic_replay * replay)
+{
+  if (replay == NULL) { return; }
+  for (size_t i = 0; i < replay->device_count; i++)
+  {
+    free(replay->devices[i].serial_number);
+    free(replay->devices[i].os_id);
+    free(replay->devices[i].transfers);
+  }
+  tic_error_free(replay->load_error);
+  free(replay->data);
+  free(replay);
+}
+
+// Loads the recording the first time it is needed.  If there was an error
+// loading it, every replay function returns a copy of that error.
+static tic_error * tic_replay_get(tic_replay ** result)
+{
+  tic_replay * replay = __atomic_load_n(&tic_replay_state, __ATOMIC_ACQUIRE);
+  if (replay == NULL)
+  {
+    replay = calloc(1, sizeof(tic_replay));
+    if (replay == NULL) { return &tic_error_no_memory; }
+
+    const char * path = tic_recording_env(TIC_REPLAY_ENV_VAR);
+    size_t size = 0;
+    replay->load_error = tic_replay_read_file(path, &replay->data, &size);
+    if (replay->load_error == NULL)
+    {
+      replay->load_error = tic_replay_parse(replay, size);
+    }
+    if (replay->load_error != NULL)
+    {
+      replay->load_error = tic_error_add(replay->load_error,
+        "There was an error loading the USB recording.");
+    }
+
+    tic_replay * expected = NULL;
+    if (!__atomic_compare_exchange_n(&tic_replay_state, &expected, replay,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      // Another thread loaded it first.
+      tic_replay_free(replay);
+      replay = expected;
+    }
+  }
+
+  *result = replay;
+  return tic_error_copy(replay->load_error);
+}
+
+tic_error * tic_replay_list_devices(tic_device *** device_list,
+  size_t * device_count)
+{
+  tic_replay * replay = NULL;
+  tic_error * error = tic_replay_get(&replay);
+
+  tic_device ** list = NULL;
+  size_t count = 0;
+  if (error == NULL)
+  {
+    list = calloc(replay->device_count + 1, sizeof(tic_device *));
+    if (list == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  for (size_t i = 0; error == NULL && i < replay->device_count; i++)
+  {
+    const tic_replay_device * device = &replay->devices[i];
+    error = tic_device_create_replayed(device->serial_number, device->os_id,
+      device->product, device->firmware_version, &list[count]);
+    if (error == NULL) { count++; }
+  }
+
+  if (error == NULL)
+  {
+    *device_list = list;
+    if (device_count) { *device_count = count; }
+    list = NULL;
+    count = 0;
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    tic_device_free(list[i]);
+  }
+  tic_list_free(list);
+
+  return error;
+}
+
+tic_error * tic_replay_open(const tic_device * device,
+  tic_replay_device ** replay_device)
+{
+  *replay_device = NULL;
+
+  tic_replay * replay = NULL;
+  tic_error * error = tic_replay_get(&replay);
+  if (error) { return error; }
+
+  const char * serial_number = tic_device_get_serial_number(device);
+  for (size_t i = 0; i < replay->device_count; i++)
+  {
+    if (strcmp(replay->devices[i].serial_number, serial_number) == 0)
+    {
+      *replay_device = &replay->devices[i];
+      return NULL;
+    }
+  }
+
+  return tic_error_add_code(
+    tic_error_create("The device is not in the USB recording."),
+    TIC_ERROR_DEVICE_DISCONNECTED);
+}
+
+tic_error * tic_replay_control_transfer(tic_replay_device * device,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  void * buffer, uint16_t length, size_t * transferred)
+{
+  if (transferred) { *transferred = 0; }
+
+  size_t next = __atomic_fetch_add(&device->next_transfer, 1, __ATOMIC_RELAXED);
+  if (next >= device->transfer_count)
+  {
+    return tic_error_add_code(
+      tic_error_create("The USB recording has no more transfers for this device."),
+      TIC_ERROR_DEVICE_DISCONNECTED);
+  }
+
+  const tic_replay_transfer * transfer = &device->transfers[next];
+  bool out_data_matches = (request_type & 0x80) ||
+    (buffer == NULL ? transfer->payload_length == 0 :
+      transfer->payload_length == length &&
+      memcmp(buffer, transfer->payload, length) == 0);
+  if (transfer->request_type != request_type ||
+    transfer->request != request ||
+    transfer->value != value ||
+    transfer->index != index ||
+    transfer->length != length ||
+    !out_data_matches)
+  {
+    return tic_error_create(
+      "USB transfer %u does not match the recording: expected request 0x%02x "
+      "(0x%02x, 0x%04x, 0x%04x, %u), got request 0x%02x (0x%02x, 0x%04x, "
+      "0x%04x, %u).",
+      (unsigned int)next,
+      transfer->request, transfer->request_type, transfer->value,
+      transfer->index, transfer->length,
+      request, request_type, value, index, length);
+  }
+
+  if (transfer->error_flags & TIC_RECORD_FLAG_ERROR)
+  {
+    tic_error * error = tic_error_create("%.*s",
+      (int)transfer->message_length, transfer->message);
+    for (uint32_t code = 1; code < 7; code++)
+    {
+      if (transfer->error_flags & (1 << code))
+      {
+        error = tic_error_add_code(error, code);
+      }
+    }
+    return error;
+  }
+
+  if (request_type & 0x80)
+  {
+    if (transfer->payload_length > length ||
+      (buffer == NULL && transfer->payload_length != 0))
+    {
+      return tic_error_create("USB transfer %u in the recording has %u bytes "
+        "of data, which does not fit in the buffer.",
+        (unsigned int)next, (unsigned int)transfer->payload_length);
+    }
+    memcpy(buffer, transfer->payload, transfer->payload_length);
+    if (transferred) { *transferred = transfer->payload_length; }
+  }
+  else if (transferred)
+  {
+    *transferred = length;
+  }
+
+  return NULL;
+}
@@ -0,0 +1,385 @@
+// Functions for making jerk-limited moves.
+//
+// The Tic's planner changes the velocity at a constant rate, so the
+// acceleration jumps at the start and end of every ramp.  To get an S-curve,
+// where the acceleration itself ramps up and down, we plan the move on the
+// computer and send a new target velocity at a fixed rate.  Each update also
+// corrects for the difference between where the plan says the motor should be
+// and where the Tic says it is.  At the end of the plan, we send the final
+// target position so the Tic lands on it exactly.
+//
+// A rest-to-rest S-curve has at most seven phases with constant jerk: the jerk
+// is positive, zero, then negative while accelerating, zero while cruising,
+// and the mirror image while decelerating.
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+#define TIC_S_CURVE_PHASE_COUNT 7
+
+// When correcting the velocity for position errors, aim to remove the error in
+// this many seconds.
+#define TIC_S_CURVE_CORRECTION_TIME 0.02
+
+typedef struct tic_s_curve_phase
+{
+  double duration;
+  double jerk;
+
+  // The state at the start of the phase, relative to the start position.
+  double position;
+  double velocity;
+  double accel;
+} tic_s_curve_phase;
+
+struct tic_s_curve
+{
+  uint32_t max_speed;
+  uint32_t max_accel;
+  uint32_t max_jerk;
+  uint32_t update_interval_us;
+
+  // The plan made by the last call to tic_s_curve_plan().  All values are in
+  // microsteps and seconds, measured in the direction of the move.
+  int32_t start_position;
+  int32_t target_position;
+  double direction;
+  tic_s_curve_phase phases[TIC_S_CURVE_PHASE_COUNT];
+};
+
+tic_error * tic_s_curve_create(tic_s_curve ** curve)
+{
+  if (curve == NULL)
+  {
+    return tic_error_create("S-curve output pointer is null.");
+  }
+
+  *curve = NULL;
+
+  tic_s_curve * new_curve = calloc(1, sizeof(tic_s_curve));
+  if (new_curve == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  new_curve->update_interval_us = 2000;
+  new_curve->direction = 1;
+
+  *curve = new_curve;
+  return NULL;
+}
+
+void tic_s_curve_free(tic_s_curve * curve)
+{
+  free(curve);
+}
+
+void tic_s_curve_set_max_speed(tic_s_curve * curve, uint32_t speed)
+{
+  if (curve == NULL) { return; }
+  curve->max_speed = speed;
+}
+
+uint32_t tic_s_curve_get_max_speed(const tic_s_curve * curve)
+{
+  if (curve == NULL) { return 0; }
+  return curve->max_speed;
+}
+
+void tic_s_curve_set_max_accel(tic_s_curve * curve, uint32_t accel)
+{
+  if (curve == NULL) { return; }
+  curve->max_accel = accel;
+}
+
+uint32_t tic_s_curve_get_max_accel(const tic_s_curve * curve)
+{
+  if (curve == NULL) { return 0; }
+  return curve->max_accel;
+}
+
+void tic_s_curve_set_max_jerk(tic_s_curve * curve, uint32_t jerk)
+{
+  if (curve == NULL) { return; }
+  curve->max_jerk = jerk;
+}
+
+uint32_t tic_s_curve_get_max_jerk(const tic_s_curve * curve)
+{
+  if (curve == NULL) { return 0; }
+  return curve->max_jerk;
+}
+
+void tic_s_curve_set_update_interval_us(tic_s_curve * curve, uint32_t interval_us)
+{
+  if (curve == NULL) { return; }
+  curve->update_interval_us = interval_us;
+}
+
+uint32_t tic_s_curve_get_update_interval_us(const tic_s_curve * curve)
+{
+  if (curve == NULL) { return 0; }
+  return curve->update_interval_us;
+}
+
+// Fills in the starting state of each phase from the durations and jerks.
+static void tic_s_curve_integrate(tic_s_curve * curve)
+{
+  double x = 0, v = 0, a = 0;
+  for (size_t i = 0; i < TIC_S_CURVE_PHASE_COUNT; i++)
+  {
+    tic_s_curve_phase * phase = &curve->phases[i];
+    double t = phase->duration, j = phase->jerk;
+    phase->position = x;
+    phase->velocity = v;
+    phase->accel = a;
+    x += v * t + a * t * t / 2 + j * t * t * t / 6;
+    v += a * t + j * t * t / 2;
+    a += j * t;
+  }
+}
+
+tic_error * tic_s_curve_plan(tic_s_curve * curve,
+  int32_t start_position, int32_t target_position)
+{
+  if (curve == NULL)
+  {
+    return tic_error_create("S-curve is null.");
+  }
+
+  if (curve->max_speed == 0 || curve->max_accel == 0 || curve->max_jerk == 0)
+  {
+    return tic_error_create(
+      "The max speed, max acceleration, and max jerk of an S-curve must be "
+      "positive.");
+  }
+
+  double distance = (double)target_position - start_position;
+  double v_max = (double)curve->max_speed / TIC_SPEED_UNITS_PER_HZ;
+  double a_max = (double)curve->max_accel / TIC_ACCEL_UNITS_PER_HZ2;
+  double j = curve->max_jerk;
+
+  curve->start_position = start_position;
+  curve->target_position = target_position;
+  curve->direction = distance < 0 ? -1 : 1;
+  distance = fabs(distance);
+
+  // Find the peak speed, the duration of each jerk phase, and the duration of
+  // the constant acceleration phase.  A ramp from rest to speed v covers
+  // v * (ramp time) / 2 because it is symmetric.
+  double v = v_max;
+  double jerk_time, accel_time;
+  if (v * j < a_max * a_max)
+  {
+    // The acceleration never reaches the limit.
+    jerk_time = sqrt(v / j);
+    accel_time = 0;
+  }
+  else
+  {
+    jerk_time = a_max / j;
+    accel_time = v / a_max - jerk_time;
+  }
+
+  double ramp_distance = v * (2 * jerk_time + accel_time) / 2;
+  double cruise_time = 0;
+  if (2 * ramp_distance <= distance)
+  {
+    cruise_time = (distance - 2 * ramp_distance) / v;
+  }
+  else
+  {
+    // The move is too short to reach the max speed.  First try a peak speed
+    // that still reaches the max acceleration, from
+    // v * (v / a + a / j) = distance.
+    double r = a_max / j;
+    v = (-r + sqrt(r * r + 4 * distance / a_max)) * a_max / 2;
+    if (v * j >= a_max * a_max)
+    {
+      jerk_time = r;
+      accel_time = v / a_max - jerk_time;
+    }
+    else
+    {
+      // From 2 * j * jerk_time^3 = distance.
+      jerk_time = cbrt(distance / (2 * j));
+      accel_time = 0;
+    }
+  }
+
+  const double durations[TIC_S_CURVE_PHASE_COUNT] = {
+    jerk_time, accel_time, jerk_time, cruise_time,
+    jerk_time, accel_time, jerk_time };
+  const double jerks[TIC_S_CURVE_PHASE_COUNT] = { j, 0, -j, 0, -j, 0, j };
+  for (size_t i = 0; i < TIC_S_CURVE_PHASE_COUNT; i++)
+  {
+    curve->phases[i].duration = durations[i];
+    curve->phases[i].jerk = jerks[i];
+  }
+  tic_s_curve_integrate(curve);
+
+  return NULL;
+}
+
+int64_t tic_s_curve_get_duration_us(const tic_s_curve * curve)
+{
+  if (curve == NULL) { return 0; }
+  double t = 0;
+  for (size_t i = 0; i < TIC_S_CURVE_PHASE_COUNT; i++)
+  {
+    t += curve->phases[i].duration;
+  }
+  return (int64_t)floor(t * 1e6 + 0.5);
+}
+
+// Computes the position and velocity at the given time in seconds after the
+// start of the move.
+static void tic_s_curve_evaluate(const tic_s_curve * curve, double t,
+  double * position, double * velocity)
+{
+  for (size_t i = 0; i < TIC_S_CURVE_PHASE_COUNT; i++)
+  {
+    const tic_s_curve_phase * phase = &curve->phases[i];
+    if (t < phase->duration)
+    {
+      double x = phase->position + phase->velocity * t +
+        phase->accel * t * t / 2 + phase->jerk * t * t * t / 6;
+      double v = phase->velocity + phase->accel * t + phase->jerk * t * t / 2;
+      *position = curve->start_position + curve->direction * x;
+      *velocity = curve->direction * v;
+      return;
+    }
+    t -= phase->duration;
+  }
+
+  *position = curve->target_position;
+  *velocity = 0;
+}
+
+void tic_s_curve_predict(const tic_s_curve * curve, int64_t time_us,
+  int32_t * position, int32_t * velocity)
+{
+  double x = 0, v = 0;
+  if (curve != NULL)
+  {
+    tic_s_curve_evaluate(curve, time_us / 1e6, &x, &v);
+  }
+  if (position) { *position = (int32_t)floor(x + 0.5); }
+  if (velocity) { *velocity = (int32_t)floor(v * TIC_SPEED_UNITS_PER_HZ + 0.5); }
+}
+
+// Converts a velocity in microsteps per second to the Tic's units, limiting
+// it to what the Tic accepts.
+static int32_t tic_s_curve_velocity_code(double velocity, uint32_t max_speed)
+{
+  double code = floor(velocity * TIC_SPEED_UNITS_PER_HZ + 0.5);
+  if (code > max_speed) { code = max_speed; }
+  if (code < -(double)max_speed) { code = -(double)max_speed; }
+  return (int32_t)code;
+}
+
+tic_error * tic_s_curve_move(tic_s_curve * curve, tic_handle * handle,
+  int32_t target_position)
+{
+  if (curve == NULL)
+  {
+    return tic_error_create("S-curve is null.");
+  }
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (curve->update_interval_us == 0)
+  {
+    return tic_error_create("The S-curve update interval must be positive.");
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_variables * vars = NULL;
+  tic_error * error = tic_get_variables(handle, &vars, false);
+
+  if (error == NULL)
+  {
+    error = tic_s_curve_plan(curve,
+      tic_variables_get_current_position(vars), target_position);
+  }
+
+  // The Tic will not go faster than its max speed, so there is no point in
+  // asking it to.
+  uint32_t speed_limit = 0;
+  if (error == NULL)
+  {
+    speed_limit = tic_variables_get_max_speed(vars);
+  }
+
+  int64_t duration_us = tic_s_curve_get_duration_us(curve);
+  int64_t interval_us = curve->update_interval_us;
+  int64_t start_ns = tic_clock_ns();
+  bool velocity_sent = false;
+
+  // Update times are counted from the start of the plan, not from when the
+  // last update was sent, so a slow update does not delay the others.
+  for (int64_t time_us = 0; error == NULL && time_us < duration_us;
+       time_us += interval_us)
+  {
+    tic_sleep_until_ns(start_ns + time_us * 1000);
+
+    if (time_us != 0)
+    {
+      tic_variables_free(vars);
+      vars = NULL;
+      error = tic_get_variables(handle, &vars, false);
+      if (error != NULL) { break; }
+    }
+
+    if (tic_variables_get_error_status(vars))
+    {
+      error = tic_error_create(
+        "The Tic stopped the move because of errors (0x%04x).",
+        tic_variables_get_error_status(vars));
+      break;
+    }
+
+    // The velocity we send now lasts until the next update, so aim for the
+    // planned velocity in the middle of that interval.
+    double planned_position, planned_velocity, unused;
+    tic_s_curve_evaluate(curve, time_us / 1e6, &planned_position, &unused);
+    tic_s_curve_evaluate(curve, (time_us + interval_us / 2) / 1e6,
+      &unused, &planned_velocity);
+
+    double position_error = planned_position -
+      tic_variables_get_current_position(vars);
+    double velocity = planned_velocity +
+      position_error / TIC_S_CURVE_CORRECTION_TIME;
+
+    error = tic_set_target_velocity(handle,
+      tic_s_curve_velocity_code(velocity, speed_limit));
+    velocity_sent = true;
+  }
+
+  if (error == NULL)
+  {
+    error = tic_set_target_position(handle, target_position);
+  }
+
+  // Otherwise the last velocity we sent would keep the motor moving.  The
+  // handle might be broken, so this is just an attempt.
+  if (error != NULL && velocity_sent)
+  {
+    tic_error_free(tic_set_target_velocity(handle, 0));
+  }
+
+  tic_variables_free(vars);
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error, "There was an error making an S-curve move.");
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
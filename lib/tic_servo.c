@@ -0,0 +1,386 @@
+// Functions for closing the position loop on the encoder from the computer.
+//
+// Each update reads the variables from the error status to the encoder
+// position in one request, instead of reading all of them, and then sends one
+// target velocity.  The velocity is the feed-forward velocity plus PID terms
+// computed from the error between the target position and the encoder
+// position.  The integral term stops growing while the output is saturated
+// and is limited on its own, so it does not wind up while the motor is
+// blocked or far from the target.
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+// The part of the variables we read on each update.
+#define TIC_SERVO_READ_START TIC_VAR_ERROR_STATUS
+#define TIC_SERVO_READ_LENGTH (TIC_VAR_ENCODER_POSITION + 4 - TIC_SERVO_READ_START)
+
+struct tic_servo
+{
+  double kp;
+  double ki;
+  double kd;
+  uint32_t encoder_prescaler;
+  uint32_t encoder_postscaler;
+  uint32_t max_speed;
+  uint32_t integral_limit;
+  double tolerance;
+
+  double target_position;
+  int32_t target_velocity;
+
+  // The state of the loop.  Speeds are in microsteps per second.
+  bool started;
+  double position;
+  double error;
+  double integral;
+  int32_t output;
+
+  // Timing statistics, in microseconds.
+  uint64_t update_count;
+  uint64_t overrun_count;
+  uint64_t total_update_us;
+  uint64_t max_update_us;
+  uint64_t max_lateness_us;
+};
+
+tic_error * tic_servo_create(tic_servo ** servo)
+{
+  if (servo == NULL)
+  {
+    return tic_error_create("Servo output pointer is null.");
+  }
+
+  *servo = NULL;
+
+  tic_servo * new_servo = calloc(1, sizeof(tic_servo));
+  if (new_servo == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  new_servo->kp = 20;
+  new_servo->encoder_prescaler = 1;
+  new_servo->encoder_postscaler = 1;
+  new_servo->tolerance = 0.5;
+
+  *servo = new_servo;
+  return NULL;
+}
+
+void tic_servo_free(tic_servo * servo)
+{
+  free(servo);
+}
+
+void tic_servo_set_gains(tic_servo * servo, double kp, double ki, double kd)
+{
+  if (servo == NULL) { return; }
+  servo->kp = kp;
+  servo->ki = ki;
+  servo->kd = kd;
+}
+
+void tic_servo_get_gains(const tic_servo * servo,
+  double * kp, double * ki, double * kd)
+{
+  if (kp) { *kp = servo ? servo->kp : 0; }
+  if (ki) { *ki = servo ? servo->ki : 0; }
+  if (kd) { *kd = servo ? servo->kd : 0; }
+}
+
+void tic_servo_set_encoder_scaling(tic_servo * servo,
+  uint32_t prescaler, uint32_t postscaler)
+{
+  if (servo == NULL) { return; }
+  servo->encoder_prescaler = prescaler ? prescaler : 1;
+  servo->encoder_postscaler = postscaler ? postscaler : 1;
+}
+
+void tic_servo_set_max_speed(tic_servo * servo, uint32_t speed)
+{
+  if (servo == NULL) { return; }
+  servo->max_speed = speed;
+}
+
+void tic_servo_set_integral_limit(tic_servo * servo, uint32_t speed)
+{
+  if (servo == NULL) { return; }
+  servo->integral_limit = speed;
+}
+
+void tic_servo_set_tolerance(tic_servo * servo, double tolerance)
+{
+  if (servo == NULL) { return; }
+  servo->tolerance = tolerance;
+}
+
+void tic_servo_set_target(tic_servo * servo, double position, int32_t velocity)
+{
+  if (servo == NULL) { return; }
+  servo->target_position = position;
+  servo->target_velocity = velocity;
+}
+
+void tic_servo_reset(tic_servo * servo)
+{
+  if (servo == NULL) { return; }
+  servo->started = false;
+  servo->integral = 0;
+  servo->output = 0;
+  servo->update_count = 0;
+  servo->overrun_count = 0;
+  servo->total_update_us = 0;
+  servo->max_update_us = 0;
+  servo->max_lateness_us = 0;
+}
+
+// Computes the next output from the latest encoder position and the time
+// since the last update in seconds.  Returns the output in the Tic's speed
+// units.
+static int32_t tic_servo_compute(tic_servo * servo, double position, double dt,
+  uint32_t device_max_speed)
+{
+  double limit = (double)device_max_speed / TIC_SPEED_UNITS_PER_HZ;
+  if (servo->max_speed && servo->max_speed < device_max_speed)
+  {
+    limit = (double)servo->max_speed / TIC_SPEED_UNITS_PER_HZ;
+  }
+
+  double error = servo->target_position - position;
+
+  // Take the derivative of the position instead of the error so that changing
+  // the target does not cause a spike.
+  double derivative = 0;
+  if (servo->started && dt > 0)
+  {
+    derivative = -(position - servo->position) / dt;
+  }
+
+  double integral = servo->integral + servo->ki * error * dt;
+  double integral_limit = servo->integral_limit ?
+    (double)servo->integral_limit / TIC_SPEED_UNITS_PER_HZ : limit;
+  if (integral > integral_limit) { integral = integral_limit; }
+  if (integral < -integral_limit) { integral = -integral_limit; }
+
+  double output = (double)servo->target_velocity / TIC_SPEED_UNITS_PER_HZ +
+    servo->kp * error + integral + servo->kd * derivative;
+
+  if (output > limit || output < -limit)
+  {
+    output = output > limit ? limit : -limit;
+
+    // Only let the integral shrink while the output is saturated.
+    if (fabs(integral) > fabs(servo->integral)) { integral = servo->integral; }
+  }
+
+  servo->started = true;
+  servo->position = position;
+  servo->error = error;
+  servo->integral = integral;
+  servo->output = (int32_t)floor(output * TIC_SPEED_UNITS_PER_HZ + 0.5);
+  return servo->output;
+}
+
+tic_error * tic_servo_update(tic_servo * servo, tic_handle * handle,
+  uint32_t interval_us)
+{
+  if (servo == NULL)
+  {
+    return tic_error_create("Servo is null.");
+  }
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  int64_t start_us = tic_clock_us();
+
+  uint8_t buffer[TIC_SERVO_READ_LENGTH];
+  tic_error * error = tic_get_variable_segment(handle,
+    TIC_SERVO_READ_START, sizeof(buffer), buffer, false);
+
+  if (error == NULL)
+  {
+    uint16_t error_status = read_u16(buffer +
+      TIC_VAR_ERROR_STATUS - TIC_SERVO_READ_START);
+    if (error_status)
+    {
+      error = tic_error_create(
+        "The Tic is not moving the motor because of errors (0x%04x).",
+        error_status);
+    }
+  }
+
+  if (error == NULL)
+  {
+    int32_t encoder_position = read_i32(buffer +
+      TIC_VAR_ENCODER_POSITION - TIC_SERVO_READ_START);
+    uint32_t max_speed = read_u32(buffer +
+      TIC_VAR_MAX_SPEED - TIC_SERVO_READ_START);
+    double position = (double)encoder_position *
+      servo->encoder_postscaler / servo->encoder_prescaler;
+    int32_t output = tic_servo_compute(servo, position, interval_us / 1e6,
+      max_speed);
+    error = tic_set_target_velocity(handle, output);
+  }
+
+  uint64_t update_us = tic_clock_us() - start_us;
+  servo->update_count++;
+  servo->total_update_us += update_us;
+  if (update_us > servo->max_update_us) { servo->max_update_us = update_us; }
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error, "There was an error updating the servo loop.");
+  }
+
+  return error;
+}
+
+double tic_servo_get_position(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->position;
+}
+
+double tic_servo_get_error(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->error;
+}
+
+int32_t tic_servo_get_output(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->output;
+}
+
+bool tic_servo_is_settled(const tic_servo * servo)
+{
+  if (servo == NULL) { return false; }
+  return servo->started && fabs(servo->error) <= servo->tolerance;
+}
+
+uint64_t tic_servo_get_update_count(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->update_count;
+}
+
+uint64_t tic_servo_get_overrun_count(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->overrun_count;
+}
+
+uint64_t tic_servo_get_mean_update_us(const tic_servo * servo)
+{
+  if (servo == NULL || servo->update_count == 0) { return 0; }
+  return servo->total_update_us / servo->update_count;
+}
+
+uint64_t tic_servo_get_max_update_us(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->max_update_us;
+}
+
+uint64_t tic_servo_get_max_lateness_us(const tic_servo * servo)
+{
+  if (servo == NULL) { return 0; }
+  return servo->max_lateness_us;
+}
+
+tic_error * tic_servo_run(tic_servo * const * servos,
+  tic_handle * const * handles, size_t count,
+  uint32_t interval_us, uint32_t timeout_ms)
+{
+  if (servos == NULL || handles == NULL)
+  {
+    return tic_error_create("Servo list is null.");
+  }
+
+  if (interval_us == 0)
+  {
+    return tic_error_create("The servo loop interval must be positive.");
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_error * error = NULL;
+  int64_t start_ns = tic_clock_ns();
+  int64_t interval_ns = (int64_t)interval_us * 1000;
+  int64_t timeout_ns = (int64_t)timeout_ms * 1000000;
+  int64_t period = 0;
+
+  // The time since the last update, which is longer than the interval if the
+  // loop overran.
+  uint32_t dt_us = interval_us;
+
+  while (error == NULL)
+  {
+    int64_t deadline_ns = start_ns + period * interval_ns;
+    tic_sleep_until_ns(deadline_ns);
+
+    bool settled = true;
+    for (size_t i = 0; error == NULL && i < count; i++)
+    {
+      int64_t lateness_us = (tic_clock_ns() - deadline_ns) / 1000;
+      if (lateness_us > 0 && (uint64_t)lateness_us > servos[i]->max_lateness_us)
+      {
+        servos[i]->max_lateness_us = lateness_us;
+      }
+
+      error = tic_servo_update(servos[i], handles[i], dt_us);
+      settled = settled && tic_servo_is_settled(servos[i]);
+    }
+
+    if (error != NULL) { break; }
+
+    if (settled)
+    {
+      // Stop trimming so the motors hold still.
+      for (size_t i = 0; error == NULL && i < count; i++)
+      {
+        error = tic_set_target_velocity(handles[i], 0);
+      }
+      break;
+    }
+
+    int64_t now_ns = tic_clock_ns();
+    if (timeout_ms != TIC_WAIT_FOREVER && now_ns - start_ns >= timeout_ns)
+    {
+      error = tic_error_add_code(
+        tic_error_create("The motors did not settle in time."),
+        TIC_ERROR_TIMEOUT);
+      break;
+    }
+
+    // If the updates took longer than the interval, skip the deadlines we
+    // missed instead of trying to catch up.
+    int64_t next_period = period + 1;
+    if (now_ns > start_ns + next_period * interval_ns)
+    {
+      next_period = (now_ns - start_ns) / interval_ns + 1;
+      for (size_t i = 0; i < count; i++) { servos[i]->overrun_count++; }
+    }
+    dt_us = (uint32_t)((next_period - period) * interval_us);
+    period = next_period;
+  }
+
+  // Otherwise the motors would keep going at the last velocities we sent.
+  // The original error is more useful than any errors from stopping.
+  if (error != NULL)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      tic_error_free(tic_set_target_velocity(handles[i], 0));
+    }
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
@@ -395,6 +395,8 @@ tic_error * tic_set_settings(tic_handle * handle, const tic_settings * settings)
     return tic_error_create("Settings object is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   tic_settings * fixed_settings = NULL;
@@ -448,5 +450,6 @@ tic_error * tic_set_settings(tic_handle * handle, const tic_settings * settings)
       "There was an error applying settings to the device.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
@@ -1006,6 +1006,8 @@ tic_error * tic_settings_fix(tic_settings * settings, char ** warnings)
     return tic_error_create("Tic settings pointer is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   // Make a string to store the warnings we accumulate in this function.
   tic_string str;
   if (warnings)
@@ -1030,6 +1032,8 @@ tic_error * tic_settings_fix(tic_settings * settings, char ** warnings)
   }
   #endif
 
+  tic_trace_end(__func__, trace_start_us);
+
   if (warnings && str.data == NULL)
   {
     // Memory allocation for the warning string failed at some point.
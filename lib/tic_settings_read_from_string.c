@@ -992,6 +992,8 @@ tic_error * tic_settings_read_from_string(const char * string,
     return tic_error_create("Settings output pointer is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   // Allocate a new settings object.
@@ -1065,5 +1067,6 @@ tic_error * tic_settings_read_from_string(const char * string,
     error = tic_error_add(error, "There was an error reading the settings file.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
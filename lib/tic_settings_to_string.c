@@ -39,6 +39,8 @@ tic_error * tic_settings_to_string(const tic_settings * settings, char ** string
     return tic_error_create("Settings pointer is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   tic_string str;
@@ -448,5 +450,6 @@ tic_error * tic_settings_to_string(const tic_settings * settings, char ** string
 
   tic_string_free(str.data);
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
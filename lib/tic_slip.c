@@ -0,0 +1,187 @@
+// Functions for noticing when the motor stalls or loses steps.
+//
+// The Tic counts the steps it sends to the motor and, separately, the pulses
+// from a quadrature encoder on the motor.  If the motor follows the steps,
+// the two counts change together once the encoder count is scaled to
+// microsteps.  The monitor remembers the difference between them when it
+// starts and flags a slip when the difference moves away from that by more
+// than a threshold.  It only uses variables that the caller already read, so
+// it can run inside any loop that polls the Tic.
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+struct tic_slip_monitor
+{
+  uint32_t encoder_prescaler;
+  uint32_t encoder_postscaler;
+  uint32_t threshold;
+  uint8_t action;
+
+  // True if we have a reference difference between the positions.
+  bool started;
+  double reference;
+
+  double deviation;
+  double max_deviation;
+  bool slipped;
+};
+
+tic_error * tic_slip_monitor_create(tic_slip_monitor ** monitor)
+{
+  if (monitor == NULL)
+  {
+    return tic_error_create("Slip monitor output pointer is null.");
+  }
+
+  *monitor = NULL;
+
+  tic_slip_monitor * new_monitor = calloc(1, sizeof(tic_slip_monitor));
+  if (new_monitor == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  new_monitor->encoder_prescaler = 1;
+  new_monitor->encoder_postscaler = 1;
+  new_monitor->threshold = 200;
+  new_monitor->action = TIC_SLIP_ACTION_NONE;
+
+  *monitor = new_monitor;
+  return NULL;
+}
+
+void tic_slip_monitor_free(tic_slip_monitor * monitor)
+{
+  free(monitor);
+}
+
+void tic_slip_monitor_set_encoder_scaling(tic_slip_monitor * monitor,
+  uint32_t prescaler, uint32_t postscaler)
+{
+  if (monitor == NULL) { return; }
+  prescaler = prescaler ? prescaler : 1;
+  postscaler = postscaler ? postscaler : 1;
+  if (prescaler != monitor->encoder_prescaler ||
+    postscaler != monitor->encoder_postscaler)
+  {
+    // The old reference is meaningless with the new scaling.
+    monitor->encoder_prescaler = prescaler;
+    monitor->encoder_postscaler = postscaler;
+    monitor->started = false;
+  }
+}
+
+void tic_slip_monitor_set_threshold(tic_slip_monitor * monitor,
+  uint32_t threshold)
+{
+  if (monitor == NULL) { return; }
+  monitor->threshold = threshold;
+}
+
+uint32_t tic_slip_monitor_get_threshold(const tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return 0; }
+  return monitor->threshold;
+}
+
+void tic_slip_monitor_set_action(tic_slip_monitor * monitor, uint8_t action)
+{
+  if (monitor == NULL) { return; }
+  monitor->action = action;
+}
+
+uint8_t tic_slip_monitor_get_action(const tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return 0; }
+  return monitor->action;
+}
+
+void tic_slip_monitor_reset(tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return; }
+  monitor->started = false;
+  monitor->deviation = 0;
+  monitor->max_deviation = 0;
+  monitor->slipped = false;
+}
+
+tic_error * tic_slip_monitor_check(tic_slip_monitor * monitor,
+  tic_handle * handle, const tic_variables * variables)
+{
+  if (monitor == NULL)
+  {
+    return tic_error_create("Slip monitor is null.");
+  }
+
+  if (variables == NULL)
+  {
+    return tic_error_create("Variables are null.");
+  }
+
+  double encoder_position =
+    (double)tic_variables_get_encoder_position(variables) *
+    monitor->encoder_postscaler / monitor->encoder_prescaler;
+  double difference = encoder_position -
+    tic_variables_get_current_position(variables);
+
+  // The motor can be turned by hand while it is not energized, so take a new
+  // reference once it is energized again.
+  if (!tic_variables_get_energized(variables))
+  {
+    monitor->started = false;
+    monitor->deviation = 0;
+    return NULL;
+  }
+
+  if (!monitor->started)
+  {
+    monitor->started = true;
+    monitor->reference = difference;
+  }
+
+  monitor->deviation = difference - monitor->reference;
+  if (fabs(monitor->deviation) > monitor->max_deviation)
+  {
+    monitor->max_deviation = fabs(monitor->deviation);
+  }
+
+  if (monitor->slipped || monitor->threshold == 0 ||
+    fabs(monitor->deviation) <= monitor->threshold)
+  {
+    return NULL;
+  }
+
+  // Only act the first time so we do not keep sending commands while the
+  // slip is still flagged.
+  monitor->slipped = true;
+
+  switch (monitor->action)
+  {
+  case TIC_SLIP_ACTION_HALT_AND_HOLD:
+    return tic_halt_and_hold(handle);
+  case TIC_SLIP_ACTION_DEENERGIZE:
+    return tic_deenergize(handle);
+  default:
+    return NULL;
+  }
+}
+
+bool tic_slip_monitor_slipped(const tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return false; }
+  return monitor->slipped;
+}
+
+double tic_slip_monitor_get_deviation(const tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return 0; }
+  return monitor->deviation;
+}
+
+double tic_slip_monitor_get_max_deviation(const tic_slip_monitor * monitor)
+{
+  if (monitor == NULL) { return 0; }
+  return monitor->max_deviation;
+}
@@ -0,0 +1,286 @@
+// Functions for measuring how long requests to the device take.
+//
+// Latencies are recorded in histograms with log-linear buckets: the first
+// buckets hold 0, 1, 2, and 3 microseconds, and after that each power of two
+// is split into TIC_STATS_SUB_BUCKET_COUNT buckets of equal width.  Recording
+// only uses atomic additions, so it never blocks and can be done from several
+// threads while another thread takes a snapshot.
+
+#include "tic_internal.h"
+
+#define TIC_STATS_SUB_BUCKET_BITS 2
+#define TIC_STATS_SUB_BUCKET_COUNT (1 << TIC_STATS_SUB_BUCKET_BITS)
+
+typedef struct tic_request_stats
+{
+  uint64_t count;
+  uint64_t error_count;
+  uint64_t timeout_count;
+  uint64_t total_us;
+  uint64_t max_us;
+  uint64_t buckets[TIC_STATS_BUCKET_COUNT];
+} tic_request_stats;
+
+struct tic_stats
+{
+  // One entry per request code, allocated the first time it is used.
+  tic_request_stats * requests[256];
+};
+
+static uint32_t tic_stats_bucket_index(uint64_t latency_us)
+{
+  if (latency_us < TIC_STATS_SUB_BUCKET_COUNT) { return latency_us; }
+
+  uint32_t msb = 63 - __builtin_clzll(latency_us);
+  uint32_t shift = msb - TIC_STATS_SUB_BUCKET_BITS;
+  uint32_t index = TIC_STATS_SUB_BUCKET_COUNT +
+    shift * TIC_STATS_SUB_BUCKET_COUNT +
+    ((latency_us >> shift) & (TIC_STATS_SUB_BUCKET_COUNT - 1));
+  if (index >= TIC_STATS_BUCKET_COUNT) { index = TIC_STATS_BUCKET_COUNT - 1; }
+  return index;
+}
+
+uint64_t tic_stats_get_bucket_limit_us(uint32_t bucket)
+{
+  if (bucket < TIC_STATS_SUB_BUCKET_COUNT) { return bucket; }
+  if (bucket >= TIC_STATS_BUCKET_COUNT - 1) { return UINT64_MAX; }
+
+  uint32_t shift = (bucket - TIC_STATS_SUB_BUCKET_COUNT) /
+    TIC_STATS_SUB_BUCKET_COUNT;
+  uint64_t sub_bucket = bucket % TIC_STATS_SUB_BUCKET_COUNT;
+  uint64_t lower = (TIC_STATS_SUB_BUCKET_COUNT + sub_bucket) << shift;
+  return lower + ((uint64_t)1 << shift) - 1;
+}
+
+tic_error * tic_stats_create(tic_stats ** stats)
+{
+  if (stats == NULL)
+  {
+    return tic_error_create("Stats output pointer is null.");
+  }
+
+  *stats = calloc(1, sizeof(tic_stats));
+  if (*stats == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  return NULL;
+}
+
+void tic_stats_free(tic_stats * stats)
+{
+  if (stats != NULL)
+  {
+    for (size_t i = 0; i < 256; i++)
+    {
+      free(stats->requests[i]);
+    }
+    free(stats);
+  }
+}
+
+tic_error * tic_stats_copy(const tic_stats * source, tic_stats ** dest)
+{
+  if (dest == NULL)
+  {
+    return tic_error_create("Stats output pointer is null.");
+  }
+
+  *dest = NULL;
+
+  if (source == NULL)
+  {
+    return NULL;
+  }
+
+  tic_error * error = NULL;
+
+  tic_stats * new_stats = NULL;
+  if (error == NULL)
+  {
+    error = tic_stats_create(&new_stats);
+  }
+
+  for (size_t i = 0; error == NULL && i < 256; i++)
+  {
+    const tic_request_stats * row =
+      __atomic_load_n(&source->requests[i], __ATOMIC_ACQUIRE);
+    if (row == NULL) { continue; }
+
+    tic_request_stats * new_row = calloc(1, sizeof(tic_request_stats));
+    if (new_row == NULL)
+    {
+      error = &tic_error_no_memory;
+      break;
+    }
+
+    // The fields are read one at a time while other threads might be
+    // recording, so a snapshot can be off by the requests in progress.
+    new_row->count = __atomic_load_n(&row->count, __ATOMIC_RELAXED);
+    new_row->error_count = __atomic_load_n(&row->error_count, __ATOMIC_RELAXED);
+    new_row->timeout_count = __atomic_load_n(&row->timeout_count, __ATOMIC_RELAXED);
+    new_row->total_us = __atomic_load_n(&row->total_us, __ATOMIC_RELAXED);
+    new_row->max_us = __atomic_load_n(&row->max_us, __ATOMIC_RELAXED);
+    for (size_t j = 0; j < TIC_STATS_BUCKET_COUNT; j++)
+    {
+      new_row->buckets[j] = __atomic_load_n(&row->buckets[j], __ATOMIC_RELAXED);
+    }
+    new_stats->requests[i] = new_row;
+  }
+
+  if (error == NULL)
+  {
+    *dest = new_stats;
+    new_stats = NULL;
+  }
+
+  tic_stats_free(new_stats);
+
+  return error;
+}
+
+void tic_stats_record(tic_stats * stats, uint8_t request,
+  uint64_t latency_us, const tic_error * error)
+{
+  if (stats == NULL) { return; }
+
+  tic_request_stats * row =
+    __atomic_load_n(&stats->requests[request], __ATOMIC_ACQUIRE);
+  if (row == NULL)
+  {
+    tic_request_stats * new_row = calloc(1, sizeof(tic_request_stats));
+    if (new_row == NULL) { return; }
+    if (__atomic_compare_exchange_n(&stats->requests[request], &row, new_row,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      row = new_row;
+    }
+    else
+    {
+      // Another thread allocated it first.
+      free(new_row);
+    }
+  }
+
+  __atomic_fetch_add(&row->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&row->total_us, latency_us, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&row->buckets[tic_stats_bucket_index(latency_us)], 1,
+    __ATOMIC_RELAXED);
+
+  uint64_t max_us = __atomic_load_n(&row->max_us, __ATOMIC_RELAXED);
+  while (latency_us > max_us &&
+    !__atomic_compare_exchange_n(&row->max_us, &max_us, latency_us,
+      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+
+  if (error != NULL)
+  {
+    __atomic_fetch_add(&row->error_count, 1, __ATOMIC_RELAXED);
+    if (tic_error_has_code(error, TIC_ERROR_TIMEOUT))
+    {
+      __atomic_fetch_add(&row->timeout_count, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static const tic_request_stats * tic_stats_row(const tic_stats * stats,
+  uint8_t request)
+{
+  if (stats == NULL) { return NULL; }
+  return stats->requests[request];
+}
+
+uint64_t tic_stats_get_count(const tic_stats * stats, uint8_t request)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  return row ? row->count : 0;
+}
+
+uint64_t tic_stats_get_error_count(const tic_stats * stats, uint8_t request)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  return row ? row->error_count : 0;
+}
+
+uint64_t tic_stats_get_timeout_count(const tic_stats * stats, uint8_t request)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  return row ? row->timeout_count : 0;
+}
+
+uint64_t tic_stats_get_total_us(const tic_stats * stats, uint8_t request)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  return row ? row->total_us : 0;
+}
+
+uint64_t tic_stats_get_max_us(const tic_stats * stats, uint8_t request)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  return row ? row->max_us : 0;
+}
+
+uint64_t tic_stats_get_bucket(const tic_stats * stats, uint8_t request,
+  uint32_t bucket)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  if (row == NULL || bucket >= TIC_STATS_BUCKET_COUNT) { return 0; }
+  return row->buckets[bucket];
+}
+
+uint64_t tic_stats_get_percentile_us(const tic_stats * stats, uint8_t request,
+  double percentile)
+{
+  const tic_request_stats * row = tic_stats_row(stats, request);
+  if (row == NULL || row->count == 0) { return 0; }
+
+  // The number of samples that must be at or below the result.
+  double rank = percentile / 100 * row->count;
+  uint64_t needed = (uint64_t)rank;
+  if (needed < rank) { needed++; }
+  if (needed == 0) { needed = 1; }
+
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < TIC_STATS_BUCKET_COUNT; i++)
+  {
+    seen += row->buckets[i];
+    if (seen >= needed)
+    {
+      uint64_t limit = tic_stats_get_bucket_limit_us(i);
+      return limit < row->max_us ? limit : row->max_us;
+    }
+  }
+  return row->max_us;
+}
+
+tic_stats * tic_stats_fake(void)
+{
+  static const struct { uint8_t request; uint32_t latency_us; bool timeout; }
+  samples[] = {
+    { TIC_CMD_GET_VARIABLE, 950, false },
+    { TIC_CMD_GET_VARIABLE, 1000, false },
+    { TIC_CMD_GET_VARIABLE, 1020, false },
+    { TIC_CMD_GET_VARIABLE, 1100, false },
+    { TIC_CMD_GET_VARIABLE, 7900, false },
+    { TIC_CMD_SET_TARGET_POSITION, 3, false },
+    { TIC_CMD_SET_TARGET_POSITION, 130, false },
+    { TIC_CMD_SET_TARGET_POSITION, 1600000, true },
+  };
+
+  tic_stats * stats = NULL;
+  tic_error_free(tic_stats_create(&stats));
+  if (stats == NULL) { return NULL; }
+
+  tic_error * timeout = tic_error_add_code(
+    tic_error_create("Fake timeout."), TIC_ERROR_TIMEOUT);
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+  {
+    tic_stats_record(stats, samples[i].request, samples[i].latency_us,
+      samples[i].timeout ? timeout : NULL);
+  }
+  tic_error_free(timeout);
+
+  return stats;
+}
@@ -0,0 +1,514 @@
+// Functions for sending a timed sequence of targets to a Tic.
+//
+// The targets are sent from a thread that sleeps until the absolute time of
+// each point, so delays in sending one point do not make later points late.
+// If the thread falls so far behind that the next point is already due, it
+// skips the stale point instead of sending it.  When replaying a USB
+// recording, every point is sent so the transfers match the recording no
+// matter how slow the thread is.
+
+// For pthread_setaffinity_np().
+#define _GNU_SOURCE
+
+#include "tic_internal.h"
+
+#include <math.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+typedef struct tic_stream_point
+{
+  int64_t time_us;
+  int32_t target;
+  uint8_t planning_mode;
+} tic_stream_point;
+
+struct tic_stream
+{
+  tic_stream_point * points;
+  size_t point_count;
+  size_t point_capacity;
+
+  int priority;
+  int cpu;
+  uint32_t max_lateness_us;
+
+  tic_handle * handle;
+  bool skip_stale;
+  bool running;
+  bool stop_requested;
+  tic_error * error;
+#ifndef _WIN32
+  pthread_t thread;
+
+  // The thread waits on stop_cond between points so that tic_stream_stop()
+  // can wake it up.  stop_mutex protects stop_requested.
+  pthread_mutex_t stop_mutex;
+  pthread_cond_t stop_cond;
+#endif
+
+  // One entry per point that was sent.  These are sorted after the thread
+  // finishes so we can get percentiles from them.
+  int64_t * lateness_ns;
+  int64_t * send_time_ns;
+  size_t sent_count;
+
+  size_t missed_count;
+  size_t skipped_count;
+};
+
+tic_error * tic_stream_create(tic_stream ** stream)
+{
+  if (stream == NULL)
+  {
+    return tic_error_create("Stream output pointer is null.");
+  }
+
+  *stream = NULL;
+
+  tic_stream * new_stream = calloc(1, sizeof(tic_stream));
+  if (new_stream == NULL)
+  {
+    return &tic_error_no_memory;
+  }
+
+  new_stream->cpu = -1;
+  new_stream->max_lateness_us = 1000;
+
+#ifndef _WIN32
+  tic_error * error = NULL;
+  pthread_condattr_t cond_attr;
+  int result = pthread_condattr_init(&cond_attr);
+#ifdef __linux__
+  // Wait with the same clock that tic_clock_ns() uses.
+  if (result == 0)
+  {
+    result = pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    if (result) { pthread_condattr_destroy(&cond_attr); }
+  }
+#endif
+  if (result == 0)
+  {
+    result = pthread_cond_init(&new_stream->stop_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+  }
+  if (result == 0)
+  {
+    result = pthread_mutex_init(&new_stream->stop_mutex, NULL);
+    if (result) { pthread_cond_destroy(&new_stream->stop_cond); }
+  }
+  if (result)
+  {
+    error = tic_error_create("Failed to initialize the stream: %s.",
+      strerror(result));
+    free(new_stream);
+    return error;
+  }
+#endif
+
+  *stream = new_stream;
+  return NULL;
+}
+
+void tic_stream_free(tic_stream * stream)
+{
+  if (stream != NULL)
+  {
+    if (stream->running)
+    {
+      tic_stream_stop(stream);
+      tic_error_free(tic_stream_wait(stream));
+    }
+    tic_error_free(stream->error);
+#ifndef _WIN32
+    pthread_cond_destroy(&stream->stop_cond);
+    pthread_mutex_destroy(&stream->stop_mutex);
+#endif
+    free(stream->points);
+    free(stream->lateness_ns);
+    free(stream->send_time_ns);
+    free(stream);
+  }
+}
+
+tic_error * tic_stream_add_point(tic_stream * stream, int64_t time_us,
+  uint8_t planning_mode, int32_t target)
+{
+  if (stream == NULL)
+  {
+    return tic_error_create("Stream is null.");
+  }
+
+  if (stream->running)
+  {
+    return tic_error_create("Points cannot be added while the stream is running.");
+  }
+
+  if (planning_mode != TIC_PLANNING_MODE_TARGET_POSITION &&
+    planning_mode != TIC_PLANNING_MODE_TARGET_VELOCITY)
+  {
+    return tic_error_create("Invalid planning mode: %u.", planning_mode);
+  }
+
+  if (stream->point_count &&
+    time_us < stream->points[stream->point_count - 1].time_us)
+  {
+    return tic_error_create("The points of a stream must be in time order.");
+  }
+
+  if (stream->point_count == stream->point_capacity)
+  {
+    size_t new_capacity = stream->point_capacity ? stream->point_capacity * 2 : 64;
+    tic_stream_point * new_points = realloc(stream->points,
+      new_capacity * sizeof(tic_stream_point));
+    if (new_points == NULL)
+    {
+      return &tic_error_no_memory;
+    }
+    stream->points = new_points;
+    stream->point_capacity = new_capacity;
+  }
+
+  tic_stream_point * point = &stream->points[stream->point_count++];
+  point->time_us = time_us;
+  point->planning_mode = planning_mode;
+  point->target = target;
+  return NULL;
+}
+
+size_t tic_stream_get_point_count(const tic_stream * stream)
+{
+  if (stream == NULL) { return 0; }
+  return stream->point_count;
+}
+
+void tic_stream_set_priority(tic_stream * stream, int priority)
+{
+  if (stream == NULL) { return; }
+  stream->priority = priority;
+}
+
+void tic_stream_set_cpu(tic_stream * stream, int cpu)
+{
+  if (stream == NULL) { return; }
+  stream->cpu = cpu;
+}
+
+void tic_stream_set_max_lateness_us(tic_stream * stream, uint32_t max_lateness_us)
+{
+  if (stream == NULL) { return; }
+  stream->max_lateness_us = max_lateness_us;
+}
+
+#ifdef _WIN32
+
+tic_error * tic_stream_start(tic_stream * stream, tic_handle * handle)
+{
+  (void)stream;
+  (void)handle;
+  return tic_error_create("Streaming is not supported on Windows.");
+}
+
+void tic_stream_stop(tic_stream * stream)
+{
+  (void)stream;
+}
+
+tic_error * tic_stream_wait(tic_stream * stream)
+{
+  (void)stream;
+  return NULL;
+}
+
+#else
+
+static tic_error * tic_stream_send(tic_handle * handle,
+  const tic_stream_point * point)
+{
+  if (point->planning_mode == TIC_PLANNING_MODE_TARGET_POSITION)
+  {
+    return tic_set_target_position(handle, point->target);
+  }
+  return tic_set_target_velocity(handle, point->target);
+}
+
+// Sleeps until tic_clock_ns() reaches the deadline, like tic_sleep_until_ns(),
+// or until tic_stream_stop() is called.  Returns true if it was stopped.
+static bool tic_stream_sleep_until_ns(tic_stream * stream, int64_t deadline_ns)
+{
+  pthread_mutex_lock(&stream->stop_mutex);
+  while (!stream->stop_requested)
+  {
+    int64_t now_ns = tic_clock_ns();
+    if (now_ns >= deadline_ns) { break; }
+
+#ifdef __linux__
+    int64_t wake_ns = deadline_ns;
+#else
+    // Other systems use the real-time clock for this, so convert the time
+    // left into a time on that clock.
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    int64_t wake_ns = (int64_t)realtime.tv_sec * 1000000000 +
+      realtime.tv_nsec + (deadline_ns - now_ns);
+#endif
+
+    struct timespec ts;
+    ts.tv_sec = wake_ns / 1000000000;
+    ts.tv_nsec = wake_ns % 1000000000;
+    pthread_cond_timedwait(&stream->stop_cond, &stream->stop_mutex, &ts);
+  }
+  bool stopped = stream->stop_requested;
+  pthread_mutex_unlock(&stream->stop_mutex);
+  return stopped;
+}
+
+static void * tic_stream_thread(void * arg)
+{
+  tic_stream * stream = arg;
+
+  if (stream->cpu >= 0)
+  {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(stream->cpu, &cpus);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result)
+    {
+      stream->error = tic_error_create(
+        "Failed to run the streaming thread on CPU %d: %s.",
+        stream->cpu, strerror(result));
+      return NULL;
+    }
+#else
+    stream->error = tic_error_create(
+      "Choosing a CPU for streaming is only supported on Linux.");
+    return NULL;
+#endif
+  }
+
+  int64_t start_ns = tic_clock_ns();
+
+  for (size_t i = 0; i < stream->point_count; i++)
+  {
+    const tic_stream_point * point = &stream->points[i];
+    int64_t deadline_ns = start_ns + point->time_us * 1000;
+    if (tic_stream_sleep_until_ns(stream, deadline_ns)) { break; }
+
+    int64_t send_start_ns = tic_clock_ns();
+    if (stream->skip_stale && i + 1 < stream->point_count &&
+      send_start_ns >= start_ns + stream->points[i + 1].time_us * 1000)
+    {
+      // The next point is due already, so this one is stale.
+      stream->skipped_count++;
+      stream->missed_count++;
+      continue;
+    }
+
+    tic_error * error = tic_stream_send(stream->handle, point);
+    int64_t send_end_ns = tic_clock_ns();
+    if (error != NULL)
+    {
+      stream->error = tic_error_add(error,
+        "There was an error sending point %u of the stream.", (unsigned int)i);
+      break;
+    }
+
+    int64_t lateness_ns = send_start_ns - deadline_ns;
+    if (lateness_ns > (int64_t)stream->max_lateness_us * 1000)
+    {
+      stream->missed_count++;
+    }
+    stream->lateness_ns[stream->sent_count] = lateness_ns;
+    stream->send_time_ns[stream->sent_count] = send_end_ns - send_start_ns;
+    stream->sent_count++;
+  }
+
+  return NULL;
+}
+
+tic_error * tic_stream_start(tic_stream * stream, tic_handle * handle)
+{
+  if (stream == NULL)
+  {
+    return tic_error_create("Stream is null.");
+  }
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (stream->running)
+  {
+    return tic_error_create("The stream is already running.");
+  }
+
+#ifdef __linux__
+  if (stream->cpu >= CPU_SETSIZE)
+  {
+    return tic_error_create("Invalid CPU for streaming: %d.", stream->cpu);
+  }
+#endif
+
+  tic_error_free(stream->error);
+  stream->error = NULL;
+  stream->handle = handle;
+  stream->skip_stale = !tic_replay_enabled();
+  stream->stop_requested = false;
+  stream->sent_count = 0;
+  stream->missed_count = 0;
+  stream->skipped_count = 0;
+
+  // Allocate everything the thread needs before starting it so it does not
+  // have to allocate memory.
+  tic_error * error = NULL;
+  size_t count = stream->point_count ? stream->point_count : 1;
+  free(stream->lateness_ns);
+  free(stream->send_time_ns);
+  stream->lateness_ns = malloc(count * sizeof(int64_t));
+  stream->send_time_ns = malloc(count * sizeof(int64_t));
+  if (stream->lateness_ns == NULL || stream->send_time_ns == NULL)
+  {
+    error = &tic_error_no_memory;
+  }
+
+  pthread_attr_t attr;
+  bool attr_initialized = false;
+  if (error == NULL)
+  {
+    int result = pthread_attr_init(&attr);
+    if (result)
+    {
+      error = tic_error_create("Failed to initialize thread attributes: %s.",
+        strerror(result));
+    }
+    else
+    {
+      attr_initialized = true;
+    }
+  }
+
+  if (error == NULL && stream->priority > 0)
+  {
+    struct sched_param param = { 0 };
+    param.sched_priority = stream->priority;
+    int result = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    if (result == 0) { result = pthread_attr_setschedpolicy(&attr, SCHED_FIFO); }
+    if (result == 0) { result = pthread_attr_setschedparam(&attr, &param); }
+    if (result)
+    {
+      error = tic_error_create("Failed to set real-time priority %d: %s.",
+        stream->priority, strerror(result));
+    }
+  }
+
+  if (error == NULL)
+  {
+    int result = pthread_create(&stream->thread, &attr, tic_stream_thread, stream);
+    if (result)
+    {
+      error = tic_error_create("Failed to start the streaming thread: %s.",
+        strerror(result));
+      if (result == EPERM)
+      {
+        error = tic_error_add_code(error, TIC_ERROR_ACCESS_DENIED);
+      }
+    }
+    else
+    {
+      stream->running = true;
+    }
+  }
+
+  if (attr_initialized)
+  {
+    pthread_attr_destroy(&attr);
+  }
+
+  return error;
+}
+
+void tic_stream_stop(tic_stream * stream)
+{
+  if (stream == NULL) { return; }
+  pthread_mutex_lock(&stream->stop_mutex);
+  stream->stop_requested = true;
+  pthread_cond_signal(&stream->stop_cond);
+  pthread_mutex_unlock(&stream->stop_mutex);
+}
+
+static int tic_stream_compare(const void * a, const void * b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+tic_error * tic_stream_wait(tic_stream * stream)
+{
+  if (stream == NULL)
+  {
+    return tic_error_create("Stream is null.");
+  }
+
+  if (!stream->running) { return NULL; }
+
+  pthread_join(stream->thread, NULL);
+  stream->running = false;
+
+  qsort(stream->lateness_ns, stream->sent_count, sizeof(int64_t),
+    tic_stream_compare);
+  qsort(stream->send_time_ns, stream->sent_count, sizeof(int64_t),
+    tic_stream_compare);
+
+  return tic_error_copy(stream->error);
+}
+
+#endif
+
+size_t tic_stream_get_sent_count(const tic_stream * stream)
+{
+  if (stream == NULL) { return 0; }
+  return stream->sent_count;
+}
+
+size_t tic_stream_get_missed_count(const tic_stream * stream)
+{
+  if (stream == NULL) { return 0; }
+  return stream->missed_count;
+}
+
+size_t tic_stream_get_skipped_count(const tic_stream * stream)
+{
+  if (stream == NULL) { return 0; }
+  return stream->skipped_count;
+}
+
+// Gets a percentile of sorted samples using the nearest-rank method.
+static int64_t tic_stream_percentile(const int64_t * sorted, size_t count,
+  double percent)
+{
+  if (count == 0) { return 0; }
+  size_t rank = (size_t)ceil(percent / 100 * count);
+  if (rank < 1) { rank = 1; }
+  if (rank > count) { rank = count; }
+  return sorted[rank - 1];
+}
+
+int64_t tic_stream_get_lateness_ns(const tic_stream * stream, double percent)
+{
+  if (stream == NULL || stream->running) { return 0; }
+  return tic_stream_percentile(stream->lateness_ns, stream->sent_count, percent);
+}
+
+int64_t tic_stream_get_send_time_ns(const tic_stream * stream, double percent)
+{
+  if (stream == NULL || stream->running) { return 0; }
+  return tic_stream_percentile(stream->send_time_ns, stream->sent_count, percent);
+}
@@ -0,0 +1,353 @@
+// Functions for sending a command to several Tics at the same time.
+//
+// Sending the commands one after the other from a single thread delays each
+// axis by the time it takes to send the commands to the axes before it.
+// Instead, each axis has its own thread that waits for the next command.
+// When we send a command, we wake up all the threads and wait until every one
+// of them is ready, and then release them together with a single atomic
+// store.  The threads spin while they wait to be released so that they start
+// sending within a few microseconds of each other.
+
+#include "tic_internal.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define TIC_SYNC_COMMAND_TARGET_POSITION 1
+#define TIC_SYNC_COMMAND_HALT_AND_HOLD 2
+
+typedef struct tic_sync_axis
+{
+  struct tic_sync * sync;
+  tic_handle * handle;
+#ifndef _WIN32
+  pthread_t thread;
+#endif
+  int32_t target;
+  tic_error * error;
+  int64_t issue_ns;
+  int64_t complete_ns;
+} tic_sync_axis;
+
+struct tic_sync
+{
+  tic_sync_axis * axes;
+  size_t count;
+  size_t started_count;
+
+#ifndef _WIN32
+  pthread_mutex_t mutex;
+  pthread_cond_t command_cond;
+  pthread_cond_t main_cond;
+#endif
+
+  // These are protected by the mutex.  The generation counts the commands, so
+  // each thread can tell when there is a new one.
+  uint32_t generation;
+  uint8_t command;
+  bool quit;
+  size_t ready_count;
+  size_t done_count;
+
+  // The threads send the command once this equals the generation.
+  uint32_t released;
+};
+
+#ifdef _WIN32
+
+tic_error * tic_sync_create(tic_handle * const * handles, size_t count,
+  tic_sync ** sync)
+{
+  (void)handles;
+  (void)count;
+  if (sync) { *sync = NULL; }
+  return tic_error_create(
+    "Synchronized commands are not supported on Windows.");
+}
+
+void tic_sync_free(tic_sync * sync)
+{
+  (void)sync;
+}
+
+static tic_error * tic_sync_run(tic_sync * sync, uint8_t command)
+{
+  (void)sync;
+  (void)command;
+  return tic_error_create(
+    "Synchronized commands are not supported on Windows.");
+}
+
+#else
+
+static tic_error * tic_sync_send(tic_sync_axis * axis, uint8_t command)
+{
+  if (command == TIC_SYNC_COMMAND_TARGET_POSITION)
+  {
+    return tic_set_target_position(axis->handle, axis->target);
+  }
+  return tic_halt_and_hold(axis->handle);
+}
+
+static void * tic_sync_thread(void * arg)
+{
+  tic_sync_axis * axis = arg;
+  tic_sync * sync = axis->sync;
+  uint32_t generation = 0;
+
+  pthread_mutex_lock(&sync->mutex);
+  while (true)
+  {
+    while (sync->generation == generation && !sync->quit)
+    {
+      pthread_cond_wait(&sync->command_cond, &sync->mutex);
+    }
+    if (sync->quit) { break; }
+
+    generation = sync->generation;
+    uint8_t command = sync->command;
+    if (++sync->ready_count == sync->count)
+    {
+      pthread_cond_signal(&sync->main_cond);
+    }
+    pthread_mutex_unlock(&sync->mutex);
+
+    while (__atomic_load_n(&sync->released, __ATOMIC_ACQUIRE) != generation) { }
+
+    axis->issue_ns = tic_clock_ns();
+    tic_error * error = tic_sync_send(axis, command);
+    axis->complete_ns = tic_clock_ns();
+
+    pthread_mutex_lock(&sync->mutex);
+    axis->error = error;
+    if (++sync->done_count == sync->count)
+    {
+      pthread_cond_signal(&sync->main_cond);
+    }
+  }
+  pthread_mutex_unlock(&sync->mutex);
+
+  return NULL;
+}
+
+tic_error * tic_sync_create(tic_handle * const * handles, size_t count,
+  tic_sync ** sync)
+{
+  if (sync == NULL)
+  {
+    return tic_error_create("Sync output pointer is null.");
+  }
+
+  *sync = NULL;
+
+  if (handles == NULL || count == 0)
+  {
+    return tic_error_create("A sync group needs at least one handle.");
+  }
+
+  tic_error * error = NULL;
+
+  tic_sync * new_sync = calloc(1, sizeof(tic_sync));
+  if (new_sync == NULL)
+  {
+    error = &tic_error_no_memory;
+  }
+
+  if (error == NULL)
+  {
+    new_sync->count = count;
+    new_sync->axes = calloc(count, sizeof(tic_sync_axis));
+    if (new_sync->axes == NULL)
+    {
+      free(new_sync);
+      error = &tic_error_no_memory;
+    }
+  }
+
+  if (error == NULL)
+  {
+    pthread_mutex_init(&new_sync->mutex, NULL);
+    pthread_cond_init(&new_sync->command_cond, NULL);
+    pthread_cond_init(&new_sync->main_cond, NULL);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      tic_sync_axis * axis = &new_sync->axes[i];
+      axis->sync = new_sync;
+      axis->handle = handles[i];
+      int result = pthread_create(&axis->thread, NULL, tic_sync_thread, axis);
+      if (result)
+      {
+        error = tic_error_create("Failed to start a thread for axis %u: %s.",
+          (unsigned int)i, strerror(result));
+        break;
+      }
+      new_sync->started_count++;
+    }
+
+    if (error != NULL)
+    {
+      tic_sync_free(new_sync);
+    }
+  }
+
+  if (error == NULL)
+  {
+    *sync = new_sync;
+  }
+
+  return error;
+}
+
+void tic_sync_free(tic_sync * sync)
+{
+  if (sync == NULL) { return; }
+
+  pthread_mutex_lock(&sync->mutex);
+  sync->quit = true;
+  pthread_cond_broadcast(&sync->command_cond);
+  pthread_mutex_unlock(&sync->mutex);
+
+  for (size_t i = 0; i < sync->started_count; i++)
+  {
+    pthread_join(sync->axes[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < sync->count; i++)
+  {
+    tic_error_free(sync->axes[i].error);
+  }
+
+  pthread_cond_destroy(&sync->main_cond);
+  pthread_cond_destroy(&sync->command_cond);
+  pthread_mutex_destroy(&sync->mutex);
+  free(sync->axes);
+  free(sync);
+}
+
+static tic_error * tic_sync_run(tic_sync * sync, uint8_t command)
+{
+  int64_t trace_start_us = tic_trace_begin();
+
+  pthread_mutex_lock(&sync->mutex);
+  for (size_t i = 0; i < sync->count; i++)
+  {
+    tic_error_free(sync->axes[i].error);
+    sync->axes[i].error = NULL;
+  }
+  sync->command = command;
+  sync->ready_count = 0;
+  sync->done_count = 0;
+  uint32_t generation = ++sync->generation;
+  pthread_cond_broadcast(&sync->command_cond);
+  while (sync->ready_count < sync->count)
+  {
+    pthread_cond_wait(&sync->main_cond, &sync->mutex);
+  }
+  pthread_mutex_unlock(&sync->mutex);
+
+  __atomic_store_n(&sync->released, generation, __ATOMIC_RELEASE);
+
+  pthread_mutex_lock(&sync->mutex);
+  while (sync->done_count < sync->count)
+  {
+    pthread_cond_wait(&sync->main_cond, &sync->mutex);
+  }
+  pthread_mutex_unlock(&sync->mutex);
+
+  tic_error * error = NULL;
+  for (size_t i = 0; error == NULL && i < sync->count; i++)
+  {
+    if (sync->axes[i].error != NULL)
+    {
+      error = tic_error_add(tic_error_copy(sync->axes[i].error),
+        "There was an error sending a command to axis %u.", (unsigned int)i);
+    }
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
+
+#endif
+
+tic_error * tic_sync_set_target_positions(tic_sync * sync,
+  const int32_t * positions)
+{
+  if (sync == NULL)
+  {
+    return tic_error_create("Sync group is null.");
+  }
+
+  if (positions == NULL)
+  {
+    return tic_error_create("Positions are null.");
+  }
+
+  for (size_t i = 0; i < sync->count; i++)
+  {
+    sync->axes[i].target = positions[i];
+  }
+
+  return tic_sync_run(sync, TIC_SYNC_COMMAND_TARGET_POSITION);
+}
+
+tic_error * tic_sync_halt_and_hold(tic_sync * sync)
+{
+  if (sync == NULL)
+  {
+    return tic_error_create("Sync group is null.");
+  }
+
+  return tic_sync_run(sync, TIC_SYNC_COMMAND_HALT_AND_HOLD);
+}
+
+size_t tic_sync_get_count(const tic_sync * sync)
+{
+  if (sync == NULL) { return 0; }
+  return sync->count;
+}
+
+tic_handle * tic_sync_get_handle(const tic_sync * sync, size_t index)
+{
+  if (sync == NULL || index >= sync->count) { return NULL; }
+  return sync->axes[index].handle;
+}
+
+// Gets the difference between the earliest and latest of the issue times or
+// completion times of the axes.
+static int64_t tic_sync_spread(const tic_sync * sync, bool complete)
+{
+  if (sync == NULL || sync->count == 0) { return 0; }
+  int64_t min = INT64_MAX, max = INT64_MIN;
+  for (size_t i = 0; i < sync->count; i++)
+  {
+    const tic_sync_axis * axis = &sync->axes[i];
+    int64_t t = complete ? axis->complete_ns : axis->issue_ns;
+    if (t < min) { min = t; }
+    if (t > max) { max = t; }
+  }
+  return max - min;
+}
+
+int64_t tic_sync_get_issue_skew_ns(const tic_sync * sync)
+{
+  return tic_sync_spread(sync, false);
+}
+
+int64_t tic_sync_get_complete_skew_ns(const tic_sync * sync)
+{
+  return tic_sync_spread(sync, true);
+}
+
+int64_t tic_sync_get_issue_offset_ns(const tic_sync * sync, size_t index)
+{
+  if (sync == NULL || index >= sync->count) { return 0; }
+  int64_t min = INT64_MAX;
+  for (size_t i = 0; i < sync->count; i++)
+  {
+    if (sync->axes[i].issue_ns < min) { min = sync->axes[i].issue_ns; }
+  }
+  return sync->axes[index].issue_ns - min;
+}
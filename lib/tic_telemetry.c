@@ -0,0 +1,574 @@
+// Functions for publishing the variables of Tics in shared memory so that
+// other processes can read them without talking to the device.
+//
+// The shared memory segment has one slot per device.  Each slot holds the
+// last TIC_TELEMETRY_HISTORY_LENGTH samples in a ring, and each sample is
+// protected by its own sequence lock: the publisher makes the sequence number
+// odd while it is writing the sample, and a reader retries if the sequence
+// number was odd or changed while it was copying the sample.  That way readers
+// never block the publisher and never make system calls, and there can be any
+// number of them.  Each slot can only have one publisher at a time.
+
+#include "tic_internal.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define TIC_TELEMETRY_MAGIC 0x4D4C4554
+#define TIC_TELEMETRY_VERSION 1
+
+// The space reserved for a copy of a tic_variables struct.
+#define TIC_TELEMETRY_VARIABLES_CAPACITY 256
+
+#define TIC_TELEMETRY_SERIAL_NUMBER_SIZE 32
+
+// How many times a reader tries to read a sample before giving up.  Retries
+// are only needed if the publisher writes the sample while we read it, so this
+// limit only matters if a publisher stopped in the middle of writing.
+#define TIC_TELEMETRY_READ_ATTEMPTS 1000
+
+typedef struct tic_telemetry_sample
+{
+  uint32_t sequence;
+  uint32_t reserved;
+  uint64_t sample_number;
+  int64_t time_us;
+  uint8_t variables[TIC_TELEMETRY_VARIABLES_CAPACITY];
+} tic_telemetry_sample;
+
+typedef struct tic_telemetry_slot
+{
+  // The process ID of the publisher, or 0 if there is none.
+  int32_t owner_pid;
+
+  // Non-zero if serial_number is valid.
+  uint32_t ready;
+
+  char serial_number[TIC_TELEMETRY_SERIAL_NUMBER_SIZE];
+
+  uint64_t sample_count;
+
+  tic_telemetry_sample history[TIC_TELEMETRY_HISTORY_LENGTH];
+} tic_telemetry_slot;
+
+typedef struct tic_telemetry_segment
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t history_length;
+  uint32_t variables_size;
+  uint32_t reserved[3];
+  tic_telemetry_slot slots[TIC_TELEMETRY_SLOT_COUNT];
+} tic_telemetry_segment;
+
+struct tic_telemetry_publisher
+{
+  tic_telemetry_segment * segment;
+  tic_telemetry_slot * slot;
+};
+
+struct tic_telemetry
+{
+  const tic_telemetry_segment * segment;
+};
+
+#ifdef _WIN32
+
+static tic_error * tic_telemetry_not_supported(void)
+{
+  return tic_error_create("Telemetry is not supported on Windows.");
+}
+
+tic_error * tic_telemetry_publisher_open(const char * name,
+  const char * serial_number, tic_telemetry_publisher ** publisher)
+{
+  (void)name;
+  (void)serial_number;
+  if (publisher) { *publisher = NULL; }
+  return tic_telemetry_not_supported();
+}
+
+tic_error * tic_telemetry_open(const char * name, tic_telemetry ** telemetry)
+{
+  (void)name;
+  if (telemetry) { *telemetry = NULL; }
+  return tic_telemetry_not_supported();
+}
+
+tic_error * tic_telemetry_remove(const char * name)
+{
+  (void)name;
+  return tic_telemetry_not_supported();
+}
+
+static void tic_telemetry_unmap(const tic_telemetry_segment * segment)
+{
+  (void)segment;
+}
+
+#else
+
+// Returns true if the process with the specified ID is running.
+static bool tic_telemetry_process_alive(int32_t pid)
+{
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Opens and maps the shared memory segment.  If writable is true, the segment
+// is created if it does not exist.
+static tic_error * tic_telemetry_map(const char * name, bool writable,
+  tic_telemetry_segment ** segment)
+{
+  *segment = NULL;
+
+  if (name == NULL)
+  {
+    return tic_error_create("Telemetry name is null.");
+  }
+
+  size_t size = sizeof(tic_telemetry_segment);
+
+  int fd = shm_open(name, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0666);
+  if (fd < 0)
+  {
+    return tic_error_create("Failed to open shared memory %s: %s.",
+      name, strerror(errno));
+  }
+
+  tic_error * error = NULL;
+
+  struct stat st;
+  if (error == NULL && fstat(fd, &st))
+  {
+    error = tic_error_create("Failed to get the size of shared memory %s: %s.",
+      name, strerror(errno));
+  }
+
+  if (error == NULL && (size_t)st.st_size < size)
+  {
+    if (!writable)
+    {
+      error = tic_error_create("Shared memory %s is not ready yet.", name);
+    }
+    else if (ftruncate(fd, size))
+    {
+      error = tic_error_create("Failed to set the size of shared memory %s: %s.",
+        name, strerror(errno));
+    }
+  }
+
+  void * map = MAP_FAILED;
+  if (error == NULL)
+  {
+    map = mmap(NULL, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+      MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      error = tic_error_create("Failed to map shared memory %s: %s.",
+        name, strerror(errno));
+    }
+  }
+
+  close(fd);
+
+  tic_telemetry_segment * new_segment = map == MAP_FAILED ? NULL : map;
+
+  if (error == NULL && writable &&
+    __atomic_load_n(&new_segment->magic, __ATOMIC_ACQUIRE) == 0)
+  {
+    // This is a new segment.  If two publishers do this at the same time,
+    // they write the same values, so that is OK.
+    new_segment->version = TIC_TELEMETRY_VERSION;
+    new_segment->slot_count = TIC_TELEMETRY_SLOT_COUNT;
+    new_segment->history_length = TIC_TELEMETRY_HISTORY_LENGTH;
+    new_segment->variables_size = tic_variables_size;
+    __atomic_store_n(&new_segment->magic, TIC_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+  }
+
+  if (error == NULL)
+  {
+    if (__atomic_load_n(&new_segment->magic, __ATOMIC_ACQUIRE) != TIC_TELEMETRY_MAGIC)
+    {
+      error = tic_error_create("Shared memory %s is not ready yet.", name);
+    }
+    else if (new_segment->version != TIC_TELEMETRY_VERSION ||
+      new_segment->slot_count != TIC_TELEMETRY_SLOT_COUNT ||
+      new_segment->history_length != TIC_TELEMETRY_HISTORY_LENGTH ||
+      new_segment->variables_size != tic_variables_size)
+    {
+      error = tic_error_create(
+        "Shared memory %s was made by an incompatible version of this library.",
+        name);
+    }
+  }
+
+  if (error == NULL)
+  {
+    *segment = new_segment;
+    new_segment = NULL;
+  }
+
+  if (new_segment != NULL)
+  {
+    munmap(new_segment, size);
+  }
+
+  return error;
+}
+
+static void tic_telemetry_unmap(const tic_telemetry_segment * segment)
+{
+  if (segment != NULL)
+  {
+    munmap((void *)segment, sizeof(tic_telemetry_segment));
+  }
+}
+
+// Tries to become the publisher for a slot that is owned by the specified
+// process ID (0 for no owner).
+static bool tic_telemetry_claim(tic_telemetry_slot * slot, int32_t owner_pid)
+{
+  int32_t new_owner_pid = getpid();
+  return __atomic_compare_exchange_n(&slot->owner_pid, &owner_pid,
+    new_owner_pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+static bool tic_telemetry_slot_has_serial_number(
+  const tic_telemetry_slot * slot, const char * serial_number)
+{
+  return __atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE) &&
+    strncmp(slot->serial_number, serial_number,
+      TIC_TELEMETRY_SERIAL_NUMBER_SIZE) == 0;
+}
+
+// Finds a slot for the device and becomes its publisher.  A device always
+// gets the same slot if it had one before, so readers that already looked up
+// the slot keep working.
+static tic_error * tic_telemetry_claim_slot(tic_telemetry_segment * segment,
+  const char * serial_number, tic_telemetry_slot ** result)
+{
+  *result = NULL;
+
+  for (size_t i = 0; i < TIC_TELEMETRY_SLOT_COUNT; i++)
+  {
+    tic_telemetry_slot * slot = &segment->slots[i];
+    if (!tic_telemetry_slot_has_serial_number(slot, serial_number)) { continue; }
+
+    int32_t owner_pid = __atomic_load_n(&slot->owner_pid, __ATOMIC_ACQUIRE);
+    if (owner_pid != 0 && tic_telemetry_process_alive(owner_pid))
+    {
+      return tic_error_create(
+        "Telemetry for this device is already being published.");
+    }
+    if (tic_telemetry_claim(slot, owner_pid))
+    {
+      *result = slot;
+      return NULL;
+    }
+  }
+
+  // Prefer slots that were never used, so that readers can still see the last
+  // samples from devices that are gone.
+  for (int pass = 0; pass < 2; pass++)
+  {
+    for (size_t i = 0; i < TIC_TELEMETRY_SLOT_COUNT; i++)
+    {
+      tic_telemetry_slot * slot = &segment->slots[i];
+      int32_t owner_pid = __atomic_load_n(&slot->owner_pid, __ATOMIC_ACQUIRE);
+      bool available = pass == 0 ?
+        (owner_pid == 0 && !__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) :
+        (owner_pid == 0 || !tic_telemetry_process_alive(owner_pid));
+      if (!available || !tic_telemetry_claim(slot, owner_pid)) { continue; }
+
+      // Samples numbers keep increasing, so readers will not confuse the old
+      // device's samples with the new one's.
+      __atomic_store_n(&slot->ready, 0, __ATOMIC_RELEASE);
+      memset(slot->serial_number, 0, TIC_TELEMETRY_SERIAL_NUMBER_SIZE);
+      strncpy(slot->serial_number, serial_number,
+        TIC_TELEMETRY_SERIAL_NUMBER_SIZE - 1);
+      __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+      *result = slot;
+      return NULL;
+    }
+  }
+
+  return tic_error_create("There are no free telemetry slots.");
+}
+
+tic_error * tic_telemetry_publisher_open(const char * name,
+  const char * serial_number, tic_telemetry_publisher ** publisher)
+{
+  if (publisher == NULL)
+  {
+    return tic_error_create("Publisher output pointer is null.");
+  }
+
+  *publisher = NULL;
+
+  if (serial_number == NULL)
+  {
+    return tic_error_create("Serial number is null.");
+  }
+
+  tic_error * error = NULL;
+
+  tic_telemetry_publisher * new_publisher = NULL;
+  if (error == NULL)
+  {
+    new_publisher = calloc(1, sizeof(tic_telemetry_publisher));
+    if (new_publisher == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  if (error == NULL)
+  {
+    error = tic_telemetry_map(name, true, &new_publisher->segment);
+  }
+
+  if (error == NULL)
+  {
+    error = tic_telemetry_claim_slot(new_publisher->segment,
+      serial_number, &new_publisher->slot);
+  }
+
+  if (error == NULL)
+  {
+    *publisher = new_publisher;
+    new_publisher = NULL;
+  }
+
+  tic_telemetry_publisher_close(new_publisher);
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error,
+      "There was an error starting to publish telemetry.");
+  }
+
+  return error;
+}
+
+tic_error * tic_telemetry_open(const char * name, tic_telemetry ** telemetry)
+{
+  if (telemetry == NULL)
+  {
+    return tic_error_create("Telemetry output pointer is null.");
+  }
+
+  *telemetry = NULL;
+
+  tic_error * error = NULL;
+
+  tic_telemetry * new_telemetry = NULL;
+  if (error == NULL)
+  {
+    new_telemetry = calloc(1, sizeof(tic_telemetry));
+    if (new_telemetry == NULL)
+    {
+      error = &tic_error_no_memory;
+    }
+  }
+
+  tic_telemetry_segment * segment = NULL;
+  if (error == NULL)
+  {
+    error = tic_telemetry_map(name, false, &segment);
+  }
+
+  if (error == NULL)
+  {
+    new_telemetry->segment = segment;
+    *telemetry = new_telemetry;
+    new_telemetry = NULL;
+  }
+
+  tic_telemetry_close(new_telemetry);
+
+  return error;
+}
+
+tic_error * tic_telemetry_remove(const char * name)
+{
+  if (name == NULL)
+  {
+    return tic_error_create("Telemetry name is null.");
+  }
+
+  if (shm_unlink(name))
+  {
+    return tic_error_create("Failed to remove shared memory %s: %s.",
+      name, strerror(errno));
+  }
+  return NULL;
+}
+
+#endif
+
+void tic_telemetry_publisher_close(tic_telemetry_publisher * publisher)
+{
+  if (publisher != NULL)
+  {
+    if (publisher->slot != NULL)
+    {
+      __atomic_store_n(&publisher->slot->owner_pid, 0, __ATOMIC_RELEASE);
+    }
+    tic_telemetry_unmap(publisher->segment);
+    free(publisher);
+  }
+}
+
+void tic_telemetry_publish(tic_telemetry_publisher * publisher,
+  const tic_variables * variables)
+{
+  if (publisher == NULL || variables == NULL) { return; }
+
+  tic_telemetry_slot * slot = publisher->slot;
+  uint64_t sample_number = slot->sample_count;
+  tic_telemetry_sample * sample =
+    &slot->history[sample_number % TIC_TELEMETRY_HISTORY_LENGTH];
+
+  uint32_t sequence = sample->sequence;
+  __atomic_store_n(&sample->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  sample->sample_number = sample_number;
+  sample->time_us = tic_clock_us();
+  memcpy(sample->variables, variables, tic_variables_size);
+
+  __atomic_store_n(&sample->sequence, sequence + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&slot->sample_count, sample_number + 1, __ATOMIC_RELEASE);
+}
+
+void tic_telemetry_close(tic_telemetry * telemetry)
+{
+  if (telemetry != NULL)
+  {
+    tic_telemetry_unmap(telemetry->segment);
+    free(telemetry);
+  }
+}
+
+bool tic_telemetry_find_device(const tic_telemetry * telemetry,
+  const char * serial_number, uint32_t * slot)
+{
+  if (telemetry == NULL || serial_number == NULL) { return false; }
+
+  for (uint32_t i = 0; i < TIC_TELEMETRY_SLOT_COUNT; i++)
+  {
+    if (tic_telemetry_slot_has_serial_number(
+        &telemetry->segment->slots[i], serial_number))
+    {
+      if (slot) { *slot = i; }
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t tic_telemetry_get_sample_count(const tic_telemetry * telemetry,
+  uint32_t slot)
+{
+  if (telemetry == NULL || slot >= TIC_TELEMETRY_SLOT_COUNT) { return 0; }
+  return __atomic_load_n(&telemetry->segment->slots[slot].sample_count,
+    __ATOMIC_ACQUIRE);
+}
+
+tic_error * tic_telemetry_read_sample(const tic_telemetry * telemetry,
+  uint32_t slot, uint64_t sample_number,
+  tic_variables * variables, int64_t * time_us)
+{
+  if (variables == NULL)
+  {
+    return tic_error_create("Variables pointer is null.");
+  }
+
+  if (telemetry == NULL)
+  {
+    return tic_error_create("Telemetry is null.");
+  }
+
+  if (slot >= TIC_TELEMETRY_SLOT_COUNT)
+  {
+    return tic_error_create("Invalid telemetry slot: %u.", slot);
+  }
+
+  const tic_telemetry_sample * sample = &telemetry->segment->slots[slot]
+    .history[sample_number % TIC_TELEMETRY_HISTORY_LENGTH];
+
+  bool consistent = false;
+  uint64_t copied_sample_number = 0;
+  int64_t copied_time_us = 0;
+  for (int i = 0; i < TIC_TELEMETRY_READ_ATTEMPTS; i++)
+  {
+    uint32_t sequence = __atomic_load_n(&sample->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1) { continue; }
+
+    copied_sample_number = sample->sample_number;
+    copied_time_us = sample->time_us;
+    memcpy(variables, sample->variables, tic_variables_size);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&sample->sequence, __ATOMIC_RELAXED) == sequence)
+    {
+      consistent = true;
+      break;
+    }
+  }
+
+  if (!consistent)
+  {
+    return tic_error_create("The telemetry publisher stopped while writing.");
+  }
+
+  if (copied_sample_number != sample_number)
+  {
+    return tic_error_create("Telemetry sample %llu is not available.",
+      (unsigned long long)sample_number);
+  }
+
+  if (time_us) { *time_us = copied_time_us; }
+  return NULL;
+}
+
+tic_error * tic_telemetry_get_sample(const tic_telemetry * telemetry,
+  uint32_t slot, uint64_t sample_number,
+  tic_variables ** variables, int64_t * time_us)
+{
+  if (variables == NULL)
+  {
+    return tic_error_create("Variables output pointer is null.");
+  }
+
+  *variables = NULL;
+
+  tic_error * error = NULL;
+
+  tic_variables * new_variables = NULL;
+  if (error == NULL)
+  {
+    error = tic_variables_create(&new_variables);
+  }
+
+  if (error == NULL)
+  {
+    error = tic_telemetry_read_sample(telemetry, slot, sample_number,
+      new_variables, time_us);
+  }
+
+  if (error == NULL)
+  {
+    *variables = new_variables;
+    new_variables = NULL;
+  }
+
+  tic_variables_free(new_variables);
+
+  return error;
+}
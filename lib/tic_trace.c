@@ -0,0 +1,248 @@
+// Functions for recording a timeline of library calls and USB transfers.
+//
+// If the TIC_TRACE environment variable is set to a file name, every traced
+// library call and USB transfer is recorded in a buffer that belongs to the
+// calling thread, so recording never waits for other threads.  When the
+// program exits, all of the buffers are written to the file in the Chrome
+// trace event format, which can be viewed with chrome://tracing or
+// https://ui.perfetto.dev.
+
+#include "tic_internal.h"
+
+#define TIC_TRACE_ENV_VAR "TIC_TRACE"
+
+#define TIC_TRACE_CHUNK_SIZE 4096
+
+// Limits each thread to about a million events (64 MB) so that a program
+// that runs for a long time does not use up all the memory.  Later events are
+// counted but not recorded.
+#define TIC_TRACE_MAX_CHUNKS 256
+
+enum
+{
+  TIC_TRACE_UNKNOWN,
+  TIC_TRACE_ENABLED,
+  TIC_TRACE_DISABLED,
+};
+
+typedef struct tic_trace_event
+{
+  const char * name;
+  int64_t start_us;
+  int64_t duration_us;
+  bool usb;
+  bool failed;
+  uint8_t request_type;
+  uint8_t request;
+  uint16_t value;
+  uint16_t index;
+  uint16_t length;
+} tic_trace_event;
+
+typedef struct tic_trace_chunk
+{
+  struct tic_trace_chunk * next;
+  size_t count;
+  tic_trace_event events[TIC_TRACE_CHUNK_SIZE];
+} tic_trace_chunk;
+
+typedef struct tic_trace_thread
+{
+  struct tic_trace_thread * next;
+  uint32_t id;
+  uint32_t chunk_count;
+  uint64_t dropped_count;
+  tic_trace_chunk * first;
+  tic_trace_chunk * last;
+} tic_trace_thread;
+
+static int tic_trace_state;
+static char * tic_trace_path;
+static tic_trace_thread * tic_trace_threads;
+static uint32_t tic_trace_thread_count;
+static __thread tic_trace_thread * tic_trace_current_thread;
+
+static void tic_trace_write(void);
+
+static bool tic_trace_enabled(void)
+{
+  int state = __atomic_load_n(&tic_trace_state, __ATOMIC_ACQUIRE);
+  if (state != TIC_TRACE_UNKNOWN) { return state == TIC_TRACE_ENABLED; }
+
+  const char * path = getenv(TIC_TRACE_ENV_VAR);
+  state = TIC_TRACE_DISABLED;
+  if (path != NULL && path[0] != 0)
+  {
+    char * path_copy = malloc(strlen(path) + 1);
+    if (path_copy != NULL)
+    {
+      strcpy(path_copy, path);
+      char * expected = NULL;
+      if (__atomic_compare_exchange_n(&tic_trace_path, &expected, path_copy,
+          false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      {
+        atexit(tic_trace_write);
+      }
+      else
+      {
+        // Another thread got here first.
+        free(path_copy);
+      }
+      state = TIC_TRACE_ENABLED;
+    }
+  }
+  __atomic_store_n(&tic_trace_state, state, __ATOMIC_RELEASE);
+  return state == TIC_TRACE_ENABLED;
+}
+
+static tic_trace_thread * tic_trace_get_thread(void)
+{
+  tic_trace_thread * thread = tic_trace_current_thread;
+  if (thread != NULL) { return thread; }
+
+  thread = calloc(1, sizeof(tic_trace_thread));
+  if (thread == NULL) { return NULL; }
+  thread->id = __atomic_add_fetch(&tic_trace_thread_count, 1, __ATOMIC_RELAXED);
+
+  thread->next = __atomic_load_n(&tic_trace_threads, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&tic_trace_threads, &thread->next,
+      thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+  {
+  }
+
+  tic_trace_current_thread = thread;
+  return thread;
+}
+
+static void tic_trace_add(const tic_trace_event * event)
+{
+  tic_trace_thread * thread = tic_trace_get_thread();
+  if (thread == NULL) { return; }
+
+  tic_trace_chunk * chunk = thread->last;
+  if (chunk == NULL || chunk->count == TIC_TRACE_CHUNK_SIZE)
+  {
+    tic_trace_chunk * new_chunk = NULL;
+    if (thread->chunk_count < TIC_TRACE_MAX_CHUNKS)
+    {
+      new_chunk = calloc(1, sizeof(tic_trace_chunk));
+    }
+    if (new_chunk == NULL)
+    {
+      __atomic_add_fetch(&thread->dropped_count, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+    // The chunk is published with a release store so the thread that writes
+    // the file at exit sees it initialized.
+    if (chunk == NULL)
+    {
+      __atomic_store_n(&thread->first, new_chunk, __ATOMIC_RELEASE);
+    }
+    else
+    {
+      __atomic_store_n(&chunk->next, new_chunk, __ATOMIC_RELEASE);
+    }
+    thread->last = chunk = new_chunk;
+    thread->chunk_count++;
+  }
+
+  chunk->events[chunk->count] = *event;
+  __atomic_store_n(&chunk->count, chunk->count + 1, __ATOMIC_RELEASE);
+}
+
+int64_t tic_trace_begin(void)
+{
+  if (!tic_trace_enabled()) { return 0; }
+  return tic_clock_us();
+}
+
+void tic_trace_end(const char * name, int64_t start_us)
+{
+  if (start_us == 0) { return; }
+
+  tic_trace_event event = { 0 };
+  event.name = name;
+  event.start_us = start_us;
+  event.duration_us = tic_clock_us() - start_us;
+  tic_trace_add(&event);
+}
+
+void tic_trace_end_transfer(int64_t start_us,
+  uint8_t request_type, uint8_t request, uint16_t value, uint16_t index,
+  uint16_t length, const tic_error * error)
+{
+  if (start_us == 0) { return; }
+
+  tic_trace_event event = { 0 };
+  event.name = tic_look_up_command_name_ui(request);
+  event.start_us = start_us;
+  event.duration_us = tic_clock_us() - start_us;
+  event.usb = true;
+  event.failed = error != NULL;
+  event.request_type = request_type;
+  event.request = request;
+  event.value = value;
+  event.index = index;
+  event.length = length;
+  tic_trace_add(&event);
+}
+
+static void tic_trace_write_event(FILE * file, int pid, uint32_t tid,
+  const tic_trace_event * event)
+{
+  fprintf(file,
+    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+    "\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%u",
+    event->name, event->usb ? "usb" : "api",
+    (long long)event->start_us, (long long)event->duration_us, pid, tid);
+  if (event->usb)
+  {
+    fprintf(file,
+      ",\"args\":{\"request_type\":%u,\"request\":%u,\"value\":%u,"
+      "\"index\":%u,\"length\":%u,\"failed\":%s}",
+      event->request_type, event->request, event->value,
+      event->index, event->length, event->failed ? "true" : "false");
+  }
+  fprintf(file, "}");
+}
+
+static void tic_trace_write(void)
+{
+  FILE * file = fopen(tic_trace_path, "w");
+  if (file == NULL)
+  {
+    fprintf(stderr, "Failed to write trace to %s: %s.\n",
+      tic_trace_path, strerror(errno));
+    return;
+  }
+
+  int pid = getpid();
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+    "\"args\":{\"name\":\"libpololu-tic\"}}", pid);
+
+  tic_trace_thread * thread = __atomic_load_n(&tic_trace_threads, __ATOMIC_ACQUIRE);
+  for (; thread != NULL; thread = thread->next)
+  {
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+      "\"tid\":%u,\"args\":{\"name\":\"Thread %u\",\"dropped_events\":%llu}}",
+      pid, thread->id, thread->id, (unsigned long long)
+      __atomic_load_n(&thread->dropped_count, __ATOMIC_RELAXED));
+
+    // Other threads might still be adding events, so only write the ones that
+    // were completely recorded.
+    tic_trace_chunk * chunk = __atomic_load_n(&thread->first, __ATOMIC_ACQUIRE);
+    for (; chunk != NULL; chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE))
+    {
+      size_t count = __atomic_load_n(&chunk->count, __ATOMIC_ACQUIRE);
+      for (size_t i = 0; i < count; i++)
+      {
+        tic_trace_write_event(file, pid, thread->id, &chunk->events[i]);
+      }
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+}
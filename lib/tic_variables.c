@@ -53,6 +53,8 @@ struct tic_variables
   uint8_t last_hp_driver_errors;
 };
 
+const size_t tic_variables_size = sizeof(tic_variables);
+
 tic_error * tic_variables_create(tic_variables ** variables)
 {
   if (variables == NULL)
@@ -239,6 +241,8 @@ tic_error * tic_get_variables(tic_handle * handle, tic_variables ** variables,
     return tic_error_create("Handle is null.");
   }
 
+  int64_t trace_start_us = tic_trace_begin();
+
   tic_error * error = NULL;
 
   // Create a variables object.
@@ -287,6 +291,7 @@ tic_error * tic_get_variables(tic_handle * handle, tic_variables ** variables,
   {
     new_variables->product = tic_device_get_product(tic_handle_get_device(handle));
     write_buffer_to_variables(buf, new_variables, product);
+    tic_handle_publish_variables(handle, new_variables);
   }
 
   // Pass the new variables to the caller.
@@ -304,6 +309,7 @@ tic_error * tic_get_variables(tic_handle * handle, tic_variables ** variables,
       "There was an error reading variables from the device.");
   }
 
+  tic_trace_end(__func__, trace_start_us);
   return error;
 }
 
@@ -675,3 +681,31 @@ tic_variables * tic_variables_fake(void)
 
   return vars;
 }
+
+tic_error * tic_variables_decode(const uint8_t * buffer, uint8_t product,
+  tic_variables ** variables)
+{
+  if (variables == NULL)
+  {
+    return tic_error_create("Variables output pointer is null.");
+  }
+
+  *variables = NULL;
+
+  if (buffer == NULL)
+  {
+    return tic_error_create("Buffer is null.");
+  }
+
+  tic_variables * new_variables = NULL;
+  tic_error * error = tic_variables_create(&new_variables);
+
+  if (error == NULL)
+  {
+    new_variables->product = product;
+    write_buffer_to_variables(buffer, new_variables, product);
+    *variables = new_variables;
+  }
+
+  return error;
+}
@@ -0,0 +1,185 @@
+// Functions for waiting until the device reaches some state.
+
+#include "tic_internal.h"
+
+// The shortest and longest time to sleep between polls when we can predict how
+// long the motor will take to settle, in microseconds.
+#define TIC_WAIT_MIN_INTERVAL_US 1000
+#define TIC_WAIT_MAX_INTERVAL_US 50000
+
+// The time to sleep between polls when we cannot predict when the condition
+// will become true, in microseconds.
+#define TIC_WAIT_DEFAULT_INTERVAL_US 10000
+
+tic_error * tic_poll_until(tic_handle * handle, tic_poll_function * poll,
+  void * context, uint32_t timeout_ms)
+{
+  int64_t deadline_us = tic_clock_us() + (int64_t)timeout_ms * 1000;
+
+  // If the function does not say how long to wait, we check quickly at first
+  // and then back off.
+  uint32_t backoff_us = TIC_WAIT_MIN_INTERVAL_US;
+
+  while (true)
+  {
+    bool done = false;
+    uint32_t interval_us = 0;
+    tic_error * error = poll(handle, context, &done, &interval_us);
+    if (error != NULL || done) { return error; }
+
+    if (interval_us == 0)
+    {
+      interval_us = backoff_us;
+      if (backoff_us < TIC_WAIT_DEFAULT_INTERVAL_US) { backoff_us *= 2; }
+    }
+
+    int64_t now_us = tic_clock_us();
+    if (timeout_ms != TIC_WAIT_FOREVER)
+    {
+      if (now_us >= deadline_us)
+      {
+        return tic_error_add_code(
+          tic_error_create("The device took too long to finish."),
+          TIC_ERROR_TIMEOUT);
+      }
+
+      // Poll one last time right at the deadline.
+      if (interval_us > deadline_us - now_us)
+      {
+        interval_us = deadline_us - now_us;
+      }
+    }
+
+    usleep(interval_us);
+  }
+}
+
+// Predicts how many microseconds it will take for the motor to reach its
+// target, or returns 0 if that is not known.
+static uint32_t tic_wait_predict_us(const tic_variables * vars)
+{
+  tic_motion * motion = NULL;
+  tic_error * error = tic_motion_create(&motion);
+  if (error != NULL)
+  {
+    tic_error_free(error);
+    return 0;
+  }
+
+  tic_motion_set_from_variables(motion, vars);
+  int64_t time_us = tic_motion_get_time_to_target_us(motion);
+  tic_motion_free(motion);
+
+  if (time_us <= 0) { return 0; }
+  if (time_us > UINT32_MAX) { return UINT32_MAX; }
+  return (uint32_t)time_us;
+}
+
+typedef struct tic_wait_context
+{
+  tic_wait_condition * condition;
+  void * condition_context;
+  tic_variables * variables;
+} tic_wait_context;
+
+static tic_error * tic_wait_poll(tic_handle * handle, void * context,
+  bool * done, uint32_t * interval_us)
+{
+  tic_wait_context * wait = context;
+
+  tic_variables_free(wait->variables);
+  wait->variables = NULL;
+  tic_error * error = tic_get_variables(handle, &wait->variables, false);
+  if (error != NULL) { return error; }
+
+  if (wait->condition(wait->variables, wait->condition_context))
+  {
+    *done = true;
+    return NULL;
+  }
+
+  // Check again halfway to the predicted finish so we get closer to it each
+  // time.
+  uint32_t predicted_us = tic_wait_predict_us(wait->variables);
+  if (predicted_us == 0)
+  {
+    *interval_us = TIC_WAIT_DEFAULT_INTERVAL_US;
+  }
+  else
+  {
+    *interval_us = predicted_us / 2;
+    if (*interval_us < TIC_WAIT_MIN_INTERVAL_US)
+    {
+      *interval_us = TIC_WAIT_MIN_INTERVAL_US;
+    }
+    if (*interval_us > TIC_WAIT_MAX_INTERVAL_US)
+    {
+      *interval_us = TIC_WAIT_MAX_INTERVAL_US;
+    }
+  }
+  return NULL;
+}
+
+tic_error * tic_wait_until(tic_handle * handle, tic_wait_condition * condition,
+  void * context, uint32_t timeout_ms, tic_variables ** variables)
+{
+  if (variables != NULL) { *variables = NULL; }
+
+  if (handle == NULL)
+  {
+    return tic_error_create("Handle is null.");
+  }
+
+  if (condition == NULL)
+  {
+    return tic_error_create("Condition is null.");
+  }
+
+  int64_t trace_start_us = tic_trace_begin();
+
+  tic_wait_context wait = { condition, context, NULL };
+  tic_error * error = tic_poll_until(handle, tic_wait_poll, &wait, timeout_ms);
+
+  if (error == NULL && variables != NULL)
+  {
+    *variables = wait.variables;
+    wait.variables = NULL;
+  }
+
+  tic_variables_free(wait.variables);
+
+  if (error != NULL)
+  {
+    error = tic_error_add(error, "There was an error waiting for the device.");
+  }
+
+  tic_trace_end(__func__, trace_start_us);
+  return error;
+}
+
+bool tic_wait_position_reached(const tic_variables * variables, void * context)
+{
+  (void)context;
+  return tic_variables_get_planning_mode(variables) ==
+    TIC_PLANNING_MODE_TARGET_POSITION &&
+    tic_variables_get_current_position(variables) ==
+    tic_variables_get_target_position(variables);
+}
+
+bool tic_wait_not_homing(const tic_variables * variables, void * context)
+{
+  (void)context;
+  return !tic_variables_get_homing_active(variables);
+}
+
+bool tic_wait_energized(const tic_variables * variables, void * context)
+{
+  (void)context;
+  return tic_variables_get_energized(variables);
+}
+
+bool tic_wait_velocity_zero(const tic_variables * variables, void * context)
+{
+  (void)context;
+  return tic_variables_get_current_velocity(variables) == 0;
+}
@@ -0,0 +1,67 @@
+require_relative 'spec_helper'
+
+ExpectedArrivals = <<END
+cruise: 6000 ms
+  0: 1000 steps/s, 6000 ms, model 6000 ms
+  1: 354 steps/s, 6000 ms, model 6000 ms
+no cruise: 1414 ms
+  0: 707 steps/s, 1414 ms, model 1414 ms
+  1: 74 steps/s, 1414 ms, model 1414 ms
+decel: 3674 ms
+  0: 1632 steps/s, 3674 ms, model 3674 ms
+  1: 935 steps/s, 3674 ms, model 3674 ms
+starting speed: 4810 ms
+  0: 1000 steps/s, 4810 ms, model 4810 ms
+  1: 200 steps/s, 1500 ms, model 1500 ms
+too fast to wait: 5000 ms
+  0: 1000 steps/s, 5000 ms, model 5000 ms
+  1: 900 steps/s, 3333 ms, model 3333 ms
+no move: 4000 ms
+  0: 1000 steps/s, 4000 ms, model 4000 ms
+  1: 1000 steps/s, 0 ms, model 0 ms
+min duration: 8000 ms
+  0: 683 steps/s, 8000 ms, model 8000 ms
+  1: 258 steps/s, 8000 ms, model 8000 ms
+END
+
+describe 'tic_arrival' do
+  it 'plans moves that finish on every axis at once' do
+    stdout, stderr, result = run_ticcmd('--test 8')
+    expect(stderr).to eq ''
+    expect(stdout).to eq ExpectedArrivals
+    expect(result).to eq 0
+  end
+end
+
+describe '--sync-arrival' do
+  let(:recording) { 'spec/recordings/t825_sync_arrival.ticrec' }
+
+  it 'slows down the shorter moves and starts all the axes together' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002,00000003 ' \
+      '--sync-position 4000,-1000,300 --sync-arrival',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report['duration_ms']).to eq 2500
+    expect(report['max_speed']).to eq({
+      '00000001' => 20000000, '00000002' => 4174243, '00000003' => 1214756 })
+  end
+
+  it 'restores the limits when an axis cannot move' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002,00000003 ' \
+      '--sync-position 4000,-1000,300 --sync-arrival',
+      env: { 'TIC_REPLAY' => 'spec/recordings/t825_sync_arrival_error.ticrec' })
+    expect(stderr).to eq "Error: Device 00000001 stopped before reaching " \
+      "its target because of errors.\n"
+    expect(result).to eq 2
+  end
+
+  it 'requires --sync-position' do
+    stdout, stderr, result = run_ticcmd('--sync-arrival')
+    expect(stderr).to eq "Error: The --sync-arrival option requires " \
+      "--sync-position.\n"
+    expect(result).to eq 1
+  end
+end
@@ -0,0 +1,22 @@
+require_relative 'spec_helper'
+
+describe '--benchmark' do
+  it 'prints machine-readable latencies for each kind of request' do
+    stdout, stderr, result = run_ticcmd(
+      '--benchmark --iterations 3 --settings-iterations 1',
+      env: { 'TIC_REPLAY' => 'spec/recordings/t825_benchmark.ticrec' })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report.keys).to eq %w(open close get_variables set_target_position
+      get_settings set_settings)
+    report.each do |name, numbers|
+      expect(numbers.keys).to eq %w(iterations total_us per_second min_us
+        mean_us p50_us p90_us p99_us p99_9_us max_us)
+      expect(numbers['iterations']).to eq(name.end_with?('settings') ? 1 : 3)
+      expect(numbers['min_us'] <= numbers['p50_us']).to eq true
+      expect(numbers['p50_us'] <= numbers['max_us']).to eq true
+    end
+  end
+end
@@ -34,6 +34,25 @@ describe 'commands for controlling the motor', usb: true do
     end
   end
 
+  describe 'Wait for position' do
+    it 'waits until the motor reaches the target position' do
+      stdout, stderr, result = run_ticcmd('-p 2000 --wait-for-position')
+      expect(stderr).to eq ''
+      expect(stdout).to eq ''
+      expect(result).to eq 0
+
+      expect(tic_get_status['Current position']).to eq 2000
+    end
+
+    it 'gives up after the timeout' do
+      stdout, stderr, result = run_ticcmd(
+        '-p -2000000 --wait-for-position --wait-timeout 20')
+      expect(stderr).to include 'The device took too long to finish.'
+      expect(stdout).to eq ''
+      expect(result).to eq 2
+    end
+  end
+
   describe 'Set target velocity' do
     it 'lets you set the velocity' do
       stdout, stderr, result = run_ticcmd('-y 100000')
@@ -0,0 +1,33 @@
+require_relative 'spec_helper'
+
+describe '--dynamic-position' do
+  let(:recording) { 'spec/recordings/t825_dynamic_steps.ticrec' }
+
+  it 'goes faster than 50 kHz allows in the base step mode' do
+    stdout, stderr, result = run_ticcmd('--resume --step-mode 16 ' \
+      '--max-accel 8000000 --dynamic-max-speed 160000000 ' \
+      '--dynamic-steps 4:15000000,full:60000000 --dynamic-position 10000',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report['switches']).to eq 4
+    expect(report['max_speed']).to eq 160000000
+    expect(report['position']).to eq 10000
+  end
+
+  it 'requires --dynamic-steps' do
+    stdout, stderr, result = run_ticcmd('--dynamic-position 5')
+    expect(stderr).to eq "Error: The --dynamic-position option requires " \
+      "--dynamic-steps.\n"
+    expect(result).to eq 1
+  end
+
+  it 'complains about step modes without speeds' do
+    stdout, stderr, result = run_ticcmd('--dynamic-steps 4,full:1')
+    expect(stderr).to eq "Error: The step modes after '--dynamic-steps' are " \
+      "invalid.  They should look like '4:10000000,full:60000000'.\n"
+    expect(result).to eq 1
+  end
+end
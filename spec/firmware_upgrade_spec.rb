@@ -0,0 +1,17 @@
+require_relative 'spec_helper'
+
+describe 'Upgrade firmware' do
+  it 'requires a filename' do
+    stdout, stderr, result = run_ticcmd('--upgrade-firmware')
+    expect(stderr).to eq "Error: Expected an argument after '--upgrade-firmware'.\n"
+    expect(stdout).to eq ''
+    expect(result).to eq EXIT_BAD_ARGS
+  end
+
+  it 'complains if the file does not exist' do
+    stdout, stderr, result = run_ticcmd('--upgrade-firmware nonexistent.fmi')
+    expect(stderr).to eq "Error: nonexistent.fmi: No such file or directory.\n"
+    expect(stdout).to eq ''
+    expect(result).to eq EXIT_OPERATION_FAILED
+  end
+end
@@ -0,0 +1,71 @@
+require_relative 'spec_helper'
+
+GcodeProgram = <<END
+; A rectangle from a CAM program.
+%
+G21 G90 G94 G17
+M17
+G92 X0 Y0
+G0 X2 Y1
+G1 X4 F600 (split into segments that lie on one line)
+G1 X6
+G1 X8
+G1 Y3
+G4 P50
+G91 G1 X-4 Y-1
+G90 X2 Y1
+M18
+M30
+G1 X100
+END
+
+describe '--gcode' do
+  let(:recording) { 'spec/recordings/t825_gcode.ticrec' }
+
+  it 'runs the program and joins moves along the same line' do
+    stdout, stderr, result = run_ticcmd('--axes Y=00000002,X=00000001 ' \
+      '--gcode - --gcode-scale 20',
+      env: { 'TIC_REPLAY' => recording }, input: GcodeProgram)
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report.keys).to eq %w(moves merged_moves elapsed_ms moves_per_s)
+    expect(report['moves']).to eq 7
+    expect(report['merged_moves']).to eq 2
+    expect(report['moves_per_s'] > 0).to eq true
+  end
+
+  it 'checks the whole program before running it' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002 --gcode -',
+      input: "G0 X1\nG2 X3 Y4\n")
+    expect(stderr).to eq "Error: Unsupported G-code 'G2' on line 2.\n"
+    expect(result).to eq 1
+  end
+
+  it 'complains about axes that are not mapped to a device' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002 --gcode -',
+      input: "G1 Z1 F60\n")
+    expect(stderr).to eq "Error: Axis 'Z' is not one of the --axes on line 1.\n"
+    expect(result).to eq 1
+  end
+
+  it 'needs a feed rate for G1' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001 --gcode -',
+      input: "G1 X1\n")
+    expect(stderr).to eq "Error: G1 needs a feed rate (F) on line 1.\n"
+    expect(result).to eq 1
+  end
+
+  it 'requires --axes' do
+    stdout, stderr, result = run_ticcmd('--gcode -')
+    expect(stderr).to eq "Error: The --gcode option requires --axes.\n"
+    expect(result).to eq 1
+  end
+
+  it 'does not allow two devices on one axis' do
+    stdout, stderr, result = run_ticcmd('--axes X=00000001,X=00000002')
+    expect(stderr).to eq "Error: The axes after '--axes' are invalid.\n"
+    expect(result).to eq 1
+  end
+end
@@ -0,0 +1,30 @@
+require_relative 'spec_helper'
+
+describe '--idle-current' do
+  let(:recording) { 'spec/recordings/t825_idle_current.ticrec' }
+
+  # The recording only replays if the full current limit is sent before the
+  # first velocity of the S-curve.
+  it 'lowers the current of a still motor and restores it before moving' do
+    stdout, stderr, result = run_ticcmd('--resume --idle-current 100 ' \
+      '--idle-time 0 --idle-watch 300 --s-curve 100 --max-jerk 400000 ' \
+      '--wait-for-position',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+    expect(stdout).to include "Idle current reduced:         No\n"
+    expect(stdout).to include "Idle current limit:           96 mA\n"
+    expect(stdout).to include "Full current limit:           320 mA\n"
+    expect(stdout).to include "Idle reductions:              1\n"
+    expect(stdout).to include "Idle restores:                1\n"
+    expect(stdout).to include "Idle errors:                  0\n"
+    expect(stdout).to match(/^Idle current\^2 saved: +0\.0\d+ A\^2 s$/)
+  end
+
+  it 'requires --idle-current for --idle-watch' do
+    stdout, stderr, result = run_ticcmd('--idle-watch 100')
+    expect(stderr).to eq "Error: The --idle-time and --idle-watch options " \
+      "require --idle-current.\n"
+    expect(result).to eq 1
+  end
+end
@@ -0,0 +1,36 @@
+require_relative 'spec_helper'
+
+ExpectedMotion = <<END
+trapezoid: 11000000 us
+  500 ms: 125, 500
+  5000 ms: 4500, 1000
+  10500 ms: 9875, 500
+  20000 ms: 10000, 0
+triangle: 1264911 us
+  200 ms: 20, 200
+starting speed: 10640000 us
+  0 ms: 0, 200
+  400 ms: 160, 600
+turn around: 2625000 us
+  500 ms: -125, 0
+  1500 ms: 375, 1000
+overshoot: 2095445 us
+  1000 ms: 500, 0
+velocity: 1000000 us
+  500 ms: -125, -500
+  2000 ms: -1500, -1000
+stop: 1000000 us
+  500 ms: 375, 500
+  2000 ms: 500, 0
+no speed: -1 us
+  1000 ms: 0, 0
+END
+
+describe 'tic_motion' do
+  it 'predicts trapezoidal moves like the Tic does' do
+    stdout, stderr, result = run_ticcmd('--test 6')
+    expect(stderr).to eq ''
+    expect(stdout).to eq ExpectedMotion
+    expect(result).to eq 0
+  end
+end
@@ -0,0 +1,63 @@
+require_relative 'spec_helper'
+require 'tmpdir'
+
+describe 'TIC_REPLAY' do
+  let(:recording) { 'spec/recordings/t825_status.ticrec' }
+
+  it 'lists the devices in the recording' do
+    stdout, stderr, result = run_ticcmd('--list',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(stdout).to include '00000001'
+    expect(stdout).to include 'Tic T825 Stepper Motor Controller'
+    expect(result).to eq 0
+  end
+
+  it 'gives back the recorded responses' do
+    stdout, stderr, result = run_ticcmd('-s',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(stdout).to include "Serial number:                00000001\n"
+    expect(stdout).to include "Firmware version:             1.09\n"
+    expect(stdout).to include "VIN voltage:                  12.0 V\n"
+    expect(stdout).to include "  - Safe start violation\n"
+    expect(result).to eq 0
+  end
+
+  it 'complains about requests that were not recorded' do
+    stdout, stderr, result = run_ticcmd('--energize',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to include 'USB transfer 0 does not match the recording'
+    expect(stdout).to eq ''
+    expect(result).to eq 2
+  end
+
+  it 'rejects transfers with more data than they asked for' do
+    data = File.binread(recording)
+
+    # Find the first transfer that read data and shrink its length field.
+    p = 8
+    loop do
+      if data.getbyte(p) == 1
+        p += 8 + data.getbyte(p + 5) + data[p + 6 + data.getbyte(p + 5), 2].unpack('v')[0]
+        next
+      end
+      payload_length, message_length = data[p + 23, 4].unpack('vv')
+      if (data.getbyte(p + 14) & 0x80) != 0 && payload_length > 0
+        data[p + 20, 2] = [payload_length - 1].pack('v')
+        break
+      end
+      p += 27 + message_length + payload_length
+    end
+
+    Dir.mktmpdir do |dir|
+      corrupt = File.join(dir, 'corrupt.ticrec')
+      File.binwrite(corrupt, data)
+      stdout, stderr, result = run_ticcmd('-s',
+        env: { 'TIC_REPLAY' => corrupt })
+      expect(stderr).to include 'The USB recording is corrupt'
+      expect(stdout).to eq ''
+      expect(result).not_to eq 0
+    end
+  end
+end
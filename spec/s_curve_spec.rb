@@ -0,0 +1,49 @@
+require_relative 'spec_helper'
+
+ExpectedSCurves = <<END
+cruise: 11100000 us
+  100 ms: 2, 50
+  550 ms: 125, 500
+  5550 ms: 5000, 1000
+  11100 ms: 10000, 0
+no cruise: 2102498 us
+  1000 ms: 451, 938
+no constant accel: 317480 us
+  79 ms: 1, 31
+jerk limited: 12000000 us
+  1000 ms: 167, 500
+reverse: 11100000 us
+  550 ms: 375, -500
+  11100 ms: -9500, 0
+no move: 0 us
+  0 ms: 7, 0
+END
+
+describe 'tic_s_curve' do
+  it 'plans jerk-limited moves' do
+    stdout, stderr, result = run_ticcmd('--test 7')
+    expect(stderr).to eq ''
+    expect(stdout).to eq ExpectedSCurves
+    expect(result).to eq 0
+  end
+end
+
+describe '--s-curve' do
+  let(:recording) { 'spec/recordings/t825_s_curve.ticrec' }
+
+  it 'streams velocities and then lands on the target position' do
+    stdout, stderr, result = run_ticcmd(
+      '--resume --max-speed 20000000 --max-accel 2000000 ' \
+      '--s-curve 100 --max-jerk 400000 --wait-for-position',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(stdout).to eq ''
+    expect(result).to eq 0
+  end
+
+  it 'requires a jerk limit' do
+    stdout, stderr, result = run_ticcmd('--s-curve 100')
+    expect(stderr).to eq "Error: The --s-curve option requires --max-jerk.\n"
+    expect(result).to eq 1
+  end
+end
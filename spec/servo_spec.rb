@@ -0,0 +1,27 @@
+require_relative 'spec_helper'
+
+describe '--servo' do
+  let(:recording) { 'spec/recordings/t825_servo.ticrec' }
+
+  it 'moves until the encoder reaches the target and reports loop timing' do
+    stdout, stderr, result = run_ticcmd('--resume --servo 40 --servo-interval 5000',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report.keys).to eq %w(updates overruns position error
+      mean_update_us max_update_us max_lateness_us)
+    expect(report['updates']).to eq 33
+    expect(report['position']).to eq 40
+    expect(report['error']).to eq 0
+    expect(report['mean_update_us'] <= report['max_update_us']).to eq true
+  end
+
+  it 'complains about invalid gains' do
+    stdout, stderr, result = run_ticcmd('--servo 5 --servo-gains 1,2')
+    expect(stderr).to eq "Error: The gains after '--servo-gains' are " \
+      "invalid.  They should look like '20,0.5,0'.\n"
+    expect(result).to eq 1
+  end
+end
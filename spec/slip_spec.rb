@@ -0,0 +1,33 @@
+require_relative 'spec_helper'
+
+describe '--watch-slip' do
+  let(:recording) { 'spec/recordings/t825_slip.ticrec' }
+
+  # These settings scale the encoder by 2, so the encoder gets ahead of the
+  # current position as soon as the motor moves, like it would if the motor
+  # was slipping.
+  let(:settings) { 'spec/recordings/t825_slip_settings.txt' }
+
+  it 'stops with an error when the encoder gets too far from the position' do
+    stdout, stderr, result = run_ticcmd("--settings #{settings} --resume " \
+      '-p 2000 --watch-slip 100 --slip-action halt --wait-for-position',
+      env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq "Error: The motor slipped: the encoder was off " \
+      "by 127 microsteps.\n"
+    expect(stdout).to eq ''
+    expect(result).to eq 2
+  end
+
+  it 'requires --watch-slip for --slip-action' do
+    stdout, stderr, result = run_ticcmd('--slip-action deenergize')
+    expect(stderr).to eq "Error: The --slip-action option requires " \
+      "--watch-slip.\n"
+    expect(result).to eq 1
+  end
+
+  it 'complains about invalid actions' do
+    stdout, stderr, result = run_ticcmd('--watch-slip 5 --slip-action stop')
+    expect(stderr).to eq "Error: The slip action specified is invalid.\n"
+    expect(result).to eq 1
+  end
+end
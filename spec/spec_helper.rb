@@ -8,7 +8,7 @@ EXIT_DEVICE_NOT_FOUND = 3
 EXIT_DEVICE_MULTIPLE_FOUND = 4
 
 def run_ticcmd(args, opts = {})
-  env = {}
+  env = opts.fetch(:env, {})
   cmd = 'ticcmd ' + args.to_s
   cmd = 'valgrind ' + cmd if ENV['TIC_SPEC_VALGRIND'] == 'Y'
   open3_opts = {}
@@ -0,0 +1,49 @@
+require_relative 'spec_helper'
+
+FakeStats = <<END
+Get variable:
+  Count:                      5
+  Errors:                     0
+  Timeouts:                   0
+  Average:                    2394 us
+  Median:                     1023 us
+  90th percentile:            7900 us
+  99th percentile:            7900 us
+  Max:                        7900 us
+  Histogram:
+    Up to 1023 us:            3
+    Up to 1279 us:            1
+    Up to 8191 us:            1
+Set target position:
+  Count:                      3
+  Errors:                     1
+  Timeouts:                   1
+  Average:                    533377 us
+  Median:                     159 us
+  90th percentile:            1600000 us
+  99th percentile:            1600000 us
+  Max:                        1600000 us
+  Histogram:
+    Up to 3 us:               1
+    Up to 159 us:             1
+    Up to 1835007 us:         1
+END
+
+describe '--stats' do
+  it 'shows the latency of every request', usb: true do
+    stdout, stderr, result = run_ticcmd('--stats -s')
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+    expect(stdout).to include "Get variable and clear errors occurred:\n  Count:"
+    expect(stdout).to include "Get setting:\n  Count:"
+  end
+end
+
+describe 'print_stats' do
+  it 'can print fake latencies for testing' do
+    stdout, stderr, result = run_ticcmd('--test 5')
+    expect(stderr).to eq ''
+    expect(stdout).to eq FakeStats
+    expect(result).to eq 0
+  end
+end
@@ -0,0 +1,45 @@
+require_relative 'spec_helper'
+
+describe '--stream' do
+  let(:recording) { 'spec/recordings/t825_stream.ticrec' }
+
+  it 'sends each point and reports how late they were' do
+    points = <<END
+# time_us  kind      target
+0          velocity  100000
+2000       velocity  200000
+4000       velocity  300000  # faster
+
+6000       position  -50
+END
+    stdout, stderr, result = run_ticcmd('--stream -',
+      env: { 'TIC_REPLAY' => recording }, input: points)
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report.keys).to eq %w(points sent missed skipped lateness send_time)
+    expect(report['points']).to eq 4
+    # Points are never skipped while replaying, so the transfers always match
+    # the recording.
+    expect(report['sent']).to eq 4
+    expect(report['skipped']).to eq 0
+    expect(report['lateness'].keys).to eq %w(p50_us p99_us max_us)
+    expect(report['lateness']['p50_us'] <= report['lateness']['max_us']).to eq true
+  end
+
+  it 'complains about invalid points' do
+    stdout, stderr, result = run_ticcmd('--stream -',
+      env: { 'TIC_REPLAY' => recording }, input: "0 velocity 100\n5 speed 3\n")
+    expect(stderr).to eq "Error: Invalid stream point on line 2: '5 speed 3'.\n"
+    expect(result).to eq 1
+  end
+
+  it 'rejects CPUs that cannot be in a CPU set' do
+    skip 'CPUs can only be chosen on Linux' unless RUBY_PLATFORM =~ /linux/
+    stdout, stderr, result = run_ticcmd('--stream - --stream-cpu 100000',
+      env: { 'TIC_REPLAY' => recording }, input: "0 velocity 100\n")
+    expect(stderr).to eq "Error: Invalid CPU for streaming: 100000.\n"
+    expect(result).to eq 2
+  end
+end
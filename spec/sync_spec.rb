@@ -0,0 +1,41 @@
+require_relative 'spec_helper'
+
+describe '--sync-position' do
+  let(:recording) { 'spec/recordings/t825_sync.ticrec' }
+
+  it 'sets the targets of all the axes and reports the skew' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002,00000003 ' \
+      '--sync-position 100,-200,300', env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to eq ''
+    expect(result).to eq 0
+
+    report = YAML.load(stdout)
+    expect(report.keys).to eq %w(issue_skew_us complete_skew_us issue_offset_us)
+    expect(report['issue_offset_us'].keys).to eq %w(00000001 00000002 00000003)
+    offsets = report['issue_offset_us'].values
+    expect(offsets.min).to eq 0
+    expect(offsets.max).to eq report['issue_skew_us']
+  end
+
+  it 'reports which axis got the wrong command' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002,00000003 ' \
+      '--sync-position 100,-200,301', env: { 'TIC_REPLAY' => recording })
+    expect(stderr).to include 'There was an error sending a command to axis 2.'
+    expect(result).to eq 2
+  end
+
+  it 'needs one position per axis' do
+    stdout, stderr, result = run_ticcmd('--axes 00000001,00000002 ' \
+      '--sync-position 5')
+    expect(stderr).to eq "Error: The --sync-position option needs one " \
+      "position for each of the --axes.\n"
+    expect(result).to eq 1
+  end
+
+  it 'needs --axes' do
+    stdout, stderr, result = run_ticcmd('--sync-halt')
+    expect(stderr).to eq "Error: The --sync-position and --sync-halt " \
+      "options require --axes.\n"
+    expect(result).to eq 1
+  end
+end
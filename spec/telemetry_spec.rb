@@ -0,0 +1,27 @@
+require_relative 'spec_helper'
+
+TelemetryOutput = <<END
+found: 1
+found other: 0
+count: 70
+latest position: 500
+oldest position: 500
+sample 5: Telemetry sample 5 is not available.
+sample 70: Telemetry sample 70 is not available.
+second publisher: There was an error starting to publish telemetry.  Telemetry for this device is already being published.
+END
+
+describe 'telemetry' do
+  it 'can publish and read variables in shared memory' do
+    if Gem.win_platform?
+      skip 'Telemetry is not supported on Windows.'
+    end
+
+    # The C++ side publishes more samples than fit in the history and checks
+    # which ones can still be read.
+    stdout, stderr, code = run_ticcmd('--test 4')
+    expect(stderr).to eq ''
+    expect(stdout).to eq TelemetryOutput
+    expect(code).to eq 0
+  end
+end
@@ -0,0 +1,27 @@
+require_relative 'spec_helper'
+require 'json'
+require 'tmpdir'
+
+describe 'TIC_TRACE' do
+  it 'writes a timeline of library calls when the program exits' do
+    Dir.mktmpdir do |dir|
+      trace_file = File.join(dir, 'trace.json')
+      output_file = File.join(dir, 'settings.txt')
+      stdout, stderr, result = run_ticcmd(
+        "--fix-settings spec/default_settings/t825.txt #{output_file}",
+        env: { 'TIC_TRACE' => trace_file })
+      expect(stderr).to eq ''
+      expect(stdout).to eq ''
+      expect(result).to eq 0
+
+      trace = JSON.parse(File.read(trace_file))
+      names = trace['traceEvents'].select { |e| e['ph'] == 'X' }.map { |e| e['name'] }
+      expect(names).to eq %w(
+        tic_settings_read_from_string tic_settings_fix tic_settings_to_string)
+      trace['traceEvents'].select { |e| e['ph'] == 'X' }.each do |event|
+        expect(event['cat']).to eq 'api'
+        expect(event['dur'] >= 0).to eq true
+      end
+    end
+  end
+end